@@ -117,14 +117,26 @@ typedef union savefpu {
     savexmm sv_xmm;
 } savefpu;
 
-/// @brief Called during a context switch to save the FPU registers status
-/// of the currently running thread.
+/// @brief Called when entering the kernel, makes the FPU trap so that the
+/// registers of the interrupted task are saved only if someone else needs them.
 void switch_fpu(void);
 
-/// @brief Called during a context switch to load the FPU registers status
-/// of the currently running thread inside the FPU.
+/// @brief Called when returning to user mode, lets the FPU run without
+/// trapping if its registers belong to the task that is about to run.
 void unswitch_fpu(void);
 
+struct task_struct;
+
+/// @brief Writes the FPU registers of the task back into its thread, if they
+/// are still loaded in the FPU (e.g., before copying the thread).
+/// @param task the task.
+void fpu_save_task(struct task_struct *task);
+
+/// @brief Forgets that the FPU registers belong to the task, which is exiting
+/// or replacing its image.
+/// @param task the task.
+void fpu_release_task(struct task_struct *task);
+
 /// @brief Enable the FPU context handling.
 /// @return 0 if fails, 1 if succeed.
 int fpu_install(void);
@@ -11,6 +11,7 @@
 #pragma once
 
 #include "kernel.h"
+#include "process/wait.h"
 #include "ring_buffer.h"
 
 DECLARE_FIXED_SIZE_RING_BUFFER(int, keybuffer, 256, -1)
@@ -40,6 +41,14 @@ int keyboard_peek_back(void);
 /// @return The read character.
 int keyboard_peek_front(void);
 
+/// @brief Puts the current process to sleep until a key is pressed, or a
+/// signal arrives.
+/// @return the entry added to the wait queue, NULL on failure.
+wait_queue_entry_t *keyboard_sleep_on(void);
+
+/// @brief Wakes up the processes waiting for a key to be pressed.
+void keyboard_wake_up(void);
+
 /// @brief Initializes the keyboard drivers.
 /// @return 0 on success, 1 on error.
 int keyboard_initialize(void);
@@ -62,6 +62,16 @@
 
 /// @}
 
+/// @defgroup header_segment_flags Program Header Segment Flags
+/// @brief Permissions of a loadable segment.
+/// @{
+
+#define PF_X 0x1 ///< The segment is executable.
+#define PF_W 0x2 ///< The segment is writable.
+#define PF_R 0x4 ///< The segment is readable.
+
+/// @}
+
 /// Elf header ident size.
 #define EI_NIDENT 16
 
@@ -248,6 +258,10 @@ enum StT_Types {
 };
 
 /// @brief Loads an ELF file into the memory of task.
+/// @details Loadable segments are not read here: they are mapped privately
+/// from the file, and each page is read on its first access. Pages which are
+/// never written keep the frame of the page cache, and are therefore shared by
+/// every process running the same executable.
 /// @param task  The task for which we load the ELF.
 /// @param file  The ELF file.
 /// @param entry The ELF binary entry.
@@ -0,0 +1,76 @@
+/// @file bcache.h
+/// @brief Block buffer cache shared by block-based filesystems.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+/// @details The buffer cache sits between a filesystem (e.g., EXT2) and the
+/// block device it is mounted on. Blocks are indexed by (device, block index)
+/// through a hash table and evicted in Least Recently Used (LRU) order. Writes
+/// are kept in memory and marked dirty, they reach the device when the buffer
+/// is evicted or when the cache is synchronized (see `sys_sync`).
+
+#pragma once
+
+#include "fs/vfs_types.h"
+#include "stdint.h"
+
+/// @brief Statistics collected by the buffer cache.
+typedef struct bcache_stats {
+    /// Number of lookups served from memory.
+    unsigned long hits;
+    /// Number of lookups that required a device access.
+    unsigned long misses;
+    /// Number of buffers recycled to make room for other blocks.
+    unsigned long evictions;
+    /// Number of dirty buffers written back to the device.
+    unsigned long writebacks;
+    /// Number of buffers currently cached.
+    unsigned long buffers;
+    /// Number of buffers currently dirty.
+    unsigned long dirty;
+} bcache_stats_t;
+
+/// @brief Initializes the buffer cache.
+/// @return 0 on success, -1 on failure.
+int bcache_initialize(void);
+
+/// @brief Reads a block, serving it from memory when possible.
+/// @param device the block device.
+/// @param block_index the index of the block on the device.
+/// @param block_size the size of a block, in bytes.
+/// @param buffer the buffer where the content of the block is copied.
+/// @return the amount of data we read, or negative value for an error.
+ssize_t bcache_read(vfs_file_t *device, uint32_t block_index, uint32_t block_size, void *buffer);
+
+/// @brief Reads consecutive blocks, serving them from memory when possible.
+/// @details Runs of blocks that are not cached are read from the device with a
+/// single request each, and are not added to the cache: this is meant for
+/// callers that keep the data themselves (e.g., the page cache).
+/// @param device the block device.
+/// @param block_index the index of the first block on the device.
+/// @param count the number of blocks.
+/// @param block_size the size of a block, in bytes.
+/// @param buffer the buffer where the content of the blocks is copied.
+/// @return the amount of data we read, or negative value for an error.
+ssize_t bcache_read_range(vfs_file_t *device, uint32_t block_index, uint32_t count, uint32_t block_size, void *buffer);
+
+/// @brief Writes a block into the cache and marks it dirty.
+/// @param device the block device.
+/// @param block_index the index of the block on the device.
+/// @param block_size the size of a block, in bytes.
+/// @param buffer the buffer containing the new content of the block.
+/// @return the amount of data we wrote, or negative value for an error.
+ssize_t bcache_write(vfs_file_t *device, uint32_t block_index, uint32_t block_size, const void *buffer);
+
+/// @brief Writes back all the dirty buffers belonging to the given device.
+/// @param device the block device, or NULL to synchronize every device.
+/// @return 0 on success, -1 if at least one write-back failed.
+int bcache_sync(vfs_file_t *device);
+
+/// @brief Writes back and drops all the buffers belonging to the given device.
+/// @param device the block device, or NULL to drop every buffer.
+/// @return 0 on success, -1 if at least one write-back failed.
+int bcache_invalidate(vfs_file_t *device);
+
+/// @brief Retrieves a snapshot of the buffer cache statistics.
+/// @param stats where the statistics are copied.
+void bcache_get_stats(bcache_stats_t *stats);
@@ -0,0 +1,76 @@
+/// @file dcache.h
+/// @brief Directory entry cache used during path resolution.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+/// @details The cache remembers the outcome of looking up a name inside a
+/// directory, indexed by (filesystem, parent inode, name). Names that do not
+/// exist are cached as negative entries, so that repeated failed lookups (e.g.,
+/// searching a command through `PATH`) do not scan the directory again. The
+/// filesystem is in charge of dropping entries whenever a directory changes.
+
+#pragma once
+
+#include "stddef.h"
+#include "stdint.h"
+
+/// @brief The content of a cached directory entry.
+typedef struct dcache_entry {
+    /// The inode the entry points to, 0 for negative entries.
+    ino_t ino;
+    /// The type of the entry, as stored by the filesystem.
+    uint32_t type;
+    /// Filesystem-specific data (e.g., where the entry is stored on disk).
+    uint32_t data[3];
+} dcache_entry_t;
+
+/// @brief Statistics collected by the directory entry cache.
+typedef struct dcache_stats {
+    /// Number of lookups served from the cache.
+    unsigned long hits;
+    /// Number of lookups served from the cache with a negative entry.
+    unsigned long negative_hits;
+    /// Number of lookups not found in the cache.
+    unsigned long misses;
+    /// Number of entries recycled to make room for other entries.
+    unsigned long evictions;
+    /// Number of entries currently cached.
+    unsigned long entries;
+} dcache_stats_t;
+
+/// @brief Initializes the directory entry cache.
+/// @return 0 on success, -1 on failure.
+int dcache_initialize(void);
+
+/// @brief Searches the entry `name` inside the directory `parent`.
+/// @param fs the filesystem instance the directory belongs to.
+/// @param parent the inode of the directory.
+/// @param name the name of the entry.
+/// @param entry where the cached entry is copied, its inode is 0 for negative entries.
+/// @return 1 if the entry is cached, 0 otherwise.
+int dcache_lookup(const void *fs, ino_t parent, const char *name, dcache_entry_t *entry);
+
+/// @brief Adds the entry `name` of the directory `parent` to the cache.
+/// @param fs the filesystem instance the directory belongs to.
+/// @param parent the inode of the directory.
+/// @param name the name of the entry.
+/// @param entry the content of the entry, NULL to cache a negative entry.
+void dcache_add(const void *fs, ino_t parent, const char *name, const dcache_entry_t *entry);
+
+/// @brief Drops the entry `name` of the directory `parent` from the cache.
+/// @param fs the filesystem instance the directory belongs to.
+/// @param parent the inode of the directory.
+/// @param name the name of the entry.
+void dcache_remove(const void *fs, ino_t parent, const char *name);
+
+/// @brief Drops all the entries of the directory `ino`, and those pointing to it.
+/// @param fs the filesystem instance the directory belongs to.
+/// @param ino the inode of the directory.
+void dcache_remove_dir(const void *fs, ino_t ino);
+
+/// @brief Drops all the entries belonging to the filesystem.
+/// @param fs the filesystem instance, or NULL to drop every entry.
+void dcache_purge(const void *fs);
+
+/// @brief Retrieves a snapshot of the directory entry cache statistics.
+/// @param stats where the statistics are copied.
+void dcache_get_stats(dcache_stats_t *stats);
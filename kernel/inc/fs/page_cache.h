@@ -0,0 +1,94 @@
+/// @file page_cache.h
+/// @brief Page cache holding the content of regular files.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+/// @details Pages are indexed by (filesystem, inode, page index inside the
+/// file) and evicted in Least Recently Used (LRU) order. The cache does not
+/// know how to read a file: the filesystem fills the pages it allocates, and
+/// keeps them up to date by forwarding its writes (see `page_cache_write`).
+/// Pages whose frame is mapped by a process (see `vfs_getpage`) hold an extra
+/// reference on the frame, and they are never recycled.
+
+#pragma once
+
+#include "list_head.h"
+#include "stddef.h"
+#include "stdint.h"
+
+/// @brief A cached page of file data.
+typedef struct page_cache_page {
+    /// The filesystem instance.
+    const void *fs;
+    /// The inode of the file.
+    ino_t ino;
+    /// The index of the page inside the file.
+    uint32_t index;
+    /// The content of the page.
+    uint8_t *data;
+    /// Link inside the hash bucket.
+    list_head_t hash_link;
+    /// Link inside the LRU list.
+    list_head_t lru_link;
+} page_cache_page_t;
+
+/// @brief Statistics collected by the page cache.
+typedef struct page_cache_stats {
+    /// Number of lookups served from memory.
+    unsigned long hits;
+    /// Number of lookups that required reading the file.
+    unsigned long misses;
+    /// Number of pages filled ahead of the reader.
+    unsigned long readahead;
+    /// Number of pages recycled to make room for other pages.
+    unsigned long evictions;
+    /// Number of pages currently cached.
+    unsigned long pages;
+} page_cache_stats_t;
+
+/// @brief Initializes the page cache.
+/// @return 0 on success, -1 on failure.
+int page_cache_initialize(void);
+
+/// @brief Searches a page inside the cache.
+/// @param fs the filesystem instance.
+/// @param ino the inode of the file.
+/// @param index the index of the page inside the file.
+/// @return the page if cached, NULL otherwise.
+page_cache_page_t *page_cache_lookup(const void *fs, ino_t ino, uint32_t index);
+
+/// @brief Checks if a page is cached, without counting it as an access.
+/// @param fs the filesystem instance.
+/// @param ino the inode of the file.
+/// @param index the index of the page inside the file.
+/// @return 1 if the page is cached, 0 otherwise.
+int page_cache_contains(const void *fs, ino_t ino, uint32_t index);
+
+/// @brief Provides a page for the given file offset, recycling the least
+/// recently used one if the cache is full. The content must be filled by the caller.
+/// @param fs the filesystem instance.
+/// @param ino the inode of the file.
+/// @param index the index of the page inside the file.
+/// @param readahead if the page is filled ahead of the reader.
+/// @return the page, or NULL on failure.
+page_cache_page_t *page_cache_alloc(const void *fs, ino_t ino, uint32_t index, int readahead);
+
+/// @brief Removes a page from the cache, e.g., when it could not be filled.
+/// @param page the page.
+void page_cache_remove(page_cache_page_t *page);
+
+/// @brief Copies written data into the cached pages of the file.
+/// @param fs the filesystem instance.
+/// @param ino the inode of the file.
+/// @param offset the offset inside the file where the data was written.
+/// @param buffer the written data.
+/// @param size the amount of written data.
+void page_cache_write(const void *fs, ino_t ino, uint32_t offset, const void *buffer, size_t size);
+
+/// @brief Drops all the cached pages of the file.
+/// @param fs the filesystem instance.
+/// @param ino the inode of the file.
+void page_cache_invalidate(const void *fs, ino_t ino);
+
+/// @brief Retrieves a snapshot of the page cache statistics.
+/// @param stats where the statistics are copied.
+void page_cache_get_stats(page_cache_stats_t *stats);
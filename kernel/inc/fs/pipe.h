@@ -6,23 +6,33 @@
 #pragma once
 
 #include "klib/mutex.h"
+#include "mem/mm/page.h"
+#include "mem/paging.h"
 #include "process/process.h"
 #include "process/wait.h"
 
 /// @brief This constant specifies the size of the buffer allocated for each
 /// pipe, and its value can affect the performance and capacity of pipes.
-// #define PIPE_BUFFER_SIZE PAGE_SIZE
-#define PIPE_BUFFER_SIZE 64
+#define PIPE_BUFFER_SIZE PAGE_SIZE
 
-/// @brief The number of buffers.
-#define PIPE_NUM_BUFFERS 5
+/// @brief The default number of buffers, which can be changed with
+/// `fcntl(F_SETPIPE_SZ)`.
+#define PIPE_NUM_BUFFERS 16
+
+/// @brief The largest capacity, in bytes, an unprivileged user can give to a
+/// pipe.
+#define PIPE_MAX_SIZE (1024UL * 1024UL)
+
+/// @brief The page of the buffer has been gifted by the writer, it is shared
+/// with the address space of the writer, and it must not be written.
+#define PIPE_BUF_FLAG_GIFT 0x01
 
 /// @brief Represents a single buffer within a pipe. This structure manages the
 /// data stored in the buffer, including its memory location, size, usage count,
 /// and associated operations.
 typedef struct pipe_buffer {
-    /// @brief The buffer's data.
-    char data[PIPE_BUFFER_SIZE];
+    /// @brief The page holding the buffer's data, NULL if the buffer is unused.
+    page_t *page;
 
     /// @brief Offset within the memory page where the buffer's data begins.
     /// This allows for partial usage of the page if the buffer does not occupy
@@ -34,6 +44,9 @@ typedef struct pipe_buffer {
     /// write operations.
     size_t len;
 
+    /// @brief Flags of the buffer (e.g., PIPE_BUF_FLAG_GIFT).
+    unsigned int flags;
+
     /// @brief Pointer to a set of operations that can be performed on the
     /// buffer. These operations include functions for getting, releasing, and
     /// mapping the buffer, tailored to the specific needs of the buffer's data
@@ -46,19 +59,22 @@ typedef struct pipe_buffer {
 /// information about the buffer used for the pipe, the readers and writers, and
 /// synchronization details.
 typedef struct pipe_inode_info {
-    /// @brief Array of pipe buffers. Each buffer holds a portion of data for
-    /// the pipe. For the time beeing I'm setting a fixed number of buffers.
-    pipe_buffer_t bufs[PIPE_NUM_BUFFERS];
+    /// @brief Ring of pipe buffers. Each buffer holds a page of data for the
+    /// pipe.
+    pipe_buffer_t *bufs;
 
     /// @brief Number of buffers allocated for the pipe. This value determines
     /// the size of the `bufs` array and how many buffers are available for use.
     size_t numbuf;
 
-    /// @brief Index for reading.
-    size_t read_index;
+    /// @brief Index of the first buffer holding data, the next to be read.
+    size_t curbuf;
+
+    /// @brief Number of buffers holding data, starting from `curbuf`.
+    size_t nrbufs;
 
-    /// @brief Index for writing.
-    size_t write_index;
+    /// @brief A page left by a drained buffer, kept to fill the next one.
+    page_t *spare_page;
 
     /// @brief The number of processes currently reading from the pipe.
     size_t readers;
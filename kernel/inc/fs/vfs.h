@@ -109,6 +109,12 @@ ssize_t vfs_read(vfs_file_t *file, void *buf, size_t offset, size_t nbytes);
 /// @return The number of written characters.
 ssize_t vfs_write(vfs_file_t *file, const void *buf, size_t offset, size_t nbytes);
 
+/// @brief Retrieves the cached page of a file, holding a reference on it.
+/// @param file  The file structure used to reference a file.
+/// @param index The index of the page inside the file.
+/// @return The page, or NULL if the file is not cached in pages.
+struct page *vfs_getpage(vfs_file_t *file, uint32_t index);
+
 /// @brief Repositions the file offset inside a file.
 /// @param file   The file for which we reposition the offest.
 /// @param offset The offest to use for the operation.
@@ -87,6 +87,9 @@ typedef struct vfs_file_operations {
     ssize_t (*readlink_f)(const char *, char *, size_t);
     /// Modifies the attributes of an open file.
     int (*setattr_f)(struct vfs_file *, struct iattr *);
+    /// Provides the cached page of a file at the given page index, holding a
+    /// reference on it (used by file mappings).
+    struct page *(*getpage_f)(struct vfs_file *, uint32_t);
 } vfs_file_operations_t;
 
 /// @brief Data structure that contains information about the mounted filesystems.
@@ -125,6 +128,10 @@ typedef struct vfs_file {
     vfs_file_operations_t *fs_operations;
     /// Offset for read operations.
     size_t f_pos;
+    /// Read-ahead: the offset where a sequential read is expected to continue.
+    uint32_t ra_offset;
+    /// Read-ahead: the number of pages to read ahead of a sequential reader.
+    uint32_t ra_pages;
     /// The number of links.
     uint32_t nlink;
     /// List to hold all active files associated with a specific entry in a filesystem.
@@ -145,6 +152,8 @@ typedef struct super_block {
     file_system_type_t *type;
     /// List to hold all active mounting points.
     list_head_t mounts;
+    /// Link inside the hash table of mounting points, indexed by path.
+    list_head_t hash;
 } super_block_t;
 
 /// @brief Data structure containing information about an open file.
@@ -27,6 +27,10 @@ struct ipc_perm register_ipc(key_t key, mode_t mode);
 /// @return 0 on success, 1 on failure.
 int sem_init(void);
 
+/// @brief Reverts the SEM_UNDO operations of an exiting process.
+/// @param pid the process.
+void sem_exit(pid_t pid);
+
 /// @brief Initializes the shared memory system.
 /// @return 0 on success, 1 on failure.
 int shm_init(void);
@@ -56,6 +56,12 @@ void *rbtree_node_get_value(rbtree_node_t *node);
 /// @param node The node to destroy.
 void rbtree_node_dealloc(rbtree_node_t *node);
 
+/// @brief Provides access to the children of a node.
+/// @param node The node itself.
+/// @param dir  Which child (0: left, 1: right).
+/// @return The child, NULL if there is none.
+rbtree_node_t *rbtree_node_get_child(rbtree_node_t *node, int dir);
+
 // ============================================================================
 // Tree management functions.
 
@@ -74,6 +80,24 @@ rbtree_t *rbtree_tree_create(rbtree_tree_node_cmp_f node_cb);
 /// @return Pointer to tree itself.
 rbtree_t *rbtree_tree_init(rbtree_t *tree, rbtree_tree_node_cmp_f node_cb);
 
+/// @brief Sets the callback which recomputes the data a node keeps about its
+/// subtree (e.g., the maximum of some property), making the tree augmented.
+/// @param tree       The tree.
+/// @param augment_cb The callback, it is called on a node only after its
+/// children are up to date.
+void rbtree_tree_set_augment(rbtree_t *tree, rbtree_tree_node_f augment_cb);
+
+/// @brief Returns the root of the tree.
+/// @param tree The tree.
+/// @return The root node, NULL if the tree is empty.
+rbtree_node_t *rbtree_tree_get_root(rbtree_t *tree);
+
+/// @brief Recomputes the augmented data of the node holding the given value,
+/// and of its ancestors, after something it depends on has changed.
+/// @param tree  The tree.
+/// @param value The value whose node must be updated.
+void rbtree_tree_update(rbtree_t *tree, void *value);
+
 /// @brief Deallocate a node.
 /// @param tree    The tree to destroy.
 /// @param node_cb The function called on each element of the tree before destroying the tree.
@@ -14,6 +14,10 @@
 /// DMA zone needs to fit between 1MB-kernel_start (~10MB), so max 8MB works.
 #define MAX_BUDDYSYSTEM_GFP_ORDER 12
 
+/// @brief Number of orders, starting from zero, whose free blocks are cached in
+/// front of the free lists.
+#define BB_CACHE_ORDERS 2
+
 /// @brief Provide the offset of the element inside the given type of page.
 #define BBSTRUCT_OFFSET(page, element) ((uint32_t) & (((page *)NULL)->element))
 
@@ -45,6 +49,16 @@ typedef struct bb_free_area {
     int nr_free;
 } bb_free_area_t;
 
+/// @brief Cache of free blocks of a given order, kept out of the free lists so
+/// that they can be handed out without splitting and merging.
+typedef struct bb_cache {
+    /// Cached blocks, the recently freed (hot) ones first, the ones taken from
+    /// the free lists (cold) last.
+    list_head_t blocks;
+    /// Number of blocks in the cache.
+    unsigned long count;
+} bb_cache_t;
+
 /// @brief Buddy system instance,
 /// that represents a memory area managed by the buddy system
 typedef struct bb_instance {
@@ -52,10 +66,8 @@ typedef struct bb_instance {
     const char *name;
     /// List of buddy system pages grouped by level.
     bb_free_area_t free_area[MAX_BUDDYSYSTEM_GFP_ORDER];
-    /// Pointer to start of free pages cache
-    list_head_t free_pages_cache_list;
-    /// Size of the current cache
-    unsigned long free_pages_cache_size;
+    /// Caches of free blocks for the lowest orders.
+    bb_cache_t cache[BB_CACHE_ORDERS];
     /// Buddysystem instance size in number of pages.
     unsigned long total_pages;
     /// Address of the first managed page
@@ -77,15 +89,27 @@ bb_page_t *bb_alloc_pages(bb_instance_t *instance, unsigned int order);
 /// @param page     The address of the first page descriptor of the block.
 void bb_free_pages(bb_instance_t *instance, bb_page_t *page);
 
-/// @brief Alloc a page using bb cache.
-/// @param instance Buddy system instance.
-/// @return An allocated page.
-bb_page_t *bb_alloc_page_cached(bb_instance_t *instance);
+/// @brief Shrinks an allocated block of page frames to its first pages.
+/// @details The kept pages are split into aligned blocks, each one with its
+/// own order, which must be freed one by one. The remaining pages are given
+/// back to the free lists.
+/// @param instance A buddy system instance.
+/// @param page     The address of the first page descriptor of the block.
+/// @param count    The number of pages to keep, at most the size of the block.
+void bb_trim_pages(bb_instance_t *instance, bb_page_t *page, unsigned int count);
 
-/// @brief Free a page allocated with bb_alloc_page_cached.
-/// @param instance Buddy system instance.
+/// @brief Allocate a block of page frames of size 2^order, using the cache of
+/// free blocks for the lowest orders.
+/// @param instance A buddy system instance.
+/// @param order    The logarithm of the size of the block.
+/// @return The address of the first page descriptor of the block, or NULL.
+bb_page_t *bb_alloc_pages_cached(bb_instance_t *instance, unsigned int order);
+
+/// @brief Free a block of page frames, keeping it in the cache of free blocks
+/// if its order has one.
+/// @param instance A buddy system instance.
 /// @param page     The address of the first page descriptor of the block.
-void bb_free_page_cached(bb_instance_t *instance, bb_page_t *page);
+void bb_free_pages_cached(bb_instance_t *instance, bb_page_t *page);
 
 /// @brief Initialize Buddy System.
 /// @param instance      A buddysystem instance.
@@ -117,6 +141,7 @@ int buddy_system_to_string(const bb_instance_t *instance, char *buffer, size_t b
 unsigned long buddy_system_get_total_space(const bb_instance_t *instance);
 
 /// @brief Returns the free space for the given instance.
+/// @details Cached blocks are free, they are counted too.
 /// @param instance A buddy system instance.
 /// @return The requested total sapce.
 unsigned long buddy_system_get_free_space(const bb_instance_t *instance);
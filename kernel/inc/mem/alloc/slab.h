@@ -19,6 +19,9 @@ typedef void (*kmem_fun_t)(void *);
 /// Create a new cache.
 #define KMEM_CREATE(objtype) kmem_cache_create(#objtype, sizeof(objtype), alignof(objtype), GFP_KERNEL, NULL, NULL)
 
+/// Number of recently freed objects each cache keeps at hand, in front of its slabs.
+#define KMEM_MAGAZINE_SIZE 16
+
 /// Creates a new cache and allows to specify the constructor.
 #define KMEM_CREATE_CTOR(objtype, ctor)                                                                                \
     kmem_cache_create(#objtype, sizeof(objtype), alignof(objtype), GFP_KERNEL, (kmem_fun_t)(ctor), NULL)
@@ -53,8 +56,33 @@ typedef struct kmem_cache {
     list_head_t slabs_partial;
     /// List of completely free slabs.
     list_head_t slabs_free;
+    /// Stack of free objects, served before touching the slab lists. These
+    /// objects are still counted in `free_num`.
+    void *magazine[KMEM_MAGAZINE_SIZE];
+    /// Number of objects inside the magazine.
+    unsigned int magazine_count;
+    /// Allocations served by the magazine.
+    unsigned long alloc_hits;
+    /// Allocations which had to take objects from the slabs.
+    unsigned long alloc_misses;
+    /// Frees which found room inside the magazine.
+    unsigned long free_hits;
+    /// Frees which had to drain the magazine back into the slabs.
+    unsigned long free_misses;
+    /// Bytes asked by the kmalloc requests served by this cache, since its creation.
+    unsigned long requested_bytes;
 } kmem_cache_t;
 
+/// @brief Statistics about the kmalloc requests too big for the slab caches.
+typedef struct kmalloc_stats {
+    /// Number of allocated objects.
+    unsigned long large_objects;
+    /// Number of pages they use.
+    unsigned long large_pages;
+    /// Bytes of those pages past the end of the objects.
+    unsigned long large_wasted;
+} kmalloc_stats_t;
+
 /// @brief Initializes the kernel memory cache system.
 /// @details This function initializes the global cache list and creates the
 /// main cache for managing kmem_cache_t structures. It also creates caches for
@@ -91,6 +119,11 @@ kmem_cache_t *kmem_cache_create(
 /// @return Returns 0 on success, or -1 if an error occurs.
 int kmem_cache_destroy(kmem_cache_t *cachep);
 
+/// @brief Iterates over the existing caches.
+/// @param cachep The current cache, or NULL to get the first one.
+/// @return The cache following the given one, or NULL if there are no more.
+kmem_cache_t *kmem_cache_next(kmem_cache_t *cachep);
+
 /// @brief Allocs a new object using the provided cache.
 /// @param file   File where the object is allocated.
 /// @param fun    Function where the object is allocated.
@@ -123,6 +156,10 @@ void *pr_kmalloc(const char *file, const char *fun, int line, unsigned int size)
 /// @param ptr The pointer to the allocated memory.
 void pr_kfree(const char *file, const char *fun, int line, void *ptr);
 
+/// @brief Returns the statistics about the large kmalloc requests.
+/// @param stats Where the statistics are copied.
+void kmalloc_get_stats(kmalloc_stats_t *stats);
+
 /// Wrapper that provides the filename, the function and line where the alloc is happening.
 #define kmem_cache_alloc(...) pr_kmem_cache_alloc(__RELATIVE_PATH__, __func__, __LINE__, __VA_ARGS__)
 
@@ -35,6 +35,25 @@ enum zone_type {
     __MAX_NR_ZONES
 };
 
+/// @brief Maximum number of zeroed page frames kept by each zone.
+#define ZERO_POOL_SIZE 32
+
+/// @brief Number of page frames zeroed by each deferred refill.
+#define ZERO_POOL_BATCH 4
+
+/// @brief Page frames taken from the buddy system and filled with zeros in
+/// advance, handed out to the __GFP_ZERO allocations of a single page.
+typedef struct zero_pool {
+    /// The zeroed pages, linked through their buddy cache pointer.
+    list_head_t pages;
+    /// Number of pages in the pool.
+    unsigned long count;
+    /// Zeroed allocations served by the pool.
+    unsigned long hits;
+    /// Zeroed allocations cleared on the spot.
+    unsigned long misses;
+} zero_pool_t;
+
 /// @brief Data structure to differentiate memory zone.
 typedef struct zone {
     /// Zone's name.
@@ -51,6 +70,8 @@ typedef struct zone {
     size_t total_size;
     /// Buddy system managing this zone
     bb_instance_t buddy_system;
+    /// Pages already filled with zeros, they count as free.
+    zero_pool_t zero_pool;
 } zone_t;
 
 /// @brief Data structure to rapresent a memory node. In Uniform memory access
@@ -159,6 +180,20 @@ uint32_t alloc_pages_lowmem(gfp_t gfp_mask, uint32_t order);
 /// @return Returns 0 on success, or -1 if an error occurs.
 int free_pages_lowmem(uint32_t vaddr);
 
+/// @brief Allocates exactly the given number of contiguous page frames.
+/// @details A block of 2^order pages is taken from the buddy system, and the
+/// pages past the requested ones are given back.
+/// @param gfp_mask GFP_FLAGS to decide the zone allocation.
+/// @param count    The number of pages.
+/// @return The first page of the block, or NULL if allocation fails.
+page_t *alloc_pages_exact(gfp_t gfp_mask, uint32_t count);
+
+/// @brief Frees page frames allocated with alloc_pages_exact.
+/// @param page  The first page of the block.
+/// @param count The number of pages, the same given to alloc_pages_exact.
+/// @return Returns 0 on success, or -1 if an error occurs.
+int free_pages_exact(page_t *page, uint32_t count);
+
 /// @brief Retrieves the total space of the zone corresponding to the given GFP mask.
 /// @param gfp_mask The GFP mask specifying the allocation constraints.
 /// @return The total space of the zone, or 0 if the zone cannot be retrieved.
@@ -174,6 +209,19 @@ unsigned long get_zone_free_space(gfp_t gfp_mask);
 /// @return The cached space of the zone, or 0 if the zone cannot be retrieved.
 unsigned long get_zone_cached_space(gfp_t gfp_mask);
 
+/// @brief Retrieves the pool of zeroed pages of the zone corresponding to the given GFP mask.
+/// @param gfp_mask The GFP mask specifying the allocation constraints.
+/// @return The pool, or NULL if the zone cannot be retrieved.
+const zero_pool_t *get_zone_zero_pool(gfp_t gfp_mask);
+
+/// @brief Zeroes free pages in advance, for the zones that have been asked
+/// for zeroed pages, until their pools are full.
+/// @details It must not run while an allocation is in progress, so it is
+/// called when the timer interrupts user mode.
+/// @param budget The maximum number of pages to zero.
+/// @return The number of pages added to the pools.
+unsigned zone_zero_pool_refill(unsigned budget);
+
 /// @brief Retrieves the buddy system status for the zone associated with the given GFP mask.
 /// @param gfp_mask The GFP mask specifying the memory zone (e.g., GFP_KERNEL, GFP_HIGHUSER).
 /// @param buffer A pointer to the buffer where the formatted status string will be written.
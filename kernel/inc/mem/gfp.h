@@ -92,6 +92,16 @@ typedef unsigned int gfp_t;
 
 /// @}
 
+/// @defgroup ActionModifiers Action Modifiers
+/// @brief Change what is done with the allocated memory.
+/// @{
+
+/// @brief Returns the pages filled with zeros. Single pages are served from a
+/// pool of frames zeroed in advance, the others are cleared on the spot.
+#define __GFP_ZERO ___GFP_ZERO
+
+/// @}
+
 /// @defgroup gfp_flag_combinations Flag Combinations
 /// @brief Useful GFP flag combinations.
 /// @details
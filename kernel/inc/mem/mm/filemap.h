@@ -0,0 +1,26 @@
+/// @file filemap.h
+/// @brief File-backed memory mappings.
+/// @copyright (c) 2014-2025 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+/// @details The pages of a file mapping are not read when the mapping is
+/// created, but on the first access to each of them. When the filesystem keeps
+/// the file in the page cache, the frame of the cache is mapped directly:
+/// shared mappings write straight into it, while private mappings map it
+/// read-only and copy it on the first write.
+
+#pragma once
+
+#include "mem/mm/vm_area.h"
+
+/// @brief Populates the page of a file mapping containing the given address.
+/// @param area the file-backed virtual memory area.
+/// @param addr the faulting address.
+/// @return 0 on success, -1 on failure.
+int filemap_fault(vm_area_struct_t *area, uint32_t addr);
+
+/// @brief Writes back to the file the dirty pages of a shared file mapping.
+/// @param area the file-backed virtual memory area.
+/// @param start the start of the range to synchronize.
+/// @param end the end of the range to synchronize (exclusive).
+/// @return 0 on success, -1 if at least one page could not be written.
+int filemap_sync(vm_area_struct_t *area, uint32_t start, uint32_t end);
@@ -5,13 +5,16 @@
 
 #pragma once
 
+#include "klib/rbtree.h"
 #include "list_head.h"
 #include "stdint.h"
 
 /// @brief Memory Descriptor, used to store details about the memory of a user process.
 typedef struct mm_struct {
-    /// List of memory areas (vm_area_struct references).
+    /// List of memory areas (vm_area_struct references), sorted by address.
     list_head_t mmap_list;
+    /// Index of the memory areas, sorted by address.
+    rbtree_t *mm_rb;
     /// Pointer to the last used memory area.
     struct vm_area_struct *mmap_cache;
     /// Pointer to the process's page directory.
@@ -42,7 +45,8 @@ typedef struct mm_struct {
     uint32_t env_start;
     /// End address of the environment variables.
     uint32_t env_end;
-    /// Total number of mapped pages.
+    /// Total number of mapped pages, including the ones which are not backed
+    /// by a frame yet (see mm_get_rss for the resident ones).
     unsigned int total_vm;
 } mm_struct_t;
 
@@ -64,6 +68,13 @@ mm_struct_t *mm_create_blank(size_t stack_size);
 /// @return The Memory Descriptor created.
 mm_struct_t *mm_clone(mm_struct_t *mmp);
 
+/// @brief Counts the pages of the address space which are backed by a frame,
+/// i.e., the Resident Set Size. Demand-zero and not yet read file pages are
+/// part of total_vm, but not of the RSS.
+/// @param mm The Memory Descriptor.
+/// @return the number of resident pages.
+unsigned int mm_get_rss(mm_struct_t *mm);
+
 /// @brief Free Memory Descriptor with all the memory segment contained.
 /// @param mm The Memory Descriptor to free.
 /// @return Returns -1 on error, otherwise 0.
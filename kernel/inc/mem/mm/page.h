@@ -22,9 +22,11 @@ typedef struct page {
     /// @brief Contains pointers to the slabs doubly linked list of pages.
     list_head_t slabs;
     /// @brief Slab allocator variables / Contains the total number of objects
-    /// in this page, 0 if not managed by the slub.
+    /// in this page, 0 if not managed by the slub. On the first page of a
+    /// large kmalloc block, the number of pages of the block.
     unsigned int slab_objcnt;
-    /// @brief Tracks the number of free objects in the current page
+    /// @brief Tracks the number of free objects in the current page. On the
+    /// first page of a large kmalloc block, the requested size.
     unsigned int slab_objfree;
     /// @brief Holds the first free object (if slab_objfree is > 0)
     list_head_t slab_freelist;
@@ -37,12 +37,28 @@ typedef struct vm_area_struct {
     pgprot_t vm_page_prot;
     /// Flags indicating attributes of the memory area.
     unsigned short vm_flags;
+    /// The mapped file, NULL for anonymous memory.
+    struct vfs_file *vm_file;
+    /// The offset of the mapping inside the file, in pages.
+    uint32_t vm_pgoff;
+    /// Largest free gap preceding an area of the subtree rooted at this area,
+    /// inside the index of the memory descriptor.
+    uint32_t vm_rb_subtree_gap;
 } vm_area_struct_t;
 
 /// @brief Initialize the virtual memory area subsystem.
 /// @return 0 on success, -1 on error.
 int vm_area_init(void);
 
+/// @brief Initializes the index of the areas of a memory descriptor.
+/// @param mm the memory descriptor, which must have no area.
+/// @return 0 on success, -1 on error.
+int vm_area_index_init(struct mm_struct *mm);
+
+/// @brief Releases the index of the areas of a memory descriptor.
+/// @param mm the memory descriptor, whose areas must all be destroyed.
+void vm_area_index_destroy(struct mm_struct *mm);
+
 /// @brief Create a virtual memory area.
 /// @param mm The memory descriptor which will contain the new segment.
 /// @param vm_start The virtual address to map to.
@@ -67,6 +83,15 @@ uint32_t vm_area_clone(struct mm_struct *mm, vm_area_struct_t *area, int cow, ui
 /// @return 0 if the area was destroyed, or -1 if the operation failed.
 int vm_area_destroy(struct mm_struct *mm, vm_area_struct_t *area);
 
+/// @brief Moves the end of a virtual memory area.
+/// @details Pages added to the area are zero-filled on first access, while the
+/// frames of the pages removed from it are released.
+/// @param mm the memory descriptor containing the area.
+/// @param area the area to resize.
+/// @param vm_end the new end of the area, which must be page aligned.
+/// @return 0 on success, -1 if the area cannot be resized.
+int vm_area_resize(struct mm_struct *mm, vm_area_struct_t *area, uint32_t vm_end);
+
 /// @brief Checks if the given virtual memory area range is valid.
 /// @param mm the memory descriptor which we use to check the range.
 /// @param vm_start the starting address of the area.
@@ -80,7 +105,21 @@ int vm_area_is_valid(struct mm_struct *mm, uintptr_t vm_start, uintptr_t vm_end)
 /// @return a pointer to the area if we found it, NULL otherwise.
 vm_area_struct_t *vm_area_find(struct mm_struct *mm, uint32_t vm_start);
 
-/// @brief Searches for an empty spot for a new virtual memory area.
+/// @brief Searches for the virtual memory area containing the given address.
+/// @param mm the memory descriptor which should contain the area.
+/// @param addr the address.
+/// @return a pointer to the area if we found it, NULL otherwise.
+vm_area_struct_t *vm_area_lookup(struct mm_struct *mm, uint32_t addr);
+
+/// @brief Searches for the first virtual memory area ending after the given
+/// address, which either contains it or is the first one above it.
+/// @param mm the memory descriptor which should contain the area.
+/// @param addr the address.
+/// @return a pointer to the area if we found it, NULL otherwise.
+vm_area_struct_t *vm_area_lookup_next(struct mm_struct *mm, uint32_t addr);
+
+/// @brief Searches for an empty spot for a new virtual memory area, between
+/// two existing areas. The highest spot large enough is chosen.
 /// @param mm the memory descriptor which should contain the new area.
 /// @param length the size of the empty spot.
 /// @param vm_start where we save the starting address for the new area.
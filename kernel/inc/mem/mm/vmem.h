@@ -21,6 +21,17 @@ typedef struct virt_map_page {
     bb_page_t bbpage;
 } virt_map_page_t;
 
+/// @brief Fixed one-page windows, used to reach a page frame for a short time.
+/// @details Each user of a window owns it until the matching vmem_kunmap, so
+/// two frames can be reached at the same time only through different slots.
+typedef enum kmap_slot {
+    KMAP_SRC,   ///< The source of a copy, or a page being read.
+    KMAP_DST,   ///< The destination of a copy, or a page being filled.
+    KMAP_ZERO,  ///< A page being cleared by the page allocator.
+    KMAP_PIPE,  ///< A page of a pipe, being copied to a reader.
+    KMAP_SLOTS, ///< The number of windows.
+} kmap_slot_t;
+
 /// @brief Initialize the virtual memory mapper.
 /// @return Returns 0 on success, or -1 if an error occurs.
 int vmem_init(void);
@@ -54,6 +65,20 @@ int vmem_unmap_virtual_address(uint32_t addr);
 /// @return Returns 0 on success, or -1 if an error occurs.
 int vmem_unmap_virtual_address_page(virt_map_page_t *page);
 
+/// @brief Makes a single page frame reachable by the kernel.
+/// @details Lowmem frames are permanently mapped, and their address is
+/// returned as is. Highmem frames are placed in the window of the given slot,
+/// which costs a single TLB invalidation.
+/// @param page The page frame.
+/// @param slot The window to use for highmem frames.
+/// @return The virtual address of the frame.
+void *vmem_kmap(page_t *page, kmap_slot_t slot);
+
+/// @brief Releases an address returned by vmem_kmap.
+/// @param addr The address of the frame.
+/// @param slot The window given to vmem_kmap.
+void vmem_kunmap(void *addr, kmap_slot_t slot);
+
 /// @brief Memcpy from different processes virtual addresses
 /// @param dst_mm The destination memory struct
 /// @param dst_vaddr The destination memory address
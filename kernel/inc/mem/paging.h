@@ -130,6 +130,12 @@ void paging_flush_tlb_single(unsigned long addr);
 /// @return A pointer to the physical page corresponding to the virtual address, or NULL on error.
 page_t *mem_virtual_to_page(page_directory_t *pgdir, uint32_t virt_start, size_t *size);
 
+/// @brief Retrieves the page table entry mapping a virtual address.
+/// @param pgd The page directory.
+/// @param virt_addr The virtual address.
+/// @return A pointer to the entry, or NULL if the page table does not exist.
+page_table_entry_t *mem_virtual_to_pte(page_directory_t *pgd, uint32_t virt_addr);
+
 /// @brief Updates the virtual memory area in a page directory.
 /// @param pgd The page directory to update.
 /// @param virt_start The starting virtual address to update.
@@ -154,3 +160,15 @@ int mem_clone_vm_area(
     uint32_t dst_start,
     size_t size,
     uint32_t flags);
+
+/// @brief Shares a range of pages between two distinct page tables.
+/// @details Every present frame gains a reference, which is dropped when the
+/// range is destroyed. With copy-on-write, the writable pages become read-only
+/// in both page tables, and a write fault gives the writer its own copy.
+/// @param src_pgd    The source page directory.
+/// @param dst_pgd    The destination page directory.
+/// @param virt_start The virtual address of the range, in both directories.
+/// @param size       The size of the range.
+/// @param cow        If the writable pages must be copied on write.
+/// @return 0 on success, -1 on failure.
+int mem_share_vm_area(page_directory_t *src_pgd, page_directory_t *dst_pgd, uint32_t virt_start, size_t size, int cow);
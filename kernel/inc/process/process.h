@@ -9,6 +9,7 @@
 #include "devices/fpu.h"
 #include "drivers/keyboard/keyboard.h"
 #include "mem/paging.h"
+#include "process/wait.h"
 #include "stdbool.h"
 #include "system/signal.h"
 
@@ -109,6 +110,10 @@ typedef struct task_struct {
     list_head_t children;
     /// List of siblings, namely processes created by parent process.
     list_head_t sibling;
+    /// Processes waiting for a child of this process to exit or stop.
+    wait_queue_head_t wait_chldexit;
+    /// The entry of the process while it sleeps in TASK_INTERRUPTIBLE.
+    wait_queue_entry_t *wait_entry;
     /// The context of the processors.
     thread_struct_t thread;
     /// For scheduling algorithms.
@@ -157,6 +162,8 @@ typedef struct task_struct {
     termios_t termios;
     /// Buffer for managing inputs from keyboard.
     rb_keybuffer_t keyboard_rb;
+    /// Ticks at which the pending non-canonical read times out (see VTIME), 0 if none.
+    unsigned long keyboard_timeout;
 
     //==== Future work =========================================================
     // - task's attributes:
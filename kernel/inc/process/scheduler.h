@@ -22,6 +22,8 @@ typedef struct runqueue {
     list_head_t queue;
     /// The current running process.
     task_struct *curr;
+    /// Set when the scheduler must run before going back to user mode.
+    bool_t need_resched;
 } runqueue_t;
 
 /// @brief Structure that describes scheduling parameters.
@@ -69,6 +71,16 @@ void scheduler_enqueue_task(task_struct *process);
 /// @param process Process that has to be activated.
 void scheduler_dequeue_task(task_struct *process);
 
+/// @brief Asks for the scheduler to run before returning to user mode.
+/// @details It is called whenever a task is woken up, receives a signal, or
+/// changes its scheduling parameters, and by the timer tick.
+void scheduler_set_need_resched(void);
+
+/// @brief Checks if the scheduler must run before returning to user mode.
+/// @return 1 if it was asked to, or if the current process is not running
+/// anymore or has signals to handle, 0 otherwise.
+int scheduler_need_resched(void);
+
 /// @brief The RR implementation of the scheduler.
 /// @param f The context of the process.
 void scheduler_run(pt_regs_t *f);
@@ -77,6 +77,8 @@ typedef struct wait_queue_entry {
     int (*func)(struct wait_queue_entry *, unsigned, int);
     /// Handler for placing the entry inside a waiting queue double linked-list.
     struct list_head task_list;
+    /// The wait queue the entry is in, NULL if it is in none.
+    struct wait_queue_head *head;
     /// Additional context or data, typically a pointer to relevant information
     /// for the wake function.
     void *private;
@@ -116,6 +118,25 @@ void remove_wait_queue(wait_queue_head_t *head, wait_queue_entry_t *entry);
 /// @return 1 on success, 0 on failure.
 int default_wake_function(wait_queue_entry_t *entry, unsigned mode, int sync);
 
+/// @brief Wakes up the tasks sleeping on the wait queue, removing from the
+///        queue and freeing the entries whose wake function accepted.
+/// @param head The wait queue.
+/// @return The number of tasks woken up.
+int wake_up(wait_queue_head_t *head);
+
+/// @brief Wakes up the task of a single entry, e.g., one picked by the caller
+///        among the ones in the queue, removing and freeing the entry if its
+///        wake function accepted.
+/// @param entry The entry.
+/// @return 1 if the task was woken up, 0 otherwise.
+int wake_up_entry(wait_queue_entry_t *entry);
+
+/// @brief Wakes up a task sleeping in TASK_INTERRUPTIBLE, e.g., because it
+///        received a signal, removing and freeing its entry.
+/// @param task The task.
+/// @return 1 if the task was woken up, 0 if it was not sleeping interruptibly.
+int wake_up_interruptible_task(struct task_struct *task);
+
 /// @brief Sets the state of the current process to TASK_UNINTERRUPTIBLE
 ///        and inserts it into the specified wait queue.
 ///
@@ -123,3 +144,12 @@ int default_wake_function(wait_queue_entry_t *entry, unsigned mode, int sync);
 /// @return Pointer to the entry inside the wq representing the
 ///         sleeping process.
 wait_queue_entry_t *sleep_on(wait_queue_head_t *head);
+
+/// @brief Sets the state of the current process to TASK_INTERRUPTIBLE
+///        and inserts it into the specified wait queue, a signal sent to the
+///        process wakes it up and removes it from the queue.
+///
+/// @param head Waitqueue where to sleep.
+/// @return Pointer to the entry inside the wq representing the
+///         sleeping process.
+wait_queue_entry_t *sleep_on_interruptible(wait_queue_head_t *head);
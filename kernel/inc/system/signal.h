@@ -254,6 +254,14 @@ long sys_sigreturn(struct pt_regs *f);
 /// otherwise, 0.
 int do_signal(struct pt_regs *f);
 
+struct task_struct;
+
+/// @brief Checks if the task has a pending signal which interrupts its
+/// blocking calls, namely one which is not blocked nor ignored.
+/// @param t the task.
+/// @return 1 if there is such a signal, 0 otherwise.
+int signal_pending(struct task_struct *t);
+
 /// @brief Initialize the signals.
 /// @return 1 on success, 0 on failure.
 int signals_init(void);
@@ -8,6 +8,7 @@
 #include "dirent.h"
 #include "fs/vfs_types.h"
 #include "kernel.h"
+#include "sys/mman.h"
 #include "sys/msg.h"
 #include "sys/sem.h"
 #include "sys/shm.h"
@@ -15,10 +16,17 @@
 #include "sys/utsname.h"
 #include "system/syscall_types.h"
 
-/// @brief Initialize the system calls.
+/// Error code of the frames of the system calls entered with SYSENTER, they are
+/// the only ones that can be returned to with SYSEXIT.
+#define SYSENTER_FRAME 1
+
+/// @brief Initialize the system calls, and the SYSENTER entry point if the
+/// CPU supports it.
 void syscall_init(void);
 
-/// @brief Handler for the system calls.
+/// @brief Handler for the system calls, entered both from `int 0x80` and from
+/// SYSENTER. A system call returning -ERESTART has put the process to sleep,
+/// and is issued again when the process resumes.
 /// @param f The interrupt stack frame.
 void syscall_handler(pt_regs_t *f);
 
@@ -377,6 +385,18 @@ void *sys_mmap(void *addr, size_t length, int prot, int flags, int fd, off_t off
 /// @return 0 on success, -1 on falure and errno is set.
 int sys_munmap(void *addr, size_t length);
 
+/// @brief creates a new mapping, with the arguments packed in a structure.
+/// @param args the arguments of the mapping (see sys_mmap).
+/// @return returns a pointer to the mapped area, -1 and errno is set.
+void *sys_old_mmap(mmap_arg_struct_t *args);
+
+/// @brief flushes changes made to a shared file mapping back to the file.
+/// @param addr the starting address, which must be page aligned.
+/// @param length the length of the range to synchronize.
+/// @param flags either MS_SYNC or MS_ASYNC, possibly with MS_INVALIDATE.
+/// @return 0 on success, -1 on falure and errno is set.
+int sys_msync(void *addr, size_t length, int flags);
+
 /// @brief Returns system information in the structure pointed to by buf.
 /// @param buf Buffer where the info will be placed.
 /// @return 0 on success, a negative value on failure.
@@ -423,12 +443,9 @@ long sys_syncfs(int fd);
 /// @details Schedules a range of bytes within a file to be written to storage.
 long sys_sync_file_range(int fd, long long offset, long long nbytes, unsigned int flags);
 
-/// @brief User malloc.
-/// @param addr This argument is treated as an address of a dynamically
-///             allocated memory if falls inside the process heap area.
-///             Otherwise, it is treated as an amount of memory that
-///             should be allocated.
-/// @return NULL if there is no more memory available or we were freeing
-///         a previously allocated memory area, the address of the
-///         allocated space otherwise.
+/// @brief Sets the end of the data segment (the program break).
+/// @param addr The new program break, the heap grows or shrinks accordingly.
+///             If it is below the start of the heap (e.g., NULL), the break
+///             is left untouched.
+/// @return The new program break on success, the current one on failure.
 void *sys_brk(void *addr);
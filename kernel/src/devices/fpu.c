@@ -19,8 +19,10 @@
 #include "system/panic.h"
 #include "system/signal.h"
 
-/// Pointer to the thread currently using the FPU, if any.
+/// Pointer to the thread whose registers are loaded in the FPU, if any.
 task_struct *thread_using_fpu = NULL;
+/// Whether CR0.TS is set, so that the next FPU instruction traps.
+static bool_t fpu_trapping = false;
 /// Temporary aligned buffer for copying around FPU contexts.
 uint8_t saves[512] __attribute__((aligned(16)));
 
@@ -54,6 +56,24 @@ static inline void __disable_fpu(void)
     __asm__ __volatile__("mov %0, %%cr0" ::"r"(t));
 }
 
+/// @brief Makes the next FPU instruction trap, unless it already does.
+static inline void __set_ts(void)
+{
+    if (!fpu_trapping) {
+        __disable_fpu();
+        fpu_trapping = true;
+    }
+}
+
+/// @brief Lets the FPU instructions run, unless they already do.
+static inline void __clear_ts(void)
+{
+    if (fpu_trapping) {
+        __asm__ __volatile__("clts");
+        fpu_trapping = false;
+    }
+}
+
 /// @brief Restore the FPU for a process.
 /// @param proc the process for which we are restoring the FPU registers.
 static inline void __restore_fpu(task_struct *proc)
@@ -76,6 +96,8 @@ static inline void __save_fpu(task_struct *proc)
 static inline void __init_fpu(void) { __asm__ __volatile__("fninit"); }
 
 /// Kernel trap for FPU usage when FPU is disabled.
+/// @details This is where the FPU changes hands: the registers of the last
+/// user are saved only now, and those of the new one are loaded.
 /// @param f The interrupt stack frame.
 static inline void __invalid_op(pt_regs_t *f)
 {
@@ -83,13 +105,22 @@ static inline void __invalid_op(pt_regs_t *f)
     pr_debug("  EIP: 0x%x, ESP: 0x%x\n", f->eip, f->esp);
 
     // First, turn the FPU on.
-    pr_debug("  Enabling FPU...\n");
-    __enable_fpu();
-    pr_debug("  FPU enabled.\n");
+    __clear_ts();
 
     task_struct *current = scheduler_get_current_process();
     pr_debug("  Current process: %p (pid=%d)\n", current, current ? current->pid : -1);
 
+    // The kernel itself wants to use the FPU, as scratch space: put away the
+    // registers of their owner, who reloads them on its next use.
+    if ((f->cs & 0x3) != 0x3) {
+        if (thread_using_fpu) {
+            __save_fpu(thread_using_fpu);
+            thread_using_fpu = NULL;
+        }
+        __init_fpu();
+        return;
+    }
+
     if (thread_using_fpu == current) {
         // If this is the thread that last used the FPU, do nothing.
         pr_debug("  Current process already using FPU, returning.\n");
@@ -100,11 +131,9 @@ static inline void __invalid_op(pt_regs_t *f)
         // If there is a thread that was using the FPU, save its state.
         pr_debug("  Saving FPU state for previous process (pid=%d)\n", thread_using_fpu->pid);
         __save_fpu(thread_using_fpu);
-        pr_debug("  FPU state saved.\n");
     }
 
     thread_using_fpu = current;
-    pr_debug("  Updated thread_using_fpu to %p\n", thread_using_fpu);
 
     if (!thread_using_fpu->thread.fpu_enabled) {
         /*
@@ -113,16 +142,13 @@ static inline void __invalid_op(pt_regs_t *f)
          */
         pr_debug("  Initializing FPU for first use...\n");
         __init_fpu();
-        pr_debug("  FPU initialized.\n");
         thread_using_fpu->thread.fpu_enabled = true;
-        pr_debug("  FPU enabled flag set.\n");
         return;
     }
 
     // Otherwise we restore the context for this thread.
     pr_debug("  Restoring FPU context for process (pid=%d)\n", thread_using_fpu->pid);
     __restore_fpu(thread_using_fpu);
-    pr_debug("  FPU context restored.\n");
 }
 
 /// Kernel trap for various integer and floating-point errors
@@ -219,9 +245,42 @@ static int __fpu_test(void)
     return 1;
 }
 
-void switch_fpu(void) { __save_fpu(scheduler_get_current_process()); }
+void switch_fpu(void)
+{
+    // The registers stay where they are, the kernel only has to trap if it
+    // wants to use them.
+    __set_ts();
+}
+
+void unswitch_fpu(void)
+{
+    // Only the owner of the registers can use them without trapping, which is
+    // never the case for tasks that do not use the FPU.
+    if (thread_using_fpu && (thread_using_fpu == scheduler_get_current_process())) {
+        __clear_ts();
+    } else {
+        __set_ts();
+    }
+}
+
+void fpu_save_task(task_struct *task)
+{
+    if (thread_using_fpu == task) {
+        bool_t trapping = fpu_trapping;
+        __clear_ts();
+        __save_fpu(task);
+        if (trapping) {
+            __set_ts();
+        }
+    }
+}
 
-void unswitch_fpu(void) { __restore_fpu(scheduler_get_current_process()); }
+void fpu_release_task(task_struct *task)
+{
+    if (thread_using_fpu == task) {
+        thread_using_fpu = NULL;
+    }
+}
 
 int fpu_install(void)
 {
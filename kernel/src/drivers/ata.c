@@ -23,8 +23,10 @@
 #include "io/port_io.h"
 #include "klib/spinlock.h"
 #include "math.h"
+#include "mem/alloc/slab.h"
 #include "mem/alloc/zone_allocator.h"
 #include "mem/mm/page.h"
+#include "mem/paging.h"
 #include "process/wait.h"
 #include "stdbool.h"
 #include "stdio.h"
@@ -149,6 +151,20 @@ typedef struct prdt {
     unsigned short end_of_table;
 } prdt_t;
 
+/// @brief A block I/O operation on consecutive sectors.
+typedef struct ata_bio {
+    /// The first sector.
+    uint32_t lba;
+    /// The number of sectors.
+    uint32_t count;
+    /// The source or destination buffer, `count` sectors long.
+    uint8_t *buffer;
+    /// If the data is written to the device.
+    bool_t write;
+    /// The outcome of the operation, 0 on success or a negative errno.
+    int status;
+} ata_bio_t;
+
 /// @brief Stores information about an ATA device.
 typedef struct ata_device {
     /// Name of the device.
@@ -240,18 +256,29 @@ typedef struct ata_device {
         uint8_t *start;
         /// Physical address of the DMA memory area.
         uintptr_t start_phys;
+        /// If bus-master DMA can be used, it is cleared after a failed transfer.
+        bool_t enabled;
+        /// Set by the IRQ handler when the controller signals the end of a transfer.
+        volatile bool_t completed;
     } dma;
+    /// Buffer used to gather and scatter adjacent bios transferred with a
+    /// single command.
+    uint8_t *bounce;
     /// Device root file.
     vfs_file_t *fs_root;
     /// For device lock.
     spinlock_t lock;
 } ata_device_t;
 
-#define ATA_SECTOR_SIZE 512 ///< The sector size.
-#define ATA_DMA_SIZE    512 ///< The size of the DMA area.
+#define ATA_SECTOR_SIZE      512                                    ///< The sector size.
+#define ATA_DMA_MAX_SECTORS  128                                    ///< Maximum number of sectors per command.
+#define ATA_DMA_SIZE         (ATA_DMA_MAX_SECTORS * ATA_SECTOR_SIZE) ///< The size of the DMA area.
+#define ATA_DMA_PRDT_ENTRIES (ATA_DMA_SIZE / PAGE_SIZE)             ///< One PRD per page, none crosses 64K.
 
 #define ATA_CMD_READ_PIO       0x20
 #define ATA_CMD_READ_PIO_RETRY 0x21
+#define ATA_CMD_WRITE_PIO      0x30
+#define ATA_CMD_CACHE_FLUSH    0xE7
 
 #define ATA_BMR_CMD_START 0x01
 #define ATA_BMR_CMD_READ  0x08
@@ -260,7 +287,7 @@ typedef struct ata_device {
 #define ATA_BMR_STATUS_ERROR  0x02
 #define ATA_BMR_STATUS_IRQ    0x04
 
-#define ATA_DMA_POLL_LIMIT 100000
+#define ATA_DMA_POLL_LIMIT 1000000
 
 /// @brief Keeps track of the incremental letters for the ATA drives.
 static char ata_drive_char = 'a';
@@ -269,6 +296,16 @@ static int cdrom_number    = 0;
 /// @brief We store the ATA pci address here.
 static uint32_t ata_pci    = 0x00000000;
 
+/// @brief If bus mastering was successfully enabled on the controller.
+static bool_t ata_bus_mastering = false;
+
+/// @brief The device with a DMA transfer in flight on the primary channel.
+/// Master and slave share the bus master registers of their channel, so only
+/// this device is credited with the interrupts of the channel.
+static ata_device_t *ata_primary_dma_device   = NULL;
+/// @brief The device with a DMA transfer in flight on the secondary channel.
+static ata_device_t *ata_secondary_dma_device = NULL;
+
 /// @brief The ATA primary master control register locations.
 static ata_device_t ata_primary_master = {
     .io_base = 0x1F0,
@@ -1103,7 +1140,7 @@ static bool_t ata_device_init(ata_device_t *dev)
     }
 
     // Allocate the memory for the Physical Region Descriptor Table (PRDT).
-    dev->dma.prdt = (prdt_t *)ata_dma_alloc(sizeof(prdt_t), &dev->dma.prdt_phys);
+    dev->dma.prdt = (prdt_t *)ata_dma_alloc(sizeof(prdt_t) * ATA_DMA_PRDT_ENTRIES, &dev->dma.prdt_phys);
     if (dev->dma.prdt == NULL) {
         pr_crit(
             "[%-16s, %-9s] Failed to allocate memory for PRDT.\n", ata_get_device_settings_str(dev),
@@ -1122,14 +1159,28 @@ static bool_t ata_device_init(ata_device_t *dev)
         return 1;
     }
 
-    // Initialize the PRDT with the physical address of the DMA.
-    dev->dma.prdt->physical_address = dev->dma.start_phys;
+    // Each PRD covers one page of the DMA area, the entries are filled for
+    // every transfer depending on its size.
+    for (uint32_t i = 0; i < ATA_DMA_PRDT_ENTRIES; ++i) {
+        dev->dma.prdt[i].physical_address = dev->dma.start_phys + (i * PAGE_SIZE);
+        dev->dma.prdt[i].byte_count       = 0;
+        dev->dma.prdt[i].end_of_table     = 0;
+    }
 
-    // Set the size of the DMA transfer.
-    dev->dma.prdt->byte_count = ATA_DMA_SIZE;
+    // Use DMA only if the controller accepted to become bus master.
+    dev->dma.enabled   = ata_bus_mastering;
+    dev->dma.completed = false;
 
-    // Set the End of Table (EOT) flag.
-    dev->dma.prdt->end_of_table = 0x8000;
+    // Allocate the buffer used to transfer adjacent bios together.
+    dev->bounce = kmalloc(ATA_DMA_SIZE);
+    if (dev->bounce == NULL) {
+        pr_crit(
+            "[%-16s, %-9s] Failed to allocate the bounce buffer.\n", ata_get_device_settings_str(dev),
+            ata_get_device_type_str(dev->type));
+        ata_dma_free((uintptr_t)dev->dma.start);
+        ata_dma_free((uintptr_t)dev->dma.prdt);
+        return 1;
+    }
 
     // Print the device data for debugging purposes.
     ata_dump_device(dev);
@@ -1139,51 +1190,81 @@ static bool_t ata_device_init(ata_device_t *dev)
 
 // == ATA SECTOR READ/WRITE FUNCTIONS =========================================
 
-/// @brief PIO fallback for sector reads.
+/// @brief Selects the device and programs the task file for an LBA28 command.
 /// @param dev target device.
-/// @param lba_sector sector to read.
-/// @param buffer destination buffer.
+/// @param lba_sector first sector of the transfer.
+/// @param count number of sectors, at most 255.
 /// @return 0 on success, negative errno on failure.
-static int ata_device_read_sector_pio(ata_device_t *dev, uint32_t lba_sector, uint8_t *buffer)
+static inline int ata_device_setup_lba28(ata_device_t *dev, uint32_t lba_sector, uint32_t count)
 {
-    int rc = 0;
-
     if (ata_status_wait_not(dev, ata_status_bsy, 100000)) {
-        rc = -EBUSY;
-        goto out;
+        return -EBUSY;
     }
-
-    outportb(dev->io_control, ata_control_nien);
     outportb(dev->io_reg.hddevsel, 0xE0 | (dev->slave << 4) | ((lba_sector >> 24) & 0x0F));
     ata_io_wait(dev);
-
+    if (ata_status_wait_not(dev, ata_status_bsy, 100000)) {
+        return -EBUSY;
+    }
     outportb(dev->io_reg.feature, 0x00);
-    outportb(dev->io_reg.sector_count, 1);
+    outportb(dev->io_reg.sector_count, (uint8_t)count);
     outportb(dev->io_reg.lba_lo, (uint8_t)(lba_sector & 0xFF));
     outportb(dev->io_reg.lba_mid, (uint8_t)((lba_sector >> 8) & 0xFF));
     outportb(dev->io_reg.lba_hi, (uint8_t)((lba_sector >> 16) & 0xFF));
+    return 0;
+}
 
-    outportb(dev->io_reg.command, ATA_CMD_READ_PIO);
+/// @brief PIO fallback for multi-sector transfers.
+/// @param dev target device.
+/// @param lba_sector first sector of the transfer.
+/// @param count number of sectors.
+/// @param buffer source or destination buffer.
+/// @param write true when writing to the device.
+/// @return 0 on success, negative errno on failure.
+static int ata_device_transfer_pio(ata_device_t *dev, uint32_t lba_sector, uint32_t count, uint8_t *buffer, bool_t write)
+{
+    int rc = 0;
 
-    if (ata_status_wait_not(dev, ata_status_bsy, 100000)) {
-        rc = -EBUSY;
-        goto out;
-    }
-    if (ata_status_wait_for(dev, ata_status_drq, 100000)) {
-        rc = -ETIMEDOUT;
+    // The transfer is polled, so keep the device from raising interrupts.
+    outportb(dev->io_control, ata_control_nien);
+
+    if ((rc = ata_device_setup_lba28(dev, lba_sector, count)) < 0) {
         goto out;
     }
 
-    uint8_t status = inportb(dev->io_reg.status);
-    if (status & (ata_status_err | ata_status_df)) {
-        rc = -EIO;
-        goto out;
+    outportb(dev->io_reg.command, write ? ATA_CMD_WRITE_PIO : ATA_CMD_READ_PIO);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        if (ata_status_wait_not(dev, ata_status_bsy, 100000)) {
+            rc = -EBUSY;
+            goto out;
+        }
+        if (ata_status_wait_for(dev, ata_status_drq, 100000)) {
+            rc = -ETIMEDOUT;
+            goto out;
+        }
+        if (inportb(dev->io_reg.status) & (ata_status_err | ata_status_df)) {
+            rc = -EIO;
+            goto out;
+        }
+        uint16_t *sector = (uint16_t *)(buffer + (i * ATA_SECTOR_SIZE));
+        if (write) {
+            outportsw(dev->io_reg.data, sector, ATA_SECTOR_SIZE / sizeof(uint16_t));
+        } else {
+            inportsw(dev->io_reg.data, sector, ATA_SECTOR_SIZE / sizeof(uint16_t));
+        }
+        ata_io_wait(dev);
     }
 
-    inportsw(dev->io_reg.data, (uint16_t *)buffer, (ATA_SECTOR_SIZE / sizeof(uint16_t)));
+    if (write) {
+        // Make sure the data leaves the write cache of the drive.
+        outportb(dev->io_reg.command, ATA_CMD_CACHE_FLUSH);
+        if (ata_status_wait_not(dev, ata_status_bsy, 100000)) {
+            rc = -EBUSY;
+            goto out;
+        }
+    }
 
-    status = inportb(dev->io_reg.status);
-    if (status & (ata_status_err | ata_status_df)) {
+    if (inportb(dev->io_reg.status) & (ata_status_err | ata_status_df)) {
         rc = -EIO;
     }
 
@@ -1192,131 +1273,255 @@ out:
     return rc;
 }
 
-/// @brief DMA path for sector reads with error detection.
-/// @details Currently disabled: QEMU DMA IRQs don't fire as expected.
-///          Always returns error to force PIO fallback, which works reliably.
+/// @brief Waits for the end of a bus-master DMA transfer.
+/// @details The kernel runs with interrupts disabled, so the completion
+/// raised through the IRQ line is also observed by polling the IRQ bit of the
+/// bus master status register. The IRQ handler sets `dma.completed` when it
+/// gets to acknowledge the transfer first.
 /// @param dev target device.
-/// @param lba_sector sector to read.
-/// @param buffer destination buffer.
-/// @return Always returns -ENOSYS to force PIO fallback.
-static int ata_device_read_sector_dma(ata_device_t *dev, uint32_t lba_sector, uint8_t *buffer)
+/// @return 0 on success, negative errno on failure.
+static inline int ata_dma_wait_completion(ata_device_t *dev)
 {
-    // DMA IRQ handling is unreliable in QEMU emulation. PIO works perfectly.
-    // Rather than waste time on DMA timeouts, go directly to PIO.
-    (void)dev;
-    (void)lba_sector;
-    (void)buffer;
-    return -ENOSYS;
+    for (long i = 0; i < ATA_DMA_POLL_LIMIT; ++i) {
+        if (dev->dma.completed) {
+            return 0;
+        }
+        uint8_t bmr_status = inportb(dev->bmr.status);
+        if (bmr_status & ATA_BMR_STATUS_ERROR) {
+            return -EIO;
+        }
+        if ((bmr_status & ATA_BMR_STATUS_IRQ) && !(bmr_status & ATA_BMR_STATUS_ACTIVE)) {
+            return 0;
+        }
+    }
+    return -ETIMEDOUT;
 }
 
-/// @brief Reads an ATA sector with PIO (DMA disabled due to QEMU incompatibility).
-/// @param dev the device on which we perform the read.
-/// @param lba_sector the sector where we read.
-/// @param buffer the buffer we are writing.
-static void ata_device_read_sector(ata_device_t *dev, uint32_t lba_sector, uint8_t *buffer)
+/// @brief Returns where the device with a DMA transfer in flight on the
+/// channel of the given device is stored.
+/// @param dev a device attached to the channel.
+/// @return a pointer to the active device of the channel.
+static inline ata_device_t **ata_dma_channel_device(ata_device_t *dev)
 {
-    if ((dev->type != ata_dev_type_pata) && (dev->type != ata_dev_type_sata)) {
-        pr_crit("[%s] Unsupported device type for read operation.\n", ata_get_device_settings_str(dev));
-        return;
-    }
-
-    spinlock_lock(&dev->lock);
-
-    // Skip DMA entirely; QEMU's DMA IRQ emulation is unreliable.
-    // PIO works perfectly, so use it directly.
-    int rc = ata_device_read_sector_pio(dev, lba_sector, buffer);
-    if (rc) {
-        pr_crit("ata_device_read_sector: PIO failed (sector %u, rc=%d)\n", lba_sector, rc);
-    }
-
-    spinlock_unlock(&dev->lock);
+    return dev->primary ? &ata_primary_dma_device : &ata_secondary_dma_device;
 }
 
-/// @brief Writs an ATA sector.
-/// @param dev the device on which we perform the write.
-/// @param lba_sector the sector where we read.
-/// @param buffer the buffer where we store what we read.
-static void ata_device_write_sector(ata_device_t *dev, uint32_t lba_sector, uint8_t *buffer)
+/// @brief Bus-master DMA path for multi-sector transfers.
+/// @param dev target device.
+/// @param lba_sector first sector of the transfer.
+/// @param count number of sectors, at most ATA_DMA_MAX_SECTORS.
+/// @param buffer source or destination buffer.
+/// @param write true when writing to the device.
+/// @return 0 on success, negative errno on failure.
+static int ata_device_transfer_dma(ata_device_t *dev, uint32_t lba_sector, uint32_t count, uint8_t *buffer, bool_t write)
 {
-    // Check if we are trying to perform the read on a valid device type.
-    if ((dev->type != ata_dev_type_pata) && (dev->type != ata_dev_type_sata)) {
-        pr_crit("[%s] Unsupported device type for read operation.\n", ata_get_device_settings_str(dev));
-        return;
-    }
+    uint32_t size      = count * ATA_SECTOR_SIZE;
+    uint32_t entries   = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+    uint8_t direction  = write ? 0 : ATA_BMR_CMD_READ;
+    uint8_t bmr_status = 0;
+    int rc             = 0;
 
-    // Acquire the lock for thread safety.
-    spinlock_lock(&dev->lock);
+    // Describe the transfer, one PRD per page of the DMA area.
+    for (uint32_t i = 0; i < entries; ++i) {
+        dev->dma.prdt[i].byte_count   = (uint16_t)min(PAGE_SIZE, size - (i * PAGE_SIZE));
+        dev->dma.prdt[i].end_of_table = (i == (entries - 1)) ? 0x8000 : 0;
+    }
 
     // Copy the buffer over to the DMA area.
-    memcpy(dev->dma.start, buffer, ATA_DMA_SIZE);
-
-    // Reset the bus master register's command register.
-    outportb(dev->bmr.command, 0);
+    if (write) {
+        memcpy(dev->dma.start, buffer, size);
+    }
 
-    // Set the Physical Region Descriptor Table (PRDT).
+    // Stop the controller, load the PRDT, and clear the IRQ and error bits.
+    outportb(dev->bmr.command, ata_bm_stop_bus_master);
     outportl(dev->bmr.prdt, dev->dma.prdt_phys);
+    outportb(dev->bmr.status, inportb(dev->bmr.status) | ATA_BMR_STATUS_IRQ | ATA_BMR_STATUS_ERROR);
+    // The direction must be set while the controller is stopped.
+    outportb(dev->bmr.command, direction);
 
-    // Enable error and IRQ status in the bus master register.
-    outportb(dev->bmr.status, inportb(dev->bmr.status) | 0x04 | 0x02);
+    // Let the device raise its interrupt line, it drives the BMR IRQ bit.
+    outportb(dev->io_control, ata_control_zero);
 
-    // Wait for the device to be ready (BSY flag should be clear).
-    if (ata_status_wait_not(dev, ata_status_bsy, 100000)) {
-        ata_print_status_error(dev);
-        spinlock_unlock(&dev->lock);
-        return;
+    if ((rc = ata_device_setup_lba28(dev, lba_sector, count)) < 0) {
+        return rc;
     }
 
-    // Select the drive (set head and device).
-    outportb(dev->io_reg.hddevsel, 0xe0 | (dev->slave << 4) | ((lba_sector & 0x0F000000) >> 24));
+    // The interrupts of the channel belong to this device, until it is done.
+    ata_device_t **active = ata_dma_channel_device(dev);
+    *active               = dev;
 
-    // Wait for the device to be ready again (BSY flag should be clear).
-    if (ata_status_wait_not(dev, ata_status_bsy, 100000)) {
-        ata_print_status_error(dev);
-        spinlock_unlock(&dev->lock);
-        return;
+    dev->dma.completed = false;
+    outportb(dev->io_reg.command, write ? ata_dma_command_write : ata_dma_command_read);
+    outportb(dev->bmr.command, direction | ATA_BMR_CMD_START);
+
+    rc = ata_dma_wait_completion(dev);
+
+    // Stop the controller, and acknowledge both the controller and the device.
+    outportb(dev->bmr.command, direction);
+    bmr_status     = inportb(dev->bmr.status);
+    uint8_t status = inportb(dev->io_reg.status);
+    outportb(dev->bmr.status, bmr_status | ATA_BMR_STATUS_IRQ | ATA_BMR_STATUS_ERROR);
+    *active = NULL;
+
+    if (rc < 0) {
+        return rc;
+    }
+    if ((bmr_status & ATA_BMR_STATUS_ERROR) || (status & (ata_status_err | ata_status_df))) {
+        return -EIO;
     }
 
-    // Set the features, sector count, and LBA for the write operation.
-    outportb(dev->io_reg.feature, 0x00);                           // No features for this write operation.
-    outportb(dev->io_reg.sector_count, 1);                         // Write one sector.
-    outportb(dev->io_reg.lba_lo, (lba_sector & 0x000000FF) >> 0);  // LBA low byte.
-    outportb(dev->io_reg.lba_mid, (lba_sector & 0x0000FF00) >> 8); // LBA mid byte.
-    outportb(dev->io_reg.lba_hi, (lba_sector & 0x00FF0000) >> 16); // LBA high byte.
+    // Copy the content of the DMA area over to the buffer.
+    if (!write) {
+        memcpy(buffer, dev->dma.start, size);
+    }
+    return 0;
+}
 
-    // Wait for the device to be ready for data transfer (BSY should be clear).
-    if (ata_status_wait_not(dev, ata_status_bsy, 100000)) {
-        ata_print_status_error(dev);
-        spinlock_unlock(&dev->lock);
-        return;
+/// @brief Transfers a run of consecutive sectors, using DMA when available and
+/// falling back to PIO otherwise.
+/// @param dev the device on which we perform the transfer.
+/// @param lba_sector the first sector of the transfer.
+/// @param count the number of sectors, at most ATA_DMA_MAX_SECTORS.
+/// @param buffer the source or destination buffer.
+/// @param write true when writing to the device.
+/// @return 0 on success, negative errno on failure.
+static int ata_device_transfer(ata_device_t *dev, uint32_t lba_sector, uint32_t count, uint8_t *buffer, bool_t write)
+{
+    if ((dev->type != ata_dev_type_pata) && (dev->type != ata_dev_type_sata)) {
+        pr_crit("[%s] Unsupported device type for transfer.\n", ata_get_device_settings_str(dev));
+        return -EPERM;
+    }
+    if ((count == 0) || (count > ATA_DMA_MAX_SECTORS)) {
+        return -EINVAL;
     }
 
-    // Notify that we are starting the DMA writing operation.
-    outportb(dev->io_reg.command, ata_dma_command_write);
+    int rc = -ENOSYS;
+    if (dev->dma.enabled) {
+        rc = ata_device_transfer_dma(dev, lba_sector, count, buffer, write);
+        if (rc < 0) {
+            // Do not pay for DMA timeouts again, stick with PIO from now on.
+            pr_warning(
+                "[%s] DMA %s failed (sector %u, count %u, rc=%d), falling back to PIO.\n",
+                ata_get_device_settings_str(dev), write ? "write" : "read", lba_sector, count, rc);
+            dev->dma.enabled = false;
+            ata_soft_reset(dev);
+        }
+    }
+    if (rc < 0) {
+        rc = ata_device_transfer_pio(dev, lba_sector, count, buffer, write);
+        if (rc < 0) {
+            pr_crit(
+                "[%s] PIO %s failed (sector %u, count %u, rc=%d)\n", ata_get_device_settings_str(dev),
+                write ? "write" : "read", lba_sector, count, rc);
+        }
+    }
+    return rc;
+}
 
-    // Start the DMA writing process.
-    outportb(dev->bmr.command, 0x01); // Start the DMA transfer.
+// == ATA BLOCK I/O ===========================================================
 
-    // Wait for the DMA write to complete.
-    while (1) {
-        int status  = inportb(dev->bmr.status);
-        int dstatus = inportb(dev->io_reg.status);
-        // Wait for DMA transfer to complete.
-        if (!(status & 0x04)) {
-            continue;
+/// @brief Checks if the buffers of the bios follow each other in memory.
+/// @param bios the bios.
+/// @param nbios the number of bios.
+/// @return true if the bios can be transferred straight into their buffers.
+static inline bool_t ata_bios_are_contiguous(ata_bio_t *bios, unsigned nbios)
+{
+    for (unsigned i = 1; i < nbios; ++i) {
+        if (bios[i].buffer != (bios[i - 1].buffer + (bios[i - 1].count * ATA_SECTOR_SIZE))) {
+            return false;
         }
-        // Exit when device is no longer busy.
-        if (!(dstatus & ata_status_bsy)) {
-            break;
+    }
+    return true;
+}
+
+/// @brief Transfers adjacent bios going in the same direction.
+/// @param dev the device.
+/// @param bios the bios, each one starting where the previous one ends.
+/// @param nbios the number of bios.
+/// @param count the total number of sectors, at most ATA_DMA_MAX_SECTORS if
+/// there is more than one bio.
+/// @return 0 on success, negative errno on failure.
+static int ata_bios_transfer(ata_device_t *dev, ata_bio_t *bios, unsigned nbios, uint32_t count)
+{
+    uint32_t lba = bios[0].lba;
+    bool_t write = bios[0].write;
+    int rc       = 0;
+
+    if (ata_bios_are_contiguous(bios, nbios)) {
+        // Transfer straight into the bios, splitting into commands of the
+        // maximum size supported.
+        for (uint32_t done = 0; done < count;) {
+            uint32_t run = min(count - done, ATA_DMA_MAX_SECTORS);
+            rc           = ata_device_transfer(dev, lba + done, run, bios[0].buffer + (done * ATA_SECTOR_SIZE), write);
+            if (rc < 0) {
+                return rc;
+            }
+            done += run;
         }
+        return 0;
     }
 
-    // Inform the device that we are done with the write operation.
-    outportb(dev->bmr.status, inportb(dev->bmr.status) | 0x04 | 0x02);
+    // The bios fit a single command, gather them into the bounce buffer, and
+    // scatter them back after reading.
+    if (write) {
+        for (unsigned i = 0; i < nbios; ++i) {
+            uint8_t *slot = dev->bounce + ((bios[i].lba - lba) * ATA_SECTOR_SIZE);
+            memcpy(slot, bios[i].buffer, bios[i].count * ATA_SECTOR_SIZE);
+        }
+    }
+    rc = ata_device_transfer(dev, lba, count, dev->bounce, write);
+    if ((rc == 0) && !write) {
+        for (unsigned i = 0; i < nbios; ++i) {
+            uint8_t *slot = dev->bounce + ((bios[i].lba - lba) * ATA_SECTOR_SIZE);
+            memcpy(bios[i].buffer, slot, bios[i].count * ATA_SECTOR_SIZE);
+        }
+    }
+    return rc;
+}
 
-    // Release the lock after the operation is complete.
+/// @brief Performs the bios, in the given order, and sets their status.
+/// @details A bio starting where the previous one ends, and going in the same
+/// direction, shares the command of the previous one, as long as they fit in a
+/// single command.
+/// @param dev the device.
+/// @param bios the bios.
+/// @param nbios the number of bios.
+static void ata_submit_bios(ata_device_t *dev, ata_bio_t *bios, unsigned nbios)
+{
+    spinlock_lock(&dev->lock);
+    for (unsigned first = 0, last; first < nbios; first = last) {
+        uint32_t count = bios[first].count;
+        for (last = first + 1; last < nbios; ++last) {
+            ata_bio_t *prev = &bios[last - 1], *bio = &bios[last];
+            if ((bio->write != prev->write) || (bio->lba != (prev->lba + prev->count)) ||
+                ((count + bio->count) > ATA_DMA_MAX_SECTORS)) {
+                break;
+            }
+            count += bio->count;
+        }
+        int rc = ata_bios_transfer(dev, bios + first, last - first, count);
+        for (unsigned i = first; i < last; ++i) {
+            bios[i].status = rc;
+        }
+    }
     spinlock_unlock(&dev->lock);
 }
 
+/// @brief Prepares a bio.
+/// @param bio the bio.
+/// @param lba the first sector.
+/// @param count the number of sectors.
+/// @param buffer the source or destination buffer.
+/// @param write if the data is written to the device.
+static inline void ata_bio_init(ata_bio_t *bio, uint32_t lba, uint32_t count, uint8_t *buffer, bool_t write)
+{
+    bio->lba    = lba;
+    bio->count  = count;
+    bio->buffer = buffer;
+    bio->write  = write;
+    bio->status = 0;
+}
+
 // == VFS CALLBACKS ===========================================================
 
 /// @brief Implements the open function for an ATA device.
@@ -1407,8 +1612,8 @@ static ssize_t ata_read(vfs_file_t *file, char *buffer, off_t offset, size_t siz
 {
     // pr_debug("ata_read(file: 0x%p, buffer: 0x%p, offest: %8d, size: %8d)\n", file, buffer, offset, size);
 
-    // Prepare a static support buffer.
-    static char support_buffer[ATA_SECTOR_SIZE];
+    // Prepare static support buffers, for the leading and trailing sectors.
+    static char support_buffer[2][ATA_SECTOR_SIZE];
 
     // Get the device from the VFS file.
     ata_device_t *dev = (ata_device_t *)file->device;
@@ -1444,34 +1649,48 @@ static ssize_t ata_read(vfs_file_t *file, char *buffer, off_t offset, size_t siz
         size = max_offset - offset;
     }
 
-    uint32_t start_block  = offset / ATA_SECTOR_SIZE;
-    uint32_t start_offset = offset % ATA_SECTOR_SIZE;
-    uint32_t end_block    = (offset + size - 1) / ATA_SECTOR_SIZE;
-    uint32_t end_offset   = (offset + size - 1) % ATA_SECTOR_SIZE;
-    uint32_t prefix_size  = (ATA_SECTOR_SIZE - start_offset);
-    uint32_t postfix_size = (offset + size) % ATA_SECTOR_SIZE;
-    uint32_t x_offset     = 0;
+    uint8_t *output      = (uint8_t *)buffer;
+    size_t remaining     = size;
+    uint32_t lba_sector  = offset / ATA_SECTOR_SIZE;
+    uint32_t sector_offs = offset % ATA_SECTOR_SIZE;
+    size_t head_size     = 0;
+    ata_bio_t bios[3];
+    unsigned nbios = 0;
+
+    // Queue the leading partial sector, if needed.
+    if (sector_offs && remaining) {
+        head_size = min(ATA_SECTOR_SIZE - sector_offs, remaining);
+        ata_bio_init(&bios[nbios++], lba_sector++, 1, (uint8_t *)support_buffer[0], false);
+        remaining -= head_size;
+    }
+
+    // Queue the full sectors in between, straight into the buffer.
+    if (remaining >= ATA_SECTOR_SIZE) {
+        uint32_t count = remaining / ATA_SECTOR_SIZE;
+        ata_bio_init(&bios[nbios++], lba_sector, count, output + head_size, false);
+        remaining -= count * ATA_SECTOR_SIZE;
+        lba_sector += count;
+    }
 
-    if (start_offset) {
-        ata_device_read_sector(dev, start_block, (uint8_t *)support_buffer);
-        // Copy the prefix from the support buffer to the output buffer.
-        memcpy(buffer, (void *)((uintptr_t)support_buffer + start_offset), prefix_size);
-        x_offset += prefix_size;
-        ++start_block;
+    // Queue the trailing partial sector, if needed.
+    if (remaining) {
+        ata_bio_init(&bios[nbios++], lba_sector, 1, (uint8_t *)support_buffer[1], false);
     }
 
-    // Read postfix if needed.
-    if (postfix_size && (start_block <= end_block)) {
-        ata_device_read_sector(dev, end_block, (uint8_t *)support_buffer);
-        // Copy the postfix from the support buffer to the output buffer.
-        memcpy((void *)((uintptr_t)buffer + size - postfix_size), support_buffer, postfix_size);
-        --end_block;
+    // The bios are adjacent, they share a command when they fit in one.
+    ata_submit_bios(dev, bios, nbios);
+    for (unsigned i = 0; i < nbios; ++i) {
+        if (bios[i].status < 0) {
+            return -EIO;
+        }
     }
 
-    // Read full sectors in between.
-    for (; start_block <= end_block; ++start_block) {
-        ata_device_read_sector(dev, start_block, (uint8_t *)((uintptr_t)buffer + x_offset));
-        x_offset += ATA_SECTOR_SIZE;
+    // Copy the partial sectors.
+    if (head_size) {
+        memcpy(output, support_buffer[0] + sector_offs, head_size);
+    }
+    if (remaining) {
+        memcpy(output + size - remaining, support_buffer[1], remaining);
     }
 
     // Return the number of bytes read.
@@ -1488,8 +1707,8 @@ static ssize_t ata_write(vfs_file_t *file, const void *buffer, off_t offset, siz
 {
     pr_debug("ata_write(%p, %p, %d, %d)\n", file, buffer, offset, size);
 
-    // Prepare a static support buffer.
-    static char support_buffer[ATA_SECTOR_SIZE];
+    // Prepare static support buffers, for the leading and trailing sectors.
+    static char support_buffer[2][ATA_SECTOR_SIZE];
 
     // Get the device from the VFS file.
     ata_device_t *dev = (ata_device_t *)file->device;
@@ -1506,14 +1725,10 @@ static ssize_t ata_write(vfs_file_t *file, const void *buffer, off_t offset, siz
         return -EPERM; // Return error for unsupported device types.
     }
 
-    uint32_t start_block  = offset / ATA_SECTOR_SIZE;
-    uint32_t start_offset = offset % ATA_SECTOR_SIZE;
-    uint32_t end_block    = (offset + size - 1) / ATA_SECTOR_SIZE;
-    uint32_t end_offset   = (offset + size - 1) % ATA_SECTOR_SIZE;
-    uint32_t prefix_size  = (ATA_SECTOR_SIZE - start_offset);
-    uint32_t postfix_size = (offset + size) % ATA_SECTOR_SIZE;
-    uint32_t max_offset   = ata_max_offset(dev);
-    uint32_t x_offset     = 0;
+    const uint8_t *input = (const uint8_t *)buffer;
+    uint32_t max_offset  = ata_max_offset(dev);
+    uint32_t lba_sector  = offset / ATA_SECTOR_SIZE;
+    uint32_t sector_offs = offset % ATA_SECTOR_SIZE;
 
     // Check if with the offset we are exceeding the size.
     if (offset > max_offset) {
@@ -1525,27 +1740,53 @@ static ssize_t ata_write(vfs_file_t *file, const void *buffer, off_t offset, siz
         size = max_offset - offset;
     }
 
-    // Handle the prefix if needed.
-    if (start_offset) {
-        ata_device_read_sector(dev, start_block, (uint8_t *)support_buffer);
-        memcpy((void *)((uintptr_t)support_buffer + (start_offset)), buffer, prefix_size);
-        ata_device_write_sector(dev, start_block, (uint8_t *)support_buffer);
-        x_offset += prefix_size;
-        ++start_block;
+    size_t remaining = size;
+    size_t head_size = 0;
+    ata_bio_t bios[3], partial[2];
+    ata_bio_t *head = NULL, *tail = NULL;
+    unsigned nbios = 0, npartial = 0;
+
+    if (sector_offs && remaining) {
+        head_size = min(ATA_SECTOR_SIZE - sector_offs, remaining);
+        head      = &bios[nbios++];
+        ata_bio_init(head, lba_sector++, 1, (uint8_t *)support_buffer[0], false);
+        partial[npartial++] = *head;
+        remaining -= head_size;
+    }
+    if (remaining >= ATA_SECTOR_SIZE) {
+        uint32_t count = remaining / ATA_SECTOR_SIZE;
+        ata_bio_init(&bios[nbios++], lba_sector, count, (uint8_t *)input + head_size, true);
+        remaining -= count * ATA_SECTOR_SIZE;
+        lba_sector += count;
+    }
+    if (remaining) {
+        tail = &bios[nbios++];
+        ata_bio_init(tail, lba_sector, 1, (uint8_t *)support_buffer[1], false);
+        partial[npartial++] = *tail;
+    }
+
+    // Read the partial sectors first, so that they can be patched.
+    ata_submit_bios(dev, partial, npartial);
+    for (unsigned i = 0; i < npartial; ++i) {
+        if (partial[i].status < 0) {
+            return -EIO;
+        }
     }
-
-    // Handle the postfix if needed.
-    if (postfix_size && (start_block <= end_block)) {
-        ata_device_read_sector(dev, end_block, (uint8_t *)support_buffer);
-        memcpy(support_buffer, (void *)((uintptr_t)buffer + size - postfix_size), postfix_size);
-        ata_device_write_sector(dev, end_block, (uint8_t *)support_buffer);
-        --end_block;
+    if (head) {
+        memcpy(support_buffer[0] + sector_offs, input, head_size);
+        head->write = true;
+    }
+    if (tail) {
+        memcpy(support_buffer[1], input + size - remaining, remaining);
+        tail->write = true;
     }
 
-    // Write full sectors in between.
-    for (; start_block <= end_block; ++start_block) {
-        ata_device_write_sector(dev, start_block, (uint8_t *)((uintptr_t)buffer + x_offset));
-        x_offset += ATA_SECTOR_SIZE;
+    // The bios are adjacent, they share a command when they fit in one.
+    ata_submit_bios(dev, bios, nbios);
+    for (unsigned i = 0; i < nbios; ++i) {
+        if (bios[i].status < 0) {
+            return -EIO;
+        }
     }
 
     return size;
@@ -1716,23 +1957,38 @@ static ata_device_type_t ata_device_detect(ata_device_t *dev)
 }
 
 // == IRQ HANDLERS ============================================================
+
+/// @brief Acknowledges a bus-master interrupt raised on a channel, on behalf
+/// of the device which started the DMA transfer in flight.
+/// @param dev the device with a transfer in flight on the channel, if any.
+static inline void ata_dma_irq_acknowledge(ata_device_t *dev)
+{
+    if (!dev || !dev->bmr.status) {
+        return;
+    }
+    uint8_t bmr_status = inportb(dev->bmr.status);
+    if (bmr_status & ATA_BMR_STATUS_IRQ) {
+        dev->dma.completed = true;
+        // Reading the status register clears the interrupt on the device.
+        inportb(dev->io_reg.status);
+        // The IRQ bit is cleared by writing 1 to it.
+        outportb(dev->bmr.status, bmr_status | ATA_BMR_STATUS_IRQ);
+    }
+}
+
+/// @brief Handles the interrupts of the primary ATA channel.
 /// @param f The interrupt stack frame.
 static void ata_irq_handler_master(pt_regs_t *f)
 {
-    pr_warning("ata_irq_handler_master\n");
-    inportb(ata_primary_master.io_reg.status);
-    inportb(ata_primary_master.bmr.status);
-    //outportb(ata_primary_master.bmr.command, ata_bm_stop_bus_master);
+    ata_dma_irq_acknowledge(ata_primary_dma_device);
     pic8259_send_eoi(IRQ_FIRST_HD);
 }
 
+/// @brief Handles the interrupts of the secondary ATA channel.
 /// @param f The interrupt stack frame.
 static void ata_irq_handler_slave(pt_regs_t *f)
 {
-    pr_warning("ata_irq_handler_slave\n");
-    inportb(ata_secondary_master.io_reg.status);
-    inportb(ata_primary_master.bmr.status);
-    //outportb(ata_primary_master.bmr.command, ata_bm_stop_bus_master);
+    ata_dma_irq_acknowledge(ata_secondary_dma_device);
     pic8259_send_eoi(IRQ_SECOND_HD);
 }
 
@@ -1779,8 +2035,8 @@ int ata_initialize(void)
     irq_install_handler(IRQ_FIRST_HD, ata_irq_handler_master, "IDE Master");
     irq_install_handler(IRQ_SECOND_HD, ata_irq_handler_slave, "IDE Slave");
 
-    // Enable bus mastering.
-    ata_dma_enable_bus_mastering();
+    // Enable bus mastering, devices fall back to PIO if it is not available.
+    ata_bus_mastering = (ata_dma_enable_bus_mastering() == 0);
 
     ata_device_detect(&ata_primary_master);
     ata_device_detect(&ata_primary_slave);
@@ -32,6 +32,8 @@ static uint32_t kflags  = 0;
 rb_keybuffer_t scancodes;
 /// Spinlock to protect access to the scancode buffer.
 spinlock_t scancodes_lock;
+/// Processes waiting for a key to be pressed.
+static wait_queue_head_t keyboard_wait_queue;
 
 #define KBD_LEFT_SHIFT    (1 << 0) ///< Flag which identifies the left shift.
 #define KBD_RIGHT_SHIFT   (1 << 1) ///< Flag which identifies the right shift.
@@ -165,6 +167,10 @@ int keyboard_peek_front(void)
     return c;
 }
 
+wait_queue_entry_t *keyboard_sleep_on(void) { return sleep_on_interruptible(&keyboard_wait_queue); }
+
+void keyboard_wake_up(void) { wake_up(&keyboard_wait_queue); }
+
 void keyboard_isr(pt_regs_t *f)
 {
     unsigned int scancode;
@@ -386,6 +392,10 @@ void keyboard_isr(pt_regs_t *f)
             keyboard_push_front(keymap->normal);
         }
     }
+    // Wake up the processes reading from the terminal.
+    if (!rb_keybuffer_is_empty(&scancodes)) {
+        keyboard_wake_up();
+    }
     pic8259_send_eoi(IRQ_KEYBOARD);
 }
 
@@ -411,6 +421,8 @@ int keyboard_initialize(void)
     rb_keybuffer_init(&scancodes);
     // Initialize the spinlock.
     spinlock_init(&scancodes_lock);
+    // Initialize the queue of the processes waiting for a key.
+    wait_queue_head_init(&keyboard_wait_queue);
     // Initialize the keymaps.
     init_keymaps();
     // Install the IRQ.
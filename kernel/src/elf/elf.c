@@ -12,14 +12,16 @@
 #include "assert.h"
 #include "elf/elf.h"
 #include "fs/vfs.h"
-#include "mem/paging.h"
 #include "mem/alloc/slab.h"
+#include "mem/alloc/zone_allocator.h"
 #include "mem/mm/vmem.h"
+#include "mem/paging.h"
 #include "process/process.h"
 #include "process/scheduler.h"
 #include "stddef.h"
 #include "stdio.h"
 #include "string.h"
+#include "sys/mman.h"
 
 // ============================================================================
 // GET ELF TABLES
@@ -241,43 +243,144 @@ static inline void elf_dump_symbol_table(elf_header_t *header)
 // EXEC-RELATED FUNCTIONS
 // ============================================================================
 
+/// @brief Provides the first page of the segment holding no data from the
+/// file, which must be zeroed past the end of the file data, since the rest of
+/// the page in the file belongs to something else.
+/// @param task The task for which we load the ELF.
+/// @param file The ELF file.
+/// @param program_header The header of the segment.
+/// @return 0 on success, -1 on failure.
+static inline int elf_load_partial_page(task_struct *task, vfs_file_t *file, elf_program_header_t *program_header)
+{
+    uint32_t file_end = program_header->vaddr + program_header->filesz;
+    uint32_t vaddr    = file_end & ~(PAGE_SIZE - 1);
+    uint32_t length   = file_end - vaddr;
+    // The page starts this much before the end of the segment inside the file.
+    uint32_t offset   = program_header->offset + program_header->filesz - length;
+
+    page_t *page = alloc_pages(GFP_HIGHUSER | __GFP_ZERO, 0);
+    if (!page) {
+        pr_err("Failed to allocate the page at 0x%08x.\n", vaddr);
+        return -1;
+    }
+    void *data  = vmem_kmap(page, KMAP_DST);
+    ssize_t ret = vfs_read(file, data, offset, length);
+    vmem_kunmap(data, KMAP_DST);
+    if (ret != length) {
+        pr_err("Failed to read %u bytes at offset %u of `%s`.\n", length, offset, file->name);
+        free_pages(page);
+        return -1;
+    }
+    uint32_t pgflags = MM_PRESENT | MM_USER | MM_UPDADDR | ((program_header->flags & PF_W) ? MM_RW : 0);
+    if (mem_upd_vm_area(task->mm->pgd, vaddr, get_physical_address_from_page(page), PAGE_SIZE, pgflags) < 0) {
+        pr_err("Failed to map the page at 0x%08x.\n", vaddr);
+        free_pages(page);
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Maps a loadable segment into the memory of the task.
+/// @details The pages holding data from the file are mapped privately from the
+/// file, while the remaining ones (i.e., .bss) are zero-filled on demand.
+/// @param task The task for which we load the ELF.
+/// @param file The ELF file.
+/// @param program_header The header of the segment.
+/// @return 0 on success, -1 on failure.
+static inline int elf_load_segment(task_struct *task, vfs_file_t *file, elf_program_header_t *program_header)
+{
+    vm_area_struct_t *segment;
+
+    // Pages of the file can be mapped only at matching page offsets.
+    if (((program_header->vaddr % PAGE_SIZE) != (program_header->offset % PAGE_SIZE)) ||
+        (program_header->filesz > program_header->memsz)) {
+        pr_err("Segment at 0x%08x cannot be mapped.\n", program_header->vaddr);
+        return -1;
+    }
+
+    uint32_t vm_start = program_header->vaddr & ~(PAGE_SIZE - 1);
+    uint32_t file_end = (program_header->vaddr + program_header->filesz + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    uint32_t mem_end  = (program_header->vaddr + program_header->memsz + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+    if (file_end > vm_start) {
+        segment = vm_area_create(task->mm, vm_start, file_end - vm_start, MM_USER | MM_RW, GFP_HIGHUSER);
+        if (!segment) {
+            return -1;
+        }
+        segment->vm_page_prot = PROT_READ;
+        if (program_header->flags & PF_W) {
+            segment->vm_page_prot |= PROT_WRITE;
+        }
+        if (program_header->flags & PF_X) {
+            segment->vm_page_prot |= PROT_EXEC;
+        }
+        segment->vm_flags = MAP_PRIVATE;
+        segment->vm_file  = file;
+        segment->vm_pgoff = (program_header->offset - (program_header->vaddr - vm_start)) / PAGE_SIZE;
+        ++file->count;
+
+        // The last page is shared between the data and the zeroed memory.
+        if ((program_header->memsz > program_header->filesz) && ((program_header->vaddr + program_header->filesz) % PAGE_SIZE)) {
+            if (elf_load_partial_page(task, file, program_header) < 0) {
+                return -1;
+            }
+        }
+    }
+    if (mem_end > file_end) {
+        segment = vm_area_create(
+            task->mm, file_end, mem_end - file_end, MM_USER | MM_RW | MM_PRESENT | MM_COW, GFP_HIGHUSER);
+        if (!segment) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
 /// @brief Loads an ELF executable.
-/// @param header  The header of the ELF file.
+/// @param file The ELF file.
+/// @param header The header of the ELF file.
 /// @param task The task for which we load the ELF.
 /// @return The ELF entry.
-static inline int elf_load_exec(elf_header_t *header, task_struct *task)
+static inline int elf_load_exec(vfs_file_t *file, elf_header_t *header, task_struct *task)
 {
+    elf_program_header_t *program_headers;
     elf_program_header_t *program_header;
-    vm_area_struct_t *segment;
-    virt_map_page_t *vpage;
-    uint32_t dst_addr;
-    uint32_t zmem_sz;
+    uint32_t size;
+
+    if (header->phentsize != sizeof(elf_program_header_t)) {
+        pr_err("Unsupported program header size %u.\n", header->phentsize);
+        return false;
+    }
+    // Read the program header table, which is all we need from the file.
+    size            = header->phnum * sizeof(elf_program_header_t);
+    program_headers = kmalloc(size);
+    if (program_headers == NULL) {
+        pr_err("Failed to allocate %u bytes for the program headers.\n", size);
+        return false;
+    }
+    if (vfs_read(file, program_headers, header->phoff, size) != size) {
+        pr_err("Failed to read the program headers of `%s`.\n", file->name);
+        kfree(program_headers);
+        return false;
+    }
 
     pr_debug(" Type      | Mem. Size | File Size | VADDR\n");
     for (unsigned i = 0; i < header->phnum; ++i) {
         // Get the header.
-        program_header = elf_get_program_header(header, i);
+        program_header = &program_headers[i];
         // Dump the information about the header.
         pr_debug(
             " %-9s | %9s | %9s | 0x%08x - 0x%08x\n", elf_type_to_string(program_header->type),
             to_human_size(program_header->memsz), to_human_size(program_header->filesz), program_header->vaddr,
             program_header->vaddr + program_header->memsz);
-        if (program_header->type == PT_LOAD) {
-            segment = vm_area_create(
-                task->mm, program_header->vaddr, program_header->memsz, MM_USER | MM_RW | MM_PRESENT, GFP_KERNEL);
-            vpage    = vmem_map_alloc_virtual(program_header->memsz);
-            dst_addr = vmem_map_virtual_address(task->mm, vpage, segment->vm_start, program_header->memsz);
-
-            // Load the memory area.
-            memcpy((void *)dst_addr, (void *)((uintptr_t)header + program_header->offset), program_header->filesz);
-
-            if (program_header->memsz > program_header->filesz) {
-                zmem_sz = program_header->memsz - program_header->filesz;
-                memset((void *)(dst_addr + program_header->filesz), 0, zmem_sz);
+        if ((program_header->type == PT_LOAD) && program_header->memsz) {
+            if (elf_load_segment(task, file, program_header) < 0) {
+                kfree(program_headers);
+                return false;
             }
-            vmem_unmap_virtual_address_page(vpage);
         }
     }
+    kfree(program_headers);
     return true;
 }
 
@@ -287,59 +390,37 @@ int elf_load_file(task_struct *task, vfs_file_t *file, uint32_t *entry)
     if (file == NULL) {
         return false;
     }
-    // Get the size of the file.
-    stat_t stat_buf;
-    if (vfs_fstat(file, &stat_buf) < 0) {
-        pr_err("Failed to stat the file `%s`.\n", file->name);
-        return false;
-    }
-    // Allocate the memory for the file.
-    char *buffer = kmalloc(stat_buf.st_size);
-    if (buffer == NULL) {
-        pr_err(
-            "Failed to allocate %d bytes of memory for reading the file "
-            "`%s`.\n",
-            stat_buf.st_size, file->name);
+    // Read the ELF header, the segments are mapped from the file.
+    elf_header_t header;
+    if (vfs_read(file, &header, 0, sizeof(elf_header_t)) != sizeof(elf_header_t)) {
+        pr_err("Failed to read the ELF header of `%s`.\n", file->name);
         return false;
     }
-    // Clean the memory.
-    memset(buffer, 0, stat_buf.st_size);
-    // Read the file.
-    if (vfs_read(file, buffer, 0, stat_buf.st_size) != stat_buf.st_size) {
-        pr_err("Failed to read %d bytes from the file `%s`.\n", stat_buf.st_size, file->name);
-        goto return_error_free_buffer;
-    }
-    // The first thing inside the file is the ELF header.
-    elf_header_t *header = (elf_header_t *)buffer;
     // Print header info.
-    pr_debug("Type           : %s\n", elf_type_to_string(header->type));
-    pr_debug("Version        : 0x%x\n", header->version);
-    pr_debug("Entry          : 0x%x\n", header->entry);
-    pr_debug("Headers offset : 0x%x\n", header->phoff);
-    pr_debug("Headers count  : %d\n", header->phnum);
+    pr_debug("Type           : %s\n", elf_type_to_string(header.type));
+    pr_debug("Version        : 0x%x\n", header.version);
+    pr_debug("Entry          : 0x%x\n", header.entry);
+    pr_debug("Headers offset : 0x%x\n", header.phoff);
+    pr_debug("Headers count  : %d\n", header.phnum);
     // Check the elf header.
-    if (!elf_check_file_header(header)) {
-        pr_err("File %s is not a valid ELF file.\n", stat_buf.st_size, file->name);
-        goto return_error_free_buffer;
+    if (!elf_check_file_header(&header)) {
+        pr_err("File %s is not a valid ELF file.\n", file->name);
+        return false;
     }
     // Check if the elf file is an executable.
-    if (header->type != ET_EXEC) {
+    if (header.type != ET_EXEC) {
         pr_err("Elf file is not an executable.\n");
-        goto return_error_free_buffer;
+        return false;
     }
-    if (!elf_load_exec(header, task)) {
+    if (!elf_load_exec(file, &header, task)) {
         pr_err("Failed to load the executable.\n");
-        goto return_error_free_buffer;
+        return false;
     }
 
     // Set the entry.
-    (*entry) = header->entry;
+    (*entry) = header.entry;
 
-    kfree(buffer);
     return true;
-return_error_free_buffer:
-    kfree(buffer);
-    return false;
 }
 
 int elf_check_file_type(vfs_file_t *file, Elf_Type type)
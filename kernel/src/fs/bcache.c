@@ -0,0 +1,313 @@
+/// @file bcache.c
+/// @brief Block buffer cache shared by block-based filesystems.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[BCACHE]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "fs/bcache.h"
+#include "fs/vfs.h"
+#include "klib/spinlock.h"
+#include "mem/alloc/slab.h"
+#include "string.h"
+
+/// Number of buckets of the hash table, must be a power of two.
+#define BCACHE_HASH_SIZE   256
+/// Maximum number of buffers kept in memory.
+#define BCACHE_MAX_BUFFERS 256
+
+/// @brief A cached block.
+typedef struct bcache_buffer {
+    /// The device the block belongs to.
+    vfs_file_t *device;
+    /// The index of the block on the device.
+    uint32_t block_index;
+    /// The size of the block.
+    uint32_t block_size;
+    /// If the content differs from the one on the device.
+    int dirty;
+    /// The content of the block.
+    uint8_t *data;
+    /// Link inside the hash bucket.
+    list_head_t hash_link;
+    /// Link inside the LRU list.
+    list_head_t lru_link;
+} bcache_buffer_t;
+
+/// @brief The buffer cache.
+static struct {
+    /// Hash table of cached buffers.
+    list_head_t buckets[BCACHE_HASH_SIZE];
+    /// List of buffers, most recently used first.
+    list_head_t lru;
+    /// Cache of buffer descriptors.
+    kmem_cache_t *buffer_cache;
+    /// Collected statistics.
+    bcache_stats_t stats;
+    /// Protects the whole cache.
+    spinlock_t lock;
+} bcache;
+
+/// @brief Computes the hash bucket of the given block.
+/// @param device the block device.
+/// @param block_index the index of the block.
+/// @return the bucket.
+static inline list_head_t *__bcache_bucket(vfs_file_t *device, uint32_t block_index)
+{
+    uint32_t hash = ((uint32_t)device >> 4) ^ (block_index * 2654435761U);
+    return &bcache.buckets[(hash ^ (hash >> 16)) & (BCACHE_HASH_SIZE - 1)];
+}
+
+/// @brief Searches the given block inside the cache.
+/// @param device the block device.
+/// @param block_index the index of the block.
+/// @param block_size the size of the block.
+/// @return the buffer if found, NULL otherwise.
+static inline bcache_buffer_t *__bcache_lookup(vfs_file_t *device, uint32_t block_index, uint32_t block_size)
+{
+    list_head_t *bucket = __bcache_bucket(device, block_index);
+    list_for_each_decl (it, bucket) {
+        bcache_buffer_t *buffer = list_entry(it, bcache_buffer_t, hash_link);
+        if ((buffer->device == device) && (buffer->block_index == block_index) && (buffer->block_size == block_size)) {
+            return buffer;
+        }
+    }
+    return NULL;
+}
+
+/// @brief Writes back the buffer, if dirty.
+/// @param buffer the buffer to write.
+/// @return 0 on success, -1 on failure.
+static inline int __bcache_writeback(bcache_buffer_t *buffer)
+{
+    if (!buffer->dirty) {
+        return 0;
+    }
+    size_t offset = buffer->block_index * buffer->block_size;
+    if (vfs_write(buffer->device, buffer->data, offset, buffer->block_size) < 0) {
+        pr_err("Failed to write back block %u.\n", buffer->block_index);
+        return -1;
+    }
+    buffer->dirty = 0;
+    bcache.stats.dirty--;
+    bcache.stats.writebacks++;
+    return 0;
+}
+
+/// @brief Removes the buffer from the cache and frees it.
+/// @param buffer the buffer to destroy.
+static inline void __bcache_destroy(bcache_buffer_t *buffer)
+{
+    list_head_remove(&buffer->hash_link);
+    list_head_remove(&buffer->lru_link);
+    kfree(buffer->data);
+    kmem_cache_free(buffer);
+    bcache.stats.buffers--;
+}
+
+/// @brief Provides an unused buffer for the given block, evicting the least
+/// recently used one if the cache is full.
+/// @param device the block device.
+/// @param block_index the index of the block.
+/// @param block_size the size of the block.
+/// @return the buffer, already linked inside the cache, or NULL on failure.
+static bcache_buffer_t *__bcache_get_buffer(vfs_file_t *device, uint32_t block_index, uint32_t block_size)
+{
+    bcache_buffer_t *buffer = NULL;
+    if (bcache.stats.buffers >= BCACHE_MAX_BUFFERS) {
+        // Recycle the least recently used buffer.
+        buffer = list_entry(bcache.lru.prev, bcache_buffer_t, lru_link);
+        if (__bcache_writeback(buffer) < 0) {
+            return NULL;
+        }
+        list_head_remove(&buffer->hash_link);
+        list_head_remove(&buffer->lru_link);
+        bcache.stats.evictions++;
+        // Blocks of different filesystems can have different sizes.
+        if (buffer->block_size != block_size) {
+            kfree(buffer->data);
+            buffer->data = NULL;
+        }
+    } else {
+        buffer = kmem_cache_alloc(bcache.buffer_cache, GFP_KERNEL);
+        if (!buffer) {
+            return NULL;
+        }
+        buffer->data = NULL;
+        bcache.stats.buffers++;
+    }
+    if (!buffer->data) {
+        buffer->data = kmalloc(block_size);
+        if (!buffer->data) {
+            kmem_cache_free(buffer);
+            bcache.stats.buffers--;
+            return NULL;
+        }
+    }
+    buffer->device      = device;
+    buffer->block_index = block_index;
+    buffer->block_size  = block_size;
+    buffer->dirty       = 0;
+    list_head_insert_after(&buffer->hash_link, __bcache_bucket(device, block_index));
+    list_head_insert_after(&buffer->lru_link, &bcache.lru);
+    return buffer;
+}
+
+int bcache_initialize(void)
+{
+    for (unsigned i = 0; i < BCACHE_HASH_SIZE; ++i) {
+        list_head_init(&bcache.buckets[i]);
+    }
+    list_head_init(&bcache.lru);
+    memset(&bcache.stats, 0, sizeof(bcache_stats_t));
+    spinlock_init(&bcache.lock);
+    bcache.buffer_cache = KMEM_CREATE(bcache_buffer_t);
+    if (!bcache.buffer_cache) {
+        pr_crit("Failed to create the buffer descriptors cache.\n");
+        return -1;
+    }
+    return 0;
+}
+
+ssize_t bcache_read(vfs_file_t *device, uint32_t block_index, uint32_t block_size, void *buffer)
+{
+    if (!device || !buffer || !block_size) {
+        return -1;
+    }
+    spinlock_lock(&bcache.lock);
+    bcache_buffer_t *cached = __bcache_lookup(device, block_index, block_size);
+    if (cached) {
+        bcache.stats.hits++;
+        // Move the buffer in front of the LRU list.
+        list_head_remove(&cached->lru_link);
+        list_head_insert_after(&cached->lru_link, &bcache.lru);
+        memcpy(buffer, cached->data, block_size);
+        spinlock_unlock(&bcache.lock);
+        return block_size;
+    }
+    bcache.stats.misses++;
+    cached = __bcache_get_buffer(device, block_index, block_size);
+    if (!cached) {
+        spinlock_unlock(&bcache.lock);
+        // Fall back to a direct read.
+        return vfs_read(device, buffer, block_index * block_size, block_size);
+    }
+    if (vfs_read(device, cached->data, block_index * block_size, block_size) < 0) {
+        pr_err("Failed to read block %u.\n", block_index);
+        __bcache_destroy(cached);
+        spinlock_unlock(&bcache.lock);
+        return -1;
+    }
+    memcpy(buffer, cached->data, block_size);
+    spinlock_unlock(&bcache.lock);
+    return block_size;
+}
+
+ssize_t bcache_read_range(vfs_file_t *device, uint32_t block_index, uint32_t count, uint32_t block_size, void *buffer)
+{
+    if (!device || !buffer || !block_size) {
+        return -1;
+    }
+    uint8_t *output = (uint8_t *)buffer;
+    spinlock_lock(&bcache.lock);
+    for (uint32_t i = 0; i < count;) {
+        bcache_buffer_t *cached = __bcache_lookup(device, block_index + i, block_size);
+        if (cached) {
+            bcache.stats.hits++;
+            memcpy(output + (i * block_size), cached->data, block_size);
+            ++i;
+            continue;
+        }
+        // Blocks which are not cached cannot be dirty, read the whole run
+        // straight from the device.
+        uint32_t run = 1;
+        while ((i + run < count) && !__bcache_lookup(device, block_index + i + run, block_size)) {
+            ++run;
+        }
+        bcache.stats.misses += run;
+        if (vfs_read(device, output + (i * block_size), (block_index + i) * block_size, run * block_size) < 0) {
+            pr_err("Failed to read blocks %u-%u.\n", block_index + i, block_index + i + run - 1);
+            spinlock_unlock(&bcache.lock);
+            return -1;
+        }
+        i += run;
+    }
+    spinlock_unlock(&bcache.lock);
+    return count * block_size;
+}
+
+ssize_t bcache_write(vfs_file_t *device, uint32_t block_index, uint32_t block_size, const void *buffer)
+{
+    if (!device || !buffer || !block_size) {
+        return -1;
+    }
+    spinlock_lock(&bcache.lock);
+    bcache_buffer_t *cached = __bcache_lookup(device, block_index, block_size);
+    if (cached) {
+        list_head_remove(&cached->lru_link);
+        list_head_insert_after(&cached->lru_link, &bcache.lru);
+    } else {
+        // The whole block is overwritten, there is no need to read it first.
+        cached = __bcache_get_buffer(device, block_index, block_size);
+        if (!cached) {
+            spinlock_unlock(&bcache.lock);
+            // Fall back to a direct write.
+            return vfs_write(device, buffer, block_index * block_size, block_size);
+        }
+    }
+    memcpy(cached->data, buffer, block_size);
+    if (!cached->dirty) {
+        cached->dirty = 1;
+        bcache.stats.dirty++;
+    }
+    spinlock_unlock(&bcache.lock);
+    return block_size;
+}
+
+int bcache_sync(vfs_file_t *device)
+{
+    int ret = 0;
+    spinlock_lock(&bcache.lock);
+    // Walk from the oldest buffer, which is the most likely to be evicted.
+    list_for_each_prev_decl (it, &bcache.lru) {
+        bcache_buffer_t *buffer = list_entry(it, bcache_buffer_t, lru_link);
+        if (device && (buffer->device != device)) {
+            continue;
+        }
+        if (__bcache_writeback(buffer) < 0) {
+            ret = -1;
+        }
+    }
+    spinlock_unlock(&bcache.lock);
+    return ret;
+}
+
+int bcache_invalidate(vfs_file_t *device)
+{
+    int ret = 0;
+    spinlock_lock(&bcache.lock);
+    list_for_each_safe_decl (it, store, &bcache.lru) {
+        bcache_buffer_t *buffer = list_entry(it, bcache_buffer_t, lru_link);
+        if (device && (buffer->device != device)) {
+            continue;
+        }
+        if (__bcache_writeback(buffer) < 0) {
+            ret = -1;
+            continue;
+        }
+        __bcache_destroy(buffer);
+    }
+    spinlock_unlock(&bcache.lock);
+    return ret;
+}
+
+void bcache_get_stats(bcache_stats_t *stats)
+{
+    spinlock_lock(&bcache.lock);
+    *stats = bcache.stats;
+    spinlock_unlock(&bcache.lock);
+}
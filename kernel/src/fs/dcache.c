@@ -0,0 +1,220 @@
+/// @file dcache.c
+/// @brief Directory entry cache used during path resolution.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[DCACHE]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "fs/dcache.h"
+#include "klib/spinlock.h"
+#include "limits.h"
+#include "list_head.h"
+#include "mem/alloc/slab.h"
+#include "string.h"
+
+/// Number of buckets of the hash table, must be a power of two.
+#define DCACHE_HASH_SIZE   256
+/// Maximum number of entries kept in memory.
+#define DCACHE_MAX_ENTRIES 512
+
+/// @brief A cached directory entry.
+typedef struct dentry {
+    /// The filesystem instance.
+    const void *fs;
+    /// The inode of the directory containing the entry.
+    ino_t parent;
+    /// The hash of the key.
+    uint32_t hash;
+    /// The content of the entry.
+    dcache_entry_t entry;
+    /// Link inside the hash bucket.
+    list_head_t hash_link;
+    /// Link inside the LRU list.
+    list_head_t lru_link;
+    /// The name of the entry.
+    char name[NAME_MAX];
+} dentry_t;
+
+/// @brief The directory entry cache.
+static struct {
+    /// Hash table of cached entries.
+    list_head_t buckets[DCACHE_HASH_SIZE];
+    /// List of entries, most recently used first.
+    list_head_t lru;
+    /// Cache of entries.
+    kmem_cache_t *dentry_cache;
+    /// Collected statistics.
+    dcache_stats_t stats;
+    /// Protects the whole cache.
+    spinlock_t lock;
+} dcache;
+
+/// @brief Hashes the key of an entry.
+/// @param fs the filesystem instance.
+/// @param parent the inode of the directory.
+/// @param name the name of the entry.
+/// @return the hash.
+static inline uint32_t __dcache_hash(const void *fs, ino_t parent, const char *name)
+{
+    uint32_t hash = ((uint32_t)fs >> 4) ^ ((uint32_t)parent * 2654435761U);
+    while (*name) {
+        hash = (hash * 31) + (unsigned char)*name++;
+    }
+    return hash ^ (hash >> 16);
+}
+
+/// @brief Searches the entry inside the hash table.
+/// @param fs the filesystem instance.
+/// @param parent the inode of the directory.
+/// @param name the name of the entry.
+/// @param hash the hash of the key.
+/// @return the entry if found, NULL otherwise.
+static inline dentry_t *__dcache_find(const void *fs, ino_t parent, const char *name, uint32_t hash)
+{
+    list_for_each_decl (it, &dcache.buckets[hash & (DCACHE_HASH_SIZE - 1)]) {
+        dentry_t *dentry = list_entry(it, dentry_t, hash_link);
+        if ((dentry->hash == hash) && (dentry->fs == fs) && (dentry->parent == parent) &&
+            (strcmp(dentry->name, name) == 0)) {
+            return dentry;
+        }
+    }
+    return NULL;
+}
+
+/// @brief Removes the entry from the cache and frees it.
+/// @param dentry the entry to destroy.
+static inline void __dcache_destroy(dentry_t *dentry)
+{
+    list_head_remove(&dentry->hash_link);
+    list_head_remove(&dentry->lru_link);
+    kmem_cache_free(dentry);
+    dcache.stats.entries--;
+}
+
+int dcache_initialize(void)
+{
+    for (unsigned i = 0; i < DCACHE_HASH_SIZE; ++i) {
+        list_head_init(&dcache.buckets[i]);
+    }
+    list_head_init(&dcache.lru);
+    memset(&dcache.stats, 0, sizeof(dcache_stats_t));
+    spinlock_init(&dcache.lock);
+    dcache.dentry_cache = KMEM_CREATE(dentry_t);
+    if (!dcache.dentry_cache) {
+        pr_crit("Failed to create the directory entries cache.\n");
+        return -1;
+    }
+    return 0;
+}
+
+int dcache_lookup(const void *fs, ino_t parent, const char *name, dcache_entry_t *entry)
+{
+    if (!dcache.dentry_cache || !name || (strlen(name) >= NAME_MAX)) {
+        return 0;
+    }
+    spinlock_lock(&dcache.lock);
+    dentry_t *dentry = __dcache_find(fs, parent, name, __dcache_hash(fs, parent, name));
+    if (!dentry) {
+        dcache.stats.misses++;
+        spinlock_unlock(&dcache.lock);
+        return 0;
+    }
+    if (dentry->entry.ino) {
+        dcache.stats.hits++;
+    } else {
+        dcache.stats.negative_hits++;
+    }
+    // Move the entry in front of the LRU list.
+    list_head_remove(&dentry->lru_link);
+    list_head_insert_after(&dentry->lru_link, &dcache.lru);
+    *entry = dentry->entry;
+    spinlock_unlock(&dcache.lock);
+    return 1;
+}
+
+void dcache_add(const void *fs, ino_t parent, const char *name, const dcache_entry_t *entry)
+{
+    if (!dcache.dentry_cache || !name || (strlen(name) >= NAME_MAX)) {
+        return;
+    }
+    uint32_t hash = __dcache_hash(fs, parent, name);
+    spinlock_lock(&dcache.lock);
+    dentry_t *dentry = __dcache_find(fs, parent, name, hash);
+    if (dentry) {
+        list_head_remove(&dentry->lru_link);
+        list_head_remove(&dentry->hash_link);
+    } else if (dcache.stats.entries >= DCACHE_MAX_ENTRIES) {
+        // Recycle the least recently used entry.
+        dentry = list_entry(dcache.lru.prev, dentry_t, lru_link);
+        list_head_remove(&dentry->lru_link);
+        list_head_remove(&dentry->hash_link);
+        dcache.stats.evictions++;
+    } else {
+        dentry = kmem_cache_alloc(dcache.dentry_cache, GFP_KERNEL);
+        if (!dentry) {
+            spinlock_unlock(&dcache.lock);
+            return;
+        }
+        dcache.stats.entries++;
+    }
+    dentry->fs     = fs;
+    dentry->parent = parent;
+    dentry->hash   = hash;
+    strcpy(dentry->name, name);
+    if (entry) {
+        dentry->entry = *entry;
+    } else {
+        memset(&dentry->entry, 0, sizeof(dcache_entry_t));
+    }
+    list_head_insert_after(&dentry->hash_link, &dcache.buckets[hash & (DCACHE_HASH_SIZE - 1)]);
+    list_head_insert_after(&dentry->lru_link, &dcache.lru);
+    spinlock_unlock(&dcache.lock);
+}
+
+void dcache_remove(const void *fs, ino_t parent, const char *name)
+{
+    if (!dcache.dentry_cache || !name || (strlen(name) >= NAME_MAX)) {
+        return;
+    }
+    spinlock_lock(&dcache.lock);
+    dentry_t *dentry = __dcache_find(fs, parent, name, __dcache_hash(fs, parent, name));
+    if (dentry) {
+        __dcache_destroy(dentry);
+    }
+    spinlock_unlock(&dcache.lock);
+}
+
+void dcache_remove_dir(const void *fs, ino_t ino)
+{
+    spinlock_lock(&dcache.lock);
+    list_for_each_safe_decl (it, store, &dcache.lru) {
+        dentry_t *dentry = list_entry(it, dentry_t, lru_link);
+        if ((dentry->fs == fs) && ((dentry->parent == ino) || (dentry->entry.ino == ino))) {
+            __dcache_destroy(dentry);
+        }
+    }
+    spinlock_unlock(&dcache.lock);
+}
+
+void dcache_purge(const void *fs)
+{
+    spinlock_lock(&dcache.lock);
+    list_for_each_safe_decl (it, store, &dcache.lru) {
+        dentry_t *dentry = list_entry(it, dentry_t, lru_link);
+        if (!fs || (dentry->fs == fs)) {
+            __dcache_destroy(dentry);
+        }
+    }
+    spinlock_unlock(&dcache.lock);
+}
+
+void dcache_get_stats(dcache_stats_t *stats)
+{
+    spinlock_lock(&dcache.lock);
+    *stats = dcache.stats;
+    spinlock_unlock(&dcache.lock);
+}
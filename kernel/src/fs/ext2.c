@@ -20,11 +20,17 @@ static int resource_id = -1;
 #include "assert.h"
 #include "errno.h"
 #include "fcntl.h"
+#include "fs/bcache.h"
+#include "fs/dcache.h"
 #include "fs/ext2.h"
+#include "fs/page_cache.h"
 #include "fs/vfs.h"
 #include "fs/vfs_types.h"
 #include "klib/spinlock.h"
 #include "libgen.h"
+#include "math.h"
+#include "mem/mm/page.h"
+#include "mem/paging.h"
 #include "process/process.h"
 #include "process/scheduler.h"
 #include "stdio.h"
@@ -36,6 +42,9 @@ static int resource_id = -1;
 #define EXT2_PATH_MAX          4096   ///< Maximum length of a pathname.
 #define EXT2_MAX_SYMLINK_COUNT 8      ///< Maximum nesting of symlinks, used to prevent a loop.
 #define EXT2_NAME_LEN          255    ///< The lenght of names inside directory entries.
+#define EXT2_MIN_BLOCK_SIZE    1024   ///< The smallest block size.
+#define EXT2_READAHEAD_MIN     4      ///< Pages read ahead when a sequential reader is detected.
+#define EXT2_READAHEAD_MAX     32     ///< Maximum number of pages read ahead of a sequential reader.
 
 // Permissions bit.
 #define EXT2_S_ISUID 0x0800 ///< SUID
@@ -378,6 +387,7 @@ static long ext2_ioctl(vfs_file_t *file, unsigned int request, unsigned long dat
 static ssize_t ext2_getdents(vfs_file_t *file, dirent_t *dirp, off_t doff, size_t count);
 static ssize_t ext2_readlink(const char *path, char *buffer, size_t bufsize);
 static int ext2_fsetattr(vfs_file_t *file, struct iattr *attr);
+static page_t *ext2_getpage(vfs_file_t *file, uint32_t index);
 
 static int ext2_mkdir(const char *path, mode_t mode);
 static int ext2_rmdir(const char *path);
@@ -415,6 +425,7 @@ static vfs_file_operations_t ext2_fs_operations = {
     .getdents_f = ext2_getdents,
     .readlink_f = ext2_readlink,
     .setattr_f  = ext2_fsetattr,
+    .getpage_f  = ext2_getpage,
 };
 
 // ============================================================================
@@ -1004,11 +1015,12 @@ static int ext2_write_superblock(ext2_filesystem_t *fs)
     return vfs_write(fs->block_device, &fs->superblock, 1024, sizeof(ext2_superblock_t));
 }
 
-/// @brief Syncs the filesystem to disk by writing the superblock and all BGDT blocks.
+/// @brief Syncs the filesystem to disk by writing the superblock, all BGDT blocks
+/// and every dirty block held by the buffer cache.
 /// @details This function ensures that the superblock and block group descriptor table
 /// are persisted to disk. This should be called after batch operations like FHS initialization
-/// or when an explicit sync is needed. Inode/block bitmaps and data blocks are already
-/// written during allocation, so this is safe to defer.
+/// or when an explicit sync is needed. Inode/block bitmaps and data blocks are kept
+/// dirty inside the buffer cache until they are evicted or synchronized here.
 /// @param fs the ext2 filesystem structure.
 /// @return 0 on success, negative value on failure.
 static int ext2_sync(ext2_filesystem_t *fs)
@@ -1032,6 +1044,12 @@ static int ext2_sync(ext2_filesystem_t *fs)
         return -1;
     }
 
+    // Write back the blocks held by the buffer cache.
+    if (bcache_sync(fs->block_device) < 0) {
+        pr_warning("Failed to sync cached blocks.\n");
+        return -1;
+    }
+
     pr_debug("ext2_sync() completed successfully\n");
     return 0;
 }
@@ -1051,8 +1069,7 @@ static int ext2_read_block(ext2_filesystem_t *fs, uint32_t block_index, uint8_t
         pr_err("You are trying to read with a NULL buffer.\n");
         return -1;
     }
-    uint64_t offset = (uint64_t)block_index * fs->block_size;
-    return vfs_read(fs->block_device, buffer, offset, fs->block_size);
+    return bcache_read(fs->block_device, block_index, fs->block_size, buffer);
 }
 
 /// @brief Writes a block on the block device associated with this filesystem.
@@ -1070,7 +1087,7 @@ static int ext2_write_block(ext2_filesystem_t *fs, uint32_t block_index, uint8_t
         pr_err("You are trying to write with a NULL buffer.\n");
         return -1;
     }
-    return vfs_write(fs->block_device, buffer, block_index * fs->block_size, fs->block_size);
+    return bcache_write(fs->block_device, block_index, fs->block_size, buffer);
 }
 
 /// @brief Reads the Block Group Descriptor Table (BGDT) from the block device associated with this filesystem.
@@ -1407,6 +1424,9 @@ static int ext2_free_inode(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t
     pr_debug(
         "ext2_free_inode(group: %4u, inode_index: %4u, group_offset: %4u)\n", group_index, inode_index, group_offset);
 
+    // The inode can be reused, drop the cached content.
+    page_cache_invalidate(fs, inode_index);
+
     // Free its blocks.
     for (uint32_t block_index = 0; block_index < block_number; ++block_index) {
         // Get the real index.
@@ -2028,11 +2048,140 @@ static ssize_t ext2_write_inode_data(
             break;
         }
     }
+    // Keep the cached pages of the file up to date.
+    if (ret == (uint32_t)-1) {
+        page_cache_invalidate(fs, inode_index);
+    } else {
+        page_cache_write(fs, inode_index, offset, buffer, ret);
+    }
     // Free the cache.
     ext2_dealloc_cache(cache);
     return ret;
 }
 
+/// @brief Fills a page of the page cache with the content of a regular file.
+/// @details Blocks which are contiguous on the device are read together, holes
+/// and the portion of the page beyond the end of the file are zeroed.
+/// @param fs the filesystem.
+/// @param inode the inode of the file.
+/// @param page_index the index of the page inside the file.
+/// @param data the content of the page.
+/// @return 0 on success, -1 on failure.
+static int ext2_fill_page(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t page_index, uint8_t *data)
+{
+    uint32_t blocks_per_page = PAGE_SIZE / fs->block_size;
+    uint32_t first_block     = page_index * blocks_per_page;
+    uint32_t allocated       = inode->blocks_count / fs->blocks_per_block_count;
+    uint32_t real_index[PAGE_SIZE / EXT2_MIN_BLOCK_SIZE];
+
+    // Map the blocks of the page on the device.
+    for (uint32_t i = 0; i < blocks_per_page; ++i) {
+        real_index[i] = ((first_block + i) < allocated) ? ext2_get_real_block_index(fs, inode, first_block + i) : 0;
+    }
+    for (uint32_t i = 0, run; i < blocks_per_page; i += run) {
+        run = 1;
+        if (real_index[i] == 0) {
+            memset(data + (i * fs->block_size), 0, fs->block_size);
+            continue;
+        }
+        while (((i + run) < blocks_per_page) && (real_index[i + run] == (real_index[i] + run))) {
+            ++run;
+        }
+        if (bcache_read_range(fs->block_device, real_index[i], run, fs->block_size, data + (i * fs->block_size)) < 0) {
+            return -1;
+        }
+    }
+    // Do not expose what lies beyond the end of the file.
+    uint32_t page_start = page_index * PAGE_SIZE;
+    if ((page_start + PAGE_SIZE) > inode->size) {
+        uint32_t valid = (inode->size > page_start) ? (inode->size - page_start) : 0;
+        memset(data + valid, 0, PAGE_SIZE - valid);
+    }
+    return 0;
+}
+
+/// @brief Returns the page of a regular file, reading it if it is not cached.
+/// @param fs the filesystem.
+/// @param inode the inode of the file.
+/// @param inode_index the index of the inode.
+/// @param page_index the index of the page inside the file.
+/// @param readahead if the page is read ahead of the reader.
+/// @return the page, NULL on failure.
+static page_cache_page_t *
+ext2_get_page(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t inode_index, uint32_t page_index, int readahead)
+{
+    page_cache_page_t *page = page_cache_lookup(fs, inode_index, page_index);
+    if (page) {
+        return page;
+    }
+    page = page_cache_alloc(fs, inode_index, page_index, readahead);
+    if (page == NULL) {
+        return NULL;
+    }
+    if (ext2_fill_page(fs, inode, page_index, page->data) < 0) {
+        pr_err("Failed to read page %u of inode %u\n", page_index, inode_index);
+        page_cache_remove(page);
+        return NULL;
+    }
+    return page;
+}
+
+/// @brief Reads the data of a regular file through the page cache.
+/// @details Sequential readers are detected by comparing the offset with the
+/// end of the previous read, and the following pages are read ahead, doubling
+/// the window at every sequential read up to EXT2_READAHEAD_MAX pages.
+/// @param fs the filesystem.
+/// @param inode the inode which we are working with.
+/// @param file the file we are reading.
+/// @param offset the offset from which we start reading the data.
+/// @param nbyte the number of bytes to read.
+/// @param buffer the buffer where the data is copied.
+/// @return the amount we read, -1 on failure.
+static ssize_t ext2_read_inode_data_cached(
+    ext2_filesystem_t *fs,
+    ext2_inode_t *inode,
+    vfs_file_t *file,
+    off_t offset,
+    size_t nbyte,
+    char *buffer)
+{
+    if ((offset >= inode->size) || (nbyte == 0)) {
+        return 0;
+    }
+    uint32_t end_offset = min(inode->size, offset + nbyte);
+    uint32_t first_page = offset / PAGE_SIZE;
+    uint32_t last_page  = (end_offset - 1) / PAGE_SIZE;
+    uint32_t file_pages = (inode->size + PAGE_SIZE - 1) / PAGE_SIZE;
+
+    // Detect sequential accesses, and size the read-ahead window.
+    if (offset == file->ra_offset) {
+        file->ra_pages = file->ra_pages ? min(file->ra_pages * 2, EXT2_READAHEAD_MAX) : EXT2_READAHEAD_MIN;
+    } else {
+        file->ra_pages = 0;
+    }
+    file->ra_offset = end_offset;
+
+    // Copy the requested data.
+    for (uint32_t index = first_page, curr = offset; index <= last_page; ++index) {
+        page_cache_page_t *page = ext2_get_page(fs, inode, file->ino, index, 0);
+        if (page == NULL) {
+            return -1;
+        }
+        uint32_t page_offset = curr % PAGE_SIZE;
+        uint32_t chunk       = min(PAGE_SIZE - page_offset, end_offset - curr);
+        memcpy(buffer + (curr - offset), page->data + page_offset, chunk);
+        curr += chunk;
+    }
+
+    // Read the following pages ahead of the reader.
+    for (uint32_t index = last_page + 1; (index <= last_page + file->ra_pages) && (index < file_pages); ++index) {
+        if (!page_cache_contains(fs, file->ino, index) && !ext2_get_page(fs, inode, file->ino, index, 1)) {
+            break;
+        }
+    }
+    return end_offset - offset;
+}
+
 // ============================================================================
 // Directory Entry Iteration Functions
 // ============================================================================
@@ -2519,6 +2668,9 @@ static int ext2_allocate_direntry(
         }
     }
 
+    // Drop the cached entry, it could be a negative one.
+    dcache_remove(fs, parent_inode_index, name);
+
     // pr_debug("AFTER:\n");
     // ext2_dump_direntries(fs, cache, &parent_inode);
     // pr_debug("\n");
@@ -2623,6 +2775,9 @@ static int ext2_destroy_direntry(
         return -1;
     }
 
+    // Drop the cached entries of the directory, and those pointing to it.
+    dcache_remove_dir(fs, inode_index);
+
     // Set the inode to zero.
     dirent->inode = 0;
 
@@ -2682,6 +2837,24 @@ static int ext2_find_direntry(ext2_filesystem_t *fs, ino_t ino, const char *name
         return -EPERM;
     }
 
+    // Check the directory entry cache, the root is looked up as `.`.
+    dcache_entry_t cached;
+    if (strcmp(name, "/") && dcache_lookup(fs, ino, name, &cached)) {
+        search->parent_inode = ino;
+        // Negative entry, the name is known not to exist.
+        if (cached.ino == 0) {
+            return -1;
+        }
+        search->direntry.inode     = cached.ino;
+        search->direntry.file_type = cached.type;
+        search->direntry.rec_len   = cached.data[2];
+        search->direntry.name_len  = strlen(name);
+        strcpy(search->direntry.name, name);
+        search->block_index  = cached.data[0];
+        search->block_offset = cached.data[1];
+        return 0;
+    }
+
     // Allocate the cache.
     uint8_t *cache = ext2_alloc_cache(fs);
 
@@ -2707,6 +2880,10 @@ static int ext2_find_direntry(ext2_filesystem_t *fs, ino_t ino, const char *name
     search->parent_inode = ino;
     // Check if we have found the entry.
     if (it.direntry == NULL) {
+        // Remember that the name does not exist.
+        if (strcmp(name, "/")) {
+            dcache_add(fs, ino, name, NULL);
+        }
         goto free_cache_return_error;
     }
     // Copy the direntry.
@@ -2720,6 +2897,15 @@ static int ext2_find_direntry(ext2_filesystem_t *fs, ino_t ino, const char *name
     search->block_index                          = it.block_index;
     // Copy the offset of the direntry inside the block.
     search->block_offset                         = it.block_offset;
+    // Cache the entry for the next lookups.
+    if (strcmp(name, "/")) {
+        cached.ino     = search->direntry.inode;
+        cached.type    = search->direntry.file_type;
+        cached.data[0] = search->block_index;
+        cached.data[1] = search->block_offset;
+        cached.data[2] = search->direntry.rec_len;
+        dcache_add(fs, ino, name, &cached);
+    }
     // Free the cache.
     ext2_dealloc_cache(cache);
     return 0;
@@ -3242,6 +3428,8 @@ static int ext2_unlink(const char *path)
         ret = -1;
         goto early_exit;
     }
+    // Drop the cached entry.
+    dcache_remove(fs, search.parent_inode, search.direntry.name);
     // Clear the directory entry.
     actual_dirent->inode = 0;
     memset(actual_dirent->name, 0, actual_dirent->name_len);
@@ -3308,6 +3496,9 @@ static int ext2_close(vfs_file_t *file)
         // Ensure we are not trying to free the memory of the root.
         if (file == fs->root) {
             pr_warning("ext2_close: Attempted to close the root file `%s`.\n", file->name);
+            // The reference held by the mount is gone, so the filesystem is
+            // being unmounted: its cached entries must not outlive it.
+            dcache_purge(fs);
             return -EPERM;
         }
 
@@ -3353,9 +3544,51 @@ static ssize_t ext2_read(vfs_file_t *file, char *buffer, off_t offset, size_t nb
         pr_err("Reading a directory `%s` is not allowed.\n", file->name);
         return -EISDIR;
     }
+    // Serve regular files from the page cache.
+    if (bitmask_exact(inode.mode, S_IFREG) && (fs->block_size <= PAGE_SIZE)) {
+        return ext2_read_inode_data_cached(fs, &inode, file, offset, nbyte, buffer);
+    }
     return ext2_read_inode_data(fs, &inode, file->ino, offset, nbyte, buffer);
 }
 
+/// @brief Provides the page cache frame holding a page of a regular file.
+/// @details The returned frame gains a reference, so that the page cache does
+/// not recycle it while it is mapped by a process.
+/// @param file The file we are mapping.
+/// @param index The index of the page inside the file.
+/// @return The frame, or NULL if the file cannot be served from the page cache.
+static page_t *ext2_getpage(vfs_file_t *file, uint32_t index)
+{
+    // Get the filesystem.
+    ext2_filesystem_t *fs = (ext2_filesystem_t *)file->device;
+    if (fs == NULL) {
+        pr_err("The file does not belong to an EXT2 filesystem `%s`.\n", file->name);
+        return NULL;
+    }
+    // Only regular files are cached in pages.
+    if (fs->block_size > PAGE_SIZE) {
+        return NULL;
+    }
+    // Get the inode associated with the file.
+    ext2_inode_t inode;
+    if (ext2_read_inode(fs, &inode, file->ino) == -1) {
+        pr_err("Failed to read the inode `%s`.\n", file->name);
+        return NULL;
+    }
+    if (!bitmask_exact(inode.mode, S_IFREG)) {
+        return NULL;
+    }
+    page_cache_page_t *page = ext2_get_page(fs, &inode, file->ino, index, 0);
+    if (page == NULL) {
+        return NULL;
+    }
+    page_t *frame = get_page_from_virtual_address((uint32_t)page->data);
+    if (frame) {
+        page_inc(frame);
+    }
+    return frame;
+}
+
 /// @brief Writes the given content inside the file.
 /// @param file The file descriptor of the file.
 /// @param buffer The content to write.
@@ -4041,6 +4274,8 @@ free_block_groups:
     // Free the memory occupied by the block groups.
     kfree(fs->block_groups);
 free_filesystem:
+    // Drop the entries cached while mounting.
+    dcache_purge(fs);
     // Free the memory occupied by the filesystem.
     kfree(fs);
     return NULL;
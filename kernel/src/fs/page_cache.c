@@ -0,0 +1,225 @@
+/// @file page_cache.c
+/// @brief Page cache holding the content of regular files.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[PCACHE]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "fs/page_cache.h"
+#include "klib/spinlock.h"
+#include "math.h"
+#include "mem/alloc/slab.h"
+#include "mem/alloc/zone_allocator.h"
+#include "mem/mm/page.h"
+#include "mem/paging.h"
+#include "string.h"
+
+/// Number of buckets of the hash table, must be a power of two.
+#define PAGE_CACHE_HASH_SIZE 256
+/// Maximum number of pages kept in memory.
+#define PAGE_CACHE_MAX_PAGES 512
+
+/// @brief The page cache.
+static struct {
+    /// Hash table of cached pages.
+    list_head_t buckets[PAGE_CACHE_HASH_SIZE];
+    /// List of pages, most recently used first.
+    list_head_t lru;
+    /// Cache of page descriptors.
+    kmem_cache_t *page_cache;
+    /// Collected statistics.
+    page_cache_stats_t stats;
+    /// Protects the whole cache.
+    spinlock_t lock;
+} pcache;
+
+/// @brief Computes the hash bucket of the given page.
+/// @param fs the filesystem instance.
+/// @param ino the inode of the file.
+/// @param index the index of the page inside the file.
+/// @return the bucket.
+static inline list_head_t *__page_cache_bucket(const void *fs, ino_t ino, uint32_t index)
+{
+    uint32_t hash = ((uint32_t)fs >> 4) ^ (ino * 2654435761U) ^ (index * 40503U);
+    return &pcache.buckets[(hash ^ (hash >> 16)) & (PAGE_CACHE_HASH_SIZE - 1)];
+}
+
+/// @brief Searches the given page inside the hash table.
+/// @param fs the filesystem instance.
+/// @param ino the inode of the file.
+/// @param index the index of the page inside the file.
+/// @return the page if found, NULL otherwise.
+static inline page_cache_page_t *__page_cache_find(const void *fs, ino_t ino, uint32_t index)
+{
+    list_for_each_decl (it, __page_cache_bucket(fs, ino, index)) {
+        page_cache_page_t *page = list_entry(it, page_cache_page_t, hash_link);
+        if ((page->fs == fs) && (page->ino == ino) && (page->index == index)) {
+            return page;
+        }
+    }
+    return NULL;
+}
+
+/// @brief Checks if the frame of the page is also mapped by some process.
+/// @param page the page to check.
+/// @return 1 if the frame is mapped, 0 otherwise.
+static inline int __page_cache_is_mapped(page_cache_page_t *page)
+{
+    page_t *frame = get_page_from_virtual_address((uint32_t)page->data);
+    return frame && (page_count(frame) > 1);
+}
+
+/// @brief Removes the page from the cache and frees it.
+/// @details If the frame is still mapped by some process, the cache only drops
+/// its reference and the last mapping frees the frame.
+/// @param page the page to destroy.
+static inline void __page_cache_destroy(page_cache_page_t *page)
+{
+    list_head_remove(&page->hash_link);
+    list_head_remove(&page->lru_link);
+    if (__page_cache_is_mapped(page)) {
+        page_dec(get_page_from_virtual_address((uint32_t)page->data));
+    } else {
+        free_pages_lowmem((uint32_t)page->data);
+    }
+    kmem_cache_free(page);
+    pcache.stats.pages--;
+}
+
+/// @brief Finds the least recently used page whose frame is not mapped by
+/// any process, and can therefore be recycled.
+/// @return the page, or NULL if all the pages are mapped.
+static inline page_cache_page_t *__page_cache_victim(void)
+{
+    list_for_each_prev_decl (it, &pcache.lru) {
+        page_cache_page_t *page = list_entry(it, page_cache_page_t, lru_link);
+        if (!__page_cache_is_mapped(page)) {
+            return page;
+        }
+    }
+    return NULL;
+}
+
+int page_cache_initialize(void)
+{
+    for (unsigned i = 0; i < PAGE_CACHE_HASH_SIZE; ++i) {
+        list_head_init(&pcache.buckets[i]);
+    }
+    list_head_init(&pcache.lru);
+    memset(&pcache.stats, 0, sizeof(page_cache_stats_t));
+    spinlock_init(&pcache.lock);
+    pcache.page_cache = KMEM_CREATE(page_cache_page_t);
+    if (!pcache.page_cache) {
+        pr_crit("Failed to create the page descriptors cache.\n");
+        return -1;
+    }
+    return 0;
+}
+
+page_cache_page_t *page_cache_lookup(const void *fs, ino_t ino, uint32_t index)
+{
+    spinlock_lock(&pcache.lock);
+    page_cache_page_t *page = __page_cache_find(fs, ino, index);
+    if (page) {
+        pcache.stats.hits++;
+        // Move the page in front of the LRU list.
+        list_head_remove(&page->lru_link);
+        list_head_insert_after(&page->lru_link, &pcache.lru);
+    } else {
+        pcache.stats.misses++;
+    }
+    spinlock_unlock(&pcache.lock);
+    return page;
+}
+
+int page_cache_contains(const void *fs, ino_t ino, uint32_t index)
+{
+    spinlock_lock(&pcache.lock);
+    int found = (__page_cache_find(fs, ino, index) != NULL);
+    spinlock_unlock(&pcache.lock);
+    return found;
+}
+
+page_cache_page_t *page_cache_alloc(const void *fs, ino_t ino, uint32_t index, int readahead)
+{
+    page_cache_page_t *page = NULL;
+    spinlock_lock(&pcache.lock);
+    // Recycle the least recently used page, mapped pages cannot be recycled
+    // so the cache can temporarily grow beyond its limit.
+    if ((pcache.stats.pages >= PAGE_CACHE_MAX_PAGES) && (page = __page_cache_victim())) {
+        list_head_remove(&page->hash_link);
+        list_head_remove(&page->lru_link);
+        pcache.stats.evictions++;
+    } else {
+        page = kmem_cache_alloc(pcache.page_cache, GFP_KERNEL);
+        if (!page) {
+            spinlock_unlock(&pcache.lock);
+            return NULL;
+        }
+        page->data = (uint8_t *)alloc_pages_lowmem(GFP_KERNEL, 0);
+        if (!page->data) {
+            kmem_cache_free(page);
+            spinlock_unlock(&pcache.lock);
+            return NULL;
+        }
+        pcache.stats.pages++;
+    }
+    if (readahead) {
+        pcache.stats.readahead++;
+    }
+    page->fs    = fs;
+    page->ino   = ino;
+    page->index = index;
+    list_head_insert_after(&page->hash_link, __page_cache_bucket(fs, ino, index));
+    list_head_insert_after(&page->lru_link, &pcache.lru);
+    spinlock_unlock(&pcache.lock);
+    return page;
+}
+
+void page_cache_remove(page_cache_page_t *page)
+{
+    spinlock_lock(&pcache.lock);
+    __page_cache_destroy(page);
+    spinlock_unlock(&pcache.lock);
+}
+
+void page_cache_write(const void *fs, ino_t ino, uint32_t offset, const void *buffer, size_t size)
+{
+    const uint8_t *input = (const uint8_t *)buffer;
+    spinlock_lock(&pcache.lock);
+    while (size > 0) {
+        uint32_t page_offset    = offset % PAGE_SIZE;
+        size_t chunk            = min(PAGE_SIZE - page_offset, size);
+        page_cache_page_t *page = __page_cache_find(fs, ino, offset / PAGE_SIZE);
+        if (page) {
+            memcpy(page->data + page_offset, input, chunk);
+        }
+        input += chunk;
+        offset += chunk;
+        size -= chunk;
+    }
+    spinlock_unlock(&pcache.lock);
+}
+
+void page_cache_invalidate(const void *fs, ino_t ino)
+{
+    spinlock_lock(&pcache.lock);
+    list_for_each_safe_decl (it, store, &pcache.lru) {
+        page_cache_page_t *page = list_entry(it, page_cache_page_t, lru_link);
+        if ((page->fs == fs) && (page->ino == ino)) {
+            __page_cache_destroy(page);
+        }
+    }
+    spinlock_unlock(&pcache.lock);
+}
+
+void page_cache_get_stats(page_cache_stats_t *stats)
+{
+    spinlock_lock(&pcache.lock);
+    *stats = pcache.stats;
+    spinlock_unlock(&pcache.lock);
+}
@@ -22,13 +22,20 @@
 #include "errno.h"
 #include "fcntl.h"
 #include "fs/vfs.h"
+#include "limits.h"
 #include "list_head.h"
+#include "mem/alloc/zone_allocator.h"
+#include "mem/mm/mm.h"
+#include "mem/mm/vm_area.h"
+#include "mem/mm/vmem.h"
 #include "process/scheduler.h"
 #include "stdio.h"
 #include "stdlib.h"
 #include "strerror.h"
 #include "string.h"
+#include "sys/mman.h"
 #include "sys/stat.h"
+#include "system/signal.h"
 #include "system/syscall.h"
 #include "time.h"
 
@@ -108,7 +115,7 @@ static vfs_file_operations_t pipe_fs_operations = {
 /// @param pipe_buffer Pointer to the `pipe_buffer_t` structure to initialize.
 /// @param ops Pointer to the `pipe_buf_operations` structure defining buffer operations.
 /// @return 0 on success, -ENOMEM if page allocation fails.
-static inline int __pipe_buffer_init(pipe_buffer_t *pipe_buffer, struct pipe_buf_operations *ops)
+static inline int __pipe_buffer_init(pipe_buffer_t *pipe_buffer, const struct pipe_buf_operations *ops)
 {
     // Check if we received a valid pipe buffer.
     assert(pipe_buffer && "Received a null pipe buffer.");
@@ -138,6 +145,94 @@ static inline void __pipe_buffer_deinit(pipe_buffer_t *pipe_buffer)
     pipe_buffer->ops    = NULL;
 }
 
+/// @brief Returns a buffer of the ring of a pipe.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @param position The position of the buffer, counting from the first one
+/// holding data.
+/// @return Pointer to the buffer.
+static inline pipe_buffer_t *pipe_info_buffer(pipe_inode_info_t *pipe_info, size_t position)
+{
+    return &pipe_info->bufs[(pipe_info->curbuf + position) % pipe_info->numbuf];
+}
+
+/// @brief Gets a page to fill a buffer of the pipe, reusing the spare one if
+/// there is any.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @return Pointer to the page, or NULL if the allocation fails.
+static inline page_t *__pipe_page_alloc(pipe_inode_info_t *pipe_info)
+{
+    page_t *page = pipe_info->spare_page;
+    if (page) {
+        pipe_info->spare_page = NULL;
+        return page;
+    }
+    // Lowmem pages are permanently mapped, so they can be filled directly.
+    return alloc_pages(GFP_KERNEL, 0);
+}
+
+/// @brief Releases the page of a buffer, and empties the buffer.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @param pipe_buffer Pointer to the buffer to release.
+static inline void __pipe_buffer_release(pipe_inode_info_t *pipe_info, pipe_buffer_t *pipe_buffer)
+{
+    page_t *page = pipe_buffer->page;
+    if (page) {
+        if (pipe_buffer->flags & PIPE_BUF_FLAG_GIFT) {
+            // The writer might still have the page mapped.
+            if (page_count(page) > 1) {
+                page_dec(page);
+            } else {
+                free_pages(page);
+            }
+        } else if (!pipe_info->spare_page) {
+            pipe_info->spare_page = page;
+        } else {
+            free_pages(page);
+        }
+    }
+    pipe_buffer->page   = NULL;
+    pipe_buffer->offset = 0;
+    pipe_buffer->len    = 0;
+    pipe_buffer->flags  = 0;
+}
+
+/// @brief Takes the page of the current process containing the given address,
+/// so that a pipe can hold it instead of a copy of its content.
+/// @details The page stays mapped in the writer, but it becomes copy-on-write,
+/// so that the pipe keeps the data as it was when written.
+/// @param src The page-aligned address of the data being written.
+/// @return Pointer to the page, with a reference taken for the pipe, or NULL
+/// if the page cannot be gifted.
+static page_t *__pipe_gift_page(const char *src)
+{
+    task_struct *task = scheduler_get_current_process();
+    if (!task || !task->mm) {
+        return NULL;
+    }
+    // Only private memory of the process can be gifted, shared mappings must
+    // keep being written in place.
+    vm_area_struct_t *area = vm_area_lookup(task->mm, (uint32_t)src);
+    if (!area || (area->vm_flags & MAP_SHARED)) {
+        return NULL;
+    }
+    page_table_entry_t *entry = mem_virtual_to_pte(task->mm->pgd, (uint32_t)src);
+    if (!entry || !entry->present || !entry->user) {
+        return NULL;
+    }
+    page_t *page = get_page_from_physical_address(entry->frame << 12U);
+    if (!page) {
+        return NULL;
+    }
+    // The next write of the process gives it its own copy of the page.
+    if (entry->rw) {
+        entry->rw         = 0;
+        entry->kernel_cow = 1;
+        paging_flush_tlb_single((uint32_t)src);
+    }
+    page_inc(page);
+    return page;
+}
+
 /// @brief Allocates and initializes a new `pipe_inode_info_t` structure.
 /// @param ops Pointer to the `pipe_buf_operations` structure for buffer operations.
 /// @return Pointer to the allocated and initialized `pipe_inode_info_t`
@@ -161,8 +256,14 @@ static inline pipe_inode_info_t *__pipe_inode_info_alloc(struct pipe_buf_operati
     // Initialize the mutex.
     mutex_unlock(&pipe_info->mutex);
 
-    // Set the number of buffers.
+    // Allocate the ring of buffers, their pages are allocated when written.
     pipe_info->numbuf = PIPE_NUM_BUFFERS;
+    pipe_info->bufs   = (pipe_buffer_t *)kmalloc(sizeof(pipe_buffer_t) * pipe_info->numbuf);
+    if (!pipe_info->bufs) {
+        pr_err("Failed to allocate memory for the pipe buffers.\n");
+        kfree(pipe_info);
+        return NULL;
+    }
 
     // Initialize each buffer in the buffer array.
     for (unsigned int i = 0; i < pipe_info->numbuf; ++i) {
@@ -173,16 +274,18 @@ static inline pipe_inode_info_t *__pipe_inode_info_alloc(struct pipe_buf_operati
             while (i > 0) {
                 __pipe_buffer_deinit(&pipe_info->bufs[--i]);
             }
+            kfree(pipe_info->bufs);
             kfree(pipe_info);
             return NULL;
         }
     }
 
     // Initialize remaining fields.
-    pipe_info->read_index  = 0;
-    pipe_info->write_index = 0;
-    pipe_info->readers     = 0;
-    pipe_info->writers     = 0;
+    pipe_info->curbuf     = 0;
+    pipe_info->nrbufs     = 0;
+    pipe_info->spare_page = NULL;
+    pipe_info->readers    = 0;
+    pipe_info->writers    = 0;
 
     return pipe_info;
 }
@@ -197,73 +300,62 @@ static inline void __pipe_inode_info_dealloc(pipe_inode_info_t *pipe_info)
     // Ensure that the provided pointer is valid.
     assert(pipe_info && "Received a NULL pointer.");
 
+    // Release the pages of the buffers still holding data, and the spare one.
+    for (size_t position = 0; position < pipe_info->nrbufs; ++position) {
+        __pipe_buffer_release(pipe_info, pipe_info_buffer(pipe_info, position));
+    }
+    if (pipe_info->spare_page) {
+        free_pages(pipe_info->spare_page);
+    }
+
     // Free each buffer in the array.
     for (unsigned int i = 0; i < pipe_info->numbuf; ++i) {
         __pipe_buffer_deinit(&pipe_info->bufs[i]);
     }
 
     // Free the memory used by the pipe_inode_info_t structure itself.
+    kfree(pipe_info->bufs);
     kfree(pipe_info);
 }
 
-// ============================================================================
-// PIPE INFO AND BUFFER OPERATIONS (Private)
-// ============================================================================
-
-/// @brief Converts a linear index to the corresponding buffer index within the buffer limit.
-/// @param index The linear index.
-/// @return The buffer index within [0, PIPE_NUM_BUFFERS - 1].
-static inline size_t pipe_linear_to_buffer_index(size_t index) { return (index / PIPE_BUFFER_SIZE) % PIPE_NUM_BUFFERS; }
-
-/// @brief Calculates the offset within the specified buffer from a linear index.
-/// @param index The linear index.
-/// @return The offset within the buffer.
-static inline size_t pipe_linear_to_offset(size_t index) { return index % PIPE_BUFFER_SIZE; }
-
-/// @brief Checks if the specified pipe has any data available in its buffers.
+/// @brief Changes the number of buffers of a pipe, keeping the data it holds.
 /// @param pipe_info Pointer to the pipe information structure.
-/// @return 1 if data is available, 0 if all buffers are empty, -EINVAL on error.
-static inline int pipe_info_has_data(pipe_inode_info_t *pipe_info)
+/// @param numbuf The new number of buffers.
+/// @return 0 on success, -EBUSY if the data does not fit in the new buffers,
+/// -ENOMEM if the allocation fails.
+static int __pipe_inode_info_resize(pipe_inode_info_t *pipe_info, size_t numbuf)
 {
-    // Validate input parameter.
-    if (!pipe_info) {
-        pr_err("pipe_info is NULL.\n");
-        return -EINVAL;
+    if (pipe_info->nrbufs > numbuf) {
+        return -EBUSY;
     }
 
-    // Check if data is available in at least one buffer.
-    for (unsigned int i = 0; i < pipe_info->numbuf; i++) {
-        if (pipe_info->bufs[i].len > 0) {
-            return 1;
-        }
-    }
-
-    // No data available in any buffer.
-    return 0;
-}
-
-/// @brief Checks if the specified pipe has available space in any of its buffers.
-/// @param pipe_info Pointer to the pipe information structure.
-/// @return 1 if space is available, 0 if all buffers are full, -EINVAL on error.
-static inline int pipe_info_has_space(pipe_inode_info_t *pipe_info)
-{
-    // Validate input parameter.
-    if (!pipe_info) {
-        pr_err("pipe_info is NULL.\n");
-        return -EINVAL;
+    pipe_buffer_t *bufs = (pipe_buffer_t *)kmalloc(sizeof(pipe_buffer_t) * numbuf);
+    if (!bufs) {
+        pr_err("Failed to allocate memory for %u pipe buffers.\n", numbuf);
+        return -ENOMEM;
     }
 
-    // Check if at least one buffer has available space.
-    for (unsigned int i = 0; i < pipe_info->numbuf; i++) {
-        if (pipe_info->bufs[i].len < PIPE_BUFFER_SIZE) {
-            return 1;
+    // Move the buffers holding data at the beginning of the new ring.
+    for (size_t position = 0; position < numbuf; ++position) {
+        if (position < pipe_info->nrbufs) {
+            bufs[position] = *pipe_info_buffer(pipe_info, position);
+        } else {
+            __pipe_buffer_init(&bufs[position], pipe_info->bufs[0].ops);
         }
     }
+    kfree(pipe_info->bufs);
+
+    pipe_info->bufs   = bufs;
+    pipe_info->numbuf = numbuf;
+    pipe_info->curbuf = 0;
 
-    // No space available in any buffer.
     return 0;
 }
 
+// ============================================================================
+// PIPE INFO AND BUFFER OPERATIONS (Private)
+// ============================================================================
+
 /// @brief Checks if the specified pipe buffer is empty.
 /// @param pipe_buffer Pointer to the pipe buffer structure to check.
 /// @return 1 if the buffer is empty (length is 0), or 0 if not or if pipe_buffer is NULL.
@@ -305,10 +397,60 @@ static inline size_t pipe_buffer_capacity(pipe_buffer_t *pipe_buffer)
         return 0; // Return 0 as there's no buffer to check.
     }
 
+    // Gifted pages are shared with the writer, nothing can be appended to them.
+    if (pipe_buffer->flags & PIPE_BUF_FLAG_GIFT) {
+        return 0;
+    }
+
     // Calculate available capacity by subtracting the offset + length from the total buffer size.
     return PIPE_BUFFER_SIZE - (pipe_buffer->offset + pipe_buffer->len);
 }
 
+/// @brief Checks if the specified pipe has any data available in its buffers.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @return 1 if data is available, 0 if all buffers are empty, -EINVAL on error.
+static inline int pipe_info_has_data(pipe_inode_info_t *pipe_info)
+{
+    // Validate input parameter.
+    if (!pipe_info) {
+        pr_err("pipe_info is NULL.\n");
+        return -EINVAL;
+    }
+
+    // Buffers are released as soon as they are drained.
+    return pipe_info->nrbufs > 0;
+}
+
+/// @brief Checks if the specified pipe has available space in any of its buffers.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @return 1 if space is available, 0 if all buffers are full, -EINVAL on error.
+static inline int pipe_info_has_space(pipe_inode_info_t *pipe_info)
+{
+    // Validate input parameter.
+    if (!pipe_info) {
+        pr_err("pipe_info is NULL.\n");
+        return -EINVAL;
+    }
+
+    // Check if there is a free buffer, or room left in the last one.
+    if (pipe_info->nrbufs < pipe_info->numbuf) {
+        return 1;
+    }
+    return pipe_buffer_capacity(pipe_info_buffer(pipe_info, pipe_info->nrbufs - 1)) > 0;
+}
+
+/// @brief Computes how many bytes can be written to the pipe before it is full.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @return The room left in the last buffer, plus the size of the free buffers.
+static inline size_t pipe_info_free_space(pipe_inode_info_t *pipe_info)
+{
+    size_t space = (pipe_info->numbuf - pipe_info->nrbufs) * PIPE_BUFFER_SIZE;
+    if (pipe_info->nrbufs > 0) {
+        space += pipe_buffer_capacity(pipe_info_buffer(pipe_info, pipe_info->nrbufs - 1));
+    }
+    return space;
+}
+
 /// @brief Determines the number of bytes that can be read from the pipe buffer.
 /// @param pipe_buffer Pointer to the pipe buffer structure.
 /// @param count The requested number of bytes to read.
@@ -414,18 +556,16 @@ static ssize_t pipe_buffer_read(pipe_buffer_t *pipe_buffer, char *dest, size_t c
         return bytes_to_read;
     }
 
-    // Copy data from the pipe buffer's data at the specified offset.
-    memcpy(dest, pipe_buffer->data + pipe_buffer->offset, bytes_to_read);
+    // Copy data from the pipe buffer's data at the specified offset, gifted
+    // pages might be in highmem, so reach the page through a kmap window.
+    char *data = (char *)vmem_kmap(pipe_buffer->page, KMAP_PIPE);
+    memcpy(dest, data + pipe_buffer->offset, bytes_to_read);
+    vmem_kunmap(data, KMAP_PIPE);
 
     // Adjust buffer's offset and length to reflect the data consumption.
     pipe_buffer->offset += bytes_to_read;
     pipe_buffer->len -= bytes_to_read;
 
-    // If all data has been read, reset offset to 0 for reusability.
-    if (pipe_buffer->len == 0) {
-        pipe_buffer->offset = 0;
-    }
-
     pr_debug(
         "Read %3ld bytes from buffer (offset: %3u, length: %3u).\n", bytes_to_read, pipe_buffer->offset,
         pipe_buffer->len);
@@ -461,7 +601,9 @@ static ssize_t pipe_buffer_write(pipe_buffer_t *pipe_buffer, const char *src, si
     }
 
     // Write data to the buffer's current write position (offset + length).
-    memcpy(pipe_buffer->data + pipe_buffer->offset + pipe_buffer->len, src, bytes_to_write);
+    char *data = (char *)vmem_kmap(pipe_buffer->page, KMAP_PIPE);
+    memcpy(data + pipe_buffer->offset + pipe_buffer->len, src, bytes_to_write);
+    vmem_kunmap(data, KMAP_PIPE);
 
     // Update the buffer's length to reflect the newly added data.
     pipe_buffer->len += bytes_to_write;
@@ -497,9 +639,11 @@ int pipe_read_wake_function(wait_queue_entry_t *wait, unsigned mode, int sync)
     // Validate that data is available in the pipe for reading.
     if ((pipe_info_has_data(pipe_info) > 0) || (pipe_info->writers == 0)) {
         // Check if the task is in an appropriate sleep state to be woken up.
-        if ((wait->task->state == TASK_UNINTERRUPTIBLE) || (wait->task->state == TASK_STOPPED)) {
+        if (wait->task->state == TASK_INTERRUPTIBLE) {
             // Set the task's state to the specified wake-up mode.
             wait->task->state = mode;
+            // Let the scheduler pick it up.
+            scheduler_set_need_resched();
 
             // Signal that the task has been woken up.
             pr_debug("Data available or no more writers, waking up reader %d.\n", wait->task->pid);
@@ -533,10 +677,12 @@ int pipe_write_wake_function(wait_queue_entry_t *wait, unsigned mode, int sync)
 
     // Check if there is available space in the pipe for writing.
     if (pipe_info_has_space(pipe_info) > 0) {
-        // Only tasks in the state TASK_UNINTERRUPTIBLE or TASK_STOPPED can be woken up.
-        if ((wait->task->state == TASK_UNINTERRUPTIBLE) || (wait->task->state == TASK_STOPPED)) {
+        // Only tasks sleeping in the state TASK_INTERRUPTIBLE can be woken up.
+        if (wait->task->state == TASK_INTERRUPTIBLE) {
             // Set the wake-up mode for the task.
             wait->task->state = mode;
+            // Let the scheduler pick it up.
+            scheduler_set_need_resched();
 
             // Signal that the task has been woken up.
             pr_debug("Space available, waking up writer %d.\n", wait->task->pid);
@@ -552,34 +698,9 @@ int pipe_write_wake_function(wait_queue_entry_t *wait, unsigned mode, int sync)
     return 0;
 }
 
-/// @brief Wakes up tasks in the specified wait queue if their wake-up condition is met.
-/// @param wait_queue Pointer to the wait queue from which tasks should be woken up.
-/// @param debug_msg Debug message describing the wake-up context.
-static void pipe_wake_up_tasks(wait_queue_head_t *wait_queue, const char *debug_msg)
-{
-    // Validate input parameters.
-    if (!wait_queue) {
-        pr_err("pipe_wake_up_tasks: wait_queue is NULL.\n");
-        return;
-    }
-
-    list_for_each_safe_decl(it, store, &wait_queue->task_list)
-    {
-        wait_queue_entry_t *wait_queue_entry = list_entry(it, wait_queue_entry_t, task_list);
-
-        // Run the wakeup test function for the waiting task.
-        if (wait_queue_entry->func(wait_queue_entry, TASK_RUNNING, 0)) {
-            // Task is ready, remove from the wait queue.
-            remove_wait_queue(wait_queue, wait_queue_entry);
-
-            // Log and free the memory associated with the wait entry.
-            pr_debug("%s: Process %d woken up.\n", debug_msg, wait_queue_entry->task->pid);
-            wait_queue_entry_dealloc(wait_queue_entry);
-        }
-    }
-}
-
-/// @brief Puts the current process to sleep on the specified wait queue if blocking is needed.
+/// @brief Puts the current process to sleep on the specified wait queue, the
+/// caller must then return -ERESTART so that the system call is issued again
+/// once the process is woken up, either by the wake function or by a signal.
 /// @param pipe_info Pointer to the pipe information structure.
 /// @param wait_queue Pointer to the wait queue on which to put the process to sleep.
 /// @param wake_function Wake-up function associated with the wait queue entry.
@@ -592,7 +713,7 @@ static int pipe_put_process_to_sleep(
     const char *debug_msg)
 {
     // Blocking behavior: Put the process to sleep until the condition is met.
-    wait_queue_entry_t *wait_queue_entry = sleep_on(wait_queue);
+    wait_queue_entry_t *wait_queue_entry = sleep_on_interruptible(wait_queue);
     assert(wait_queue_entry && "Failed to allocate wait_queue_entry_t.");
 
     // Set the wake-up function and private data for the wait entry.
@@ -870,7 +991,7 @@ static int pipe_close(vfs_file_t *file)
     // If all writers have closed, wake up waiting readers.
     if (pipe_info->writers == 0) {
         pr_debug("All writers have closed the pipe. Waking up readers.\n");
-        pipe_wake_up_tasks(&pipe_info->read_wait, "pipe_close");
+        wake_up(&pipe_info->read_wait);
     }
 
     // If both readers and writers are zero, free the pipe resources.
@@ -925,50 +1046,49 @@ static ssize_t pipe_read(vfs_file_t *file, char *buffer, off_t offset, size_t nb
     // Acquire the pipe mutex to ensure safe access.
     mutex_lock(&pipe_info->mutex, task->pid);
 
-    // Return 0 if there are no writers left.
-    if (pipe_info->writers == 0) {
-        pr_debug("No writers left.\n");
-        return 0;
-    }
-
     ssize_t bytes_read = 0;
 
-    if (pipe_info_has_data(pipe_info)) {
-        // Loop to read data from the pipe until requested bytes are read or an error occurs.
-        while (bytes_read < nbyte) {
-            // Wrap read_index around when exceeding max buffer capacity.
-            pipe_info->read_index %= (pipe_info->numbuf * PIPE_BUFFER_SIZE);
+    // Copy as much as requested, going through all the buffers holding data.
+    while ((bytes_read < nbyte) && pipe_info_has_data(pipe_info)) {
+        pipe_buffer_t *pipe_buffer = pipe_info_buffer(pipe_info, 0);
 
-            // Calculate the buffer index for the current read position.
-            size_t buffer_index        = pipe_linear_to_buffer_index(pipe_info->read_index);
-            pipe_buffer_t *pipe_buffer = &pipe_info->bufs[buffer_index];
-
-            // Confirm that the buffer is ready to be read.
-            if (pipe_buffer_confirm(pipe_buffer) < 0) {
-                pr_err("Failed to confirm readiness of buffer %u for reading.\n", buffer_index);
-                break; // Stop if there’s no data to read.
-            }
+        // Confirm that the buffer is ready to be read.
+        if (pipe_buffer_confirm(pipe_buffer) < 0) {
+            pr_err("Failed to confirm readiness of buffer %u for reading.\n", pipe_info->curbuf);
+            break;
+        }
 
-            // Calculate bytes to read in this iteration, considering the remaining requested bytes.
-            ssize_t bytes_to_read = pipe_buffer_read(pipe_buffer, buffer + bytes_read, nbyte - bytes_read);
-            if (bytes_to_read < 0) {
-                pr_err("Error reading from pipe buffer (error[%2d]: %s).\n", -bytes_to_read, strerror(-bytes_to_read));
-                bytes_read = -bytes_to_read;
-                break;
-            }
+        // Calculate bytes to read in this iteration, considering the remaining requested bytes.
+        ssize_t bytes_to_read = pipe_buffer_read(pipe_buffer, buffer + bytes_read, nbyte - bytes_read);
+        if (bytes_to_read < 0) {
+            pr_err("Error reading from pipe buffer (error[%2d]: %s).\n", -bytes_to_read, strerror(-bytes_to_read));
+            break;
+        }
+        bytes_read = bytes_read + bytes_to_read;
 
-            // Update the total bytes read and the read index.
-            bytes_read            = bytes_read + bytes_to_read;
-            pipe_info->read_index = pipe_info->read_index + bytes_to_read;
+        // Once drained, the buffer is given back to the writers.
+        if (pipe_buffer_empty(pipe_buffer)) {
+            __pipe_buffer_release(pipe_info, pipe_buffer);
+            pipe_info->curbuf = (pipe_info->curbuf + 1) % pipe_info->numbuf;
+            pipe_info->nrbufs = pipe_info->nrbufs - 1;
         }
-    } else {
-        // If in blocking mode, put the process to sleep until data is available.
-        if (pipe_is_blocking(file)) {
+    }
+
+    if ((bytes_read == 0) && (nbyte > 0)) {
+        if (pipe_info->writers == 0) {
+            // The pipe is empty, and nobody is left to fill it.
+            pr_debug("No writers left.\n");
+        } else if (!pipe_is_blocking(file)) {
+            bytes_read = -EAGAIN;
+        } else if (signal_pending(task)) {
+            // A signal interrupts the wait.
+            bytes_read = -EINTR;
+        } else {
+            // Sleep until data is available, or a signal arrives, then the
+            // system call is issued again from the start.
             pipe_put_process_to_sleep(pipe_info, &pipe_info->read_wait, pipe_read_wake_function, "pipe_read");
+            bytes_read = -ERESTART;
         }
-        // TODO: We currently do not save kernel regs status, so we need a
-        // work-around when putting processes to sleep.
-        bytes_read = -EAGAIN;
     }
 
     // Release the mutex after reading.
@@ -976,7 +1096,7 @@ static ssize_t pipe_read(vfs_file_t *file, char *buffer, off_t offset, size_t nb
 
     // Wake up tasks that might be waiting to write to the pipe.
     if (bytes_read > 0) {
-        pipe_wake_up_tasks(&pipe_info->write_wait, "pipe_read");
+        wake_up(&pipe_info->write_wait);
     }
 
     return bytes_read;
@@ -1016,46 +1136,90 @@ static ssize_t pipe_write(vfs_file_t *file, const void *buffer, off_t offset, si
 
     ssize_t bytes_written = 0;
 
-    // Check if there is available space in the pipe for writing.
-    if (pipe_info_has_space(pipe_info)) {
-        // Loop to write data to the pipe buffer until the requested number of bytes is written.
-        while (bytes_written < nbyte) {
-            // Wrap around write_index when it exceeds the max buffer capacity.
-            pipe_info->write_index %= (pipe_info->numbuf * PIPE_BUFFER_SIZE);
-
-            // Get the buffer index for the current write position.
-            size_t buffer_index        = pipe_linear_to_buffer_index(pipe_info->write_index);
-            pipe_buffer_t *pipe_buffer = &pipe_info->bufs[buffer_index];
-
-            // Confirm the buffer is ready for writing.
-            if (pipe_buffer_confirm(pipe_buffer) < 0) {
-                pr_err("Failed to confirm readiness of buffer %u for writing.\n", buffer_index);
-                bytes_written = -1;
-                break;
+    // Writes of up to PIPE_BUF bytes are not interleaved with other writes,
+    // so nothing is written until they fit as a whole.
+    size_t bytes_to_copy = nbyte;
+    if ((nbyte <= PIPE_BUF) && (pipe_info_free_space(pipe_info) < nbyte)) {
+        bytes_to_copy = 0;
+    }
+
+    // Copy as much as possible, filling the buffers one after the other.
+    while (bytes_written < bytes_to_copy) {
+        const char *src  = (const char *)buffer + bytes_written;
+        size_t remaining = nbyte - bytes_written;
+        ssize_t bytes_to_write;
+
+        // Append to the last buffer, as long as it has room left.
+        if (pipe_info_has_data(pipe_info)) {
+            pipe_buffer_t *last = pipe_info_buffer(pipe_info, pipe_info->nrbufs - 1);
+            if (pipe_buffer_capacity(last) > 0) {
+                bytes_to_write = pipe_buffer_write(last, src, remaining);
+                if (bytes_to_write < 0) {
+                    pr_err(
+                        "Error writing to pipe buffer (error[%2d]: %s).\n", -bytes_to_write,
+                        strerror(-bytes_to_write));
+                    break;
+                }
+                bytes_written = bytes_written + bytes_to_write;
+                continue;
             }
+        }
 
-            // Attempt to write data into the pipe buffer.
-            ssize_t bytes_to_write =
-                pipe_buffer_write(pipe_buffer, (const char *)buffer + bytes_written, nbyte - bytes_written);
-            if (bytes_to_write < 0) {
-                // Other errors: Log and return immediately.
-                pr_err("Error writing to pipe buffer (error[%2d]: %s).\n", -bytes_to_write, strerror(-bytes_to_write));
-                bytes_written = -1;
-                break;
+        // Otherwise, take the next free buffer, if there is any.
+        if (pipe_info->nrbufs == pipe_info->numbuf) {
+            break;
+        }
+        pipe_buffer_t *pipe_buffer = pipe_info_buffer(pipe_info, pipe_info->nrbufs);
+
+        // Confirm the buffer is ready for writing.
+        if (pipe_buffer_confirm(pipe_buffer) < 0) {
+            pr_err("Failed to confirm readiness of buffer %u for writing.\n", pipe_info->nrbufs);
+            break;
+        }
+
+        // Whole pages are handed over to the readers, instead of being copied.
+        if ((remaining >= PIPE_BUFFER_SIZE) && !((uint32_t)src & (PAGE_SIZE - 1))) {
+            pipe_buffer->page = __pipe_gift_page(src);
+            if (pipe_buffer->page) {
+                pipe_buffer->len   = PIPE_BUFFER_SIZE;
+                pipe_buffer->flags = PIPE_BUF_FLAG_GIFT;
+                pipe_info->nrbufs  = pipe_info->nrbufs + 1;
+                bytes_written      = bytes_written + PIPE_BUFFER_SIZE;
+                continue;
             }
+        }
 
-            // Update the total bytes written and the write index.
-            bytes_written          = bytes_written + bytes_to_write;
-            pipe_info->write_index = pipe_info->write_index + bytes_to_write;
+        // Copy the data into a page of the pipe.
+        pipe_buffer->page = __pipe_page_alloc(pipe_info);
+        if (!pipe_buffer->page) {
+            pr_err("Failed to allocate a page for the pipe buffer.\n");
+            if (bytes_written == 0) {
+                bytes_written = -ENOMEM;
+            }
+            break;
         }
-    } else {
-        // Blocking behavior: Put the process to sleep until space is available.
-        if (pipe_is_blocking(file)) {
+        bytes_to_write = pipe_buffer_write(pipe_buffer, src, remaining);
+        if (bytes_to_write < 0) {
+            pr_err("Error writing to pipe buffer (error[%2d]: %s).\n", -bytes_to_write, strerror(-bytes_to_write));
+            __pipe_buffer_release(pipe_info, pipe_buffer);
+            break;
+        }
+        pipe_info->nrbufs = pipe_info->nrbufs + 1;
+        bytes_written     = bytes_written + bytes_to_write;
+    }
+
+    if ((bytes_written == 0) && (nbyte > 0)) {
+        if (!pipe_is_blocking(file)) {
+            bytes_written = -EAGAIN;
+        } else if (signal_pending(task)) {
+            // A signal interrupts the wait.
+            bytes_written = -EINTR;
+        } else {
+            // Sleep until space is available, or a signal arrives, then the
+            // system call is issued again from the start.
             pipe_put_process_to_sleep(pipe_info, &pipe_info->write_wait, pipe_write_wake_function, "pipe_write");
+            bytes_written = -ERESTART;
         }
-        // TODO: We currently do not save kernel regs status, so we need a
-        // work-around when putting processes to sleep.
-        bytes_written = -EAGAIN;
     }
 
     // Release the mutex after the write operation is complete.
@@ -1063,7 +1227,7 @@ static ssize_t pipe_write(vfs_file_t *file, const void *buffer, off_t offset, si
 
     // Wake up tasks waiting to read from the pipe.
     if (bytes_written > 0) {
-        pipe_wake_up_tasks(&pipe_info->read_wait, "pipe_write");
+        wake_up(&pipe_info->read_wait);
     }
 
     return bytes_written;
@@ -1082,11 +1246,48 @@ static off_t pipe_lseek(vfs_file_t *file, off_t offset, int whence) { return -1;
 /// @return Always returns -1 as pipes do not support file status retrieval.
 static int pipe_fstat(vfs_file_t *file, stat_t *stat) { return -1; }
 
+/// @brief Changes the capacity of a pipe.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @param size The requested capacity in bytes, rounded up to whole buffers.
+/// @return The new capacity in bytes on success, or a negative error code.
+static long pipe_set_size(pipe_inode_info_t *pipe_info, unsigned long size)
+{
+    // Retrieve the current task structure.
+    task_struct *task = scheduler_get_current_process();
+    assert(task && "Failed to retrieve current task.");
+
+    // Only root can go beyond the limit.
+    if ((size > PIPE_MAX_SIZE) && (task->uid != 0)) {
+        return -EPERM;
+    }
+
+    // A pipe holds at least one buffer.
+    size_t numbuf = (size / PIPE_BUFFER_SIZE) + ((size % PIPE_BUFFER_SIZE) != 0);
+    if (numbuf == 0) {
+        numbuf = 1;
+    }
+
+    mutex_lock(&pipe_info->mutex, task->pid);
+    int ret = __pipe_inode_info_resize(pipe_info, numbuf);
+    mutex_unlock(&pipe_info->mutex);
+    if (ret < 0) {
+        return ret;
+    }
+
+    // Writers waiting for space might have some now.
+    wake_up(&pipe_info->write_wait);
+
+    return (long)(numbuf * PIPE_BUFFER_SIZE);
+}
+
 /// @brief Performs a fcntl operation on a pipe file descriptor
 /// @param file Pointer to the vfs_file_t structure representing the pipe file.
-/// @param request The fcntl command (e.g., F_GETFL, F_SETFL)
-/// @param data Additional argument for setting flags (used with F_SETFL)
-/// @return On success, returns 0 for F_SETFL or current flags for F_GETFL; -1 on error with errno set.
+/// @param request The fcntl command (e.g., F_GETFL, F_SETFL, F_SETPIPE_SZ)
+/// @param data Additional argument for setting flags (used with F_SETFL), or
+/// the capacity of the pipe in bytes (used with F_SETPIPE_SZ).
+/// @return On success, returns 0 for F_SETFL, current flags for F_GETFL, or the
+/// capacity of the pipe for F_GETPIPE_SZ and F_SETPIPE_SZ; -1 or a negative
+/// error code on error.
 static long pipe_fcntl(vfs_file_t *file, unsigned int request, unsigned long data)
 {
     if (!file) {
@@ -1112,6 +1313,19 @@ static long pipe_fcntl(vfs_file_t *file, unsigned int request, unsigned long dat
         }
         return 0;
 
+    case F_GETPIPE_SZ:
+        if (!file->device) {
+            return -EBADF;
+        }
+        return (long)(((pipe_inode_info_t *)file->device)->numbuf * PIPE_BUFFER_SIZE);
+
+    case F_SETPIPE_SZ:
+        if (!file->device) {
+            return -EBADF;
+        }
+        pr_debug("Setting the capacity of the pipe to %lu bytes.\n", data);
+        return pipe_set_size((pipe_inode_info_t *)file->device, data);
+
     default:
         errno = EINVAL;
         pr_err("Unsupported request %u.\n", request);
@@ -8,25 +8,23 @@
 /// - sys_syncfs: Synchronize a specific filesystem by file descriptor
 /// - sys_sync_file_range: Sync a specific range of a file
 
+#include "errno.h"
+#include "fs/bcache.h"
 #include "fs/vfs.h"
 #include "io/debug.h"
 
 /// @brief Synchronize all filesystems to persistent storage.
-/// @details This function schedules all dirty filesystem data to be written
-/// to disk. The actual I/O may occur asynchronously after this returns.
+/// @details This function writes back every dirty block held by the buffer
+/// cache, which is where block-based filesystems keep their pending writes.
 /// Always returns 0 (success).
-/// @note Currently a stub that always succeeds. Full implementation would
-/// iterate through all mounted filesystems and sync each one.
 long sys_sync(void)
 {
     pr_debug("sys_sync() - syncing all filesystems\n");
-    
-    // In a full implementation, this would iterate through all mounted
-    // filesystems and call their sync methods. For now, this is a stub.
-    // 
-    // The kernel maintains a list of mounted filesystems and superblocks.
-    // A complete implementation would call sync on each one.
-    
+
+    if (bcache_sync(NULL) < 0) {
+        pr_warning("sys_sync() failed to write back some cached blocks\n");
+    }
+
     pr_debug("sys_sync() completed\n");
     return 0;
 }
@@ -36,8 +34,8 @@ long sys_sync(void)
 /// @return 0 on success, -EBADF if fd is invalid.
 /// @details This function synchronizes the filesystem containing the file
 /// referenced by fd. The actual I/O may occur asynchronously.
-/// @note Currently a stub. Full implementation would look up the file by fd,
-/// get its filesystem superblock, and call that filesystem's sync method.
+/// @note The buffer cache does not track which filesystem a block belongs to,
+/// so this writes back the dirty blocks of every device.
 long sys_syncfs(int fd)
 {
     pr_debug("sys_syncfs(%d) - syncing filesystem for fd %d\n", fd, fd);
@@ -45,6 +43,10 @@ long sys_syncfs(int fd)
     if (fd < 0) {
         return -1;  // Invalid file descriptor
     }
+
+    if (bcache_sync(NULL) < 0) {
+        return -EIO;
+    }
     
     pr_debug("sys_syncfs(%d) completed\n", fd);
     return 0;
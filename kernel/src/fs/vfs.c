@@ -31,8 +31,13 @@
 static int resource_id = -1;
 #endif
 
+/// Number of buckets of the mounting points hash table, must be a power of two.
+#define VFS_MOUNT_HASH_SIZE 32
+
 /// The list of superblocks.
 static list_head_t vfs_super_blocks;
+/// Hash table of superblocks, indexed by the path of the mounting point.
+static list_head_t vfs_mount_table[VFS_MOUNT_HASH_SIZE];
 /// The list of filesystems.
 static list_head_t vfs_filesystems;
 /// Lock for refcount field.
@@ -47,8 +52,11 @@ static kmem_cache_t *vfs_file_cache;
 
 void vfs_init(void)
 {
-    // Initialize the list of superblocks.
+    // Initialize the list of superblocks, and their hash table.
     list_head_init(&vfs_super_blocks);
+    for (unsigned i = 0; i < VFS_MOUNT_HASH_SIZE; ++i) {
+        list_head_init(&vfs_mount_table[i]);
+    }
     // Initialize the list of filesystems.
     list_head_init(&vfs_filesystems);
     // Initialize the caches for superblocks and files.
@@ -162,6 +170,35 @@ int vfs_unregister_filesystem(file_system_type_t *fs)
     return 1;
 }
 
+/// @brief Hashes the first `len` characters of a mounting point path.
+/// @param path the path.
+/// @param len the number of characters to consider.
+/// @return the bucket of the mounting points hash table.
+static inline list_head_t *__vfs_mount_bucket(const char *path, size_t len)
+{
+    uint32_t hash = 0;
+    for (size_t i = 0; i < len; ++i) {
+        hash = (hash * 31) + (unsigned char)path[i];
+    }
+    return &vfs_mount_table[(hash ^ (hash >> 16)) & (VFS_MOUNT_HASH_SIZE - 1)];
+}
+
+/// @brief Searches the superblock mounted exactly on the first `len`
+/// characters of the path.
+/// @param path the path.
+/// @param len the number of characters to consider.
+/// @return the superblock if found, NULL otherwise.
+static inline super_block_t *__vfs_mount_lookup(const char *path, size_t len)
+{
+    list_for_each_decl (it, __vfs_mount_bucket(path, len)) {
+        super_block_t *sb = list_entry(it, super_block_t, hash);
+        if ((strlen(sb->path) == len) && !strncmp(sb->path, path, len)) {
+            return sb;
+        }
+    }
+    return NULL;
+}
+
 /// @brief Logs the details of a superblock at the specified log level.
 /// @param log_level Logging level to use for the output.
 /// @param sb Pointer to the `super_block_t` structure to dump.
@@ -222,10 +259,14 @@ int vfs_register_superblock(const char *name, const char *path, file_system_type
 
     // Initialize the list head for the superblock.
     list_head_init(&sb->mounts);
+    list_head_init(&sb->hash);
 
     // Insert the superblock into the global list of superblocks.
     list_head_insert_after(&sb->mounts, &vfs_super_blocks);
 
+    // Index the superblock by the path of its mounting point.
+    list_head_insert_after(&sb->hash, __vfs_mount_bucket(sb->path, strlen(sb->path)));
+
     // Unlock the vfs spinlock.
     spinlock_unlock(&vfs_spinlock);
 
@@ -236,6 +277,7 @@ int vfs_unregister_superblock(super_block_t *sb)
 {
     pr_debug("vfs_unregister_superblock(name: %s, path: %s, type: %s)\n", sb->name, sb->path, sb->type->name);
     list_head_remove(&sb->mounts);
+    list_head_remove(&sb->hash);
     kmem_cache_free(sb);
     return 1;
 }
@@ -243,21 +285,26 @@ int vfs_unregister_superblock(super_block_t *sb)
 super_block_t *vfs_get_superblock(const char *path)
 {
     pr_debug("vfs_get_superblock(path: %s)\n", path);
-    size_t last_sb_len = 0;
-    size_t len;
-    super_block_t *last_sb = NULL;
-    super_block_t *sb      = NULL;
-    list_for_each_decl (it, &vfs_super_blocks) {
-        sb  = list_entry(it, super_block_t, mounts);
-        len = strlen(sb->path);
-        if (!strncmp(path, sb->path, len)) {
-            if (len > last_sb_len) {
-                last_sb_len = len;
-                last_sb     = sb;
-            }
+    super_block_t *sb = NULL;
+    size_t len        = strlen(path);
+    // Probe the path and then each of its parent directories, the first match
+    // is the deepest mounting point containing the path.
+    while (len > 0) {
+        if ((sb = __vfs_mount_lookup(path, len)) != NULL) {
+            return sb;
+        }
+        if (len == 1) {
+            break;
+        }
+        // Move to the parent directory, dropping the trailing slash.
+        while ((len > 1) && (path[len - 1] != '/')) {
+            --len;
+        }
+        if (len > 1) {
+            --len;
         }
     }
-    return last_sb;
+    return NULL;
 }
 
 vfs_file_t *vfs_open_abspath(const char *absolute_path, int flags, mode_t mode)
@@ -389,6 +436,14 @@ ssize_t vfs_write(vfs_file_t *file, const void *buf, size_t offset, size_t nbyte
     return file->fs_operations->write_f(file, buf, offset, nbytes);
 }
 
+struct page *vfs_getpage(vfs_file_t *file, uint32_t index)
+{
+    if (file->fs_operations->getpage_f == NULL) {
+        return NULL;
+    }
+    return file->fs_operations->getpage_f(file, index);
+}
+
 off_t vfs_lseek(vfs_file_t *file, off_t offset, int whence)
 {
     if (file->fs_operations->lseek_f == NULL) {
@@ -19,6 +19,7 @@
 #include "io/port_io.h"
 #include "io/video.h"
 #include "klib/irqflags.h"
+#include "mem/alloc/zone_allocator.h"
 #include "process/scheduler.h"
 #include "process/wait.h"
 #include "stdint.h"
@@ -91,20 +92,25 @@ void timer_phase(const uint32_t hz)
 
 void timer_handler(pt_regs_t *reg)
 {
-    // Save current process fpu state.
+    // Make the FPU trap, its registers are saved only if the kernel uses it.
     switch_fpu();
     // Check if a second has passed.
     ++timer_ticks;
     // Update all timers
     run_timer_softirq();
+    // The time slice is over, if we are in a system call it is served on exit.
+    scheduler_set_need_resched();
+    // The ack is sent to PIC only when all handlers terminated, but before
+    // scheduling, since the scheduler may wait for the next tick.
+    pic8259_send_eoi(IRQ_TIMER);
     // Perform the schedule only if the interrupt came from user mode.
     if ((reg->cs & 0x3) == 0x3) {
+        // No allocation can be in progress, zero some pages in advance.
+        zone_zero_pool_refill(ZERO_POOL_BATCH);
         scheduler_run(reg);
     }
-    // Restore fpu state.
+    // Let the owner of the FPU registers use them without trapping.
     unswitch_fpu();
-    // The ack is sent to PIC only when all handlers terminated!
-    pic8259_send_eoi(IRQ_TIMER);
 }
 
 void timer_install(void)
@@ -222,8 +222,8 @@ static inline ssize_t __procr_do_stat(char *buffer, size_t bufsize, task_struct
     //(23) vsize  %lu
     //      Virtual memory size in bytes.
     //
-    sprintf(buffer, "%s %lu", buffer, task->mm->total_vm);
-    //(24) TODO: rss  %ld
+    sprintf(buffer, "%s %lu", buffer, task->mm->total_vm * PAGE_SIZE);
+    //(24) rss  %ld
     //      Resident Set Size: number of pages the process has in
     //      real memory.  This is just the pages which count toward
     //      text, data, or stack space.  This does not include
@@ -231,7 +231,7 @@ static inline ssize_t __procr_do_stat(char *buffer, size_t bufsize, task_struct
     //      are swapped out.  This value is inaccurate; see
     //      /proc/[pid]/statm below.
     //
-    strcat(buffer, " 0");
+    sprintf(buffer, "%s %u", buffer, mm_get_rss(task->mm));
     //(25) TODO: rsslim  %lu
     //      Current soft limit in bytes on the rss of the process;
     //      see the description of RLIMIT_RSS in getrlimit(2).
@@ -4,9 +4,14 @@
 /// See LICENSE.md for details.
 
 #include "errno.h"
+#include "fs/bcache.h"
+#include "fs/dcache.h"
+#include "fs/page_cache.h"
 #include "fs/procfs.h"
 #include "hardware/timer.h"
 #include "io/debug.h"
+#include "mem/alloc/slab.h"
+#include "mem/paging.h"
 #include "process/process.h"
 #include "stdio.h"
 #include "string.h"
@@ -24,6 +29,17 @@ static ssize_t procs_do_meminfo(char *buffer, size_t bufsize);
 
 static ssize_t procs_do_stat(char *buffer, size_t bufsize);
 
+static ssize_t procs_do_bcache(char *buffer, size_t bufsize);
+
+static ssize_t procs_do_dcache(char *buffer, size_t bufsize);
+
+static ssize_t procs_do_pagecache(char *buffer, size_t bufsize);
+
+static ssize_t procs_do_slabinfo(char *buffer, size_t bufsize);
+
+/// Size of the buffer the entries are written into, large enough for one line per slab cache.
+#define PROCS_BUFSIZ 8192
+
 /// @brief Read function for the proc system.
 /// @param file The file.
 /// @param buf Buffer where the read content must be placed.
@@ -41,23 +57,32 @@ static ssize_t __procs_read(vfs_file_t *file, char *buf, off_t offset, size_t nb
         pr_err("The file is not a valid proc entry.\n");
         return -EFAULT;
     }
-    // Prepare a buffer.
-    char buffer[BUFSIZ];
-    memset(buffer, 0, BUFSIZ);
+    // Prepare a buffer, too big for the stack. Reads do not sleep, so it is
+    // never shared by two readers.
+    static char buffer[PROCS_BUFSIZ];
+    memset(buffer, 0, PROCS_BUFSIZ);
     // Call the specific function.
     int ret = 0;
     if (strcmp(entry->name, "uptime") == 0) {
-        ret = procs_do_uptime(buffer, BUFSIZ);
+        ret = procs_do_uptime(buffer, PROCS_BUFSIZ);
     } else if (strcmp(entry->name, "version") == 0) {
-        ret = procs_do_version(buffer, BUFSIZ);
+        ret = procs_do_version(buffer, PROCS_BUFSIZ);
     } else if (strcmp(entry->name, "mounts") == 0) {
-        ret = procs_do_mounts(buffer, BUFSIZ);
+        ret = procs_do_mounts(buffer, PROCS_BUFSIZ);
     } else if (strcmp(entry->name, "cpuinfo") == 0) {
-        ret = procs_do_cpuinfo(buffer, BUFSIZ);
+        ret = procs_do_cpuinfo(buffer, PROCS_BUFSIZ);
     } else if (strcmp(entry->name, "meminfo") == 0) {
-        ret = procs_do_meminfo(buffer, BUFSIZ);
+        ret = procs_do_meminfo(buffer, PROCS_BUFSIZ);
     } else if (strcmp(entry->name, "stat") == 0) {
-        ret = procs_do_stat(buffer, BUFSIZ);
+        ret = procs_do_stat(buffer, PROCS_BUFSIZ);
+    } else if (strcmp(entry->name, "bcache") == 0) {
+        ret = procs_do_bcache(buffer, PROCS_BUFSIZ);
+    } else if (strcmp(entry->name, "dcache") == 0) {
+        ret = procs_do_dcache(buffer, PROCS_BUFSIZ);
+    } else if (strcmp(entry->name, "pagecache") == 0) {
+        ret = procs_do_pagecache(buffer, PROCS_BUFSIZ);
+    } else if (strcmp(entry->name, "slabinfo") == 0) {
+        ret = procs_do_slabinfo(buffer, PROCS_BUFSIZ);
     }
     // Perform read.
     ssize_t it = 0;
@@ -101,7 +126,7 @@ static vfs_file_operations_t procs_fs_operations = {
 int procs_module_init(void)
 {
     proc_dir_entry_t *system_entry;
-    char *entry_names[] = {"uptime", "version", "mounts", "cpuinfo", "meminfo", "stat"};
+    char *entry_names[] = {"uptime", "version", "mounts", "cpuinfo", "meminfo", "stat", "bcache", "dcache", "pagecache", "slabinfo"};
     for (int i = 0; i < count_of(entry_names); i++) {
         char *entry_name = entry_names[i];
         if ((system_entry = proc_create_entry(entry_name, NULL)) == NULL) {
@@ -158,6 +183,9 @@ static ssize_t procs_do_meminfo(char *buffer, size_t bufsize)
     double free_space             = get_zone_free_space(GFP_KERNEL) + get_zone_free_space(GFP_HIGHUSER);
     double cached_space           = get_zone_cached_space(GFP_KERNEL) + get_zone_cached_space(GFP_HIGHUSER);
     double used_space             = total_space - free_space;
+    // Pools of zeroed pages.
+    const zero_pool_t *kernel_zero = get_zone_zero_pool(GFP_KERNEL);
+    const zero_pool_t *user_zero   = get_zone_zero_pool(GFP_HIGHUSER);
     // Buddy system status strings.
     char kernel_buddy_status[512] = {0};
     char user_buddy_status[512]   = {0};
@@ -170,10 +198,12 @@ static ssize_t procs_do_meminfo(char *buffer, size_t bufsize)
         "MemFree        : %12.2f Kb\n"
         "MemUsed        : %12.2f Kb\n"
         "Cached         : %12.2f Kb\n"
+        "ZeroPool       : %12lu pages (%lu hits, %lu misses)\n"
         "Kernel Zone    : %s\n"
         "User Zone      : %s\n",
         total_space / (double)K, free_space / (double)K, used_space / (double)K, cached_space / (double)K,
-        kernel_buddy_status, user_buddy_status);
+        kernel_zero->count + user_zero->count, kernel_zero->hits + user_zero->hits,
+        kernel_zero->misses + user_zero->misses, kernel_buddy_status, user_buddy_status);
 }
 
 /// @brief Write the process statistics inside the buffer.
@@ -181,3 +211,98 @@ static ssize_t procs_do_meminfo(char *buffer, size_t bufsize)
 /// @param bufsize the buffer size.
 /// @return the amount we wrote.
 static ssize_t procs_do_stat(char *buffer, size_t bufsize) { return 0; }
+
+/// @brief Write the buffer cache statistics inside the buffer.
+/// @param buffer the buffer.
+/// @param bufsize the buffer size.
+/// @return the amount we wrote.
+static ssize_t procs_do_bcache(char *buffer, size_t bufsize)
+{
+    bcache_stats_t stats;
+    bcache_get_stats(&stats);
+    return snprintf(
+        buffer, bufsize,
+        "Buffers        : %12lu\n"
+        "Dirty          : %12lu\n"
+        "Hits           : %12lu\n"
+        "Misses         : %12lu\n"
+        "Evictions      : %12lu\n"
+        "Writebacks     : %12lu\n",
+        stats.buffers, stats.dirty, stats.hits, stats.misses, stats.evictions, stats.writebacks);
+}
+
+/// @brief Write the directory entry cache statistics inside the buffer.
+/// @param buffer the buffer.
+/// @param bufsize the buffer size.
+/// @return the amount we wrote.
+static ssize_t procs_do_dcache(char *buffer, size_t bufsize)
+{
+    dcache_stats_t stats;
+    dcache_get_stats(&stats);
+    return snprintf(
+        buffer, bufsize,
+        "Entries        : %12lu\n"
+        "Hits           : %12lu\n"
+        "Negative hits  : %12lu\n"
+        "Misses         : %12lu\n"
+        "Evictions      : %12lu\n",
+        stats.entries, stats.hits, stats.negative_hits, stats.misses, stats.evictions);
+}
+
+/// @brief Write the page cache statistics inside the buffer.
+/// @param buffer the buffer.
+/// @param bufsize the buffer size.
+/// @return the amount we wrote.
+static ssize_t procs_do_pagecache(char *buffer, size_t bufsize)
+{
+    page_cache_stats_t stats;
+    page_cache_get_stats(&stats);
+    return snprintf(
+        buffer, bufsize,
+        "Pages          : %12lu\n"
+        "Hits           : %12lu\n"
+        "Misses         : %12lu\n"
+        "Read-ahead     : %12lu\n"
+        "Evictions      : %12lu\n",
+        stats.pages, stats.hits, stats.misses, stats.readahead, stats.evictions);
+}
+
+/// @brief Write the statistics of each slab cache inside the buffer.
+/// @details Waste counts the bytes of the slabs not covered by objects, plus
+/// the padding of the objects in use. Fit is the average share of an object
+/// actually asked for, by kmalloc callers or by the size of the cache type.
+/// @param buffer the buffer.
+/// @param bufsize the buffer size.
+/// @return the amount we wrote.
+static ssize_t procs_do_slabinfo(char *buffer, size_t bufsize)
+{
+    size_t len = snprintf(
+        buffer, bufsize, "%-16s %7s %7s %7s %8s %4s %3s %4s\n", "Name", "ObjSize", "Active", "Total", "Waste", "Fit%",
+        "Mag", "Hit%");
+    for (kmem_cache_t *cachep = kmem_cache_next(NULL); cachep && (len < bufsize); cachep = kmem_cache_next(cachep)) {
+        unsigned int active     = cachep->total_num - cachep->free_num;
+        unsigned int slab_size  = PAGE_SIZE << cachep->gfp_order;
+        unsigned int per_slab   = slab_size / cachep->aligned_object_size;
+        unsigned long slab_tail = slab_size - per_slab * cachep->aligned_object_size;
+        unsigned long padding   = cachep->aligned_object_size - cachep->raw_object_size;
+        unsigned long waste     = (cachep->total_num / per_slab) * slab_tail + active * padding;
+        unsigned long allocs    = cachep->alloc_hits + cachep->alloc_misses;
+        unsigned long requested = cachep->requested_bytes ? cachep->requested_bytes : allocs * cachep->raw_object_size;
+        double served           = (double)allocs * cachep->aligned_object_size;
+        unsigned long fit       = allocs ? (unsigned long)((requested * 100.0) / served) : 100;
+        unsigned long hits      = cachep->alloc_hits + cachep->free_hits;
+        unsigned long misses    = cachep->alloc_misses + cachep->free_misses;
+        unsigned long hit_rate  = (hits + misses) ? (unsigned long)((hits * 100.0) / (hits + misses)) : 0;
+        len += snprintf(
+            buffer + len, bufsize - len, "%-16s %7u %7u %7u %8lu %3lu%% %3u %3lu%%\n", cachep->name,
+            cachep->aligned_object_size, active, cachep->total_num, waste, fit, cachep->magazine_count, hit_rate);
+    }
+    if (len < bufsize) {
+        kmalloc_stats_t stats;
+        kmalloc_get_stats(&stats);
+        len += snprintf(
+            buffer + len, bufsize - len, "Large objects  : %12lu\nLarge pages    : %12lu\nLarge waste    : %12lu\n",
+            stats.large_objects, stats.large_pages, stats.large_wasted);
+    }
+    return min(len, bufsize - 1);
+}
@@ -18,9 +18,13 @@
 #include "fcntl.h"
 #include "fs/procfs.h"
 #include "fs/vfs.h"
+#include "hardware/timer.h"
 #include "io/video.h"
+#include "math.h"
+#include "mem/alloc/slab.h"
 #include "process/scheduler.h"
 #include "sys/bitops.h"
+#include "system/signal.h"
 
 #define DISPLAY_CHAR(c) (iscntrl(c) ? ' ' : (c))
 #define ERASE_CHAR()      \
@@ -41,23 +45,14 @@ void rb_keybuffer_print(rb_keybuffer_t *rb)
     pr_debug("]\n");
 }
 
-/// @brief Read function for the proc video system.
-/// @param file The file.
-/// @param buf Buffer where the read content must be placed.
-/// @param offset Offset from which we start reading from the file.
-/// @param nbyte The number of bytes to read.
-/// @return The number of red bytes.
-static ssize_t procv_read(vfs_file_t *file, char *buf, off_t offset, size_t nbyte)
+/// @brief Applies the line discipline to a character received from the keyboard.
+/// @param process The process reading from the terminal.
+/// @param c The character.
+/// @return 1 if the character generated a signal, 0 otherwise.
+static int procv_receive(task_struct *process, int c)
 {
-    // Stop if the buffer is invalid.
-    if (buf == NULL) {
-        return -1;
-    }
-
-    // Get the currently running process.
-    task_struct *process = scheduler_get_current_process();
     // Get a pointer to its keyboard ring buffer.
-    rb_keybuffer_t *rb   = &process->keyboard_rb;
+    rb_keybuffer_t *rb = &process->keyboard_rb;
 
     // Pre-check the terminal flags.
     bool_t flg_icanon  = (process->termios.c_lflag & ICANON) == ICANON;
@@ -73,27 +68,6 @@ static ssize_t procv_read(vfs_file_t *file, char *buf, off_t offset, size_t nbyt
     bool_t flg_tostop  = (process->termios.c_lflag & TOSTOP) == TOSTOP;
     bool_t flg_iexten  = (process->termios.c_lflag & IEXTEN) == IEXTEN;
 
-    // If we are in canonical mode and the last inserted element is a newline,
-    // pop the buffer until it's empty.
-    if (!rb_keybuffer_is_empty(rb) && (!flg_icanon || (rb_keybuffer_peek_front(rb) == '\n'))) {
-        // Return the newline character.
-        *(buf) = rb_keybuffer_pop_back(rb) & 0x00FF;
-        pr_debug("POP BUFFER  [%c](%d)\n", DISPLAY_CHAR(*buf), (*buf));
-        // Indicate a character has been returned.
-        return 1;
-    }
-
-    // Once we have dealt with canonical mode, get the character.
-    int c = keyboard_pop_back();
-
-    // Check that it's a valid character.
-    if (c < 0) {
-        return 0; // No valid character received.
-    }
-
-    // Keep only the character, not the scancode.
-    c &= 0x00FF;
-
     // Handle special characters.
     switch (c) {
     case '\t':
@@ -102,27 +76,18 @@ static ssize_t procv_read(vfs_file_t *file, char *buf, off_t offset, size_t nbyt
                 video_putc(' ');
             }
         }
-        *(buf) = c;
-        pr_debug("RETURN      [%c](%d)\n", DISPLAY_CHAR(*buf), *buf);
-        return 1;
+        break;
 
     case '\n':
         if (flg_echo || (flg_icanon && flg_echonl)) {
             video_putc(c);
         }
-        if (flg_icanon) {
-            rb_keybuffer_push_front(rb, c);
-            pr_debug("PUSH BUFFER [%c](%d) (Trigger consumption of the buffer)\n", DISPLAY_CHAR(c), c);
-            return 0;
-        }
-        *(buf) = c;
-        pr_debug("RETURN      [%c](%d)\n", DISPLAY_CHAR(*buf), *buf);
-        return 1;
+        break;
 
     case 0x15: // ^U (KILL)
         if (flg_icanon) {
-            // Flush entire line buffer
-            while (!rb_keybuffer_is_empty(rb)) {
+            // Flush the line being edited, not the ones already completed.
+            while (!rb_keybuffer_is_empty(rb) && (rb_keybuffer_peek_front(rb) != '\n')) {
                 rb_keybuffer_pop_front(rb);
                 if (flg_echoke) {
                     // Visually erase characters if ECHOKE is set
@@ -141,8 +106,8 @@ static ssize_t procv_read(vfs_file_t *file, char *buf, off_t offset, size_t nbyt
     case '\b':
     case 127:
         if (flg_icanon) {
-            // Canonical mode: erase last character in buffer
-            if (!rb_keybuffer_is_empty(rb)) {
+            // Canonical mode: erase last character of the line being edited.
+            if (!rb_keybuffer_is_empty(rb) && (rb_keybuffer_peek_front(rb) != '\n')) {
                 rb_keybuffer_pop_front(rb);
                 if (flg_echoe) {
                     // Visually erase the character.
@@ -159,10 +124,7 @@ static ssize_t procv_read(vfs_file_t *file, char *buf, off_t offset, size_t nbyt
         if (flg_echo) {
             video_putc(c);
         }
-        rb_keybuffer_push_front(rb, c);
-        *(buf) = rb_keybuffer_pop_back(rb) & 0x00FF;
-        pr_debug("RETURN      [%c](%d)\n", DISPLAY_CHAR(*buf), (*buf));
-        return 1;
+        break;
 
     default:
         if (iscntrl(c)) {
@@ -170,29 +132,18 @@ static ssize_t procv_read(vfs_file_t *file, char *buf, off_t offset, size_t nbyt
             if (flg_isig) {
                 if (c == 0x03) { // Ctrl+C
                     sys_kill(process->pid, SIGTERM);
-                    return 0;
+                    return 1;
                 }
                 if (c == 0x1A) { // Ctrl+Z
                     sys_kill(process->pid, SIGSTOP);
-                    return 0;
+                    return 1;
                 }
             }
 
             // Echo control characters as ^X if ECHOCTL is set
             if (flg_echo && flg_echoctl) {
-                if (c == '\n') {
-                    if (flg_echo || (flg_icanon && flg_echonl)) {
-                        video_putc('\n');
-                    }
-                } else {
-                    video_putc('^');
-                    video_putc(c + '@'); // e.g., Ctrl+C → ^C
-                }
-            } else if (flg_echo && c == '\n') {
-                // ECHOCTL not set: echo newline only if allowed
-                if (flg_echo || (flg_icanon && flg_echonl)) {
-                    video_putc('\n');
-                }
+                video_putc('^');
+                video_putc(c + '@'); // e.g., Ctrl+C → ^C
             }
         } else if (flg_echo) {
             // Printable character
@@ -200,17 +151,145 @@ static ssize_t procv_read(vfs_file_t *file, char *buf, off_t offset, size_t nbyt
         }
         break;
     }
-    // If in canonical mode, push the character to the ring buffer.
-    if (flg_icanon) {
-        // Add the character to the ring buffer.
-        rb_keybuffer_push_front(rb, c);
-        pr_debug("PUSH BUFFER [%c](%d)\n", (iscntrl(c) ? ' ' : c), c);
+    // Add the character to the ring buffer.
+    rb_keybuffer_push_front(rb, c);
+    pr_debug("PUSH BUFFER [%c](%d)\n", DISPLAY_CHAR(c), c);
+    return 0;
+}
+
+/// @brief Checks if the ring-buffer contains a complete line.
+/// @param rb the ring-buffer.
+/// @return 1 if a line can be returned, 0 otherwise.
+static inline int procv_line_ready(rb_keybuffer_t *rb)
+{
+    // A full buffer is returned as it is, since the line cannot grow anymore.
+    if (rb_keybuffer_is_full(rb)) {
+        return 1;
+    }
+    for (unsigned i = 0; i < rb->count; ++i) {
+        if (rb_keybuffer_get(rb, i) == '\n') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/// @brief Wakes up the readers when a non-canonical read times out.
+/// @param data Unused.
+static void procv_timeout(unsigned long data)
+{
+    (void)data;
+    keyboard_wake_up();
+}
+
+/// @brief Checks if a non-canonical read can return, following VMIN and VTIME.
+/// @param process The process reading from the terminal.
+/// @param nbyte The number of bytes requested.
+/// @return 1 if the read can return, 0 otherwise.
+static inline int procv_input_ready(task_struct *process, size_t nbyte)
+{
+    unsigned count = process->keyboard_rb.count;
+    unsigned vmin  = min(process->termios.c_cc[VMIN], nbyte);
+    unsigned vtime = process->termios.c_cc[VTIME];
+
+    // Without a timeout, wait for VMIN bytes (VMIN = 0 is a poll).
+    if (vtime == 0) {
+        return count >= vmin;
+    }
+    // With a timeout, VMIN = 0 returns as soon as there is something.
+    if ((vmin == 0) ? (count > 0) : (count >= vmin)) {
+        return 1;
+    }
+    // With VMIN > 0 the timer starts with the first byte.
+    if ((vmin > 0) && (count == 0)) {
+        return 0;
+    }
+    // Start the timer, or check if it expired.
+    unsigned long now = timer_get_ticks();
+    if (process->keyboard_timeout == 0) {
+        struct timer_list *timer = kmalloc(sizeof(struct timer_list));
+        if (timer == NULL) {
+            return 1;
+        }
+        init_timer(timer);
+        process->keyboard_timeout = now + max(1U, (vtime * TICKS_PER_SECOND) / 10U);
+        timer->expires            = process->keyboard_timeout;
+        timer->function           = &procv_timeout;
+        timer->data               = 0;
+        add_timer(timer);
+        return 0;
+    }
+    return now >= process->keyboard_timeout;
+}
+
+/// @brief Read function for the proc video system.
+/// @details The characters received from the keyboard are processed by the
+/// line discipline, and stored in the ring-buffer of the process. If the
+/// buffer cannot satisfy the read, the process sleeps until a key is pressed
+/// or a signal arrives, and the system call is restarted when it wakes up.
+/// @param file The file.
+/// @param buf Buffer where the read content must be placed.
+/// @param offset Offset from which we start reading from the file.
+/// @param nbyte The number of bytes to read.
+/// @return The number of red bytes.
+static ssize_t procv_read(vfs_file_t *file, char *buf, off_t offset, size_t nbyte)
+{
+    // Stop if the buffer is invalid.
+    if (buf == NULL) {
+        return -1;
+    }
+    if (nbyte == 0) {
         return 0;
     }
-    // If NOT in canonical mode, return the character.
-    *(buf) = c & 0x00FF;
-    pr_debug("RETURN      [%c](%d)\n", DISPLAY_CHAR(*buf), (*buf));
-    return 1;
+
+    // Get the currently running process.
+    task_struct *process = scheduler_get_current_process();
+    // Get a pointer to its keyboard ring buffer.
+    rb_keybuffer_t *rb   = &process->keyboard_rb;
+
+    // Move all the characters received so far into the ring-buffer.
+    int signaled = 0, c;
+    while (!rb_keybuffer_is_full(rb) && ((c = keyboard_pop_back()) >= 0)) {
+        // Keep only the character, not the scancode.
+        signaled |= procv_receive(process, c & 0x00FF);
+    }
+
+    // Check if the read can be satisfied.
+    int ready;
+    if ((process->termios.c_lflag & ICANON) == ICANON) {
+        ready = procv_line_ready(rb);
+    } else {
+        ready = procv_input_ready(process, nbyte);
+    }
+
+    if (!ready) {
+        // Let the signal be delivered, the read is restarted afterwards.
+        if (signaled) {
+            return -ERESTART;
+        }
+        // A signal interrupts the read, a new one starts a new timeout.
+        if (signal_pending(process)) {
+            process->keyboard_timeout = 0;
+            return -EINTR;
+        }
+        // Wait for a key to be pressed.
+        if (keyboard_sleep_on() == NULL) {
+            return -ENOMEM;
+        }
+        return -ERESTART;
+    }
+    process->keyboard_timeout = 0;
+
+    // Return the characters, up to the end of the line in canonical mode.
+    size_t count = 0;
+    while ((count < nbyte) && !rb_keybuffer_is_empty(rb)) {
+        buf[count] = rb_keybuffer_pop_back(rb) & 0x00FF;
+        pr_debug("POP BUFFER  [%c](%d)\n", DISPLAY_CHAR(buf[count]), buf[count]);
+        if ((buf[count++] == '\n') && ((process->termios.c_lflag & ICANON) == ICANON)) {
+            break;
+        }
+    }
+    return count;
 }
 
 /// @brief Writes data to the video output by sending each character from the buffer to the video output.
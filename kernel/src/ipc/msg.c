@@ -16,27 +16,46 @@
 #include "fcntl.h"
 #include "process/process.h"
 #include "process/scheduler.h"
+#include "process/wait.h"
 #include "stdio.h"
 #include "stdlib.h"
 #include "string.h"
 #include "sys/msg.h"
 #include "system/panic.h"
+#include "system/signal.h"
 
 #include "ipc/ipc.h"
 
+/// The number of buckets of the index of the messages by type.
+#define MSQ_TYPE_BUCKETS 16
+
 ///@brief A value to compute the message queue ID.
 static int __msq_id = 0;
 
+/// @brief The messages of the same type inside a message queue.
+typedef struct {
+    /// The type of the messages.
+    long type;
+    /// The messages of this type, in arrival order.
+    list_head_t messages;
+    /// Reference inside the bucket of the index.
+    list_head_t bucket;
+} msg_type_queue_t;
+
 /// @brief Message queue management structure.
 typedef struct {
     /// @brief ID associated to the message queue.
     int id;
     /// @brief The message queue data strcutre.
     struct msqid_ds msqid;
-    /// Pointer to the first message in the queue.
-    struct msg *msg_first;
-    /// Pointer to the last message in the queue.
-    struct msg *msg_last;
+    /// All the messages in the queue, in arrival order.
+    list_head_t messages;
+    /// Index of the messages by type, each bucket holds some msg_type_queue_t.
+    list_head_t types[MSQ_TYPE_BUCKETS];
+    /// Processes waiting for space in the queue.
+    wait_queue_head_t senders;
+    /// Processes waiting for a message, each entry keeps the requested type.
+    wait_queue_head_t receivers;
     /// Reference inside the list of message queue management structures.
     list_head_t list;
 } msq_info_t;
@@ -61,9 +80,13 @@ static inline msq_info_t *__msq_info_alloc(key_t key, int msqflg)
     // Clean the memory.
     memset(msq_info, 0, sizeof(msq_info_t));
     // Initialize it.
-    msq_info->id        = ++__msq_id;
-    msq_info->msg_first = NULL;
-    msq_info->msg_last  = NULL;
+    msq_info->id = ++__msq_id;
+    list_head_init(&msq_info->messages);
+    for (int i = 0; i < MSQ_TYPE_BUCKETS; ++i) {
+        list_head_init(&msq_info->types[i]);
+    }
+    wait_queue_head_init(&msq_info->senders);
+    wait_queue_head_init(&msq_info->receivers);
     list_head_init(&msq_info->list);
     // Initialize the internal data structure.
     msq_info->msqid.msg_perm   = register_ipc(key, msqflg & 0x1FF);
@@ -85,16 +108,20 @@ static inline void __msq_info_dealloc(msq_info_t *msq_info)
 {
     assert(msq_info && "Received a NULL pointer.");
     // Free the memory of all the messages.
-    struct msg *message = msq_info->msg_first;
-    struct msg *next    = NULL;
-    while (message) {
-        next = message->msg_next;
+    list_for_each_safe_decl(it, store, &msq_info->messages)
+    {
+        struct msg *message = list_entry(it, struct msg, msg_list);
         // Free the memory of the message.
         kfree(message->msg_ptr);
         // Fre the memory of the msg structure.
         kfree(message);
-        // Move to the next.
-        message = next;
+    }
+    // Free the memory of the index.
+    for (int i = 0; i < MSQ_TYPE_BUCKETS; ++i) {
+        list_for_each_safe_decl(it, store, &msq_info->types[i])
+        {
+            kfree(list_entry(it, msg_type_queue_t, bucket));
+        }
     }
     // Deallocate the memory.
     kfree(msq_info);
@@ -158,24 +185,49 @@ static inline void __list_remove_msq_info(msq_info_t *msq_info)
     list_head_remove(&msq_info->list);
 }
 
+/// @brief Searches the messages of the given type.
+/// @param msq_info the message queue.
+/// @param type the type of the messages.
+/// @param create whether to allocate them when there are none.
+/// @return the messages of the given type, NULL if there are none.
+static inline msg_type_queue_t *__msq_info_find_type(msq_info_t *msq_info, long type, int create)
+{
+    list_head_t *bucket = &msq_info->types[(unsigned long)type % MSQ_TYPE_BUCKETS];
+    list_for_each_decl (it, bucket) {
+        msg_type_queue_t *type_queue = list_entry(it, msg_type_queue_t, bucket);
+        if (type_queue->type == type) {
+            return type_queue;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    msg_type_queue_t *type_queue = (msg_type_queue_t *)kmalloc(sizeof(msg_type_queue_t));
+    if (type_queue) {
+        type_queue->type = type;
+        list_head_init(&type_queue->messages);
+        list_head_insert_before(&type_queue->bucket, bucket);
+    }
+    return type_queue;
+}
+
 /// @brief Pushes a messages inside the message queue.
 /// @param msq_info the structure that will contain the message.
 /// @param message the message to push.
-static inline void __msq_info_push_message(msq_info_t *msq_info, struct msg *message)
+/// @return 0 on success, -ENOMEM on failure.
+static inline int __msq_info_push_message(msq_info_t *msq_info, struct msg *message)
 {
     assert(msq_info && "Received a NULL pointer.");
     assert(message && "Received a NULL pointer.");
-    // If there is no first message set, set it.
-    if (msq_info->msg_first == NULL) {
-        msq_info->msg_first = message;
-    }
-    // If there is no last message set, set it.
-    if (msq_info->msg_last == NULL) {
-        msq_info->msg_last = message;
-    } else { // Otherwise, append after the last.
-        msq_info->msg_last->msg_next = message;
-        msq_info->msg_last           = message;
+    // Get the messages with the same type.
+    msg_type_queue_t *type_queue = __msq_info_find_type(msq_info, message->msg_type, 1);
+    if (type_queue == NULL) {
+        return -ENOMEM;
     }
+    // Append the message to both.
+    list_head_insert_before(&message->msg_list, &msq_info->messages);
+    list_head_insert_before(&message->msg_type_list, &type_queue->messages);
+    return 0;
 }
 
 /// @brief Removes the message from the message queue.
@@ -185,25 +237,69 @@ static inline void __msq_info_remove_message(msq_info_t *msq_info, struct msg *m
 {
     assert(msq_info && "Received a NULL pointer.");
     assert(message && "Received a NULL pointer.");
-    // If the message is the first of the queue, next will become the first.
-    if (msq_info->msg_first == message) {
-        msq_info->msg_first = message->msg_next;
-    } else {
-        // Otherwise, we need to find the element before it, and connect the
-        // previous one with the next one.
-        for (struct msg *it = msq_info->msg_first; it; it = it->msg_next) {
-            if (it->msg_next == message) {
-                it->msg_next = message->msg_next;
-                break;
+    list_head_remove(&message->msg_list);
+    list_head_remove(&message->msg_type_list);
+    // Drop the type from the index, once it has no messages.
+    msg_type_queue_t *type_queue = __msq_info_find_type(msq_info, message->msg_type, 0);
+    if (type_queue && list_head_empty(&type_queue->messages)) {
+        list_head_remove(&type_queue->bucket);
+        kfree(type_queue);
+    }
+}
+
+/// @brief Searches the message that should be received.
+/// @param msq_info the message queue.
+/// @param msgtyp the type requested by the receiver (see msgrcv).
+/// @return the message, NULL if there is none.
+static inline struct msg *__msq_info_find_message(msq_info_t *msq_info, long msgtyp)
+{
+    msg_type_queue_t *type_queue = NULL;
+    // If msgtyp is 0, then the first message in the queue is read.
+    if (msgtyp == 0) {
+        if (list_head_empty(&msq_info->messages)) {
+            return NULL;
+        }
+        return list_entry(msq_info->messages.next, struct msg, msg_list);
+    }
+    // If msgtyp is greater than 0, then the first message in the queue of type
+    // msgtyp is read.
+    if (msgtyp > 0) {
+        type_queue = __msq_info_find_type(msq_info, msgtyp, 0);
+    }
+    // If msgtyp is less than 0, then the first message in the queue with the
+    // lowest type less than or equal to the absolute value of msgtyp will be
+    // read.
+    else {
+        for (int i = 0; i < MSQ_TYPE_BUCKETS; ++i) {
+            list_for_each_decl (it, &msq_info->types[i]) {
+                msg_type_queue_t *entry = list_entry(it, msg_type_queue_t, bucket);
+                if ((entry->type <= -msgtyp) && (!type_queue || (entry->type < type_queue->type))) {
+                    type_queue = entry;
+                }
             }
         }
     }
-    // If the message is the last of the queue, set the last to NULL.
-    if (msq_info->msg_last == message) {
-        msq_info->msg_last = NULL;
+    // The types in the index always have at least one message.
+    if (type_queue == NULL) {
+        return NULL;
+    }
+    return list_entry(type_queue->messages.next, struct msg, msg_type_list);
+}
+
+/// @brief Wakes up the processes waiting for a message of the given type.
+/// @param msq_info the message queue.
+/// @param type the type of the message which arrived.
+static inline void __msq_info_wake_receivers(msq_info_t *msq_info, long type)
+{
+    list_for_each_safe_decl(it, store, &msq_info->receivers.task_list)
+    {
+        wait_queue_entry_t *entry = list_entry(it, wait_queue_entry_t, task_list);
+        // The type requested by the receiver.
+        long msgtyp               = (long)entry->private;
+        if ((msgtyp == 0) || (msgtyp == type) || ((msgtyp < 0) && (type <= -msgtyp))) {
+            wake_up_entry(entry);
+        }
     }
-    // Clear the pointer in message.
-    message->msg_next = NULL;
 }
 
 // ============================================================================
@@ -287,6 +383,11 @@ int sys_msgsnd(int msqid, const void *msgp, size_t msgsz, int msgflg)
     }
     // Use the template to acess the message.
     _msgp = (struct msgbuf *)msgp;
+    // The type of the message must be positive.
+    if (_msgp->mtype < 1) {
+        pr_err("The type of the message is not positive.\n");
+        return -EINVAL;
+    }
     // The value of msgsz is negative.
     if (msgsz <= 0) {
         pr_err("The value of msgsz is negative.\n");
@@ -311,10 +412,26 @@ int sys_msgsnd(int msqid, const void *msgp, size_t msgsz, int msgflg)
                "calling process does not have permission to access the set.\n");
         return -EACCES;
     }
+    // The message would never fit in the queue.
+    if (msgsz > msq_info->msqid.msg_qbytes) {
+        pr_err("The value of msgsz is above the maximum size of the queue.\n");
+        return -EINVAL;
+    }
     // Check if the message can't be sent due to the msg_qbytes limit for the
     // queue.
-    if (((msq_info->msqid.msg_cbytes + msgsz) >= msq_info->msqid.msg_qbytes)) {
-        return -EAGAIN;
+    if ((msq_info->msqid.msg_cbytes + msgsz) > msq_info->msqid.msg_qbytes) {
+        if (msgflg & IPC_NOWAIT) {
+            return -EAGAIN;
+        }
+        // A signal interrupts the wait.
+        if (signal_pending(scheduler_get_current_process())) {
+            return -EINTR;
+        }
+        // Sleep until a message is received, or a signal arrives, then try again.
+        if (sleep_on_interruptible(&msq_info->senders) == NULL) {
+            return -ENOMEM;
+        }
+        return -ERESTART;
     }
     // Allocate the memory for the message.
     struct msg *message = (struct msg *)kmalloc(sizeof(struct msg));
@@ -322,8 +439,9 @@ int sys_msgsnd(int msqid, const void *msgp, size_t msgsz, int msgflg)
         pr_err("We failed to allocate the memory for the message.\n");
         return -ENOMEM;
     }
-    // Initialize the pointer to the next.
-    message->msg_next = NULL;
+    // Initialize the references inside the queue.
+    list_head_init(&message->msg_list);
+    list_head_init(&message->msg_type_list);
     // Copy the type of message.
     message->msg_type = _msgp->mtype;
     // Allocate the memory for the content of the message.
@@ -338,7 +456,12 @@ int sys_msgsnd(int msqid, const void *msgp, size_t msgsz, int msgflg)
     // The length of the message.
     message->msg_size = msgsz;
     // Add the message to the queue.
-    __msq_info_push_message(msq_info, message);
+    if (__msq_info_push_message(msq_info, message) < 0) {
+        pr_err("We failed to allocate the memory for the message.\n");
+        kfree(message->msg_ptr);
+        kfree(message);
+        return -ENOMEM;
+    }
 
     // Update last send time.
     msq_info->msqid.msg_stime = sys_time(NULL);
@@ -348,14 +471,17 @@ int sys_msgsnd(int msqid, const void *msgp, size_t msgsz, int msgflg)
     msq_info->msqid.msg_cbytes += msgsz;
     // Increment the number of messages in the message queue.
     msq_info->msqid.msg_qnum += 1;
+    // Wake up the processes waiting for this type of message.
+    __msq_info_wake_receivers(msq_info, message->msg_type);
 
     pr_debug(
         "[%2d] msg_lspid: %2d, msg_lrpid: %2d, msg_qnum: %2d, msg_cbytes: %4d "
         "(%s)\n",
         msq_info->id, msq_info->msqid.msg_lspid, msq_info->msqid.msg_lrpid, msq_info->msqid.msg_qnum,
         msq_info->msqid.msg_cbytes, message->msg_ptr);
-    for (struct msg *it = msq_info->msg_first; it; it = it->msg_next) {
-        pr_debug("    type: %3ld, size: %3d, msg: `%s`\n", it->msg_type, it->msg_size, it->msg_ptr);
+    list_for_each_decl (it, &msq_info->messages) {
+        struct msg *entry = list_entry(it, struct msg, msg_list);
+        pr_debug("    type: %3ld, size: %3d, msg: `%s`\n", entry->msg_type, entry->msg_size, entry->msg_ptr);
     }
     return 0;
 }
@@ -401,43 +527,23 @@ ssize_t sys_msgrcv(int msqid, void *msgp, size_t msgsz, long msgtyp, int msgflg)
                "set.\n");
         return -EACCES;
     }
-    // Prepare a structure for the message.
-    struct msg *message = NULL;
-    // If msgtyp is 0, then the first message in the queue is read.
-    if (msgtyp == 0) {
-        // Get the first message.
-        message = msq_info->msg_first;
-    }
-    // If msgtyp is greater than 0, then the first message in the queue of type
-    // msgtyp is read.
-    else if (msgtyp > 0) {
-        for (struct msg *it = msq_info->msg_first; it; it = it->msg_next) {
-            if (it->msg_type == msgtyp) {
-                message = it;
-                break;
-            }
+    // Search for the message to receive.
+    struct msg *message = __msq_info_find_message(msq_info, msgtyp);
+    if (message == NULL) {
+        if (msgflg & IPC_NOWAIT) {
+            return -ENOMSG;
         }
-    }
-    // If msgtyp is less than 0, then the first message in the queue with the
-    // lowest type less than or equal to the absolute value of msgtyp will be
-    // read.
-    else {
-        long lowest_type = LONG_MAX;
-        for (struct msg *it = msq_info->msg_first; it; it = it->msg_next) {
-            if ((it->msg_type < abs(msgtyp)) && (it->msg_type < lowest_type)) {
-                lowest_type = it->msg_type;
-            }
+        // A signal interrupts the wait.
+        if (signal_pending(scheduler_get_current_process())) {
+            return -EINTR;
         }
-        for (struct msg *it = msq_info->msg_first; it; it = it->msg_next) {
-            if (it->msg_type == lowest_type) {
-                message = it;
-                break;
-            }
+        // Sleep until a message of the requested type is sent, or a signal arrives, then try again.
+        wait_queue_entry_t *entry = sleep_on_interruptible(&msq_info->receivers);
+        if (entry == NULL) {
+            return -ENOMEM;
         }
-    }
-    if (message == NULL) {
-        // pr_err("There are no messages to read.\n");
-        return -ENOMSG;
+        entry->private = (void *)msgtyp;
+        return -ERESTART;
     }
     // Check if the message is longer than msgsz.
     if (message->msg_size > msgsz) {
@@ -451,7 +557,8 @@ ssize_t sys_msgrcv(int msqid, void *msgp, size_t msgsz, long msgtyp, int msgflg)
     }
     // The number of bytes actually copied.
     ssize_t actual_size = min(message->msg_size, msgsz);
-    // Copy the content of the message (we might truncate).
+    // Copy the type and the content of the message (we might truncate).
+    _msgp->mtype = message->msg_type;
     memcpy(_msgp->mtext, message->msg_ptr, actual_size);
 
     // Update last receive time.
@@ -465,14 +572,17 @@ ssize_t sys_msgrcv(int msqid, void *msgp, size_t msgsz, long msgtyp, int msgflg)
 
     // Remove the message to the queue.
     __msq_info_remove_message(msq_info, message);
+    // Wake up the processes waiting for space in the queue.
+    wake_up(&msq_info->senders);
 
     pr_debug(
         "[%2d] msg_lspid: %2d, msg_lrpid: %2d, msg_qnum: %2d, msg_cbytes: %4d "
         "(%s)\n",
         msq_info->id, msq_info->msqid.msg_lspid, msq_info->msqid.msg_lrpid, msq_info->msqid.msg_qnum,
         msq_info->msqid.msg_cbytes, message->msg_ptr);
-    for (struct msg *it = msq_info->msg_first; it; it = it->msg_next) {
-        pr_debug("    type: %3ld, size: %3d, msg: `%s`\n", it->msg_type, it->msg_size, it->msg_ptr);
+    list_for_each_decl (it, &msq_info->messages) {
+        struct msg *entry = list_entry(it, struct msg, msg_list);
+        pr_debug("    type: %3ld, size: %3d, msg: `%s`\n", entry->msg_type, entry->msg_size, entry->msg_ptr);
     }
 
     // Free the memory of the message.
@@ -512,6 +622,9 @@ int sys_msgctl(int msqid, int cmd, struct msqid_ds *buf)
                    "queue.\n");
             return -EPERM;
         }
+        // Wake up the processes waiting on the queue, they will find it removed.
+        wake_up(&msq_info->senders);
+        wake_up(&msq_info->receivers);
         // Remove the info from the list.
         __list_remove_msq_info(msq_info);
         // Delete the info.
@@ -532,6 +645,31 @@ int sys_msgctl(int msqid, int cmd, struct msqid_ds *buf)
         }
         // Copying all the data.
         memcpy(buf, &msq_info->msqid, sizeof(struct msqid_ds));
+    } else if (cmd == IPC_SET) {
+        // Write the values of some members of the msqid_ds structure pointed to
+        // by buf to the kernel data structure associated with this message queue.
+        // Check if the buffer is a null pointer.
+        if (!buf) {
+            pr_err("The buffer is NULL.\n");
+            return -EINVAL;
+        }
+        if ((msq_info->msqid.msg_perm.uid != task->uid) && (msq_info->msqid.msg_perm.cuid != task->uid)) {
+            pr_err("The calling process is not the creator or the owner of the "
+                   "queue.\n");
+            return -EPERM;
+        }
+        // Only root can raise the limit above the default one.
+        if ((buf->msg_qbytes > MSGMNB) && (buf->msg_qbytes > msq_info->msqid.msg_qbytes) && (task->uid != 0)) {
+            pr_err("Only root can raise the size of the queue above MSGMNB.\n");
+            return -EPERM;
+        }
+        msq_info->msqid.msg_perm.uid  = buf->msg_perm.uid;
+        msq_info->msqid.msg_perm.gid  = buf->msg_perm.gid;
+        msq_info->msqid.msg_perm.mode = (msq_info->msqid.msg_perm.mode & ~0x1FF) | (buf->msg_perm.mode & 0x1FF);
+        msq_info->msqid.msg_qbytes    = buf->msg_qbytes;
+        msq_info->msqid.msg_ctime     = sys_time(NULL);
+        // The queue might have more space now.
+        wake_up(&msq_info->senders);
     }
     return 0;
 }
@@ -29,6 +29,13 @@
 /// For testing purposes -> you can try the t_semget and the t_sem1 tests. They
 /// both use semaphores and blocking / non blocking operations. t_sem1 is also
 /// an exercise that was assingned by Professor Drago in the OS course.
+///
+/// # Blocking operations
+/// The operations passed to semop are applied all together or not at all. When
+/// they cannot be applied, the process sleeps on the wait queue of the set, and
+/// the system call is restarted when the values of the set change, or fails
+/// with EINTR when a signal arrives. Operations with SEM_UNDO are recorded per
+/// process, and reverted when it exits.
 
 // ============================================================================
 // Setup the logging for this file (do this before any other include).
@@ -44,11 +51,14 @@
 #include "assert.h"
 #include "errno.h"
 #include "fcntl.h"
+#include "math.h"
 #include "process/process.h"
 #include "process/scheduler.h"
+#include "process/wait.h"
 #include "stdio.h"
 #include "stdlib.h"
 #include "string.h"
+#include "system/signal.h"
 
 ///@brief A value to compute the semid value.
 int __sem_id = 0;
@@ -61,10 +71,24 @@ typedef struct {
     struct semid_ds semid;
     /// @brief List of all the semaphores.
     struct sem *sem_base;
+    /// Processes waiting for the values of the set to change.
+    wait_queue_head_t wait;
+    /// Adjustments to apply when the processes using SEM_UNDO exit.
+    list_head_t undo_list;
     /// Reference inside the list of semaphore management structures.
     list_head_t list;
 } sem_info_t;
 
+/// @brief Adjustments that revert the SEM_UNDO operations of a process.
+typedef struct {
+    /// The process which performed the operations.
+    pid_t pid;
+    /// Reference inside the undo list of the set.
+    list_head_t list;
+    /// The adjustment of each semaphore of the set.
+    short semadj[];
+} sem_undo_t;
+
 /// @brief List of all current active semaphores.
 list_head_t semaphores_list;
 
@@ -97,6 +121,8 @@ static inline sem_info_t *__sem_info_alloc(key_t key, int nsems, int semflg)
     sem_info->semid.sem_otime = 0;
     sem_info->semid.sem_ctime = 0;
     sem_info->semid.sem_nsems = nsems;
+    wait_queue_head_init(&sem_info->wait);
+    list_head_init(&sem_info->undo_list);
     for (int i = 0; i < nsems; i++) {
         sem_info->sem_base[i].sem_pid  = sys_getpid();
         sem_info->sem_base[i].sem_val  = 0;
@@ -112,12 +138,113 @@ static inline sem_info_t *__sem_info_alloc(key_t key, int nsems, int semflg)
 static inline void __sem_info_dealloc(sem_info_t *sem_info)
 {
     assert(sem_info && "Received a NULL pointer.");
+    // Deallocate the undo adjustments.
+    list_for_each_safe_decl(it, store, &sem_info->undo_list)
+    {
+        sem_undo_t *undo = list_entry(it, sem_undo_t, list);
+        list_head_remove(&undo->list);
+        kfree(undo);
+    }
     // Deallocate the array of semaphores.
     kfree(sem_info->sem_base);
     // Deallocate the semid memory.
     kfree(sem_info);
 }
 
+/// @brief Searches the undo adjustments of a process, and allocates them if needed.
+/// @param sem_info the semaphore set.
+/// @param pid the process.
+/// @param create whether to allocate them when they do not exist.
+/// @return the undo adjustments, NULL if they do not exist.
+static inline sem_undo_t *__sem_undo_find(sem_info_t *sem_info, pid_t pid, int create)
+{
+    list_for_each_decl (it, &sem_info->undo_list) {
+        sem_undo_t *undo = list_entry(it, sem_undo_t, list);
+        if (undo->pid == pid) {
+            return undo;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    size_t size      = sizeof(sem_undo_t) + sizeof(short) * sem_info->semid.sem_nsems;
+    sem_undo_t *undo = (sem_undo_t *)kmalloc(size);
+    if (undo) {
+        memset(undo, 0, size);
+        undo->pid = pid;
+        list_head_insert_before(&undo->list, &sem_info->undo_list);
+    }
+    return undo;
+}
+
+/// @brief Forgets the undo adjustments of a semaphore, whose value was set.
+/// @param sem_info the semaphore set.
+/// @param semnum the semaphore, or -1 for all of them.
+static inline void __sem_undo_clear(sem_info_t *sem_info, int semnum)
+{
+    list_for_each_decl (it, &sem_info->undo_list) {
+        sem_undo_t *undo = list_entry(it, sem_undo_t, list);
+        for (int i = 0; i < sem_info->semid.sem_nsems; ++i) {
+            if ((semnum < 0) || (semnum == i)) {
+                undo->semadj[i] = 0;
+            }
+        }
+    }
+}
+
+// ============================================================================
+// SEMAPHORE OPERATIONS (Private)
+// ============================================================================
+
+/// @brief Counts the processes waiting on the semaphore set for a condition.
+/// @details The entry of each waiting process points to the counter of the
+/// condition it waits for, so the count follows the wait queue, whichever way
+/// the processes leave it.
+/// @param sem_info the semaphore set.
+/// @param counter the sem_ncnt or sem_zcnt of a semaphore.
+/// @return the number of processes.
+static inline int __sem_count_waiting(sem_info_t *sem_info, unsigned short *counter)
+{
+    int count = 0;
+    list_for_each_decl (it, &sem_info->wait.task_list) {
+        wait_queue_entry_t *entry = list_entry(it, wait_queue_entry_t, task_list);
+        count += (entry->private == counter);
+    }
+    return count;
+}
+
+/// @brief Applies the operations to the semaphore set, all of them or none.
+/// @param sem_info the semaphore set.
+/// @param sops the operations.
+/// @param nsops the number of operations.
+/// @return the number of operations, or the index of the one which blocked,
+/// or -ERANGE if a value would exceed SEMVMX.
+static inline int __sem_try_apply(sem_info_t *sem_info, struct sembuf *sops, unsigned nsops)
+{
+    int i, result = nsops;
+    for (i = 0; i < nsops; ++i) {
+        struct sem *sem = &sem_info->sem_base[sops[i].sem_num];
+        int value       = (int)sem->sem_val + (int)sops[i].sem_op;
+        // Wait until the value becomes zero, or until it is big enough.
+        if (((sops[i].sem_op == 0) && (sem->sem_val != 0)) || (value < 0)) {
+            result = i;
+            break;
+        }
+        if (value > SEMVMX) {
+            result = -ERANGE;
+            break;
+        }
+        sem->sem_val = value;
+    }
+    // Revert the operations applied so far.
+    if (result != nsops) {
+        while (--i >= 0) {
+            sem_info->sem_base[sops[i].sem_num].sem_val -= sops[i].sem_op;
+        }
+    }
+    return result;
+}
+
 // ============================================================================
 // LIST MANAGEMENT/SEARCH FUNCTIONS (Private)
 // ============================================================================
@@ -188,6 +315,26 @@ int sem_init(void)
     return 0;
 }
 
+void sem_exit(pid_t pid)
+{
+    list_for_each_decl (it, &semaphores_list) {
+        sem_info_t *sem_info = list_entry(it, sem_info_t, list);
+        sem_undo_t *undo     = __sem_undo_find(sem_info, pid, 0);
+        if (!undo) {
+            continue;
+        }
+        // Revert the operations, without going below zero.
+        for (int i = 0; i < sem_info->semid.sem_nsems; ++i) {
+            int value                     = (int)sem_info->sem_base[i].sem_val + undo->semadj[i];
+            sem_info->sem_base[i].sem_val = max(0, min(value, SEMVMX));
+        }
+        list_head_remove(&undo->list);
+        kfree(undo);
+        // Someone might be waiting for the new values.
+        wake_up(&sem_info->wait);
+    }
+}
+
 long sys_semget(key_t key, int nsems, int semflg)
 {
     sem_info_t *sem_info = NULL;
@@ -279,10 +426,12 @@ long sys_semop(int semid, struct sembuf *sops, unsigned nsops)
         return -EINVAL;
     }
     // The value of sem_num is less than 0 or greater than or equal to the number of semaphores in the set.
-    if ((sops->sem_num < 0) || (sops->sem_num >= sem_info->semid.sem_nsems)) {
-        pr_err("The value of sem_num is less than 0 or greater than or equal "
-               "to the number of semaphores in the set.\n");
-        return -EFBIG;
+    for (unsigned i = 0; i < nsops; ++i) {
+        if ((sops[i].sem_num < 0) || (sops[i].sem_num >= sem_info->semid.sem_nsems)) {
+            pr_err("The value of sem_num is less than 0 or greater than or equal "
+                   "to the number of semaphores in the set.\n");
+            return -EFBIG;
+        }
     }
     // Check if the semaphore set exists for the given key, but the calling
     // process does not have permission to access the set.
@@ -291,21 +440,58 @@ long sys_semop(int semid, struct sembuf *sops, unsigned nsops)
                "process does not have permission to access the set.\n");
         return -EACCES;
     }
+    // Get the adjustments for SEM_UNDO, before changing anything.
+    sem_undo_t *undo = NULL;
+    for (unsigned i = 0; (i < nsops) && !undo; ++i) {
+        if (sops[i].sem_flg & SEM_UNDO) {
+            if ((undo = __sem_undo_find(sem_info, sys_getpid(), 1)) == NULL) {
+                return -ENOMEM;
+            }
+        }
+    }
+    // Apply all the operations, or none of them.
+    int result = __sem_try_apply(sem_info, sops, nsops);
+    if (result < 0) {
+        return result;
+    }
+    if (result < nsops) {
+        struct sembuf *blocking = &sops[result];
+        // We cannot wait, the operation fails.
+        if (blocking->sem_flg & IPC_NOWAIT) {
+            return -EAGAIN;
+        }
+        // A signal interrupts the wait.
+        if (signal_pending(scheduler_get_current_process())) {
+            return -EINTR;
+        }
+        // Sleep until the values of the set change, or a signal arrives, then try again.
+        wait_queue_entry_t *entry = sleep_on_interruptible(&sem_info->wait);
+        if (!entry) {
+            return -ENOMEM;
+        }
+        // Count the process among the ones waiting on the semaphore.
+        struct sem *sem = &sem_info->sem_base[blocking->sem_num];
+        entry->private  = (blocking->sem_op == 0) ? &sem->sem_zcnt : &sem->sem_ncnt;
+        return -ERESTART;
+    }
+    int changed = 0;
+    for (unsigned i = 0; i < nsops; ++i) {
+        // Keep track of how to revert the operation.
+        if (sops[i].sem_flg & SEM_UNDO) {
+            undo->semadj[sops[i].sem_num] -= sops[i].sem_op;
+        }
+        // Update the pid of the process that did last op.
+        sem_info->sem_base[sops[i].sem_num].sem_pid = sys_getpid();
+        changed |= (sops[i].sem_op != 0);
+    }
     // Update semop time.
     sem_info->semid.sem_otime = sys_time(NULL);
-    // If the operation is negative then we need to check for possible blocking
-    // operation. If the value of the sem were to become negative then we return
-    // a special value.
-    if (((int)sem_info->sem_base[sops->sem_num].sem_val + (int)sops->sem_op) < 0) {
-        // The value would become negative, we cannot perform the operation.
-        return -EAGAIN;
-    }
-    // Update the semaphore value.
-    sem_info->sem_base[sops->sem_num].sem_val += sops->sem_op;
-    // Update the pid of the process that did last op.
-    sem_info->sem_base[sops->sem_num].sem_pid = sys_getpid();
     // Update the time.
-    sem_info->semid.sem_ctime                 = sys_time(NULL);
+    sem_info->semid.sem_ctime = sys_time(NULL);
+    // Wake up the processes waiting for the new values.
+    if (changed) {
+        wake_up(&sem_info->wait);
+    }
     return 0;
 }
 
@@ -333,6 +519,8 @@ long sys_semctl(int semid, int semnum, int cmd, union semun *arg)
                    "semaphore set.\n");
             return -EPERM;
         }
+        // Wake up the processes waiting on the set, they will find it removed.
+        wake_up(&sem_info->wait);
         // Remove the set from the list.
         __list_remove_sem_info(sem_info);
         // Delete the set.
@@ -362,10 +550,19 @@ long sys_semctl(int semid, int semnum, int cmd, union semun *arg)
                    "access the set.\n");
             return -EACCES;
         }
+        // Checking if the value is valid.
+        if (arg->val > SEMVMX) {
+            pr_err("The value to set is not valid %d.\n", arg->val);
+            return -ERANGE;
+        }
         // Setting the value.
         sem_info->sem_base[semnum].sem_val = arg->val;
         // Update the last change time.
         sem_info->semid.sem_ctime          = sys_time(NULL);
+        // The adjustments of SEM_UNDO do not apply anymore.
+        __sem_undo_clear(sem_info, semnum);
+        // Wake up the processes waiting for the new value.
+        wake_up(&sem_info->wait);
     } else if (cmd == SETALL) {
         // Initialize all semaphore in the set referred to by semid, using the
         // values supplied in the array pointed to by arg.array.
@@ -386,12 +583,23 @@ long sys_semctl(int semid, int semnum, int cmd, union semun *arg)
                    "access the set.\n");
             return -EACCES;
         }
+        // Checking if the values are valid.
+        for (unsigned i = 0; i < sem_info->semid.sem_nsems; ++i) {
+            if (arg->array[i] > SEMVMX) {
+                pr_err("The value to set is not valid %d.\n", arg->array[i]);
+                return -ERANGE;
+            }
+        }
         // Setting the values.
         for (unsigned i = 0; i < sem_info->semid.sem_nsems; ++i) {
             sem_info->sem_base[i].sem_val = arg->array[i];
         }
         // Update the last change time.
         sem_info->semid.sem_ctime = sys_time(NULL);
+        // The adjustments of SEM_UNDO do not apply anymore.
+        __sem_undo_clear(sem_info, -1);
+        // Wake up the processes waiting for the new values.
+        wake_up(&sem_info->wait);
     } else if (cmd == IPC_STAT) {
         // Place a copy of the semid_ds data structure in the buffer pointed to by
         // arg.buf.
@@ -478,7 +686,7 @@ long sys_semctl(int semid, int semnum, int cmd, union semun *arg)
                    "access the set.\n");
             return -EACCES;
         }
-        return sem_info->sem_base[semnum].sem_ncnt;
+        return __sem_count_waiting(sem_info, &sem_info->sem_base[semnum].sem_ncnt);
     } else if (cmd == GETZCNT) {
         // Return the number of processes currently waiting for the value of the
         // semnum-th semaphore to become 0.
@@ -494,7 +702,7 @@ long sys_semctl(int semid, int semnum, int cmd, union semun *arg)
                    "access the set.\n");
             return -EACCES;
         }
-        return sem_info->sem_base[semnum].sem_zcnt;
+        return __sem_count_waiting(sem_info, &sem_info->sem_base[semnum].sem_zcnt);
     } else if (cmd == SEM_STAT) {
         pr_err("Not implemented.\n");
         return -ENOSYS;
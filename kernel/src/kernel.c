@@ -19,6 +19,9 @@
 #include "drivers/mem.h"
 #include "drivers/ps2.h"
 #include "drivers/rtc.h"
+#include "fs/bcache.h"
+#include "fs/dcache.h"
+#include "fs/page_cache.h"
 #include "fs/ext2.h"
 #include "fs/fhs.h"
 #include "fs/procfs.h"
@@ -234,6 +237,36 @@ int kmain(boot_info_t *boot_informations)
     vfs_init();
     print_ok();
 
+    //==========================================================================
+    pr_notice("Initialize the buffer cache.\n");
+    printf("Initialize the buffer cache...");
+    if (bcache_initialize()) {
+        print_fail();
+        pr_emerg("Failed to initialize the buffer cache!\n");
+        return 1;
+    }
+    print_ok();
+
+    //==========================================================================
+    pr_notice("Initialize the directory entry cache.\n");
+    printf("Initialize the directory entry cache...");
+    if (dcache_initialize()) {
+        print_fail();
+        pr_emerg("Failed to initialize the directory entry cache!\n");
+        return 1;
+    }
+    print_ok();
+
+    //==========================================================================
+    pr_notice("Initialize the page cache.\n");
+    printf("Initialize the page cache...");
+    if (page_cache_initialize()) {
+        print_fail();
+        pr_emerg("Failed to initialize the page cache!\n");
+        return 1;
+    }
+    print_ok();
+
     //==========================================================================
     // Scan for ata devices.
     pr_notice("Initialize ATA devices...\n");
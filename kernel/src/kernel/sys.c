@@ -4,6 +4,7 @@
 /// See LICENSE.md for details.
 
 #include "errno.h"
+#include "fs/bcache.h"
 #include "klib/mutex.h"
 #include "klib/stdatomic.h"
 #include "stdio.h"
@@ -27,6 +28,8 @@ static void kernel_power_off(void)
     //        }
     //    migrate_to_reboot_cpu();
     //    syscore_shutdown();
+    // Write back the cached blocks before the disks go away.
+    bcache_sync(NULL);
     printf("Power down\n");
     //    kmsg_dump(KMSG_DUMP_POWEROFF);
     machine_power_off();
@@ -25,6 +25,8 @@ struct rbtree {
     rbtree_node_t *root;
     /// Comparison function for insertion.
     rbtree_tree_node_cmp_f cmp;
+    /// Optional callback, recomputing the data a node keeps about its subtree.
+    rbtree_tree_node_f augment;
     /// Size of the tree.
     unsigned int size;
 };
@@ -70,16 +72,36 @@ void rbtree_node_dealloc(rbtree_node_t *node)
     }
 }
 
+rbtree_node_t *rbtree_node_get_child(rbtree_node_t *node, int dir)
+{
+    if (node) {
+        return node->link[dir != 0];
+    }
+    return NULL;
+}
+
 /// @brief Checks if the node is red.
 /// @param node the node to check.
 /// @return 1 if the node is red, 0 otherwise.
 static int rbtree_node_is_red(const rbtree_node_t *node) { return node ? node->red : 0; }
 
+/// @brief Recomputes the data the node keeps about its subtree, if the tree
+/// has an augment callback.
+/// @param tree the tree.
+/// @param node the node.
+static inline void rbtree_node_augment(rbtree_t *tree, rbtree_node_t *node)
+{
+    if (tree->augment && node) {
+        tree->augment(tree, node);
+    }
+}
+
 /// @brief Performs a node rotation.
+/// @param tree the tree.
 /// @param node the node.
 /// @param dir the direction of the rotation (0: left, 1: right).
 /// @return the result of the rotate operation.
-static rbtree_node_t *rbtree_node_rotate(rbtree_node_t *node, int dir)
+static rbtree_node_t *rbtree_node_rotate(rbtree_t *tree, rbtree_node_t *node, int dir)
 {
     rbtree_node_t *result = NULL;
     if (node) {
@@ -88,26 +110,54 @@ static rbtree_node_t *rbtree_node_rotate(rbtree_node_t *node, int dir)
         result->link[dir] = node;
         node->red         = 1;
         result->red       = 0;
+        // The node is now a child of the result, update it first. The set of
+        // nodes below the result is unchanged, so are its ancestors.
+        rbtree_node_augment(tree, node);
+        rbtree_node_augment(tree, result);
     }
     return result;
 }
 
 /// @brief Performs a double rotation.
+/// @param tree the tree.
 /// @param node the node.
 /// @param dir the direction of the rotation (0: left, 1: right).
 /// @return the result of the rotate operation.
 /// @details Suppose U has a parent V and a grandparent W. Then two successive
 /// rotations on U will ensure that V and W are descendents of U.
-static rbtree_node_t *rbtree_node_rotate2(rbtree_node_t *node, int dir)
+static rbtree_node_t *rbtree_node_rotate2(rbtree_t *tree, rbtree_node_t *node, int dir)
 {
     rbtree_node_t *result = NULL;
     if (node) {
-        node->link[!dir] = rbtree_node_rotate(node->link[!dir], !dir);
-        result           = rbtree_node_rotate(node, dir);
+        node->link[!dir] = rbtree_node_rotate(tree, node->link[!dir], !dir);
+        result           = rbtree_node_rotate(tree, node, dir);
     }
     return result;
 }
 
+/// @brief Recomputes, from the bottom up, the augmented data of the nodes
+/// met while searching for the given node.
+/// @param tree the tree.
+/// @param key the node to search, it does not need to be inside the tree.
+/// @details Nodes comparing equal to the key are followed by their left
+/// subtree, so that after a removal the path also reaches the parent of the
+/// node which has been unlinked.
+static void rbtree_tree_augment_path(rbtree_t *tree, rbtree_node_t *key)
+{
+    rbtree_node_t *path[RBTREE_ITER_MAX_HEIGHT];
+    unsigned int top = 0;
+    if (!tree->augment) {
+        return;
+    }
+    for (rbtree_node_t *it = tree->root; it && (top < RBTREE_ITER_MAX_HEIGHT);) {
+        path[top++] = it;
+        it          = it->link[tree->cmp(tree, it, key) < 0];
+    }
+    while (top > 0) {
+        tree->augment(tree, path[--top]);
+    }
+}
+
 // rbtree_t - default callbacks
 
 /// @brief Peforms a comparison between the pointers of two elements.
@@ -138,13 +188,37 @@ rbtree_t *rbtree_tree_alloc(void) { return kmalloc(sizeof(rbtree_t)); }
 rbtree_t *rbtree_tree_init(rbtree_t *tree, rbtree_tree_node_cmp_f node_cb)
 {
     if (tree) {
-        tree->root = NULL;
-        tree->size = 0;
-        tree->cmp  = node_cb ? node_cb : rbtree_tree_node_cmp_ptr_cb;
+        tree->root    = NULL;
+        tree->size    = 0;
+        tree->cmp     = node_cb ? node_cb : rbtree_tree_node_cmp_ptr_cb;
+        tree->augment = NULL;
     }
     return tree;
 }
 
+void rbtree_tree_set_augment(rbtree_t *tree, rbtree_tree_node_f augment_cb)
+{
+    if (tree) {
+        tree->augment = augment_cb;
+    }
+}
+
+rbtree_node_t *rbtree_tree_get_root(rbtree_t *tree)
+{
+    if (tree) {
+        return tree->root;
+    }
+    return NULL;
+}
+
+void rbtree_tree_update(rbtree_t *tree, void *value)
+{
+    if (tree) {
+        rbtree_node_t node = {.value = value};
+        rbtree_tree_augment_path(tree, &node);
+    }
+}
+
 rbtree_t *rbtree_tree_create(rbtree_tree_node_cmp_f node_cb) { return rbtree_tree_init(rbtree_tree_alloc(), node_cb); }
 
 void rbtree_tree_dealloc(rbtree_t *tree, rbtree_tree_node_f node_cb)
@@ -256,9 +330,9 @@ int rbtree_tree_insert_node(rbtree_t *tree, rbtree_node_t *node)
                     // Hard red violation: rotations necessary
                     int dir2 = t->link[1] == g;
                     if (q == p->link[last]) {
-                        t->link[dir2] = rbtree_node_rotate(g, !last);
+                        t->link[dir2] = rbtree_node_rotate(tree, g, !last);
                     } else {
-                        t->link[dir2] = rbtree_node_rotate2(g, !last);
+                        t->link[dir2] = rbtree_node_rotate2(tree, g, !last);
                     }
                 }
 
@@ -287,6 +361,9 @@ int rbtree_tree_insert_node(rbtree_t *tree, rbtree_node_t *node)
         // Make the root black for simplified logic
         tree->root->red = 0;
         ++tree->size;
+
+        // The new node, and all its ancestors, have a new subtree.
+        rbtree_tree_augment_path(tree, node);
     }
 
     return 1;
@@ -303,8 +380,9 @@ int rbtree_tree_remove_with_cb(rbtree_t *tree, void *value, rbtree_tree_node_f n
         rbtree_node_t *q;
         rbtree_node_t *p;
         rbtree_node_t *g;        // Helpers
-        rbtree_node_t *f = NULL; // Found item
-        int dir          = 1;
+        rbtree_node_t *f  = NULL; // Found item
+        rbtree_node_t key = {0};  // Where the tree changed
+        int dir           = 1;
 
         // Set up our helpers
         q = &head;
@@ -330,7 +408,7 @@ int rbtree_tree_remove_with_cb(rbtree_t *tree, void *value, rbtree_tree_node_f n
             // Push the red node down with rotations and color flips
             if (!rbtree_node_is_red(q) && !rbtree_node_is_red(q->link[dir])) {
                 if (rbtree_node_is_red(q->link[!dir])) {
-                    p = p->link[last] = rbtree_node_rotate(q, dir);
+                    p = p->link[last] = rbtree_node_rotate(tree, q, dir);
                 } else if (!rbtree_node_is_red(q->link[!dir])) {
                     rbtree_node_t *s = p->link[!last];
                     if (s) {
@@ -342,9 +420,9 @@ int rbtree_tree_remove_with_cb(rbtree_t *tree, void *value, rbtree_tree_node_f n
                         } else {
                             int dir2 = g->link[1] == p;
                             if (rbtree_node_is_red(s->link[last])) {
-                                g->link[dir2] = rbtree_node_rotate2(p, last);
+                                g->link[dir2] = rbtree_node_rotate2(tree, p, last);
                             } else if (rbtree_node_is_red(s->link[!last])) {
-                                g->link[dir2] = rbtree_node_rotate(p, last);
+                                g->link[dir2] = rbtree_node_rotate(tree, p, last);
                             }
 
                             // Ensure correct coloring
@@ -365,6 +443,11 @@ int rbtree_tree_remove_with_cb(rbtree_t *tree, void *value, rbtree_tree_node_f n
 
             p->link[p->link[1] == q] = q->link[q->link[0] == NULL];
 
+            // The found node now holds the value that preceded the removed
+            // one (or it is the unlinked node itself), searching for it
+            // leads to the parent of the unlinked node.
+            key.value = f->value;
+
             if (node_cb) {
                 node_cb(tree, q);
             }
@@ -379,6 +462,11 @@ int rbtree_tree_remove_with_cb(rbtree_t *tree, void *value, rbtree_tree_node_f n
             tree->root->red = 0;
         }
 
+        // Update the nodes whose subtree lost the unlinked node.
+        if (f) {
+            rbtree_tree_augment_path(tree, &key);
+        }
+
         --tree->size;
     }
     return 1;
@@ -6,6 +6,7 @@
 #include "string.h"
 #include "ctype.h"
 #include "mem/alloc/slab.h"
+#include "stdint.h"
 #include "stdio.h"
 #include "stdlib.h"
 #include "sys/stat.h"
@@ -257,30 +258,28 @@ int tokenize(const char *string, const char *separators, size_t *offset, char *b
 
 void *memmove(void *dst, const void *src, size_t n)
 {
-    void *ret = dst;
-
-    if (dst <= src || (char *)dst >= ((char *)src + n)) {
-        /* Non-overlapping buffers; copy from lower addresses to higher
-         * addresses.
-         */
-        while (n--) {
-            *(char *)dst = *(char *)src;
-            dst          = (char *)dst + 1;
-            src          = (char *)src + 1;
-        }
-    } else {
-        // Overlapping buffers; copy from higher addresses to lower addresses.
-        dst = (char *)dst + n - 1;
-        src = (char *)src + n - 1;
-
-        while (n--) {
-            *(char *)dst = *(char *)src;
-            dst          = (char *)dst - 1;
-            src          = (char *)src - 1;
-        }
-    }
-
-    return ret;
+    // Copying forward is safe as long as the destination does not start
+    // inside the source.
+    if ((dst <= src) || ((char *)dst >= ((char *)src + n))) {
+        return memcpy(dst, src, n);
+    }
+    // Overlapping buffers; copy from higher addresses to lower addresses,
+    // first the trailing bytes, then the words.
+    size_t words = n >> 2U;
+    size_t tail  = n & 3U;
+    char *d      = (char *)dst + n - 1;
+    const char *s = (const char *)src + n - 1;
+    __asm__ __volatile__("std\n\t"
+                         "rep movsb\n\t"
+                         "sub $3, %%esi\n\t"
+                         "sub $3, %%edi\n\t"
+                         "mov %3, %%ecx\n\t"
+                         "rep movsl\n\t"
+                         "cld"
+                         : "+D"(d), "+S"(s), "+c"(tail)
+                         : "r"(words)
+                         : "memory", "cc");
+    return dst;
 }
 
 void *memchr(const void *ptr, int ch, size_t n)
@@ -430,6 +429,48 @@ char *strtok_r(char *str, const char *delim, char **saveptr)
 
 // Intrinsic functions.
 
+/// @brief A word which can alias any other type.
+typedef uint32_t __attribute__((__may_alias__)) __word_t;
+
+/// Bulk copies and fills below this size are not worth aligning.
+#define STRING_ALIGN_THRESHOLD 16U
+
+/// @brief Copies bytes with `rep movsb`, advancing the pointers.
+/// @param dst the destination pointer.
+/// @param src the source pointer.
+/// @param num the number of bytes.
+static inline void __copy_bytes(char **dst, const char **src, size_t num)
+{
+    __asm__ __volatile__("rep movsb" : "+D"(*dst), "+S"(*src), "+c"(num) : : "memory");
+}
+
+/// @brief Copies words with `rep movsl`, advancing the pointers.
+/// @param dst the destination pointer.
+/// @param src the source pointer.
+/// @param num the number of words.
+static inline void __copy_words(char **dst, const char **src, size_t num)
+{
+    __asm__ __volatile__("rep movsl" : "+D"(*dst), "+S"(*src), "+c"(num) : : "memory");
+}
+
+/// @brief Fills bytes with `rep stosb`, advancing the pointer.
+/// @param dst the destination pointer.
+/// @param pattern the pattern, repeated in each byte.
+/// @param num the number of bytes.
+static inline void __fill_bytes(char **dst, uint32_t pattern, size_t num)
+{
+    __asm__ __volatile__("rep stosb" : "+D"(*dst), "+c"(num) : "a"(pattern) : "memory");
+}
+
+/// @brief Fills words with `rep stosl`, advancing the pointer.
+/// @param dst the destination pointer.
+/// @param pattern the pattern.
+/// @param num the number of words.
+static inline void __fill_words(char **dst, uint32_t pattern, size_t num)
+{
+    __asm__ __volatile__("rep stosl" : "+D"(*dst), "+c"(num) : "a"(pattern) : "memory");
+}
+
 /*
  * #pragma function(memset)
  * #pragma function(memcmp)
@@ -443,43 +484,50 @@ char *strtok_r(char *str, const char *delim, char **saveptr)
 
 void *memset(void *ptr, int value, size_t num)
 {
-    // Turn the pointer into a char * pointer. Here, we use the volatile keyword
-    // to prevent the compiler from optimizing away the operations involving the
-    // pointer.
-    unsigned char volatile *dst = (unsigned char volatile *)ptr;
-    // Initialize the content of the memory.
-    while (num--) {
-        *dst++ = (unsigned char)value;
+    char *d          = (char *)ptr;
+    uint32_t pattern = (uint8_t)value * 0x01010101U;
+    // Align the destination, so that the words are written in one go.
+    if (num >= STRING_ALIGN_THRESHOLD) {
+        size_t head = (-(uintptr_t)d) & 3U;
+        __fill_bytes(&d, pattern, head);
+        num -= head;
     }
+    __fill_words(&d, pattern, num >> 2U);
+    __fill_bytes(&d, pattern, num & 3U);
     // Return the pointer.
     return ptr;
 }
 
 int memcmp(const void *ptr1, const void *ptr2, size_t n)
 {
-    if (!n) {
-        return 0;
-    }
-
-    while (--n && *(char *)ptr1 == *(char *)ptr2) {
-        ptr1 = (char *)ptr1 + 1;
-        ptr2 = (char *)ptr2 + 1;
+    const unsigned char *p1 = (const unsigned char *)ptr1;
+    const unsigned char *p2 = (const unsigned char *)ptr2;
+    // Skip the equal words, then look for the differing byte.
+    while ((n >= 4U) && (*(const __word_t *)p1 == *(const __word_t *)p2)) {
+        p1 += 4U;
+        p2 += 4U;
+        n -= 4U;
+    }
+    for (; n; --n, ++p1, ++p2) {
+        if (*p1 != *p2) {
+            return *p1 - *p2;
+        }
     }
-
-    return *((unsigned char *)ptr1) - *((unsigned char *)ptr2);
+    return 0;
 }
 
 void *memcpy(void *dst, const void *src, size_t num)
 {
-    // Turn the pointer into a char * pointer. Here, we use the volatile keyword
-    // to prevent the compiler from optimizing away the operations involving the
-    // pointer.
-    unsigned char volatile *_dst       = (unsigned char volatile *)dst;
-    const unsigned char volatile *_src = (const unsigned char volatile *)src;
-    // Initialize the content of the memory.
-    while (num--) {
-        *_dst++ = *_src++;
+    char *d       = (char *)dst;
+    const char *s = (const char *)src;
+    // Align the destination, so that the words are written in one go.
+    if (num >= STRING_ALIGN_THRESHOLD) {
+        size_t head = (-(uintptr_t)d) & 3U;
+        __copy_bytes(&d, &s, head);
+        num -= head;
     }
+    __copy_words(&d, &s, num >> 2U);
+    __copy_bytes(&d, &s, num & 3U);
     // Return the pointer.
     return dst;
 }
@@ -504,7 +552,18 @@ char *strcpy(char *dst, const char *src)
 size_t strlen(const char *s)
 {
     const char *it = s;
-    for (; *it; it++) {
+    // Reach a word boundary, an aligned word never crosses a page boundary.
+    for (; (uintptr_t)it & 3U; it++) {
+        if (!*it) {
+            return (size_t)(it - s);
+        }
+    }
+    // Skip the words which have no zero byte.
+    const __word_t *word = (const __word_t *)it;
+    while (!((*word - 0x01010101U) & ~*word & 0x80808080U)) {
+        word++;
+    }
+    for (it = (const char *)word; *it; it++) {
         ;
     }
     return (size_t)(it - s);
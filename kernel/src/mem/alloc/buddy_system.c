@@ -15,17 +15,19 @@
 #include "stdio.h"
 #include "system/panic.h"
 
-/// @brief Cache level low limit after which allocation starts.
-#define LOW_WATERMARK_LEVEL  10
-/// @brief Cache level high limit, above it deallocation happens.
-#define HIGH_WATERMARK_LEVEL 70
-/// @brief Cache level midway limit.
-#define MID_WATERMARK_LEVEL  ((LOW_WATERMARK_LEVEL + HIGH_WATERMARK_LEVEL) / 2)
+/// @brief Logarithm of the number of pages moved at once between a cache and
+/// the free lists.
+#define CACHE_BATCH_ORDER    4
+/// @brief Number of pages moved at once between a cache and the free lists.
+#define CACHE_BATCH_PAGES    (1U << CACHE_BATCH_ORDER)
+/// @brief Cache level high limit (in pages), above it a batch is given back.
+#define HIGH_WATERMARK_LEVEL 64
 
 /// @brief Bitwise flags for identifying page types and statuses.
 enum bb_flag {
-    FREE_PAGE = 0, ///< Bit position that identifies when a page is free or not.
-    ROOT_PAGE = 1  ///< Bit position that identifies when a page is the root page.
+    FREE_PAGE   = 0, ///< Bit position that identifies when a page is free or not.
+    ROOT_PAGE   = 1, ///< Bit position that identifies when a page is the root page.
+    CACHED_PAGE = 2  ///< Bit position that identifies when a block is inside a cache.
 };
 
 /// @brief Sets the given flag in the page.
@@ -348,6 +350,46 @@ void bb_free_pages(bb_instance_t *instance, bb_page_t *page)
 #endif
 }
 
+void bb_trim_pages(bb_instance_t *instance, bb_page_t *page, unsigned int count)
+{
+    if (!instance || !page) {
+        pr_crit("Invalid arguments in bb_trim_pages.\n");
+        return;
+    }
+
+    unsigned int order = page->order;
+    if ((count == 0) || (count > (1U << order))) {
+        pr_crit("Cannot trim a block of order %u to %u pages.\n", order, count);
+        return;
+    }
+
+    // Since the block is aligned to its size, splitting the kept pages
+    // following the bits of count, from the highest one, gives aligned blocks.
+    unsigned int index = 0;
+    for (int bit = order; bit >= 0; --bit) {
+        if (count & (1U << bit)) {
+            bb_page_t *block = __get_page_from_base(instance, page, index);
+            block->order     = bit;
+            __bb_set_flag(block, ROOT_PAGE);
+            __bb_clear_flag(block, FREE_PAGE);
+            index += 1U << bit;
+        }
+    }
+
+    // Do the same with the rest, from the lowest bit: each block is the buddy
+    // of a kept one, so it is not merged until that one is freed.
+    for (unsigned int bit = 0; index < (1U << order); ++bit) {
+        if (index & (1U << bit)) {
+            bb_page_t *block = __get_page_from_base(instance, page, index);
+            block->order     = bit;
+            __bb_set_flag(block, ROOT_PAGE);
+            __bb_clear_flag(block, FREE_PAGE);
+            bb_free_pages(instance, block);
+            index += 1U << bit;
+        }
+    }
+}
+
 int buddy_system_init(
     bb_instance_t *instance,
     const char *name,
@@ -405,6 +447,12 @@ int buddy_system_init(
         list_head_init(&area->free_list);
     }
 
+    // Initialize the caches of free blocks.
+    for (unsigned int order = 0; order < BB_CACHE_ORDERS; order++) {
+        list_head_init(&instance->cache[order].blocks);
+        instance->cache[order].count = 0;
+    }
+
     // Current base page descriptor of the zone.
     bb_page_t *page              = instance->base_page;
     // Address of the last page descriptor of the zone.
@@ -481,72 +529,138 @@ unsigned long buddy_system_get_free_space(const bb_instance_t *instance)
     for (int order = 0; order < MAX_BUDDYSYSTEM_GFP_ORDER; ++order) {
         size += instance->free_area[order].nr_free * (1UL << order) * PAGE_SIZE;
     }
-    return size;
+    return size + buddy_system_get_cached_space(instance);
 }
 
 unsigned long buddy_system_get_cached_space(const bb_instance_t *instance)
 {
     unsigned int size = 0;
-    for (int order = 0; order < MAX_BUDDYSYSTEM_GFP_ORDER; ++order) {
-        size += instance->free_pages_cache_size * PAGE_SIZE;
+    for (int order = 0; order < BB_CACHE_ORDERS; ++order) {
+        size += instance->cache[order].count * (1UL << order) * PAGE_SIZE;
     }
     return size;
 }
 
-/// @brief Extenmds the cache of the given amount.
-/// @param instance the cache instance.
-/// @param count the amount to extend to.
-static void __cache_extend(bb_instance_t *instance, int count)
+/// @brief Puts an allocated block inside the cache of its order.
+/// @param cache the cache.
+/// @param page the first page of the block.
+/// @param hot if the block was just used, and should be handed out first.
+static inline void __cache_push(bb_cache_t *cache, bb_page_t *page, int hot)
 {
-    for (int i = 0; i < count; i++) {
-        bb_page_t *page = bb_alloc_pages(instance, 0);
-        list_head_insert_after(&page->location.cache, &instance->free_pages_cache_list);
-        instance->free_pages_cache_size++;
+    __bb_set_flag(page, CACHED_PAGE);
+    if (hot) {
+        list_head_insert_after(&page->location.cache, &cache->blocks);
+    } else {
+        list_head_insert_before(&page->location.cache, &cache->blocks);
     }
+    cache->count++;
 }
 
-/// @brief Shrinks the cache.
-/// @param instance the cache instance.
-/// @param count the amount to shrink.
-static void __cache_shrink(bb_instance_t *instance, int count)
+/// @brief Fills the cache of the given order with a batch of cold blocks.
+/// @details The batch is taken from the free lists as a single block, and
+/// split in place. If there is no such block, a single one is taken.
+/// @param instance the buddy system instance.
+/// @param order the order of the cache.
+/// @return the number of blocks added to the cache.
+static unsigned int __cache_refill(bb_instance_t *instance, unsigned int order)
 {
-    for (int i = 0; i < count; i++) {
-        list_head_t *page_list = list_head_pop(&instance->free_pages_cache_list);
-        bb_page_t *page        = list_entry(page_list, bb_page_t, location.cache);
-        bb_free_pages(instance, page);
-        instance->free_pages_cache_size--;
+    bb_cache_t *cache        = &instance->cache[order];
+    unsigned int batch_order = CACHE_BATCH_ORDER;
+    bb_page_t *batch         = NULL;
+    for (unsigned int i = batch_order; i < MAX_BUDDYSYSTEM_GFP_ORDER; ++i) {
+        if (instance->free_area[i].nr_free > 0) {
+            batch = bb_alloc_pages(instance, batch_order);
+            break;
+        }
     }
+    if (!batch) {
+        batch_order = order;
+        batch       = bb_alloc_pages(instance, order);
+        if (!batch) {
+            return 0;
+        }
+    }
+    // Split the batch in blocks of the cache order.
+    unsigned int count = 1U << (batch_order - order);
+    for (unsigned int i = 0; i < count; ++i) {
+        bb_page_t *block = __get_page_from_base(instance, batch, i << order);
+        block->order     = order;
+        __bb_set_flag(block, ROOT_PAGE);
+        __bb_clear_flag(block, FREE_PAGE);
+        __cache_push(cache, block, 0);
+    }
+    return count;
 }
 
-/// @brief Allocate memory using the given cache.
-/// @param instance the cache instance.
-/// @return a pointer to the allocated page.
-static bb_page_t *__cached_alloc(bb_instance_t *instance)
+/// @brief Gives the coldest blocks of a cache back to the free lists.
+/// @param instance the buddy system instance.
+/// @param order the order of the cache.
+/// @param count the number of blocks to give back.
+static void __cache_drain(bb_instance_t *instance, unsigned int order, unsigned long count)
 {
-    if (instance->free_pages_cache_size < LOW_WATERMARK_LEVEL) {
-        // Request pages from the buddy system
-        uint32_t pages_to_request = MID_WATERMARK_LEVEL - instance->free_pages_cache_size;
-        __cache_extend(instance, pages_to_request);
+    bb_cache_t *cache = &instance->cache[order];
+    while (count-- && cache->count) {
+        bb_page_t *page = list_entry(cache->blocks.prev, bb_page_t, location.cache);
+        list_head_remove(&page->location.cache);
+        cache->count--;
+        __bb_clear_flag(page, CACHED_PAGE);
+        bb_free_pages(instance, page);
     }
-    list_head_t *page_list = list_head_pop(&instance->free_pages_cache_list);
-    bb_page_t *page        = list_entry(page_list, bb_page_t, location.cache);
-    return page;
 }
 
-/// @brief Frees the memory of the allocated page.
-/// @param instance the cache instance.
-/// @param page a pointer to the allocated page.
-static void __cached_free(bb_instance_t *instance, bb_page_t *page)
+/// @brief Gives all the cached blocks back to the free lists, so that they can
+/// be merged with their buddies.
+/// @param instance the buddy system instance.
+static inline void __cache_drain_all(bb_instance_t *instance)
 {
-    list_head_insert_after(&page->location.cache, &instance->free_pages_cache_list);
-
-    if (instance->free_pages_cache_size > HIGH_WATERMARK_LEVEL) {
-        // Free pages to the buddy system
-        uint32_t pages_to_free = instance->free_pages_cache_size - MID_WATERMARK_LEVEL;
-        __cache_shrink(instance, pages_to_free);
+    for (unsigned int order = 0; order < BB_CACHE_ORDERS; ++order) {
+        __cache_drain(instance, order, instance->cache[order].count);
     }
 }
 
-bb_page_t *bb_alloc_page_cached(bb_instance_t *instance) { return __cached_alloc(instance); }
+bb_page_t *bb_alloc_pages_cached(bb_instance_t *instance, unsigned int order)
+{
+    if (order >= BB_CACHE_ORDERS) {
+        bb_page_t *page = bb_alloc_pages(instance, order);
+        if (!page) {
+            // The cached blocks might be preventing the merge we need.
+            __cache_drain_all(instance);
+            page = bb_alloc_pages(instance, order);
+        }
+        return page;
+    }
+    bb_cache_t *cache = &instance->cache[order];
+    if (!cache->count && !__cache_refill(instance, order)) {
+        // The cached blocks of the other orders might be merged into what we
+        // need, give them all back and try again.
+        __cache_drain_all(instance);
+        if (!__cache_refill(instance, order)) {
+            return NULL;
+        }
+    }
+    // Take the hottest block.
+    bb_page_t *page = list_entry(cache->blocks.next, bb_page_t, location.cache);
+    list_head_remove(&page->location.cache);
+    cache->count--;
+    __bb_clear_flag(page, CACHED_PAGE);
+    return page;
+}
 
-void bb_free_page_cached(bb_instance_t *instance, bb_page_t *page) { __cached_free(instance, page); }
+void bb_free_pages_cached(bb_instance_t *instance, bb_page_t *page)
+{
+    unsigned int order = page->order;
+    if (order >= BB_CACHE_ORDERS) {
+        bb_free_pages(instance, page);
+        return;
+    }
+    if (__bb_test_flag(page, FREE_PAGE) || __bb_test_flag(page, CACHED_PAGE) || !__bb_test_flag(page, ROOT_PAGE)) {
+        pr_crit("Attempted to free a block which is not allocated (order: %u).\n", order);
+        return;
+    }
+    bb_cache_t *cache = &instance->cache[order];
+    __cache_push(cache, page, 1);
+    // Above the watermark, give a batch of the coldest blocks back.
+    if ((cache->count << order) > HIGH_WATERMARK_LEVEL) {
+        __cache_drain(instance, order, CACHE_BATCH_PAGES >> order);
+    }
+}
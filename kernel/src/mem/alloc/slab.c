@@ -31,10 +31,16 @@ typedef struct kmem_obj {
     list_head_t objlist;
 } kmem_obj_t;
 
-/// @brief Maximum order of kmalloc cache allocations.
-/// @details If a requested memory allocation exceeds this order, a raw page
-/// allocation is done instead of using the slab cache.
-#define MAX_KMALLOC_CACHE_ORDER 12
+/// @brief Number of kmalloc size classes.
+#define KMALLOC_CLASSES 16
+
+/// @brief Size of the largest kmalloc size class.
+/// @details Bigger requests get their own pages, instead of using the slab
+/// caches.
+#define KMALLOC_MAX_SIZE 2048
+
+/// @brief Granularity of the table mapping sizes to kmalloc size classes.
+#define KMALLOC_INDEX_STEP 8
 
 /// @brief Overhead size for each memory object in the slab cache.
 /// @details This defines the extra space required for managing the object,
@@ -50,6 +56,12 @@ typedef struct kmem_obj {
 /// the slab when it runs out of free objects.
 #define KMEM_MAX_REFILL_OBJ_COUNT 64
 
+/// @brief Number of objects moved at once between a magazine and the slabs.
+/// @details When the magazine is empty, an allocation takes up to this many
+/// objects from the slabs; when it is full, a free gives back as many of the
+/// oldest ones.
+#define KMEM_MAGAZINE_BATCH (KMEM_MAGAZINE_SIZE / 2)
+
 /// @brief Macro to convert an address into a kmem_obj pointer.
 /// @param addr Address of the object.
 /// @return Pointer to a kmem_obj structure.
@@ -66,8 +78,29 @@ static list_head_t kmem_caches_list;
 /// @brief Cache used for managing metadata about the memory caches themselves.
 static kmem_cache_t kmem_cache;
 
-/// @brief Array of slab caches for different orders of kmalloc.
-static kmem_cache_t *malloc_blocks[MAX_KMALLOC_CACHE_ORDER];
+/// @brief Object sizes of the kmalloc caches. Between two powers of two there
+/// is a class at three quarters, so that no more than a third of an object is
+/// wasted by rounding up a request.
+static const unsigned int kmalloc_sizes[KMALLOC_CLASSES] = {
+    8, 16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048,
+};
+
+/// @brief Names of the kmalloc caches.
+static const char *kmalloc_names[KMALLOC_CLASSES] = {
+    "kmalloc-8",   "kmalloc-16",  "kmalloc-24",  "kmalloc-32",   "kmalloc-48",   "kmalloc-64",
+    "kmalloc-96",  "kmalloc-128", "kmalloc-192", "kmalloc-256",  "kmalloc-384",  "kmalloc-512",
+    "kmalloc-768", "kmalloc-1k",  "kmalloc-1.5k", "kmalloc-2k",
+};
+
+/// @brief Array of slab caches for the kmalloc size classes.
+static kmem_cache_t *malloc_blocks[KMALLOC_CLASSES];
+
+/// @brief Index of the smallest kmalloc size class fitting a request, for each
+/// multiple of KMALLOC_INDEX_STEP.
+static uint8_t kmalloc_index[KMALLOC_MAX_SIZE / KMALLOC_INDEX_STEP];
+
+/// @brief Statistics about the kmalloc requests too big for the caches.
+static kmalloc_stats_t kmalloc_stats;
 
 /// @brief Allocates and initializes a new slab page for a memory cache.
 /// @param cachep Pointer to the memory cache (`kmem_cache_t`) for which a new
@@ -314,6 +347,12 @@ static int __kmem_cache_create(
         .slabs_full          = {NULL, NULL},
         .slabs_partial       = {NULL, NULL},
         .slabs_free          = {NULL, NULL},
+        .magazine_count      = 0,
+        .alloc_hits          = 0,
+        .alloc_misses        = 0,
+        .free_hits           = 0,
+        .free_misses         = 0,
+        .requested_bytes     = 0,
     };
 
     // Initialize the list heads for free, partial, and full slabs.
@@ -346,7 +385,6 @@ static int __kmem_cache_create(
 /// @brief Allocates an object from a specified slab page.
 /// @details This function retrieves a free object from the given slab page's free list.
 /// It decrements the count of free objects in both the slab page and the cache.
-/// If the constructor function is defined, it will be called to initialize the object.
 /// @param cachep Pointer to the cache from which the object is being allocated.
 /// @param slab_page Pointer to the slab page from which to allocate the object.
 /// @return Pointer to the allocated object, or NULL if allocation fails.
@@ -392,11 +430,6 @@ static inline void *__kmem_cache_alloc_slab(kmem_cache_t *cachep, page_t *slab_p
     // Get the address of the allocated element from the kmem object.
     void *elem = ADDR_FROM_KMEM_OBJ(object);
 
-    // Call the constructor function if it is defined to initialize the object.
-    if (cachep->ctor) {
-        cachep->ctor(elem);
-    }
-
     pr_debug("Successfully allocated object 0x%p from cache `%s`.\n", elem, cachep->name);
 
     return elem;
@@ -454,6 +487,170 @@ static inline int __kmem_cache_free_slab(kmem_cache_t *cachep, page_t *slab_page
     return 0;
 }
 
+/// @brief Retrieves the root page of the slab containing the given object.
+/// @param addr Address of the object.
+/// @return Pointer to the root slab page, or NULL on failure.
+static inline page_t *__kmem_cache_get_slab_page(void *addr)
+{
+    // Get the slab page corresponding to the given pointer.
+    page_t *slab_page = get_page_from_virtual_address((uint32_t)addr);
+
+    // Check if slab_page retrieval was successful
+    if (!slab_page) {
+        pr_crit("Failed to get slab page for pointer 0x%p.\n", addr);
+        return NULL;
+    }
+
+    // If the slab main page is a low memory page, update to the root page.
+    if (is_lowmem_page_struct(slab_page->container.slab_main_page)) {
+        slab_page = slab_page->container.slab_main_page;
+    }
+    return slab_page;
+}
+
+/// @brief Takes a free object from the slabs of the cache, growing it if needed.
+/// @param cachep Pointer to the cache from which the object is being allocated.
+/// @param flags Allocation flags used if new slab pages are needed.
+/// @return Pointer to the object, or NULL if allocation fails.
+static void *__kmem_cache_alloc_slow(kmem_cache_t *cachep, gfp_t flags)
+{
+    // Check if there are any partially filled slabs.
+    if (list_head_empty(&cachep->slabs_partial)) {
+        // If no partial slabs, check for free slabs.
+        if (list_head_empty(&cachep->slabs_free)) {
+            // If no flags are specified, use the cache's flags.
+            if (flags == 0) {
+                flags = cachep->flags;
+            }
+
+            // Attempt to refill the cache, limiting the number of objects.
+            if (__kmem_cache_refill(cachep, min(cachep->total_num, KMEM_MAX_REFILL_OBJ_COUNT), flags) < 0) {
+                pr_crit("Failed to refill cache `%s`\n", cachep->name);
+                return NULL;
+            }
+
+            // If still no free slabs, log an error and return NULL.
+            if (list_head_empty(&cachep->slabs_free)) {
+                pr_crit("Cannot allocate more slabs in `%s`\n", cachep->name);
+                return NULL;
+            }
+        }
+
+        // Move a free slab to the partial list since we're about to allocate from it.
+        list_head_t *free_slab = list_head_pop(&cachep->slabs_free);
+        if (!free_slab) {
+            pr_crit("Retrieved invalid slab from free list.\n");
+            return NULL;
+        }
+        list_head_insert_after(free_slab, &cachep->slabs_partial);
+    }
+
+    // Retrieve the slab page from the partial list.
+    page_t *slab_page = list_entry(cachep->slabs_partial.next, page_t, slabs);
+    if (!slab_page) {
+        pr_crit("Retrieved invalid slab from partial list.\n");
+        return NULL;
+    }
+
+    // Allocate an object from the slab page.
+    void *ptr = __kmem_cache_alloc_slab(cachep, slab_page);
+    if (!ptr) {
+        pr_crit("Failed to allocate object from slab.\n");
+        return NULL;
+    }
+
+    // If the slab is now full, move it to the full slabs list.
+    if (slab_page->slab_objfree == 0) {
+        list_head_t *slab_full_elem = list_head_pop(&cachep->slabs_partial);
+        if (!slab_full_elem) {
+            pr_crit("Retrieved invalid slab from partial list while moving to "
+                    "full list.\n");
+            return NULL;
+        }
+        list_head_insert_after(slab_full_elem, &cachep->slabs_full);
+    }
+    return ptr;
+}
+
+/// @brief Gives an object back to the slab it belongs to.
+/// @param cachep Pointer to the cache owning the object.
+/// @param addr Address of the object.
+/// @return 0 on success, -1 on failure.
+static int __kmem_cache_free_slow(kmem_cache_t *cachep, void *addr)
+{
+    // Get the slab page corresponding to the given pointer.
+    page_t *slab_page = __kmem_cache_get_slab_page(addr);
+    if (!slab_page) {
+        return -1;
+    }
+
+    // Get the kmem_obj from the pointer.
+    kmem_obj_t *object = KMEM_OBJ_FROM_ADDR(addr);
+
+    // Add object to the free list of the slab.
+    list_head_insert_after(&object->objlist, &slab_page->slab_freelist);
+    slab_page->slab_objfree++;
+    cachep->free_num++;
+
+    // Check if the slab is completely free, move it to the free list.
+    if (slab_page->slab_objfree == slab_page->slab_objcnt) {
+        // Remove the page from the partial list.
+        list_head_remove(&slab_page->slabs);
+        // Add the page to the free list.
+        list_head_insert_after(&slab_page->slabs, &cachep->slabs_free);
+        pr_debug("Slab page 0x%p moved to free list.\n", slab_page);
+    }
+    // If the page is not full, update its list status.
+    else if (slab_page->slab_objfree == 1) {
+        // Remove the page from the full list.
+        list_head_remove(&slab_page->slabs);
+        // Add the page to the partial list.
+        list_head_insert_after(&slab_page->slabs, &cachep->slabs_partial);
+        pr_debug("Slab page 0x%p moved to partial list.\n", slab_page);
+    }
+    return 0;
+}
+
+/// @brief Moves free objects from the slabs into the empty magazine.
+/// @details Only objects already sitting in the slabs are taken, the cache is
+/// never grown just to fill the magazine.
+/// @param cachep Pointer to the cache.
+static inline void __kmem_cache_magazine_fill(kmem_cache_t *cachep)
+{
+    // Objects in the magazine count as free, so the slabs hold the rest.
+    while ((cachep->magazine_count < KMEM_MAGAZINE_BATCH) && (cachep->free_num > cachep->magazine_count)) {
+        void *ptr = __kmem_cache_alloc_slow(cachep, 0);
+        if (!ptr) {
+            break;
+        }
+        cachep->magazine[cachep->magazine_count++] = ptr;
+        cachep->free_num++;
+    }
+}
+
+/// @brief Gives the oldest objects of the magazine back to the slabs.
+/// @param cachep Pointer to the cache.
+/// @param count Number of objects to drain.
+/// @return 0 on success, -1 on failure.
+static inline int __kmem_cache_magazine_drain(kmem_cache_t *cachep, unsigned int count)
+{
+    count = min(count, cachep->magazine_count);
+    for (unsigned int i = 0; i < count; ++i) {
+        if (__kmem_cache_free_slow(cachep, cachep->magazine[i]) < 0) {
+            pr_crit("Failed to drain the magazine of cache `%s`.\n", cachep->name);
+            return -1;
+        }
+        // The object was already counted as free.
+        cachep->free_num--;
+    }
+    // Move the most recent objects to the bottom of the stack.
+    for (unsigned int i = count; i < cachep->magazine_count; ++i) {
+        cachep->magazine[i - count] = cachep->magazine[i];
+    }
+    cachep->magazine_count -= count;
+    return 0;
+}
+
 int kmem_cache_init(void)
 {
     // Initialize the list of caches to keep track of all memory caches.
@@ -470,25 +667,25 @@ int kmem_cache_init(void)
         return -1;
     }
 
-    // Create caches for different order sizes for kmalloc allocations.
-    for (unsigned i = 0; i < MAX_KMALLOC_CACHE_ORDER; i++) {
+    // Create caches for the kmalloc size classes.
+    for (unsigned i = 0; i < KMALLOC_CLASSES; i++) {
         malloc_blocks[i] = kmem_cache_create(
-            "kmalloc",
-            1U << i, // Size of the allocation (2^i).
-            1U << i, // Alignment of the allocation.
+            kmalloc_names[i],
+            kmalloc_sizes[i],                      // Size of the allocation.
+            kmalloc_sizes[i] & -kmalloc_sizes[i], // Alignment, the largest power of two dividing the size.
             GFP_KERNEL,
             NULL,  // Constructor (none).
             NULL); // Destructor (none).
 
         // Check if the cache was created successfully.
         if (!malloc_blocks[i]) {
-            pr_crit("Failed to create kmalloc cache for order %u.\n", i);
+            pr_crit("Failed to create kmalloc cache `%s`.\n", kmalloc_names[i]);
 
             // Clean up any previously allocated caches before exiting.
             for (unsigned j = 0; j < i; j++) {
                 if (malloc_blocks[j]) {
                     if (kmem_cache_destroy(malloc_blocks[j]) < 0) {
-                        pr_crit("Failed to destroy kmalloc cache for order %u.\n", j);
+                        pr_crit("Failed to destroy kmalloc cache `%s`.\n", kmalloc_names[j]);
                     }
                     malloc_blocks[j] = NULL;
                 }
@@ -501,6 +698,14 @@ int kmem_cache_init(void)
         }
     }
 
+    // Map each size to the smallest class fitting it.
+    for (unsigned i = 0, index = 0; i < count_of(kmalloc_index); i++) {
+        while (kmalloc_sizes[index] < (i + 1) * KMALLOC_INDEX_STEP) {
+            index++;
+        }
+        kmalloc_index[i] = index;
+    }
+
     pr_info("kmem_cache system successfully initialized.\n");
 
     return 0;
@@ -560,6 +765,11 @@ int kmem_cache_destroy(kmem_cache_t *cachep)
         return -1;
     }
 
+    // Give the objects held by the magazine back to their slabs.
+    if (__kmem_cache_magazine_drain(cachep, cachep->magazine_count) < 0) {
+        return -1;
+    }
+
     // Free all slabs in the free list.
     while (!list_head_empty(&cachep->slabs_free)) {
         list_head_t *slab_list = list_head_pop(&cachep->slabs_free);
@@ -590,20 +800,26 @@ int kmem_cache_destroy(kmem_cache_t *cachep)
         __kmem_cache_free_slab(cachep, list_entry(slab_list, page_t, slabs));
     }
 
+    // Remove the cache from the global cache list.
+    list_head_remove(&cachep->cache_list);
+
+    pr_debug("Successfully destroyed cache `%s`.\n", cachep->name);
+
     // Free the cache structure itself.
     if (kmem_cache_free(cachep) != 0) {
         pr_crit("Failed to free cache structure.\n");
         return -1;
     }
 
-    // Remove the cache from the global cache list.
-    list_head_remove(&cachep->cache_list);
-
-    pr_debug("Successfully destroyed cache `%s`.\n", cachep->name);
-
     return 0;
 }
 
+kmem_cache_t *kmem_cache_next(kmem_cache_t *cachep)
+{
+    list_head_t *next = cachep ? cachep->cache_list.next : kmem_caches_list.next;
+    return (next == &kmem_caches_list) ? NULL : list_entry(next, kmem_cache_t, cache_list);
+}
+
 void *pr_kmem_cache_alloc(const char *file, const char *fun, int line, kmem_cache_t *cachep, gfp_t flags)
 {
     // Check for null cache pointer
@@ -612,60 +828,25 @@ void *pr_kmem_cache_alloc(const char *file, const char *fun, int line, kmem_cach
         return NULL;
     }
 
-    // Check if there are any partially filled slabs.
-    if (list_head_empty(&cachep->slabs_partial)) {
-        // If no partial slabs, check for free slabs.
-        if (list_head_empty(&cachep->slabs_free)) {
-            // If no flags are specified, use the cache's flags.
-            if (flags == 0) {
-                flags = cachep->flags;
-            }
-
-            // Attempt to refill the cache, limiting the number of objects.
-            if (__kmem_cache_refill(cachep, min(cachep->total_num, KMEM_MAX_REFILL_OBJ_COUNT), flags) < 0) {
-                pr_crit("Failed to refill cache `%s`\n", cachep->name);
-                return NULL;
-            }
-
-            // If still no free slabs, log an error and return NULL.
-            if (list_head_empty(&cachep->slabs_free)) {
-                pr_crit("Cannot allocate more slabs in `%s`\n", cachep->name);
-                return NULL;
-            }
-        }
-
-        // Move a free slab to the partial list since we're about to allocate from it.
-        list_head_t *free_slab = list_head_pop(&cachep->slabs_free);
-        if (!free_slab) {
-            pr_crit("Retrieved invalid slab from free list.\n");
+    void *ptr;
+    if (cachep->magazine_count > 0) {
+        // Fast path, take the most recently freed object.
+        ptr = cachep->magazine[--cachep->magazine_count];
+        cachep->free_num--;
+        cachep->alloc_hits++;
+    } else {
+        // Slow path, take the object from the slabs, and a batch along with it.
+        ptr = __kmem_cache_alloc_slow(cachep, flags);
+        if (!ptr) {
             return NULL;
         }
-        list_head_insert_after(free_slab, &cachep->slabs_partial);
-    }
-
-    // Retrieve the slab page from the partial list.
-    page_t *slab_page = list_entry(cachep->slabs_partial.next, page_t, slabs);
-    if (!slab_page) {
-        pr_crit("Retrieved invalid slab from partial list.\n");
-        return NULL;
+        cachep->alloc_misses++;
+        __kmem_cache_magazine_fill(cachep);
     }
 
-    // Allocate an object from the slab page.
-    void *ptr = __kmem_cache_alloc_slab(cachep, slab_page);
-    if (!ptr) {
-        pr_crit("Failed to allocate object from slab.\n");
-        return NULL;
-    }
-
-    // If the slab is now full, move it to the full slabs list.
-    if (slab_page->slab_objfree == 0) {
-        list_head_t *slab_full_elem = list_head_pop(&cachep->slabs_partial);
-        if (!slab_full_elem) {
-            pr_crit("Retrieved invalid slab from partial list while moving to "
-                    "full list.\n");
-            return NULL;
-        }
-        list_head_insert_after(slab_full_elem, &cachep->slabs_full);
+    // Call the constructor function if it is defined to initialize the object.
+    if (cachep->ctor) {
+        cachep->ctor(ptr);
     }
 
 #ifdef ENABLE_CACHE_TRACE
@@ -684,19 +865,11 @@ int pr_kmem_cache_free(const char *file, const char *fun, int line, void *addr)
     }
 
     // Get the slab page corresponding to the given pointer.
-    page_t *slab_page = get_page_from_virtual_address((uint32_t)addr);
-
-    // Check if slab_page retrieval was successful
+    page_t *slab_page = __kmem_cache_get_slab_page(addr);
     if (!slab_page) {
-        pr_crit("Failed to get slab page for pointer 0x%p.\n", addr);
         return 1;
     }
 
-    // If the slab main page is a low memory page, update to the root page.
-    if (is_lowmem_page_struct(slab_page->container.slab_main_page)) {
-        slab_page = slab_page->container.slab_main_page;
-    }
-
     // Retrieve the cache pointer from the slab page.
     kmem_cache_t *cachep = slab_page->container.slab_cache;
 
@@ -715,69 +888,87 @@ int pr_kmem_cache_free(const char *file, const char *fun, int line, void *addr)
         cachep->dtor(addr);
     }
 
-    // Get the kmem_obj from the pointer.
-    kmem_obj_t *object = KMEM_OBJ_FROM_ADDR(addr);
-
-    // Check if object retrieval was successful
-    if (!object) {
-        pr_crit("Failed to retrieve kmem object for pointer 0x%p.\n", addr);
-        return 1;
+    // Make room for the object by giving the oldest ones back to the slabs.
+    if (cachep->magazine_count == KMEM_MAGAZINE_SIZE) {
+        if (__kmem_cache_magazine_drain(cachep, KMEM_MAGAZINE_BATCH) < 0) {
+            return 1;
+        }
+        cachep->free_misses++;
+    } else {
+        cachep->free_hits++;
     }
 
-    // Add object to the free list of the slab.
-    list_head_insert_after(&object->objlist, &slab_page->slab_freelist);
-    slab_page->slab_objfree++;
+    // Keep the object at hand for the next allocation.
+    cachep->magazine[cachep->magazine_count++] = addr;
     cachep->free_num++;
-
-    // Check if the slab is completely free, move it to the free list.
-    if (slab_page->slab_objfree == slab_page->slab_objcnt) {
-        // Remove the page from the partial list.
-        list_head_remove(&slab_page->slabs);
-        // Add the page to the free list.
-        list_head_insert_after(&slab_page->slabs, &cachep->slabs_free);
-        pr_debug("Slab page 0x%p moved to free list.\n", slab_page);
-    }
-    // If the page is not full, update its list status.
-    else if (slab_page->slab_objfree == 1) {
-        // Remove the page from the full list.
-        list_head_remove(&slab_page->slabs);
-        // Add the page to the partial list.
-        list_head_insert_after(&slab_page->slabs, &cachep->slabs_partial);
-        pr_debug("Slab page 0x%p moved to partial list.\n", slab_page);
-    }
     return 0;
 }
 
-void *pr_kmalloc(const char *file, const char *fun, int line, unsigned int size)
+/// @brief Allocates the pages for a kmalloc request too big for the caches.
+/// @details Only the needed pages are taken, instead of a whole power of two.
+/// @param size The amount of memory to allocate.
+/// @return A pointer to the allocated memory, NULL on failure.
+static void *__kmalloc_large(unsigned int size)
 {
-    unsigned int order = 0;
+    uint32_t count = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+    page_t *page   = alloc_pages_exact(GFP_KERNEL, count);
+    if (!page) {
+        return NULL;
+    }
+    // Pages outside the slabs have no slab page, kfree uses that to recognize
+    // them, and keep their size in the otherwise unused slab counters.
+    page->container.slab_main_page = NULL;
+    page->slab_objcnt              = count;
+    page->slab_objfree             = size;
+
+    kmalloc_stats.large_objects++;
+    kmalloc_stats.large_pages += count;
+    kmalloc_stats.large_wasted += count * PAGE_SIZE - size;
+    return (void *)get_virtual_address_from_page(page);
+}
 
-    // Determine the order based on the size requested.
-    while (size != 0) {
-        order++;
-        size /= 2;
+/// @brief Frees the pages of a kmalloc request too big for the caches.
+/// @param page The first page.
+/// @return 0 on success, -1 on failure.
+static int __kfree_large(page_t *page)
+{
+    uint32_t count = page->slab_objcnt;
+    if (count == 0) {
+        pr_crit("The page 0x%p was not allocated by kmalloc.\n", page);
+        return -1;
     }
 
-    // Allocate memory. If size exceeds the maximum cache order, allocate raw pages.
+    kmalloc_stats.large_objects--;
+    kmalloc_stats.large_pages -= count;
+    kmalloc_stats.large_wasted -= count * PAGE_SIZE - page->slab_objfree;
+
+    page->slab_objcnt  = 0;
+    page->slab_objfree = 0;
+    return free_pages_exact(page, count);
+}
+
+void *pr_kmalloc(const char *file, const char *fun, int line, unsigned int size)
+{
     void *ptr;
-    if (order >= MAX_KMALLOC_CACHE_ORDER) {
-        ptr = (void *)alloc_pages_lowmem(GFP_KERNEL, order - 12);
-        if (!ptr) {
-            pr_crit("Failed to allocate raw pages for order %u at %s:%d\n", order, file, line);
+    if (size <= KMALLOC_MAX_SIZE) {
+        // Take the smallest size class fitting the request.
+        kmem_cache_t *cachep = malloc_blocks[kmalloc_index[size ? (size - 1) / KMALLOC_INDEX_STEP : 0]];
+        ptr                  = kmem_cache_alloc(cachep, GFP_KERNEL);
+        if (ptr) {
+            cachep->requested_bytes += size;
+        } else {
+            pr_crit("Failed to allocate from `%s` for size %u at %s:%d\n", cachep->name, size, file, line);
         }
     } else {
-        ptr = kmem_cache_alloc(malloc_blocks[order], GFP_KERNEL);
+        ptr = __kmalloc_large(size);
         if (!ptr) {
-            pr_crit(
-                "Failed to allocate from kmalloc cache order %u for size %u at "
-                "%s:%d\n",
-                order, size, file, line);
+            pr_crit("Failed to allocate raw pages for size %u at %s:%d\n", size, file, line);
         }
     }
 
 #ifdef ENABLE_KMEM_TRACE
     if (ptr) {
-        pr_notice("kmalloc 0x%p of order %u at %s:%d\n", ptr, order, file, line);
+        pr_notice("kmalloc 0x%p of size %u at %s:%d\n", ptr, size, file, line);
     }
     store_resource_info(resource_id, file, line, ptr);
 #endif
@@ -810,7 +1001,7 @@ void pr_kfree(const char *file, const char *fun, int line, void *ptr)
         }
     } else {
         // Otherwise, free the raw pages.
-        if (free_pages_lowmem((uint32_t)ptr) < 0) {
+        if (__kfree_large(page) < 0) {
             pr_crit("Failed to free raw pages for address 0x%p at %s:%d\n", ptr, file, line);
         }
     }
@@ -821,3 +1012,5 @@ void pr_kfree(const char *file, const char *fun, int line, void *ptr)
     print_resource_usage(resource_id, NULL);
 #endif
 }
+
+void kmalloc_get_stats(kmalloc_stats_t *stats) { *stats = kmalloc_stats; }
@@ -15,6 +15,7 @@
 #include "mem/alloc/buddy_system.h"
 #include "mem/alloc/zone_allocator.h"
 #include "mem/mm/page.h"
+#include "mem/mm/vmem.h"
 #include "mem/paging.h"
 #include "string.h"
 
@@ -160,8 +161,9 @@ static zone_t *get_zone_from_flags(gfp_t gfp_mask)
         return NULL;
     }
 
-    // Determine the appropriate zone based on the given GFP mask.
-    switch (gfp_mask) {
+    // Determine the appropriate zone based on the given GFP mask, action
+    // modifiers do not change the zone.
+    switch (gfp_mask & ~__GFP_ZERO) {
     case GFP_DMA:
         // Return the DMA zone.
         return &memory.page_data->node_zones[ZONE_DMA];
@@ -197,8 +199,9 @@ static inline int is_memory_clean(gfp_t gfp_mask)
         pr_emerg("Failed to get zone from GFP mask.\n");
         return 0;
     }
-    // Check if the total size of the zone matches the free space in the buddy system.
-    unsigned long free_space = buddy_system_get_free_space(&zone->buddy_system);
+    // Check if the total size of the zone matches the free space in the buddy
+    // system, together with the pages waiting in the zero pool.
+    unsigned long free_space = buddy_system_get_free_space(&zone->buddy_system) + (zone->zero_pool.count * PAGE_SIZE);
     if (zone->total_size != free_space) {
         pr_crit("Memory zone check failed for zone '%s'.\n", zone->name);
         pr_crit("Expected free space %lu bytes, but found %lu bytes.\n", zone->total_size, free_space);
@@ -524,6 +527,12 @@ static int zone_init(char *name, int zone_index, uint32_t adr_from, uint32_t adr
     // Clear the page structures in the memory map.
     memset(zone->zone_mem_map, 0, zone->num_pages * sizeof(page_t));
 
+    // Start with an empty pool of zeroed pages.
+    list_head_init(&zone->zero_pool.pages);
+    zone->zero_pool.count  = 0;
+    zone->zero_pool.hits   = 0;
+    zone->zero_pool.misses = 0;
+
     // Initialize the buddy system for the new zone.
     if (!buddy_system_init(
             &zone->buddy_system,             // Buddy system structure for the zone.
@@ -882,6 +891,38 @@ int pmmngr_init(boot_info_t *boot_info)
     return pmm_check();
 }
 
+/// @brief Fills the given pages with zeros.
+/// @param zone The zone containing the pages.
+/// @param page The first page.
+/// @param count The number of pages.
+/// @return 0 on success, -1 on failure.
+static int __zero_pages(zone_t *zone, page_t *page, uint32_t count)
+{
+    // Lowmem pages are always mapped.
+    if (zone != &memory.page_data->node_zones[ZONE_HIGHMEM]) {
+        memset((void *)get_virtual_address_from_page(page), 0, count * PAGE_SIZE);
+        return 0;
+    }
+    // Highmem pages go through the kmap window one at a time.
+    for (uint32_t i = 0; i < count; i++) {
+        void *vaddr = vmem_kmap(&page[i], KMAP_ZERO);
+        memset(vaddr, 0, PAGE_SIZE);
+        vmem_kunmap(vaddr, KMAP_ZERO);
+    }
+    return 0;
+}
+
+/// @brief Gives the pages of the zero pool back to the buddy system.
+/// @param zone The zone owning the pool.
+static void __zero_pool_drain(zone_t *zone)
+{
+    while (zone->zero_pool.count) {
+        page_t *page = list_entry(list_head_pop(&zone->zero_pool.pages), page_t, bbpage.location.cache);
+        bb_free_pages_cached(&zone->buddy_system, &page->bbpage);
+        --zone->zero_pool.count;
+    }
+}
+
 page_t *pr_alloc_pages(const char *file, const char *func, int line, gfp_t gfp_mask, uint32_t order)
 {
     // Calculate the block size based on the order.
@@ -896,22 +937,48 @@ page_t *pr_alloc_pages(const char *file, const char *func, int line, gfp_t gfp_m
         return NULL; // Return NULL to indicate failure.
     }
 
-    // Allocate a page from the buddy system of the zone.
-    bb_page_t *bbpage = bb_alloc_pages(&zone->buddy_system, order);
+    page_t *page      = NULL;
+    zero_pool_t *pool = &zone->zero_pool;
 
-    // Ensure the allocation was successful.
-    if (!bbpage) {
-        pr_crit("Failed to allocate page from buddy system.\n");
-        return NULL; // Return NULL to indicate failure.
-    }
+    if ((gfp_mask & __GFP_ZERO) && (order == 0) && pool->count) {
+        // A page cleared in advance is ready.
+        page = list_entry(list_head_pop(&pool->pages), page_t, bbpage.location.cache);
+        --pool->count;
+        ++pool->hits;
+    } else {
+        // Allocate a page from the buddy system of the zone, small blocks (page
+        // tables, copy-on-write copies, pipe buffers) come from its caches.
+        bb_page_t *bbpage = bb_alloc_pages_cached(&zone->buddy_system, order);
+
+        // The pages of the zero pool are free as well, give them back and retry.
+        if (!bbpage && pool->count) {
+            __zero_pool_drain(zone);
+            bbpage = bb_alloc_pages_cached(&zone->buddy_system, order);
+        }
 
-    // Convert the buddy system page structure to the page_t structure.
-    page_t *page = PG_FROM_BBSTRUCT(bbpage, page_t, bbpage);
+        // Ensure the allocation was successful.
+        if (!bbpage) {
+            pr_crit("Failed to allocate page from buddy system.\n");
+            return NULL; // Return NULL to indicate failure.
+        }
 
-    // Ensure the page allocation was successful.
-    if (!page) {
-        pr_emerg("Page allocation failed.\n");
-        return NULL; // Return NULL to indicate failure.
+        // Convert the buddy system page structure to the page_t structure.
+        page = PG_FROM_BBSTRUCT(bbpage, page_t, bbpage);
+
+        // Ensure the page allocation was successful.
+        if (!page) {
+            pr_emerg("Page allocation failed.\n");
+            return NULL; // Return NULL to indicate failure.
+        }
+
+        // The caller wants zeros, but none were ready: clear the pages now.
+        if (gfp_mask & __GFP_ZERO) {
+            ++pool->misses;
+            if (__zero_pages(zone, page, block_size) < 0) {
+                bb_free_pages_cached(&zone->buddy_system, bbpage);
+                return NULL;
+            }
+        }
     }
 
     // Set page counters for each page in the block.
@@ -956,7 +1023,7 @@ int pr_free_pages(const char *file, const char *func, int line, page_t *page)
     }
 
     // Free the pages in the buddy system.
-    bb_free_pages(&zone->buddy_system, &page->bbpage);
+    bb_free_pages_cached(&zone->buddy_system, &page->bbpage);
 
     // Increment the number of free pages in the zone.
     zone->free_pages += block_size;
@@ -1033,6 +1100,56 @@ int free_pages_lowmem(uint32_t vaddr)
     return 0;
 }
 
+page_t *alloc_pages_exact(gfp_t gfp_mask, uint32_t count)
+{
+    if (count == 0) {
+        pr_err("Cannot allocate zero pages.\n");
+        return NULL;
+    }
+
+    // Find the smallest block containing the requested pages.
+    uint32_t order = 0;
+    while ((1UL << order) < count) {
+        ++order;
+    }
+
+    // Get the zone corresponding to the given GFP mask.
+    zone_t *zone = get_zone_from_flags(gfp_mask);
+    if (!zone) {
+        pr_emerg("Failed to get zone from GFP mask.\n");
+        return NULL;
+    }
+
+    page_t *page = alloc_pages(gfp_mask, order);
+    if (!page) {
+        return NULL;
+    }
+
+    // Give back the pages past the requested ones.
+    uint32_t block_size = 1UL << order;
+    if (count < block_size) {
+        for (uint32_t i = count; i < block_size; i++) {
+            set_page_count(&page[i], 0);
+        }
+        bb_trim_pages(&zone->buddy_system, &page->bbpage, count);
+        zone->free_pages += block_size - count;
+    }
+    return page;
+}
+
+int free_pages_exact(page_t *page, uint32_t count)
+{
+    // The pages were split in blocks of decreasing size, free them one by one.
+    for (uint32_t index = 0; index < count;) {
+        uint32_t block_size = 1UL << page[index].bbpage.order;
+        if (free_pages(&page[index]) < 0) {
+            return -1;
+        }
+        index += block_size;
+    }
+    return 0;
+}
+
 unsigned long get_zone_total_space(gfp_t gfp_mask)
 {
     // Get the zone corresponding to the given GFP mask.
@@ -1059,8 +1176,8 @@ unsigned long get_zone_free_space(gfp_t gfp_mask)
         return 0; // Return 0 to indicate failure.
     }
 
-    // Return the free space of the zone.
-    return buddy_system_get_free_space(&zone->buddy_system);
+    // Return the free space of the zone, the zeroed pages are free as well.
+    return buddy_system_get_free_space(&zone->buddy_system) + (zone->zero_pool.count * PAGE_SIZE);
 }
 
 unsigned long get_zone_cached_space(gfp_t gfp_mask)
@@ -1074,8 +1191,55 @@ unsigned long get_zone_cached_space(gfp_t gfp_mask)
         return 0; // Return 0 to indicate failure.
     }
 
-    // Return the cached space of the zone.
-    return buddy_system_get_cached_space(&zone->buddy_system);
+    // Return the cached space of the zone, including the zeroed pages.
+    return buddy_system_get_cached_space(&zone->buddy_system) + (zone->zero_pool.count * PAGE_SIZE);
+}
+
+const zero_pool_t *get_zone_zero_pool(gfp_t gfp_mask)
+{
+    // Get the zone corresponding to the given GFP mask.
+    zone_t *zone = get_zone_from_flags(gfp_mask);
+
+    // Ensure the zone retrieval was successful.
+    if (!zone) {
+        pr_emerg("Cannot retrieve the correct zone for GFP mask: 0x%x.\n", gfp_mask);
+        return NULL; // Return NULL to indicate failure.
+    }
+
+    return &zone->zero_pool;
+}
+
+unsigned zone_zero_pool_refill(unsigned budget)
+{
+    unsigned added = 0;
+    if (!memory.page_data) {
+        return 0;
+    }
+    for (int index = 0; index < __MAX_NR_ZONES; index++) {
+        zone_t *zone      = &memory.page_data->node_zones[index];
+        zero_pool_t *pool = &zone->zero_pool;
+        // Only the zones that have been asked for zeroed pages keep a pool.
+        if (!pool->hits && !pool->misses) {
+            continue;
+        }
+        // Stop well before the zone runs out of memory.
+        while ((added < budget) && (pool->count < ZERO_POOL_SIZE) &&
+               ((zone->free_pages - pool->count) > ZERO_POOL_SIZE)) {
+            bb_page_t *bbpage = bb_alloc_pages_cached(&zone->buddy_system, 0);
+            if (!bbpage) {
+                break;
+            }
+            page_t *page = PG_FROM_BBSTRUCT(bbpage, page_t, bbpage);
+            if (__zero_pages(zone, page, 1) < 0) {
+                bb_free_pages_cached(&zone->buddy_system, bbpage);
+                break;
+            }
+            list_head_insert_before(&page->bbpage.location.cache, &pool->pages);
+            ++pool->count;
+            ++added;
+        }
+    }
+    return added;
 }
 
 int get_zone_buddy_system_status(gfp_t gfp_mask, char *buffer, size_t bufsize)
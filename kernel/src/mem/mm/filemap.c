@@ -0,0 +1,118 @@
+/// @file filemap.c
+/// @brief File-backed memory mappings.
+/// @copyright (c) 2014-2025 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[FILEMP]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "fs/vfs.h"
+#include "math.h"
+#include "mem/alloc/zone_allocator.h"
+#include "mem/mm/filemap.h"
+#include "mem/mm/mm.h"
+#include "mem/mm/page.h"
+#include "mem/mm/vmem.h"
+#include "mem/paging.h"
+#include "string.h"
+#include "sys/mman.h"
+
+/// @brief Reads a page of the file into a new frame, for files which are not
+/// kept in the page cache.
+/// @param file the mapped file.
+/// @param index the index of the page inside the file.
+/// @return the frame, or NULL on failure.
+static page_t *__filemap_read_page(vfs_file_t *file, uint32_t index)
+{
+    // What lies beyond the end of the file reads as zeros.
+    page_t *page = alloc_pages(GFP_HIGHUSER | __GFP_ZERO, 0);
+    if (!page) {
+        pr_err("Failed to allocate a page for `%s`.\n", file->name);
+        return NULL;
+    }
+    void *data  = vmem_kmap(page, KMAP_DST);
+    ssize_t ret = vfs_read(file, data, index * PAGE_SIZE, PAGE_SIZE);
+    vmem_kunmap(data, KMAP_DST);
+    if (ret < 0) {
+        pr_err("Failed to read page %u of `%s`.\n", index, file->name);
+        free_pages(page);
+        return NULL;
+    }
+    return page;
+}
+
+int filemap_fault(vm_area_struct_t *area, uint32_t addr)
+{
+    uint32_t vaddr = addr & ~(PAGE_SIZE - 1);
+    uint32_t index = area->vm_pgoff + ((vaddr - area->vm_start) / PAGE_SIZE);
+
+    // Map the frame of the page cache, if the filesystem keeps one, otherwise
+    // read the page into a frame of our own.
+    page_t *page = vfs_getpage(area->vm_file, index);
+    if (!page) {
+        page = __filemap_read_page(area->vm_file, index);
+        if (!page) {
+            return -1;
+        }
+    }
+
+    // Shared mappings write into the frame, private ones copy it first.
+    uint32_t flags = MM_PRESENT | MM_USER | MM_UPDADDR;
+    if (area->vm_page_prot & PROT_WRITE) {
+        flags |= (area->vm_flags & MAP_SHARED) ? MM_RW : MM_COW;
+    }
+    if (mem_upd_vm_area(area->vm_mm->pgd, vaddr, get_physical_address_from_page(page), PAGE_SIZE, flags) < 0) {
+        pr_err("Failed to map page %u of `%s`.\n", index, area->vm_file->name);
+        if (page_count(page) > 1) {
+            page_dec(page);
+        } else {
+            free_pages(page);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+int filemap_sync(vm_area_struct_t *area, uint32_t start, uint32_t end)
+{
+    // Only shared mappings carry their changes to the file.
+    if (!area->vm_file || !(area->vm_flags & MAP_SHARED)) {
+        return 0;
+    }
+    stat_t stat;
+    if (vfs_fstat(area->vm_file, &stat) < 0) {
+        pr_err("Failed to stat `%s`.\n", area->vm_file->name);
+        return -1;
+    }
+    int ret = 0;
+    start   = max(start, area->vm_start) & ~(PAGE_SIZE - 1);
+    end     = min(end, area->vm_end);
+    for (uint32_t addr = start; addr < end; addr += PAGE_SIZE) {
+        // Only pages written since the last synchronization are dirty.
+        page_table_entry_t *entry = mem_virtual_to_pte(area->vm_mm->pgd, addr);
+        if (!entry || !entry->present || !entry->dirty) {
+            continue;
+        }
+        entry->dirty = 0;
+        paging_flush_tlb_single(addr);
+        // The file is never extended through a mapping.
+        uint32_t offset = (area->vm_pgoff * PAGE_SIZE) + (addr - area->vm_start);
+        if (offset >= stat.st_size) {
+            continue;
+        }
+        page_t *page = get_page_from_physical_address(entry->frame << 12U);
+        void *data   = page ? vmem_kmap(page, KMAP_SRC) : NULL;
+        if (!data || (vfs_write(area->vm_file, data, offset, min(PAGE_SIZE, stat.st_size - offset)) < 0)) {
+            pr_err("Failed to write back page at %p of `%s`.\n", (void *)addr, area->vm_file->name);
+            entry->dirty = 1;
+            ret          = -1;
+        }
+        if (data) {
+            vmem_kunmap(data, KMAP_SRC);
+        }
+    }
+    return ret;
+}
@@ -75,14 +75,22 @@ mm_struct_t *mm_create_blank(size_t stack_size)
     // Assign the copied page directory to the mm_struct.
     mm->pgd = pdir_cpy;
 
-    // Initialize the virtual memory areas list for the new process.
+    // Initialize the virtual memory areas list and index for the new process.
     list_head_init(&mm->mmap_list);
+    if (vm_area_index_init(mm) < 0) {
+        kmem_cache_free(pdir_cpy);
+        kmem_cache_free(mm);
+        return NULL;
+    }
 
-    // Allocate the stack segment.
+    // Allocate the stack segment, its pages are zero-filled on first access,
+    // so that only the part of the stack actually used is backed by frames.
     vm_area_struct_t *segment = vm_area_create(
-        mm, PROCAREA_END_ADDR - stack_size, stack_size, MM_PRESENT | MM_RW | MM_USER, GFP_HIGHUSER);
+        mm, PROCAREA_END_ADDR - stack_size, stack_size, MM_PRESENT | MM_RW | MM_USER | MM_COW, GFP_HIGHUSER);
     if (!segment) {
         pr_crit("Failed to create stack segment for new process\n");
+        // Free the index of the areas.
+        vm_area_index_destroy(mm);
         // Free page directory if allocation fails.
         kmem_cache_free(pdir_cpy);
         // Free mm_struct as well.
@@ -139,21 +147,27 @@ mm_struct_t *mm_clone(mm_struct_t *mmp)
 
     vm_area_struct_t *vm_area = NULL;
 
-    // Reset the memory area list to prepare for cloning.
+    // Reset the memory area list and index to prepare for cloning.
     list_head_init(&mm->mmap_list);
-    mm->map_count = 0;
-    mm->total_vm  = 0;
+    mm->mmap_cache = NULL;
+    mm->map_count  = 0;
+    mm->total_vm   = 0;
+    if (vm_area_index_init(mm) < 0) {
+        kmem_cache_free(pdir_cpy);
+        kmem_cache_free(mm);
+        return NULL;
+    }
 
-    // Clone each memory area from the source process to the new process.
+    // Clone each memory area from the source process to the new process, the
+    // frames are shared as copy-on-write and copied only when written.
     list_for_each_decl (it, &mmp->mmap_list) {
         vm_area = list_entry(it, vm_area_struct_t, vm_list);
 
-        if (vm_area_clone(mm, vm_area, 0, GFP_HIGHUSER) < 0) {
+        if (vm_area_clone(mm, vm_area, 1, GFP_HIGHUSER) < 0) {
             pr_crit("Failed to clone vm_area from source process.\n");
-            // Free the previously allocated mm_struct.
-            kmem_cache_free(mm);
-            // Free the previously allocated page_directory.
-            kmem_cache_free(pdir_cpy);
+            // Release the areas cloned so far, together with the page
+            // directory and the mm_struct.
+            mm_destroy(mm);
             return NULL;
         }
     }
@@ -162,6 +176,25 @@ mm_struct_t *mm_clone(mm_struct_t *mmp)
     return mm;
 }
 
+unsigned int mm_get_rss(mm_struct_t *mm)
+{
+    unsigned int rss = 0;
+    if (!mm) {
+        return 0;
+    }
+    list_for_each_decl (it, &mm->mmap_list) {
+        vm_area_struct_t *segment = list_entry(it, vm_area_struct_t, vm_list);
+        for (uint32_t addr = segment->vm_start; addr < segment->vm_end; addr += PAGE_SIZE) {
+            // Pages still waiting for their first access have no frame.
+            page_table_entry_t *entry = mem_virtual_to_pte(mm->pgd, addr);
+            if (entry && entry->present) {
+                ++rss;
+            }
+        }
+    }
+    return rss;
+}
+
 int mm_destroy(mm_struct_t *mm)
 {
     // Check if the input mm_struct pointer is valid.
@@ -256,6 +289,9 @@ int mm_destroy(mm_struct_t *mm)
         }
     }
 
+    // Free the index of the areas, which is empty now.
+    vm_area_index_destroy(mm);
+
     // Free the page directory structure.
     kmem_cache_free((void *)mm->pgd);
 
@@ -11,12 +11,16 @@
 
 #include "mem/mm/vm_area.h"
 
-#include "list_head_algorithm.h"
+#include "fs/vfs.h"
+#include "klib/rbtree.h"
+#include "math.h"
 #include "mem/alloc/slab.h"
+#include "mem/mm/filemap.h"
 #include "mem/mm/mm.h"
 #include "mem/mm/vmem.h"
 #include "mem/paging.h"
 #include "string.h"
+#include "sys/mman.h"
 
 /// Cache for storing vm_area_struct.
 static kmem_cache_t *vm_area_cache;
@@ -31,6 +35,181 @@ int vm_area_init(void)
     return 0;
 }
 
+/// @brief Orders the areas inside the index by their starting address.
+/// @param tree the index.
+/// @param a the node of the first area.
+/// @param b the node of the second area.
+/// @return the sign of the difference between the two starting addresses.
+static int __vm_area_rb_cmp(rbtree_t *tree, rbtree_node_t *a, rbtree_node_t *b)
+{
+    (void)tree;
+    vm_area_struct_t *area0 = rbtree_node_get_value(a);
+    vm_area_struct_t *area1 = rbtree_node_get_value(b);
+    return (area0->vm_start > area1->vm_start) - (area0->vm_start < area1->vm_start);
+}
+
+/// @brief Computes the free space between the area and the one before it.
+/// @param area the area.
+/// @return the size of the gap, 0 for the first area.
+static inline uint32_t __vm_area_gap(vm_area_struct_t *area)
+{
+    if (area->vm_list.prev == &area->vm_mm->mmap_list) {
+        return 0;
+    }
+    vm_area_struct_t *prev = list_entry(area->vm_list.prev, vm_area_struct_t, vm_list);
+    return area->vm_start - prev->vm_end;
+}
+
+/// @brief Returns the largest gap inside the subtree rooted at the node.
+/// @param node the node, possibly NULL.
+/// @return the largest gap, 0 for an empty subtree.
+static inline uint32_t __vm_area_subtree_gap(rbtree_node_t *node)
+{
+    if (!node) {
+        return 0;
+    }
+    return ((vm_area_struct_t *)rbtree_node_get_value(node))->vm_rb_subtree_gap;
+}
+
+/// @brief Recomputes the largest gap of the subtree rooted at the node.
+/// @param tree the index.
+/// @param node the node.
+static void __vm_area_rb_augment(rbtree_t *tree, rbtree_node_t *node)
+{
+    (void)tree;
+    vm_area_struct_t *area  = rbtree_node_get_value(node);
+    uint32_t gap            = __vm_area_gap(area);
+    gap                     = max(gap, __vm_area_subtree_gap(rbtree_node_get_child(node, 0)));
+    gap                     = max(gap, __vm_area_subtree_gap(rbtree_node_get_child(node, 1)));
+    area->vm_rb_subtree_gap = gap;
+}
+
+/// @brief Returns the area following the given one, if any.
+/// @param mm the memory descriptor.
+/// @param area the area.
+/// @return the next area, NULL if this is the last one.
+static inline vm_area_struct_t *__vm_area_next(mm_struct_t *mm, vm_area_struct_t *area)
+{
+    if (area->vm_list.next == &mm->mmap_list) {
+        return NULL;
+    }
+    return list_entry(area->vm_list.next, vm_area_struct_t, vm_list);
+}
+
+/// @brief Adds the area to the sorted list and to the index of the memory
+/// descriptor.
+/// @param mm the memory descriptor.
+/// @param area the area, which must not overlap with the others.
+/// @return 0 on success, -1 on failure.
+static int __vm_area_link(mm_struct_t *mm, vm_area_struct_t *area)
+{
+    rbtree_node_t *node = rbtree_node_create(area);
+    if (!node) {
+        pr_crit("Failed to allocate the index node for the area.\n");
+        return -1;
+    }
+    // The area goes right before the first one above it.
+    vm_area_struct_t *next = vm_area_lookup_next(mm, area->vm_start);
+    list_head_insert_before(&area->vm_list, next ? &next->vm_list : &mm->mmap_list);
+    rbtree_tree_insert_node(mm->mm_rb, node);
+    // The gap before the next area has shrunk.
+    if (next) {
+        rbtree_tree_update(mm->mm_rb, next);
+    }
+    mm->mmap_cache = area;
+    return 0;
+}
+
+/// @brief Removes the area from the sorted list and from the index of the
+/// memory descriptor.
+/// @param mm the memory descriptor.
+/// @param area the area.
+static void __vm_area_unlink(mm_struct_t *mm, vm_area_struct_t *area)
+{
+    vm_area_struct_t *next = __vm_area_next(mm, area);
+    list_head_remove(&area->vm_list);
+    rbtree_tree_remove(mm->mm_rb, area);
+    // The gap before the next area has grown.
+    if (next) {
+        rbtree_tree_update(mm->mm_rb, next);
+    }
+    // Forget the area if it was the most recently used one.
+    if (mm->mmap_cache == area) {
+        mm->mmap_cache = NULL;
+    }
+}
+
+int vm_area_index_init(mm_struct_t *mm)
+{
+    mm->mm_rb = rbtree_tree_create(__vm_area_rb_cmp);
+    if (!mm->mm_rb) {
+        pr_crit("Failed to allocate the index of the areas.\n");
+        return -1;
+    }
+    rbtree_tree_set_augment(mm->mm_rb, __vm_area_rb_augment);
+    return 0;
+}
+
+void vm_area_index_destroy(mm_struct_t *mm)
+{
+    if (mm->mm_rb) {
+        rbtree_tree_dealloc(mm->mm_rb, NULL);
+        mm->mm_rb = NULL;
+    }
+}
+
+/// @brief Drops the reference of the address space on each frame of the range,
+/// freeing the frames nobody else is using, and unmaps the range.
+/// @param mm the memory descriptor.
+/// @param vm_start the start of the range.
+/// @param size the size of the range.
+static void __vm_area_release(mm_struct_t *mm, uint32_t vm_start, size_t size)
+{
+    for (uint32_t addr = vm_start & ~(PAGE_SIZE - 1); addr < vm_start + size; addr += PAGE_SIZE) {
+        // Non-present pages (e.g., COW without backing) own no frame.
+        page_t *page = mem_virtual_to_page(mm->pgd, addr, NULL);
+        if (!page) {
+            continue;
+        }
+        if (page_count(page) > 1) {
+            // The frame is still shared through copy-on-write.
+            page_dec(page);
+        } else {
+            free_pages(page);
+        }
+    }
+    // Leave no stale mapping to the released frames.
+    mem_upd_vm_area(mm->pgd, vm_start, 0, size, 0);
+}
+
+/// @brief Backs the range with newly allocated frames, one page at a time, so
+/// that each of them can be later shared and copied on its own.
+/// @param mm the memory descriptor.
+/// @param vm_start the start of the range.
+/// @param size the size of the range.
+/// @param pgflags the flags of the page table entries.
+/// @param gfpflags the GFP flags used to allocate the frames.
+/// @return 0 on success, -1 on failure.
+static int __vm_area_populate(mm_struct_t *mm, uint32_t vm_start, size_t size, uint32_t pgflags, uint32_t gfpflags)
+{
+    uint32_t start = vm_start & ~(PAGE_SIZE - 1);
+    for (uint32_t addr = start; addr < vm_start + size; addr += PAGE_SIZE) {
+        page_t *page = alloc_pages(gfpflags, 0);
+        if (!page) {
+            pr_crit("Failed to allocate a physical page for address %p.\n", (void *)addr);
+            __vm_area_release(mm, start, addr - start);
+            return -1;
+        }
+        if (mem_upd_vm_area(mm->pgd, addr, get_physical_address_from_page(page), PAGE_SIZE, pgflags) < 0) {
+            pr_crit("Failed to map the physical page for address %p.\n", (void *)addr);
+            free_pages(page);
+            __vm_area_release(mm, start, addr - start);
+            return -1;
+        }
+    }
+    return 0;
+}
+
 vm_area_struct_t *
 vm_area_create(struct mm_struct *mm, uint32_t vm_start, size_t size, uint32_t pgflags, uint32_t gfpflags)
 {
@@ -49,8 +228,6 @@ vm_area_create(struct mm_struct *mm, uint32_t vm_start, size_t size, uint32_t pg
     }
 
     uint32_t vm_end;
-    uint32_t phy_start;
-    uint32_t order;
     vm_area_struct_t *segment;
 
     // Compute the end of the virtual memory area.
@@ -69,56 +246,44 @@ vm_area_create(struct mm_struct *mm, uint32_t vm_start, size_t size, uint32_t pg
         return NULL;
     }
 
-    // Find the nearest order for the given memory size.
-    order = find_nearest_order_greater(vm_start, size);
-
-    if (pgflags & MM_COW) {
-        // If the area is copy-on-write, clear the present and update address
-        // flags.
-        pgflags   = pgflags & ~(MM_PRESENT | MM_UPDADDR);
-        phy_start = 0;
-    } else {
-        // Otherwise, set the update address flag and allocate physical pages.
-        pgflags = pgflags | MM_UPDADDR;
-
-        page_t *page = alloc_pages(gfpflags, order);
-        if (!page) {
-            pr_crit("Failed to allocate physical pages for vm_area at [%p, %p].\n", vm_start, vm_end);
+    if ((pgflags & MM_COW) || !(pgflags & MM_PRESENT)) {
+        // If the area is copy-on-write (i.e., demand-zero), or not present,
+        // clear the present and update address flags, the pages are provided
+        // one at a time by the page fault handler on first access.
+        pgflags = pgflags & ~(MM_PRESENT | MM_UPDADDR);
+        if (mem_upd_vm_area(mm->pgd, vm_start, 0, size, pgflags) != 0) {
+            pr_crit("Failed to update vm_area in page directory\n");
             kmem_cache_free(segment);
             return NULL;
         }
-
-        // Retrieve the physical address from the allocated page.
-        phy_start = get_physical_address_from_page(page);
-        if (!phy_start) {
-            pr_crit("Failed to retrieve physical address for allocated page.\n");
+    } else {
+        // Otherwise, allocate the physical pages and map them.
+        if (__vm_area_populate(mm, vm_start, size, pgflags | MM_UPDADDR, gfpflags) < 0) {
+            pr_crit("Failed to allocate physical pages for vm_area at [%p, %p].\n", vm_start, vm_end);
             kmem_cache_free(segment);
             return NULL;
         }
     }
 
-    // Update the virtual memory area in the page directory.
-    if (mem_upd_vm_area(mm->pgd, vm_start, phy_start, size, pgflags) != 0) {
-        pr_crit("Failed to update vm_area in page directory\n");
+    // Update vm_area_struct info.
+    segment->vm_start     = vm_start;
+    segment->vm_end       = vm_end;
+    segment->vm_mm        = mm;
+    segment->vm_page_prot = 0;
+    segment->vm_flags     = 0;
+    segment->vm_file      = NULL;
+    segment->vm_pgoff     = 0;
+
+    // Insert the new segment into the memory descriptor's list and index.
+    if (__vm_area_link(mm, segment) < 0) {
+        __vm_area_release(mm, vm_start, size);
         kmem_cache_free(segment);
         return NULL;
     }
 
-    // Update vm_area_struct info.
-    segment->vm_start = vm_start;
-    segment->vm_end   = vm_end;
-    segment->vm_mm    = mm;
-
-    // Insert the new segment into the memory descriptor's list of vm_area_structs.
-    list_head_insert_after(&segment->vm_list, &mm->mmap_list);
-    mm->mmap_cache = segment;
-
-    // Sort the mmap_list to maintain order.
-    list_head_sort(&mm->mmap_list, vm_area_compare);
-
     // Update memory descriptor info.
     mm->map_count++;
-    mm->total_vm += (1U << order);
+    mm->total_vm += (vm_end - vm_start + PAGE_SIZE - 1) / PAGE_SIZE;
 
     // Return the created vm_area_struct.
     return segment;
@@ -149,128 +314,119 @@ uint32_t vm_area_clone(mm_struct_t *mm, vm_area_struct_t *area, int cow, uint32_
     // Update the memory descriptor for the new segment.
     new_segment->vm_mm = mm;
 
-    // Calculate the size and the nearest order for the new segment's memory allocation.
-    uint32_t size  = new_segment->vm_end - new_segment->vm_start;
-    uint32_t order = find_nearest_order_greater(area->vm_start, size);
+    // Calculate the size of the new segment.
+    uint32_t size = new_segment->vm_end - new_segment->vm_start;
 
     if (!cow) {
-        // If not copy-on-write, allocate directly the physical pages
-        page_t *dst_page = alloc_pages(gfpflags, order);
-        if (!dst_page) {
+        // If not copy-on-write, allocate directly the physical pages.
+        if (__vm_area_populate(mm, new_segment->vm_start, size, MM_RW | MM_PRESENT | MM_UPDADDR | MM_USER, gfpflags) <
+            0) {
             pr_crit("Failed to allocate physical pages for the new vm_area\n");
             // Free the newly allocated segment on failure.
             kmem_cache_free(new_segment);
             return -1;
         }
 
-        uint32_t phy_vm_start = get_physical_address_from_page(dst_page);
-
-        // Update the virtual memory map in the page directory.
-        if (mem_upd_vm_area(
-                mm->pgd, new_segment->vm_start, phy_vm_start, size, MM_RW | MM_PRESENT | MM_UPDADDR | MM_USER) < 0) {
-            pr_crit("Failed to update virtual memory area in page directory\n");
-            // Free the allocated pages on failure.
-            free_pages(dst_page);
-            // Free the newly allocated segment.
-            kmem_cache_free(new_segment);
-            return -1;
-        }
-
         // Copy virtual memory from source area into destination area using a virtual mapping.
         vmem_memcpy(mm, area->vm_start, area->vm_mm, area->vm_start, size);
     } else {
-        // If copy-on-write, set the original pages as read-only.
-        if (mem_upd_vm_area(area->vm_mm->pgd, area->vm_start, 0, size, MM_COW | MM_PRESENT | MM_USER) < 0) {
-            pr_crit("Failed to mark original pages as copy-on-write\n");
+        // If copy-on-write, share the frames between the two address spaces,
+        // they are copied only when (and if) someone writes to them. Shared
+        // file mappings keep writing to the same frames instead.
+        int shared = area->vm_file && (area->vm_flags & MAP_SHARED);
+        if (mem_share_vm_area(area->vm_mm->pgd, mm->pgd, area->vm_start, size, !shared) < 0) {
+            pr_crit("Failed to share virtual memory area as copy-on-write\n");
+            // Drop the references taken so far.
+            __vm_area_release(mm, new_segment->vm_start, size);
             // Free the newly allocated segment.
             kmem_cache_free(new_segment);
             return -1;
         }
+    }
 
-        // Perform a COW of the whole virtual memory area, handling fragmented physical memory.
-        if (mem_clone_vm_area(
-                area->vm_mm->pgd, mm->pgd, area->vm_start, new_segment->vm_start, size,
-                MM_COW | MM_PRESENT | MM_UPDADDR | MM_USER) < 0) {
-            pr_crit("Failed to clone virtual memory area\n");
-            // Free the newly allocated segment.
-            kmem_cache_free(new_segment);
-            return -1;
-        }
+    // Insert the new segment into the memory descriptor's list and index.
+    if (__vm_area_link(mm, new_segment) < 0) {
+        __vm_area_release(mm, new_segment->vm_start, size);
+        kmem_cache_free(new_segment);
+        return -1;
     }
 
-    // Update memory descriptor list of vm_area_struct.
-    list_head_insert_after(&new_segment->vm_list, &mm->mmap_list);
-    mm->mmap_cache = new_segment;
+    // The new area keeps the mapped file open as well.
+    if (new_segment->vm_file) {
+        ++new_segment->vm_file->count;
+    }
 
     // Update memory descriptor info.
     mm->map_count++;
-    mm->total_vm += (1U << order);
+    mm->total_vm += (size + PAGE_SIZE - 1) / PAGE_SIZE;
 
     return 0;
 }
 
 int vm_area_destroy(mm_struct_t *mm, vm_area_struct_t *area)
 {
-    size_t area_total_size;
-    size_t area_size;
-    size_t area_start;
-    uint32_t order;
-    uint32_t block_size;
-    page_t *phy_page;
-
-    // Get the total size of the virtual memory area.
-    area_total_size = area->vm_end - area->vm_start;
-
-    // Get the starting address of the area.
-    area_start = area->vm_start;
+    // Write back the changes to a shared file mapping.
+    if (area->vm_file && (filemap_sync(area, area->vm_start, area->vm_end) < 0)) {
+        pr_err("Failed to write back the mapping of `%s`.\n", area->vm_file->name);
+    }
 
     // Free all the memory associated with the virtual memory area.
-    while (area_total_size > 0) {
-        area_size = area_total_size;
-
-        // Translate the virtual address to the physical page.
-        phy_page = mem_virtual_to_page(mm->pgd, area_start, &area_size);
-
-        // If the page is not present (e.g., COW without backing), skip freeing and advance.
-        if (!phy_page) {
-            pr_info("Skipping non-present page for virtual address %p\n", (void *)area_start);
-            area_size = PAGE_SIZE;
-            if (area_size > area_total_size) {
-                area_size = area_total_size;
-            }
-            area_total_size -= area_size;
-            area_start += area_size;
-            continue;
-        }
+    __vm_area_release(mm, area->vm_start, area->vm_end - area->vm_start);
 
-        // If the pages are marked as copy-on-write, do not deallocate them.
-        if (page_count(phy_page) > 1) {
-            order      = phy_page->bbpage.order;
-            block_size = 1UL << order;
-
-            // Decrement the reference count for each page in the block.
-            for (int i = 0; i < block_size; i++) {
-                page_dec(phy_page + i);
-            }
-        } else {
-            // If not copy-on-write, free the allocated pages.
-            free_pages(phy_page);
-        }
-
-        // Update the remaining size and starting address for the next iteration.
-        area_total_size -= area_size;
-        area_start += area_size;
+    // Release the mapped file.
+    if (area->vm_file) {
+        vfs_close(area->vm_file);
     }
 
-    // Remove the segment from the memory map list.
-    list_head_remove(&area->vm_list);
+    // Remove the segment from the memory map list and index.
+    __vm_area_unlink(mm, area);
+
+    // Decrement the counter for the number of memory-mapped areas, and the
+    // number of mapped pages.
+    --mm->map_count;
+    mm->total_vm -= min(mm->total_vm, (area->vm_end - area->vm_start + PAGE_SIZE - 1) / PAGE_SIZE);
 
     // Free the memory allocated for the vm_area_struct.
     kmem_cache_free(area);
 
-    // Decrement the counter for the number of memory-mapped areas.
-    --mm->map_count;
+    return 0;
+}
+
+int vm_area_resize(mm_struct_t *mm, vm_area_struct_t *area, uint32_t vm_end)
+{
+    // Validate inputs.
+    if (!mm || !area) {
+        pr_crit("Invalid arguments: mm or area is NULL.\n");
+        return -1;
+    }
+    if ((vm_end <= area->vm_start) || (vm_end % PAGE_SIZE)) {
+        pr_crit("Invalid arguments: cannot end the area [%p, %p] at %p.\n", (void *)area->vm_start,
+                (void *)area->vm_end, (void *)vm_end);
+        return -1;
+    }
 
+    if (vm_end > area->vm_end) {
+        // Check that the area can grow without overlapping its neighbours.
+        if (vm_area_is_valid(mm, area->vm_end, vm_end) <= 0) {
+            return -1;
+        }
+        // Like for anonymous areas, the new pages are provided on first access.
+        if (mem_upd_vm_area(mm->pgd, area->vm_end, 0, vm_end - area->vm_end, MM_USER | MM_RW | MM_COW) < 0) {
+            pr_crit("Failed to update vm_area in page directory\n");
+            return -1;
+        }
+        mm->total_vm += (vm_end - area->vm_end) / PAGE_SIZE;
+    } else if (vm_end < area->vm_end) {
+        // Give back the frames of the pages beyond the new end.
+        __vm_area_release(mm, vm_end, area->vm_end - vm_end);
+        mm->total_vm -= min(mm->total_vm, (area->vm_end - vm_end) / PAGE_SIZE);
+    }
+    area->vm_end = vm_end;
+    // The gap before the next area has changed.
+    vm_area_struct_t *next = __vm_area_next(mm, area);
+    if (next) {
+        rbtree_tree_update(mm->mm_rb, next);
+    }
     return 0;
 }
 
@@ -286,40 +442,13 @@ int vm_area_is_valid(mm_struct_t *mm, uintptr_t vm_start, uintptr_t vm_end)
         return -1;
     }
 
-    // Iterate through the list of memory areas to check for overlaps.
-    vm_area_struct_t *area;
-    list_for_each_prev_decl(it, &mm->mmap_list)
-    {
-        // Get the current area from the list entry.
-        area = list_entry(it, vm_area_struct_t, vm_list);
-
-        // Check if the area is NULL.
-        if (!area) {
-            pr_crit("Encountered a NULL area in the list.");
-            return -1;
-        }
-
-        // Check if the new area overlaps with the current area.
-        if ((vm_start > area->vm_start) && (vm_start < area->vm_end)) {
-            pr_crit(
-                "Overlap detected at start: %p <= %p <= %p", (void *)area->vm_start, (void *)vm_start,
-                (void *)area->vm_end);
-            return 0;
-        }
-
-        if ((vm_end > area->vm_start) && (vm_end < area->vm_end)) {
-            pr_crit(
-                "Overlap detected at end: %p <= %p <= %p", (void *)area->vm_start, (void *)vm_end,
-                (void *)area->vm_end);
-            return 0;
-        }
-
-        if ((vm_start < area->vm_start) && (vm_end > area->vm_end)) {
-            pr_crit(
-                "Wrap-around detected: %p <= (%p, %p) <= %p", (void *)vm_start, (void *)area->vm_start,
-                (void *)area->vm_end, (void *)vm_end);
-            return 0;
-        }
+    // Only the first area ending after the start can overlap with the range.
+    vm_area_struct_t *area = vm_area_lookup_next(mm, vm_start);
+    if (area && (area->vm_start < vm_end)) {
+        pr_debug(
+            "The range [%p, %p) overlaps with [%p, %p).\n", (void *)vm_start, (void *)vm_end, (void *)area->vm_start,
+            (void *)area->vm_end);
+        return 0;
     }
 
     // If no overlaps were found, return 1 to indicate the area is valid.
@@ -328,26 +457,54 @@ int vm_area_is_valid(mm_struct_t *mm, uintptr_t vm_start, uintptr_t vm_end)
 
 vm_area_struct_t *vm_area_find(mm_struct_t *mm, uint32_t vm_start)
 {
-    vm_area_struct_t *segment;
+    vm_area_struct_t *segment = vm_area_lookup(mm, vm_start);
 
-    // Iterate through the memory map list in reverse order to find the area.
-    list_for_each_prev_decl(it, &mm->mmap_list)
-    {
-        // Get the current segment from the list entry.
-        segment = list_entry(it, vm_area_struct_t, vm_list);
+    // The area must start exactly at the given address.
+    if (segment && (segment->vm_start == vm_start)) {
+        return segment;
+    }
+    return NULL;
+}
 
-        // Assert that the segment is not NULL.
-        assert(segment && "There is a NULL area in the list.");
+vm_area_struct_t *vm_area_lookup(mm_struct_t *mm, uint32_t addr)
+{
+    vm_area_struct_t *segment = vm_area_lookup_next(mm, addr);
+    if (segment && (segment->vm_start <= addr)) {
+        mm->mmap_cache = segment;
+        return segment;
+    }
+    return NULL;
+}
 
-        // Check if the starting address matches the requested vm_start.
-        if (segment->vm_start == vm_start) {
-            // Return the found segment.
-            return segment;
-        }
+vm_area_struct_t *vm_area_lookup_next(mm_struct_t *mm, uint32_t addr)
+{
+    if (!mm) {
+        pr_crit("Invalid arguments: mm is NULL.\n");
+        return NULL;
     }
 
-    // If the area is not found, return NULL.
-    return NULL;
+    // Check the most recently used area first.
+    if (mm->mmap_cache && (mm->mmap_cache->vm_start <= addr) && (addr < mm->mmap_cache->vm_end)) {
+        return mm->mmap_cache;
+    }
+
+    // Otherwise, descend the index looking for the lowest area ending after
+    // the address.
+    vm_area_struct_t *result = NULL;
+    rbtree_node_t *node      = rbtree_tree_get_root(mm->mm_rb);
+    while (node) {
+        vm_area_struct_t *segment = rbtree_node_get_value(node);
+        if (segment->vm_end > addr) {
+            result = segment;
+            if (segment->vm_start <= addr) {
+                break;
+            }
+            node = rbtree_node_get_child(node, 0);
+        } else {
+            node = rbtree_node_get_child(node, 1);
+        }
+    }
+    return result;
 }
 
 int vm_area_search_free_area(mm_struct_t *mm, size_t length, uintptr_t *vm_start)
@@ -358,45 +515,29 @@ int vm_area_search_free_area(mm_struct_t *mm, size_t length, uintptr_t *vm_start
         return -1;
     }
 
-    vm_area_struct_t *area;
-    vm_area_struct_t *prev_area;
-
-    // Iterate through the list of memory areas in reverse order.
-    list_for_each_prev_decl(it, &mm->mmap_list)
-    {
-        // Get the current area from the list entry.
-        area = list_entry(it, vm_area_struct_t, vm_list);
-
-        // Check if the current area is NULL.
-        if (!area) {
-            pr_crit("Encountered a NULL area in the list.");
-            return -1;
+    // Each node knows the largest gap of its subtree, so we can go straight
+    // to the highest gap which is large enough, preferring higher addresses.
+    rbtree_node_t *node = rbtree_tree_get_root(mm->mm_rb);
+    if (__vm_area_subtree_gap(node) < length) {
+        // If no suitable area was found, return 1 to indicate failure.
+        return 1;
+    }
+    while (node) {
+        rbtree_node_t *right = rbtree_node_get_child(node, 1);
+        if (__vm_area_subtree_gap(right) >= length) {
+            node = right;
+            continue;
         }
-
-        // Check the previous segment if it exists.
-        if (area->vm_list.prev != &mm->mmap_list) {
-            prev_area = list_entry(area->vm_list.prev, vm_area_struct_t, vm_list);
-
-            // Check if the previous area is NULL.
-            if (!prev_area) {
-                pr_crit("Encountered a NULL previous area in the list.");
-                return -1;
-            }
-
-            // Compute the available space between the current area and the previous area.
-            unsigned available_space = area->vm_start - prev_area->vm_end;
-
-            // If the available space is sufficient for the requested length,
-            // return the starting address.
-            if (available_space >= length) {
-                *vm_start = area->vm_start - length;
-                return 0;
-            }
+        vm_area_struct_t *area = rbtree_node_get_value(node);
+        if (__vm_area_gap(area) >= length) {
+            *vm_start = area->vm_start - length;
+            return 0;
         }
+        node = rbtree_node_get_child(node, 0);
     }
 
-    // If no suitable area was found, return 1 to indicate failure.
-    return 1;
+    pr_crit("The index of the areas is inconsistent.\n");
+    return -1;
 }
 
 int vm_area_compare(const list_head_t *vma0, const list_head_t *vma1)
@@ -9,6 +9,8 @@
 #define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
 #include "io/debug.h"                    // Include debugging functions.
 
+#include "assert.h"
+#include "math.h"
 #include "mem/mm/vmem.h"
 #include "string.h"
 #include "system/panic.h"
@@ -34,6 +36,17 @@ static virt_map_page_manager_t virt_default_mapping;
 /// Array of virtual pages.
 virt_map_page_t virt_pages[VIRTUAL_MEMORY_PAGES_COUNT];
 
+/// Address of the first kmap window.
+static uint32_t kmap_base;
+
+/// Page table entries of the kmap windows.
+static page_table_entry_t *kmap_entries[KMAP_SLOTS];
+
+/// Frames placed in the kmap windows, NULL when a window is not in use.
+static page_t *kmap_pages[KMAP_SLOTS];
+
+static virt_map_page_t *_alloc_virt_pages(uint32_t pfn_count);
+
 int vmem_init(void)
 {
     // Initialize the buddy system for virtual memory management.
@@ -124,6 +137,22 @@ int vmem_init(void)
         entry->frame = phy_addr >> 12U;
     }
 
+    // Reserve the kmap windows for good, and keep their page table entries at
+    // hand, so that placing a frame in a window is a single write.
+    virt_map_page_t *kmap_vpage = _alloc_virt_pages(KMAP_SLOTS);
+    if (!kmap_vpage) {
+        pr_crit("Failed to reserve the kmap windows\n");
+        return -1;
+    }
+    kmap_base = VIRT_PAGE_TO_ADDRESS(kmap_vpage);
+    for (uint32_t slot = 0; slot < KMAP_SLOTS; slot++) {
+        kmap_entries[slot] = mem_virtual_to_pte(main_pgd, kmap_base + (slot * PAGE_SIZE));
+        if (!kmap_entries[slot]) {
+            pr_crit("Failed to get the page table entry of kmap window %u\n", slot);
+            return -1;
+        }
+    }
+
     return 0;
 }
 
@@ -296,49 +325,69 @@ int vmem_unmap_virtual_address_page(virt_map_page_t *page)
     return 0;
 }
 
-// FIXME: Check if this function should support unaligned page-boundaries copy
-void vmem_memcpy(mm_struct_t *dst_mm, uint32_t dst_vaddr, mm_struct_t *src_mm, uint32_t src_vaddr, uint32_t size)
+void *vmem_kmap(page_t *page, kmap_slot_t slot)
 {
-    // Buffer size for copying.
-    const uint32_t VMEM_BUFFER_SIZE = 65536;
-
-    // Determine the buffer size to use for copying.
-    uint32_t buffer_size = min(VMEM_BUFFER_SIZE, size);
-
-    // Allocate virtual pages for the source and destination.
-    virt_map_page_t *src_vpage = vmem_map_alloc_virtual(size);
-    virt_map_page_t *dst_vpage = vmem_map_alloc_virtual(size);
-
-    // Error handling: ensure both source and destination virtual pages are allocated.
-    if (!src_vpage || !dst_vpage) {
-        kernel_panic("Cannot copy virtual memory address, unable to reserve vmem!");
+    // Lowmem frames are permanently mapped.
+    if (is_lowmem_page_struct(page)) {
+        return (void *)get_virtual_address_from_page(page);
     }
+    assert(slot < KMAP_SLOTS && "Invalid kmap slot.");
+    if (kmap_pages[slot]) {
+        pr_warning("The kmap window %u is already in use by page 0x%p.\n", slot, kmap_pages[slot]);
+    }
+    kmap_pages[slot] = page;
+
+    // Point the window to the frame, and drop the stale translation.
+    uint32_t vaddr            = kmap_base + (slot * PAGE_SIZE);
+    page_table_entry_t *entry = kmap_entries[slot];
+    entry->frame              = get_physical_address_from_page(page) >> 12U;
+    entry->rw                 = 1;
+    entry->global             = 1;
+    entry->present            = 1;
+    paging_flush_tlb_single(vaddr);
+
+    return (void *)vaddr;
+}
 
-    // Loop to copy memory in chunks.
-    for (;;) {
-        // Map the source and destination virtual addresses to the allocated
-        // virtual pages.
-        uint32_t src_map = vmem_map_virtual_address(src_mm, src_vpage, src_vaddr, buffer_size);
-        uint32_t dst_map = vmem_map_virtual_address(dst_mm, dst_vpage, dst_vaddr, buffer_size);
-
-        // Determine the size to copy in this iteration.
-        uint32_t cpy_size = min(buffer_size, size);
-
-        // Perform the memory copy.
-        memcpy((void *)dst_map, (void *)src_map, cpy_size);
+void vmem_kunmap(void *addr, kmap_slot_t slot)
+{
+    // The window keeps pointing to the frame until it is used again, the next
+    // vmem_kmap invalidates the translation anyway.
+    if ((uint32_t)addr == kmap_base + (slot * PAGE_SIZE)) {
+        kmap_pages[slot] = NULL;
+    }
+}
 
-        // Check if the entire size has been copied.
-        if (size <= buffer_size) {
-            break;
+void vmem_memcpy(mm_struct_t *dst_mm, uint32_t dst_vaddr, mm_struct_t *src_mm, uint32_t src_vaddr, uint32_t size)
+{
+    while (size) {
+        // Copy up to the nearest page boundary, on either side.
+        uint32_t src_offset = src_vaddr & (PAGE_SIZE - 1);
+        uint32_t dst_offset = dst_vaddr & (PAGE_SIZE - 1);
+        uint32_t cpy_size   = min(size, PAGE_SIZE - max(src_offset, dst_offset));
+
+        // Find the frames behind the two addresses.
+        page_table_entry_t *dst_entry = mem_virtual_to_pte(dst_mm->pgd, dst_vaddr);
+        page_table_entry_t *src_entry = mem_virtual_to_pte(src_mm->pgd, src_vaddr);
+        if (!dst_entry || !dst_entry->present) {
+            kernel_panic("Cannot copy virtual memory address, the destination is not mapped!");
+        }
+        page_t *dst_page = get_page_from_physical_address(dst_entry->frame << 12U);
+        char *dst        = (char *)vmem_kmap(dst_page, KMAP_DST);
+
+        if (src_entry && src_entry->present) {
+            page_t *src_page = get_page_from_physical_address(src_entry->frame << 12U);
+            char *src        = (char *)vmem_kmap(src_page, KMAP_SRC);
+            memcpy(dst + dst_offset, src + src_offset, cpy_size);
+            vmem_kunmap(src, KMAP_SRC);
+        } else {
+            // The source page was never touched, it reads as zeros.
+            memset(dst + dst_offset, 0, cpy_size);
         }
+        vmem_kunmap(dst, KMAP_DST);
 
-        // Update the remaining size and addresses for the next iteration.
         size -= cpy_size;
         src_vaddr += cpy_size;
         dst_vaddr += cpy_size;
     }
-
-    // Unmap the allocated virtual pages.
-    vmem_unmap_virtual_address_page(src_vpage);
-    vmem_unmap_virtual_address_page(dst_vpage);
 }
@@ -12,6 +12,7 @@
 #include "mem/page_fault.h"
 
 #include "descriptor_tables/isr.h"
+#include "mem/mm/filemap.h"
 #include "mem/mm/page.h"
 #include "mem/mm/vm_area.h"
 #include "mem/mm/vmem.h"
@@ -93,8 +94,68 @@ static void __page_fault_panic(pt_regs_t *f, uint32_t addr)
     __asm__ __volatile__("cli");
 }
 
+/// @brief Handles a write to a present Copy-On-Write (COW) page, whose frame
+///        may be shared with other address spaces.
+/// @param entry The page table entry to manage.
+/// @return 0 on success, 1 on error.
+static int __page_copy_on_write(page_table_entry_t *entry)
+{
+    // Get the page of the shared frame.
+    page_t *page = get_page_from_physical_address(entry->frame << 12U);
+    if (!page) {
+        pr_crit("Failed to get the page of frame %u.\n", entry->frame);
+        return 1;
+    }
+
+    // If someone else is still using the frame, give this address space its
+    // own copy, otherwise the frame can be reused in place.
+    if (page_count(page) > 1) {
+        page_t *copy = alloc_pages(GFP_HIGHUSER, 0);
+        if (!copy) {
+            pr_crit("Failed to allocate a new page.\n");
+            return 1;
+        }
+
+        // Reach both frames through the kmap windows, and copy the content.
+        void *src = vmem_kmap(page, KMAP_SRC);
+        void *dst = vmem_kmap(copy, KMAP_DST);
+        memcpy(dst, src, PAGE_SIZE);
+        vmem_kunmap(dst, KMAP_DST);
+        vmem_kunmap(src, KMAP_SRC);
+
+        // Drop the reference to the shared frame, and use the copy.
+        page_dec(page);
+        entry->frame = get_physical_address_from_page(copy) >> 12U;
+    }
+
+    // The frame is now private, restore the write permission.
+    entry->kernel_cow = 0;
+    entry->rw         = 1;
+
+    return 0;
+}
+
+/// @brief Populates the page of a file mapping of the current process.
+/// @param addr the faulting address.
+/// @return 0 on success, -1 if the address does not belong to a file mapping,
+/// or if the page could not be read.
+static int __page_handle_filemap(uint32_t addr)
+{
+    task_struct *task = scheduler_get_current_process();
+    if (!task || !task->mm) {
+        return -1;
+    }
+    vm_area_struct_t *area = vm_area_lookup(task->mm, addr);
+    if (!area || !area->vm_file) {
+        return -1;
+    }
+    return filemap_fault(area, addr);
+}
+
 /// @brief Handles the Copy-On-Write (COW) mechanism for a page table entry.
-///        If the page is marked as COW, it allocates a new page and updates the entry.
+///        If the page is marked as COW and not present, it allocates a new
+///        page and updates the entry; if it is present, the frame is shared
+///        and it is copied on write.
 /// @param entry The page table entry to manage.
 /// @return 0 on success, 1 on error.
 static int __page_handle_cow(page_table_entry_t *entry)
@@ -107,31 +168,24 @@ static int __page_handle_cow(page_table_entry_t *entry)
 
     // Check if the page is Copy On Write (COW).
     if (entry->kernel_cow) {
+        // The page is present, so its frame is shared with other address spaces.
+        if (entry->present) {
+            return __page_copy_on_write(entry);
+        }
+
         // Mark the page as no longer Copy-On-Write.
         entry->kernel_cow = 0;
 
         // If the page is not currently present (not allocated in physical memory).
         if (!entry->present) {
-            // Allocate a new physical page using high user memory flag.
-            page_t *page = alloc_pages(GFP_HIGHUSER, 0);
+            // Allocate a new zeroed physical page using high user memory
+            // flag, it usually comes ready from the zero pool.
+            page_t *page = alloc_pages(GFP_HIGHUSER | __GFP_ZERO, 0);
             if (!page) {
                 pr_crit("Failed to allocate a new page.\n");
                 return 1;
             }
 
-            // Map the allocated physical page to a virtual address.
-            uint32_t vaddr = vmem_map_physical_pages(page, 1);
-            if (!vaddr) {
-                pr_crit("Failed to map the physical page to virtual address.\n");
-                return 1;
-            }
-
-            // Clear the new page by setting all its bytes to 0.
-            memset((void *)vaddr, 0, PAGE_SIZE);
-
-            // Unmap the virtual address after clearing the page.
-            vmem_unmap_virtual_address(vaddr);
-
             // Set the physical frame address of the allocated page into the entry.
             entry->frame = get_physical_address_from_page(page) >> 12U; // Shift to get page frame number.
 
@@ -312,6 +366,10 @@ void page_fault_handler(pt_regs_t *f)
             __page_fault_panic(f, faulting_addr);
         }
 
+        // The original entry might belong to the current address space, and
+        // its frame or permissions might have changed, flush the whole TLB.
+        set_cr3(get_cr3());
+
         // Update the page table entry frame.
         entry->frame = orig_entry->frame;
 
@@ -354,9 +412,21 @@ void page_fault_handler(pt_regs_t *f)
                 pr_crit("Continuing with page fault handling, triggering panic.\n");
                 __page_fault_panic(f, faulting_addr);
             }
+        } else if (!entry->present && !__page_handle_filemap(faulting_addr)) {
+            // The page of a file mapping has been read, and mapped.
+            pr_debug("Page fault served by the file mapping at %p.\n", (void *)faulting_addr);
         } else {
-            // Page is not marked as CoW, this is a different fault type (e.g., demand paging)
-            pr_debug("Page fault is not Copy-on-Write, likely demand paging or other fault type.\n");
+            // Page is not marked as CoW, and does not belong to a file mapping.
+            pr_debug("Page fault is not Copy-on-Write, nor on a file mapping.\n");
+            // If the fault was caused by a user process, send a SIGSEGV signal.
+            if (err_user) {
+                task_struct *task = scheduler_get_current_process();
+                if (task) {
+                    sys_kill(task->pid, SIGSEGV);
+                    scheduler_run(f);
+                    return;
+                }
+            }
             __page_fault_panic(f, faulting_addr);
         }
     }
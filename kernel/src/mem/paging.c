@@ -10,10 +10,13 @@
 #include "io/debug.h"                    // Include debugging functions.
 
 #include "assert.h"
+#include "errno.h"
+#include "fcntl.h"
 #include "fs/vfs.h"
 #include "list_head.h"
 #include "list_head_algorithm.h"
 #include "mem/alloc/zone_allocator.h"
+#include "mem/mm/filemap.h"
 #include "mem/mm/vmem.h"
 #include "mem/page_fault.h"
 #include "mem/paging.h"
@@ -161,8 +164,9 @@ void paging_enable(void)
 {
     // Clear the PSE bit from cr4.
     set_cr4(bitmask_clear(get_cr4(), CR4_PSE));
-    // Set the PG bit in cr0.
-    set_cr0(bitmask_set(get_cr0(), CR0_PG));
+    // Set the PG bit in cr0, and the WP bit so that the kernel writing to a
+    // copy-on-write user page triggers a page fault as well.
+    set_cr0(bitmask_set(get_cr0(), CR0_PG | CR0_WP));
 }
 
 int paging_is_enabled(void) { return bitmask_check(get_cr0(), CR0_PG); }
@@ -538,6 +542,29 @@ page_t *mem_virtual_to_page(page_directory_t *pgd, uint32_t virt_start, size_t *
     return page;
 }
 
+page_table_entry_t *mem_virtual_to_pte(page_directory_t *pgd, uint32_t virt_addr)
+{
+    // Check for null pointer to the page directory to avoid dereferencing.
+    if (!pgd) {
+        pr_crit("The page directory is null.\n");
+        return NULL;
+    }
+
+    // Get the page directory entry, the page table might not exist yet.
+    page_dir_entry_t *direntry = &pgd->entries[virt_addr / (1024U * PAGE_SIZE)];
+    if (!direntry->present) {
+        return NULL;
+    }
+
+    // Get the low memory address of the page table.
+    page_table_t *table = (page_table_t *)get_virtual_address_from_page(memory.mem_map + direntry->frame);
+    if (!table) {
+        return NULL;
+    }
+
+    return &table->pages[(virt_addr / PAGE_SIZE) % 1024U];
+}
+
 int mem_upd_vm_area(page_directory_t *pgd, uint32_t virt_start, uint32_t phy_start, size_t size, uint32_t flags)
 {
     // Check for null pointer to the page directory to avoid dereferencing.
@@ -642,41 +669,107 @@ int mem_clone_vm_area(
     return 0;
 }
 
+int mem_share_vm_area(page_directory_t *src_pgd, page_directory_t *dst_pgd, uint32_t virt_start, size_t size, int cow)
+{
+    // Check for null pointer.
+    if (!src_pgd) {
+        pr_crit("The source page directory is null.\n");
+        return -1;
+    }
+
+    // Check for null pointer.
+    if (!dst_pgd) {
+        pr_crit("The destination page directory is null.\n");
+        return -1;
+    }
+
+    // Initialize iterators for both source and destination page directories.
+    page_iterator_t src_iter;
+    page_iterator_t dst_iter;
+
+    if (__pg_iter_init(&src_iter, src_pgd, virt_start, size, MM_PRESENT | MM_RW | MM_USER) < 0) {
+        pr_crit("Failed to initialize source page iterator\n");
+        return -1;
+    }
+    if (__pg_iter_init(&dst_iter, dst_pgd, virt_start, size, MM_PRESENT | MM_RW | MM_USER) < 0) {
+        pr_crit("Failed to initialize destination page iterator\n");
+        return -1;
+    }
+
+    while (__pg_iter_has_next(&src_iter) && __pg_iter_has_next(&dst_iter)) {
+        pg_iter_entry_t src_it = __pg_iter_next(&src_iter);
+        pg_iter_entry_t dst_it = __pg_iter_next(&dst_iter);
+
+        if (src_it.entry->present) {
+            // Writable pages become read-only in both address spaces, the
+            // first write will give the writer its own copy.
+            if (cow && src_it.entry->rw) {
+                src_it.entry->rw         = 0;
+                src_it.entry->kernel_cow = 1;
+                paging_flush_tlb_single(src_it.pfn * PAGE_SIZE);
+            }
+            // Take a reference on the shared frame.
+            page_t *page = get_page_from_physical_address(src_it.entry->frame << 12U);
+            if (!page) {
+                pr_crit("Failed to retrieve the page of frame %u.\n", src_it.entry->frame);
+                return -1;
+            }
+            page_inc(page);
+        }
+
+        // Share the entry as it is, including non-present copy-on-write ones
+        // which are still waiting for their first access.
+        *dst_it.entry = *src_it.entry;
+
+        paging_flush_tlb_single(dst_it.pfn * PAGE_SIZE);
+    }
+
+    return 0;
+}
+
 void *sys_mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
 {
     uintptr_t vm_start;
+    vfs_file_t *file = NULL;
 
     // Get the current task.
     task_struct *task = scheduler_get_current_process();
 
-    // Get the file descriptor.
-    vfs_file_descriptor_t *file_descriptor = fget(fd);
-    if (!file_descriptor) {
-        pr_err("Invalid file descriptor.\n");
-        return NULL;
+    // The mapping must be either shared or private.
+    if (!length || (!(flags & MAP_SHARED) == !(flags & MAP_PRIVATE))) {
+        pr_err("Invalid length or mapping type.\n");
+        return (void *)-EINVAL;
     }
 
-    // Get the actual file.
-    vfs_file_t *file = file_descriptor->file_struct;
-    if (!file) {
-        pr_err("Invalid file.\n");
-        return NULL;
+    // The offset must be a multiple of the page size.
+    if ((offset < 0) || (offset % PAGE_SIZE)) {
+        pr_err("The offset must be a multiple of the page size.\n");
+        return (void *)-EINVAL;
     }
 
-    stat_t file_stat;
-    if (vfs_fstat(file, &file_stat) < 0) {
-        pr_err("Failed to get file stat.\n");
-        return NULL;
-    }
+    // Mappings are made of whole pages.
+    length = (length + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
 
-    // Ensure the file size is large enough to map
-    if ((offset + length) > file_stat.st_size) {
-        pr_err("File is too small for the requested mapping.\n");
-        return NULL;
+    if (!(flags & MAP_ANONYMOUS)) {
+        // Get the file descriptor.
+        vfs_file_descriptor_t *file_descriptor = fget(fd);
+        if (!file_descriptor || !file_descriptor->file_struct) {
+            pr_err("Invalid file descriptor.\n");
+            return (void *)-EBADF;
+        }
+        file = file_descriptor->file_struct;
+
+        // The file must be readable, and writable to write through a shared mapping.
+        int mode = file_descriptor->flags_mask & O_ACCMODE;
+        if ((mode == O_WRONLY) || ((flags & MAP_SHARED) && (prot & PROT_WRITE) && (mode != O_RDWR))) {
+            pr_err("The file was not opened with a mode compatible with the mapping.\n");
+            return (void *)-EACCES;
+        }
     }
 
     // Check if a specific address was requested for the memory mapping.
-    if (addr && vm_area_is_valid(task->mm, (uintptr_t)addr, (uintptr_t)addr + length)) {
+    if (addr && ((uintptr_t)addr % PAGE_SIZE == 0) &&
+        (vm_area_is_valid(task->mm, (uintptr_t)addr, (uintptr_t)addr + length) > 0)) {
         // If the requested address is valid, use it as the starting address.
         vm_start = (uintptr_t)addr;
     } else {
@@ -684,64 +777,70 @@ void *sys_mmap(void *addr, size_t length, int prot, int flags, int fd, off_t off
         if (vm_area_search_free_area(task->mm, length, &vm_start)) {
             pr_err("Failed to find a suitable spot for a new virtual memory "
                    "area.\n");
-            return NULL;
+            return (void *)-ENOMEM;
         }
     }
 
-    // Allocate the virtual memory area segment.
-    vm_area_struct_t *segment =
-        vm_area_create(task->mm, vm_start, length, MM_PRESENT | MM_RW | MM_COW | MM_USER, GFP_HIGHUSER);
+    // Allocate the virtual memory area segment, no page is provided until it
+    // is accessed: anonymous pages are zeroed, file pages are read.
+    uint32_t pgflags = MM_USER | MM_RW | (file ? 0 : (MM_PRESENT | MM_COW));
+    vm_area_struct_t *segment = vm_area_create(task->mm, vm_start, length, pgflags, GFP_HIGHUSER);
     if (!segment) {
         pr_err("Failed to allocate virtual memory area segment.\n");
-        return NULL;
+        return (void *)-ENOMEM;
     }
 
     // Set the memory flags for the mapping.
-    task->mm->mmap_cache->vm_flags = flags;
+    segment->vm_page_prot = prot;
+    segment->vm_flags     = flags;
+
+    // Keep the mapped file open as long as the mapping exists.
+    if (file) {
+        segment->vm_file  = file;
+        segment->vm_pgoff = offset / PAGE_SIZE;
+        ++file->count;
+    }
 
     // Return the starting address of the newly created memory segment.
     return (void *)segment->vm_start;
 }
 
+void *sys_old_mmap(mmap_arg_struct_t *args)
+{
+    if (!args) {
+        return (void *)-EFAULT;
+    }
+    return sys_mmap(args->addr, args->length, args->prot, args->flags, args->fd, args->offset);
+}
+
 int sys_munmap(void *addr, size_t length)
 {
     // Get the current task.
     task_struct *task = scheduler_get_current_process();
 
     // Initialize variables.
-    vm_area_struct_t *segment;           // The virtual memory area segment.
     unsigned vm_start = (uintptr_t)addr; // Starting address of the memory area to unmap.
-    unsigned size;                       // Size of the segment.
 
-    // Iterate through the list of memory mapped areas in reverse order.
-    list_for_each_prev_decl(it, &task->mm->mmap_list)
-    {
-        segment = list_entry(it, vm_area_struct_t, vm_list);
-
-        // Check if the segment is valid.
-        if (!segment) {
-            pr_crit("Found a NULL area in the mmap list.\n");
-            return -1;
-        }
+    // Mappings are made of whole pages.
+    length = (length + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
 
-        // Compute the size of the current segment.
-        size = segment->vm_end - segment->vm_start;
+    // Search the area starting at the given address.
+    vm_area_struct_t *segment = vm_area_find(task->mm, vm_start);
 
-        // Check if the requested address and length match the current segment.
-        if ((vm_start == segment->vm_start) && (length == size)) {
-            pr_debug("[0x%p:0x%p] Found it, destroying it.\n", (void *)segment->vm_start, (void *)segment->vm_end);
+    // Check if the requested address and length match the segment.
+    if (segment && (length == (segment->vm_end - segment->vm_start))) {
+        pr_debug("[0x%p:0x%p] Found it, destroying it.\n", (void *)segment->vm_start, (void *)segment->vm_end);
 
-            // Step 6: Destroy the found virtual memory area.
-            if (vm_area_destroy(task->mm, segment) < 0) {
-                pr_err(
-                    "Failed to destroy the virtual memory area at "
-                    "[0x%p:0x%p].\n",
-                    (void *)segment->vm_start, (void *)segment->vm_end);
-                return -1;
-            }
-
-            return 0;
+        // Destroy the found virtual memory area.
+        if (vm_area_destroy(task->mm, segment) < 0) {
+            pr_err(
+                "Failed to destroy the virtual memory area at "
+                "[0x%p:0x%p].\n",
+                (void *)segment->vm_start, (void *)segment->vm_end);
+            return -1;
         }
+
+        return 0;
     }
 
     pr_err(
@@ -750,3 +849,37 @@ int sys_munmap(void *addr, size_t length)
         addr, length);
     return 1;
 }
+
+int sys_msync(void *addr, size_t length, int flags)
+{
+    // Get the current task.
+    task_struct *task = scheduler_get_current_process();
+
+    uint32_t start = (uintptr_t)addr;
+    uint32_t end   = start + length;
+
+    // The address must be page aligned, and the flags consistent.
+    if ((start % PAGE_SIZE) || (flags & ~(MS_ASYNC | MS_INVALIDATE | MS_SYNC)) ||
+        ((flags & MS_ASYNC) && (flags & MS_SYNC))) {
+        return -EINVAL;
+    }
+
+    // Write back every shared file mapping overlapping the range. Without a
+    // writeback thread, asynchronous requests are served synchronously too,
+    // while mappings are always coherent with the page cache so there is
+    // nothing to invalidate.
+    int found                 = 0;
+    vm_area_struct_t *segment = vm_area_lookup_next(task->mm, start);
+    while (segment && (segment->vm_start < end)) {
+        found = 1;
+        if (filemap_sync(segment, start, end) < 0) {
+            return -EIO;
+        }
+        // The areas are sorted, move to the next one.
+        if (segment->vm_list.next == &task->mm->mmap_list) {
+            break;
+        }
+        segment = list_entry(segment->vm_list.next, vm_area_struct_t, vm_list);
+    }
+    return found ? 0 : -ENOMEM;
+}
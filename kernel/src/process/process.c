@@ -96,13 +96,7 @@ static int __reset_process(task_struct *task)
         return 0;
     }
 
-    // Save the current page directory.
-    page_directory_t *crtdir = paging_get_current_pgd();
-    // FIXME: Now to clear the stack a pgdir switch is made, it should be a kernel mmapping.
-    paging_switch_pgd(task->mm->pgd);
-
-    // Clean stack space.
-    memset((char *)task->mm->start_stack, 0, DEFAULT_STACK_SIZE);
+    // The stack needs no cleaning, its pages are zero-filled on first access.
     // Set the base address of the stack.
     task->thread.regs.ebp     = (uintptr_t)(task->mm->start_stack + DEFAULT_STACK_SIZE);
     // Set the top address of the stack.
@@ -110,9 +104,6 @@ static int __reset_process(task_struct *task)
     // Enable the interrupts.
     task->thread.regs.eflags  = task->thread.regs.eflags | EFLAG_IF;
 
-    // Restore previous pgdir
-    paging_switch_pgd(crtdir);
-
     return 1;
 }
 
@@ -256,12 +247,16 @@ static inline task_struct *__alloc_task(task_struct *source, task_struct *parent
     list_head_init(&proc->children);
     // Initialize the sibling list_head.
     list_head_init(&proc->sibling);
+    // Initialize the queue of processes waiting for the children.
+    wait_queue_head_init(&proc->wait_chldexit);
     // If we have a parent, set the sibling child relation.
     if (parent) {
         // Set the new_process as child of current.
         list_head_insert_before(&proc->sibling, &parent->children);
     }
     if (source) {
+        // The FPU registers of the source might still be loaded in the FPU.
+        fpu_save_task(source);
         memcpy(&proc->thread, &source->thread, sizeof(thread_struct_t));
     }
     // Set the statistics of the process.
@@ -328,9 +323,11 @@ static inline task_struct *__alloc_task(task_struct *source, task_struct *parent
         .c_lflag = (ICANON | ECHO | ECHOE | ECHOK | ECHONL | ISIG),
         .c_oflag = 0,
         .c_iflag = 0,
+        .c_cc    = { [VMIN] = 1 },
     };
     // Initialize the ringbuffer.
     rb_keybuffer_init(&proc->keyboard_rb);
+    proc->keyboard_timeout = 0;
 
     return proc;
 }
@@ -696,6 +693,10 @@ int sys_execve(pt_regs_t *f)
     // Change the name of the process.
     strcpy(current->name, name_buffer);
 
+    // The new image starts with a clean FPU.
+    fpu_release_task(current);
+    current->thread.fpu_enabled = false;
+
     // Free the temporary args memory.
     kfree(args_mem);
 
@@ -14,6 +14,7 @@
 #include "errno.h"
 #include "fs/vfs.h"
 #include "hardware/timer.h"
+#include "ipc/ipc.h"
 #include "process/pid_manager.h"
 #include "process/prio.h"
 #include "process/scheduler.h"
@@ -21,6 +22,7 @@
 #include "process/wait.h"
 #include "strerror.h"
 #include "system/panic.h"
+#include "system/signal.h"
 
 /// @brief          Assembly function setting the kernel stack to jump into
 ///                 location in Ring 3 mode (USER mode).
@@ -41,9 +43,11 @@ void scheduler_initialize(void)
     // Initialize the PID manager.
     pid_manager_init();
     // Reset the current task.
-    runqueue.curr       = NULL;
+    runqueue.curr         = NULL;
     // Reset the number of active tasks.
-    runqueue.num_active = 0;
+    runqueue.num_active   = 0;
+    // Nothing to reschedule yet.
+    runqueue.need_resched = false;
 }
 
 task_struct *scheduler_get_current_process(void) { return runqueue.curr; }
@@ -97,6 +101,8 @@ void scheduler_enqueue_task(task_struct *process)
     list_head_insert_before(&process->run_list, &runqueue.queue);
     // Increment the number of active processes.
     ++runqueue.num_active;
+    // Give the new process a chance to run.
+    runqueue.need_resched = true;
 
 #ifdef ENABLE_SCHEDULER_FEEDBACK
     scheduler_feedback_task_add(process);
@@ -119,6 +125,37 @@ void scheduler_dequeue_task(task_struct *process)
 #endif
 }
 
+/// @brief Waits, with interrupts enabled, until a process can run, since all of
+/// them might be waiting for an interrupt (e.g., for a timer to expire).
+static inline void __scheduler_wait_runnable(void)
+{
+    while (1) {
+        list_for_each_decl (it, &runqueue.queue) {
+            if (list_entry(it, task_struct, run_list)->state == TASK_RUNNING) {
+                return;
+            }
+        }
+        __asm__ __volatile__("sti; hlt; cli" ::: "memory");
+    }
+}
+
+void scheduler_set_need_resched(void) { runqueue.need_resched = true; }
+
+int scheduler_need_resched(void)
+{
+    task_struct *curr = runqueue.curr;
+    if (runqueue.need_resched || (curr == NULL)) {
+        return 1;
+    }
+    // The process blocked, stopped or exited during the system call.
+    if (curr->state != TASK_RUNNING) {
+        return 1;
+    }
+    // The process has signals that are not blocked.
+    return ((curr->pending.signal.sig[0] & ~curr->blocked.sig[0]) ||
+            (curr->pending.signal.sig[1] & ~curr->blocked.sig[1]));
+}
+
 void scheduler_run(pt_regs_t *f)
 {
     // Check if there is a running process.
@@ -126,6 +163,9 @@ void scheduler_run(pt_regs_t *f)
         return;
     }
 
+    // The request is served now.
+    runqueue.need_resched = false;
+
     task_struct *next = NULL;
 
     // Update the context of the current process.
@@ -134,18 +174,17 @@ void scheduler_run(pt_regs_t *f)
     // We check the existence of pending signals every time we finish
     // handling an interrupt or an exception.
     if (!do_signal(f)) {
+        // Every process might be sleeping, wait for one to wake up.
+        if (runqueue.curr->state != TASK_RUNNING) {
+            __scheduler_wait_runnable();
+        }
 #if 1
         if (runqueue.curr->state == EXIT_ZOMBIE) {
             //==== Handle Zombies =================================================
             //pr_debug("Handle zombie %d\n", runqueue.curr->pid);
-            // get the next process after the current one
-            list_head_t *nNode = runqueue.curr->run_list.next;
-            // check if we reached the head of list_head_t
-            if (nNode == &runqueue.queue) {
-                nNode = nNode->next;
-            }
-            // get the task_struct
-            next = list_entry(nNode, task_struct, run_list);
+            // Pick the next runnable process, while the zombie is still in the
+            // queue.
+            next = scheduler_pick_next_task(&runqueue);
             // Remove the zombie task.
             scheduler_dequeue_task(runqueue.curr);
             assert(next && "No valid task selected after removing ZOMBIE.");
@@ -501,6 +540,8 @@ int sys_nice(int increment)
     if (PRIO_TO_NICE(runqueue.curr->se.prio) != newNice && newNice >= MIN_NICE && newNice <= MAX_NICE) {
         runqueue.curr->se.prio = NICE_TO_PRIO(newNice);
     }
+    // Let the scheduler reconsider the current process.
+    runqueue.need_resched = true;
     int actualNice = PRIO_TO_NICE(runqueue.curr->se.prio);
 
     pr_debug("Actual new nice value is: %d\n", actualNice);
@@ -536,6 +577,9 @@ pid_t sys_waitpid(pid_t pid, int *status, int options)
         return -ECHILD;
     }
 
+    // Tells if the child we are waiting for exists.
+    bool_t found = false;
+
     // Iterate through the children of the current process.
     list_for_each_safe_decl(it, store, &runqueue.curr->children)
     {
@@ -545,13 +589,23 @@ pid_t sys_waitpid(pid_t pid, int *status, int options)
             continue;
         }
 
-        // If the child is not in a zombie state, keep searching.
-        if (child->state != EXIT_ZOMBIE) {
+        // If a specific PID is provided, skip children with different PIDs.
+        if ((pid > 1) && (child->pid != pid)) {
             continue;
         }
+        found = true;
 
-        // If a specific PID is provided, skip children with different PIDs.
-        if ((pid > 1) && (child->pid != pid)) {
+        // Report a stopped child only once, its exit code is the signal.
+        if ((options & WUNTRACED) && (child->state == TASK_STOPPED) && child->exit_code) {
+            if (status != NULL) {
+                *status = (child->exit_code << 8) | 0x7f;
+            }
+            child->exit_code = 0;
+            return child->pid;
+        }
+
+        // If the child is not in a zombie state, keep searching.
+        if (child->state != EXIT_ZOMBIE) {
             continue;
         }
 
@@ -574,8 +628,26 @@ pid_t sys_waitpid(pid_t pid, int *status, int options)
         return child_pid;
     }
 
-    // No eligible child process was found.
-    return 0;
+    // The child we are waiting for is not among our children.
+    if (!found) {
+        return -ECHILD;
+    }
+
+    // No eligible child process was found, and we were asked not to wait.
+    if (options & WNOHANG) {
+        return 0;
+    }
+
+    // A signal interrupts the wait.
+    if (signal_pending(runqueue.curr)) {
+        return -EINTR;
+    }
+
+    // Sleep until a child exits or stops, or a signal arrives, then issue the call again.
+    if (sleep_on_interruptible(&runqueue.curr->wait_chldexit) == NULL) {
+        return -ENOMEM;
+    }
+    return -ERESTART;
 }
 
 void do_exit(int exit_code)
@@ -588,6 +660,11 @@ void do_exit(int exit_code)
         kernel_panic("Init process cannot call sys_exit!");
     }
 
+    // The FPU registers of the process are not needed anymore.
+    fpu_release_task(runqueue.curr);
+    // Revert the semaphore operations done with SEM_UNDO.
+    sem_exit(runqueue.curr->pid);
+
     // Set the termination code of the process.
     runqueue.curr->exit_code = exit_code;
     // Set the state of the process to zombie.
@@ -599,6 +676,8 @@ void do_exit(int exit_code)
             pr_err(
                 "[%d] %5d failed sending signal %d : %s\n", ret, runqueue.curr->parent->pid, SIGCHLD, strerror(errno));
         }
+        // Wake up the parent if it is waiting for us.
+        wake_up(&runqueue.curr->parent->wait_chldexit);
     }
 
     // If it has children, then init process has to take care of them.
@@ -615,6 +694,8 @@ void do_exit(int exit_code)
         pr_debug("}\n");
         // Plug the list of children.
         list_head_append(&init_process->children, &runqueue.curr->children);
+        // Some of them might be zombies already, let init collect them.
+        wake_up(&init_process->wait_chldexit);
         // Print the list of children.
         pr_debug("New list of init children (%d): {\n", init_process->pid);
         list_for_each_decl (it, &init_process->children) {
@@ -652,6 +733,8 @@ int sys_sched_setparam(pid_t pid, const sched_param_t *param)
 
             entry->se.is_under_analysis = true;
             entry->se.executed          = false;
+            // The parameters used to pick the next task changed.
+            runqueue.need_resched       = true;
             return 1;
         }
     }
@@ -817,6 +900,8 @@ int sys_waitperiod(void)
         pr_warning("%d > %d Missing deadline...\n", current_time, current->se.deadline);
     }
     // Tell the scheduler that we have executed the periodic process.
-    current->se.executed = true;
+    current->se.executed  = true;
+    // Leave the CPU to the other processes.
+    runqueue.need_resched = true;
     return 0;
 }
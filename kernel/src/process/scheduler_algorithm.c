@@ -64,7 +64,10 @@ static inline task_struct *__scheduler_rr(runqueue_t *runqueue, bool_t skip_peri
         // We have our next entry.
         return entry;
     }
-
+    // Nobody else can run, keep running the current task if it can.
+    if ((runqueue->curr->state == TASK_RUNNING) && !(__is_periodic_task(runqueue->curr) && skip_periodic)) {
+        return runqueue->curr;
+    }
     return NULL;
 }
 
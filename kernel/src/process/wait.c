@@ -31,6 +31,7 @@ static inline void __add_wait_queue(wait_queue_head_t *head, wait_queue_entry_t
         return;
     }
     list_head_insert_before(&entry->task_list, &head->task_list);
+    entry->head = head;
 }
 
 /// @brief Removes the entry from the wait queue.
@@ -48,6 +49,21 @@ static inline void __remove_wait_queue(wait_queue_head_t *head, wait_queue_entry
         return;
     }
     list_head_remove(&entry->task_list);
+    entry->head = NULL;
+}
+
+/// @brief Removes the entry from the wait queue it is in, and frees it.
+/// @param entry the entry.
+static inline void __wait_queue_entry_release(wait_queue_entry_t *entry)
+{
+    if (entry->head) {
+        remove_wait_queue(entry->head, entry);
+    }
+    // The task is not sleeping on the entry anymore.
+    if (entry->task && (entry->task->wait_entry == entry)) {
+        entry->task->wait_entry = NULL;
+    }
+    wait_queue_entry_dealloc(entry);
 }
 
 int default_wake_function(wait_queue_entry_t *entry, unsigned mode, int sync)
@@ -65,6 +81,8 @@ int default_wake_function(wait_queue_entry_t *entry, unsigned mode, int sync)
     if ((entry->task->state == TASK_INTERRUPTIBLE) || (entry->task->state == TASK_UNINTERRUPTIBLE)) {
         // Set the task state to the specified mode.
         entry->task->state = mode;
+        // Let the scheduler pick it up.
+        scheduler_set_need_resched();
 
         // Optionally handle sync-specific operations here if needed.
         // For now, sync is unused.
@@ -104,6 +122,7 @@ wait_queue_entry_t *wait_queue_entry_alloc(void)
     entry->task    = NULL;
     entry->func    = NULL;
     entry->private = NULL;
+    entry->head    = NULL;
     list_head_init(&entry->task_list);
     // Return the element.
     return entry;
@@ -132,6 +151,7 @@ void wait_queue_entry_init(wait_queue_entry_t *entry, struct task_struct *task)
     entry->task    = task;
     entry->func    = default_wake_function;
     entry->private = NULL;
+    entry->head    = NULL;
     list_head_init(&entry->task_list);
 }
 
@@ -168,7 +188,60 @@ void remove_wait_queue(wait_queue_head_t *head, wait_queue_entry_t *entry)
     spinlock_unlock(&head->lock);
 }
 
-wait_queue_entry_t *sleep_on(wait_queue_head_t *head)
+int wake_up(wait_queue_head_t *head)
+{
+    // Validate the input.
+    if (!head) {
+        pr_err("Variable head is NULL.\n");
+        return 0;
+    }
+    int woken = 0;
+    list_for_each_safe_decl(it, store, &head->task_list)
+    {
+        woken += wake_up_entry(list_entry(it, wait_queue_entry_t, task_list));
+    }
+    return woken;
+}
+
+int wake_up_entry(wait_queue_entry_t *entry)
+{
+    // Validate the input.
+    if (!entry) {
+        pr_err("Variable entry is NULL.\n");
+        return 0;
+    }
+    // Run the wakeup test function for the waiting task.
+    if (entry->func(entry, TASK_RUNNING, 0)) {
+        // Remove the entry from the queue, and free it.
+        __wait_queue_entry_release(entry);
+        return 1;
+    }
+    return 0;
+}
+
+int wake_up_interruptible_task(struct task_struct *task)
+{
+    // Validate the input.
+    if (!task) {
+        pr_err("Variable task is NULL.\n");
+        return 0;
+    }
+    if ((task->state != TASK_INTERRUPTIBLE) || !task->wait_entry) {
+        return 0;
+    }
+    // Nobody else is going to wake the task through the entry.
+    __wait_queue_entry_release(task->wait_entry);
+    task->state = TASK_RUNNING;
+    // Let the scheduler pick it up.
+    scheduler_set_need_resched();
+    return 1;
+}
+
+/// @brief Puts the current process to sleep on the wait queue.
+/// @param head the wait queue.
+/// @param state the state of the sleeping process.
+/// @return the entry representing the sleeping process.
+static inline wait_queue_entry_t *__sleep_on(wait_queue_head_t *head, long state)
 {
     // Validate input parameters.
     if (!head) {
@@ -183,8 +256,8 @@ wait_queue_entry_t *sleep_on(wait_queue_head_t *head)
         return NULL;
     }
 
-    // Set the task state to uninterruptible to indicate it is sleeping.
-    sleeping_task->state = TASK_UNINTERRUPTIBLE;
+    // Set the task state to indicate it is sleeping.
+    sleeping_task->state = state;
 
     // Allocate memory for a new wait queue entry.
     wait_queue_entry_t *entry = wait_queue_entry_alloc();
@@ -199,7 +272,16 @@ wait_queue_entry_t *sleep_on(wait_queue_head_t *head)
     // Add the wait queue entry to the specified wait queue.
     add_wait_queue(head, entry);
 
+    // Remember the entry, so that a signal can take the task off the queue.
+    if (state == TASK_INTERRUPTIBLE) {
+        sleeping_task->wait_entry = entry;
+    }
+
     pr_debug("Added process %d to the wait queue.\n", sleeping_task->pid);
 
     return entry;
 }
+
+wait_queue_entry_t *sleep_on(wait_queue_head_t *head) { return __sleep_on(head, TASK_UNINTERRUPTIBLE); }
+
+wait_queue_entry_t *sleep_on_interruptible(wait_queue_head_t *head) { return __sleep_on(head, TASK_INTERRUPTIBLE); }
@@ -131,6 +131,38 @@ static int __sig_is_ignored(struct task_struct *t, int sig)
     //        here I'm also accepting as not-ignored a SIG_IGN which is a SIGCHLD.
 }
 
+/// @brief Checks if the given signal interrupts a task sleeping interruptibly,
+/// namely if it is not blocked, and its delivery does something.
+/// @param t the task.
+/// @param sig the signal to check.
+/// @return 1 if it interrupts the task, 0 otherwise.
+static int __sig_interrupts(struct task_struct *t, int sig)
+{
+    if (sigismember(&t->blocked, sig)) {
+        return 0;
+    }
+    // Get the signal handler.
+    sighandler_t handler = __get_handler(t, sig);
+    if (handler == SIG_IGN) {
+        return 0;
+    }
+    // These signals are ignored by default.
+    if (handler == SIG_DFL) {
+        return (sig != SIGCONT) && (sig != SIGCHLD) && (sig != SIGURG) && (sig != SIGWINCH);
+    }
+    return 1;
+}
+
+int signal_pending(struct task_struct *t)
+{
+    for (int sig = 1; sig < NSIG; ++sig) {
+        if (sigismember(&t->pending.signal, sig) && __sig_interrupts(t, sig)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 /// @brief Allocate a new signal queue record.
 /// @param t     The task to which the signal belongs.
 /// @param sig   The signal to set.
@@ -195,6 +227,13 @@ static int __send_signal(int sig, siginfo_t *info, struct task_struct *t)
     }
     // Set that there is a signal pending.
     sigaddset(&t->pending.signal, sig);
+    // Deliver it as soon as possible.
+    scheduler_set_need_resched();
+    // Wake up the task if it is sleeping interruptibly, the call it was
+    // sleeping in is issued again, and fails with EINTR.
+    if (__sig_interrupts(t, sig)) {
+        wake_up_interruptible_task(t);
+    }
     pr_debug(
         "Added pending signal (%2d:%s) to task (%2d:%s), pending `%d, %d`.\n", sig, strsignal(sig), t->pid, t->name,
         t->pending.signal.sig[0], t->pending.signal.sig[1]);
@@ -448,6 +487,8 @@ int stop_wake_function(wait_queue_entry_t *entry, unsigned mode, int sync)
     if (entry->task->state == TASK_STOPPED) {
         // Set the task state to the specified mode.
         entry->task->state = mode;
+        // Let the scheduler pick it up.
+        scheduler_set_need_resched();
 
         // Optionally handle sync-specific operations here if needed.
         // For now, sync is unused.
@@ -473,6 +514,8 @@ static void __do_signal_stop(struct task_struct *current, struct pt_regs *f, int
             pr_warning("Failed to notify parent with signal: %d", signr);
         }
     }
+    // Wake up the parent if it is waiting for us.
+    wake_up(&current->parent->wait_chldexit);
 
     // The state is now TASK_UNINTERRUPTABLE
     wait_queue_entry_t *entry = sleep_on(&stopped_queue);
@@ -16,6 +16,7 @@
 #include "errno.h"
 #include "fs/attr.h"
 #include "fs/vfs.h"
+#include "hardware/cpuid.h"
 #include "hardware/timer.h"
 #include "kernel.h"
 #include "process/process.h"
@@ -36,6 +37,42 @@ typedef int (*SystemCall5)(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
 /// The list of function call.
 SystemCall sys_call_table[SYSCALL_NUMBER];
 
+/// MSR holding the code segment loaded by SYSENTER.
+#define MSR_SYSENTER_CS  0x174
+/// MSR holding the stack pointer loaded by SYSENTER.
+#define MSR_SYSENTER_ESP 0x175
+/// MSR holding the instruction pointer loaded by SYSENTER.
+#define MSR_SYSENTER_EIP 0x176
+/// CPUID.1:EDX bit telling that SYSENTER and SYSEXIT are supported.
+#define CPUID_EDX_SEP    (1U << 11U)
+
+/// @brief Entry point of the system calls issued with SYSENTER (sysenter.S).
+extern void sysenter_entry(void);
+
+/// @brief Writes a model-specific register.
+/// @param msr the register.
+/// @param value the value, the upper half is cleared.
+static inline void __wrmsr(uint32_t msr, uint32_t value)
+{
+    __asm__ __volatile__("wrmsr" : : "c"(msr), "a"(value), "d"(0));
+}
+
+/// @brief Checks if the CPU supports SYSENTER and SYSEXIT.
+/// @return 1 if supported, 0 otherwise.
+static inline int __sysenter_supported(void)
+{
+    pt_regs_t regs = {.eax = 1};
+    call_cpuid(&regs);
+    uint32_t family   = (regs.eax >> 8U) & 0xFU;
+    uint32_t model    = (regs.eax >> 4U) & 0xFU;
+    uint32_t stepping = regs.eax & 0xFU;
+    // The first Pentium Pro report the feature, but do not have it.
+    if ((family == 6) && (model < 3) && (stepping < 3)) {
+        return 0;
+    }
+    return (regs.edx & CPUID_EDX_SEP) != 0;
+}
+
 /// @brief A Not Implemented (NI) system-call.
 /// @return Always returns -ENOSYS.
 /// @details
@@ -70,6 +107,7 @@ void syscall_init(void)
     sys_call_table[__NR_alarm]          = (SystemCall)sys_alarm;
     sys_call_table[__NR_fstat]          = (SystemCall)sys_fstat;
     sys_call_table[__NR_nice]           = (SystemCall)sys_nice;
+    sys_call_table[__NR_sync]           = (SystemCall)sys_sync;
     sys_call_table[__NR_kill]           = (SystemCall)sys_kill;
     sys_call_table[__NR_mkdir]          = (SystemCall)sys_mkdir;
     sys_call_table[__NR_rmdir]          = (SystemCall)sys_rmdir;
@@ -92,8 +130,9 @@ void syscall_init(void)
     sys_call_table[__NR_symlink]        = (SystemCall)sys_symlink;
     sys_call_table[__NR_readlink]       = (SystemCall)sys_readlink;
     sys_call_table[__NR_reboot]         = (SystemCall)sys_reboot;
-    sys_call_table[__NR_mmap]           = (SystemCall)sys_mmap;
+    sys_call_table[__NR_mmap]           = (SystemCall)sys_old_mmap;
     sys_call_table[__NR_munmap]         = (SystemCall)sys_munmap;
+    sys_call_table[__NR_msync]          = (SystemCall)sys_msync;
     sys_call_table[__NR_syslog]         = (SystemCall)sys_syslog;
     sys_call_table[__NR_fchmod]         = (SystemCall)sys_fchmod;
     sys_call_table[__NR_fchown]         = (SystemCall)sys_fchown;
@@ -123,19 +162,33 @@ void syscall_init(void)
     sys_call_table[__NR_shmctl]         = (SystemCall)sys_shmctl;
     sys_call_table[__NR_shmdt]          = (SystemCall)sys_shmdt;
     sys_call_table[__NR_shmget]         = (SystemCall)sys_shmget;
+    sys_call_table[__NR_syncfs]         = (SystemCall)sys_syncfs;
 
     isr_install_handler(SYSTEM_CALL, &syscall_handler, "syscall_handler");
+
+    // Set up the fast entry point, `int 0x80` keeps working in any case. The
+    // user segments must follow the kernel ones in the GDT, as SYSEXIT takes
+    // them at fixed offsets from the kernel code segment.
+    if (__sysenter_supported()) {
+        __wrmsr(MSR_SYSENTER_CS, 0x08);
+        __wrmsr(MSR_SYSENTER_ESP, initial_esp);
+        __wrmsr(MSR_SYSENTER_EIP, (uint32_t)sysenter_entry);
+        pr_debug("System calls can be issued with SYSENTER.\n");
+    }
 }
 
 void syscall_handler(pt_regs_t *f)
 {
-    // Save current process fpu state.
+    // Make the FPU trap, its registers are saved only if the kernel uses it.
     switch_fpu();
 
     // The result of the system call.
     if (f->eax >= SYSCALL_NUMBER) {
         f->eax = -ENOSYS;
     } else {
+        // Keep the number, in case the system call must be issued again.
+        uint32_t number = f->eax;
+
         // Retrieve the system call function from the system call table.
         SystemCall5 fun = (SystemCall5)sys_call_table[f->eax];
 
@@ -157,11 +210,22 @@ void syscall_handler(pt_regs_t *f)
 
         // Invoke the system call with the prepared arguments and store the return value in the EAX register.
         f->eax = fun(args[0], args[1], args[2], args[3], args[4]);
+
+        // The process went to sleep, it issues the system call again once it
+        // is woken up. Both `int 0x80` and SYSENTER are two bytes long, and
+        // the process must return with iret to get back all the arguments.
+        if (f->eax == (uint32_t)-ERESTART) {
+            f->eax      = number;
+            f->eip      = f->eip - 2;
+            f->err_code = 0;
+        }
     }
 
-    // Schedule next process.
-    scheduler_run(f);
+    // Schedule next process, only if something changed since the last time.
+    if (scheduler_need_resched()) {
+        scheduler_run(f);
+    }
 
-    // Restore fpu state.
+    // Let the owner of the FPU registers use them without trapping.
     unswitch_fpu();
 }
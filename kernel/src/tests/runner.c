@@ -41,6 +41,7 @@ extern void test_buddy(void);
 extern void test_page(void);
 extern void test_memory_adversarial(void);
 extern void test_dma(void);
+extern void test_string(void);
 
 /// @brief Test registry - one entry per subsystem.
 static const test_entry_t test_functions[] = {
@@ -57,6 +58,7 @@ static const test_entry_t test_functions[] = {
     {test_page,                "Page Structure Subsystem"     },
     {test_dma,                 "DMA Zone/Allocation Tests"    },
     {test_memory_adversarial,  "Memory Adversarial/Error Tests"},
+    {test_string,              "Memory/String Routines"       },
 };
 
 static const int num_tests = sizeof(test_functions) / sizeof(test_entry_t);
@@ -9,6 +9,7 @@
 #define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
 #include "io/debug.h"                   // Include debugging functions.
 
+#include "io/tsc.h"
 #include "mem/alloc/buddy_system.h"
 #include "mem/alloc/slab.h"
 #include "mem/alloc/zone_allocator.h"
@@ -397,6 +398,78 @@ TEST(memory_buddy_coalescing_at_boundaries)
     TEST_SECTION_END();
 }
 
+/// @brief Test the caches of free blocks in front of the free lists.
+TEST(memory_buddy_cached_blocks)
+{
+    TEST_SECTION_START("Buddy cached blocks");
+
+    unsigned long free_before = get_zone_free_space(GFP_KERNEL);
+
+    // The most recently freed block is handed out first.
+    page_t *page = alloc_pages(GFP_KERNEL, 0);
+    ASSERT_MSG(page != NULL, "order 0 allocation must succeed");
+    ASSERT_MSG(get_zone_free_space(GFP_KERNEL) == free_before - PAGE_SIZE, "exactly one page must be taken");
+    ASSERT_MSG(free_pages(page) == 0, "free must succeed");
+    ASSERT_MSG(alloc_pages(GFP_KERNEL, 0) == page, "the hot page must be reused");
+    ASSERT_MSG(free_pages(page) == 0, "free must succeed");
+
+    // Cached blocks still count as free, and the caches stay bounded.
+    page_t *pages[128];
+    for (unsigned int i = 0; i < count_of(pages); ++i) {
+        pages[i] = alloc_pages(GFP_KERNEL, i % 2);
+        ASSERT_MSG(pages[i] != NULL, "allocation must succeed");
+    }
+    for (unsigned int i = 0; i < count_of(pages); ++i) {
+        ASSERT_MSG(free_pages(pages[i]) == 0, "free must succeed");
+    }
+    ASSERT_MSG(get_zone_free_space(GFP_KERNEL) == free_before, "cached blocks must count as free");
+    ASSERT_MSG(get_zone_cached_space(GFP_KERNEL) <= 2 * 64 * PAGE_SIZE, "caches must be drained above the watermark");
+
+    TEST_SECTION_END();
+}
+
+/// @brief Compares order-0/1 allocation throughput with and without caches.
+TEST(memory_buddy_cache_benchmark)
+{
+    TEST_SECTION_START("Buddy cache throughput");
+
+    bb_instance_t *buddy = &memory.page_data->node_zones[ZONE_NORMAL].buddy_system;
+    const unsigned int rounds = 256;
+    page_t *pages[32];
+    bb_page_t *blocks[32];
+
+    for (unsigned int order = 0; order < BB_CACHE_ORDERS; ++order) {
+        unsigned long long start = rdtsc();
+        for (unsigned int r = 0; r < rounds; ++r) {
+            for (unsigned int i = 0; i < count_of(pages); ++i) {
+                pages[i] = alloc_pages(GFP_KERNEL, order);
+            }
+            for (unsigned int i = 0; i < count_of(pages); ++i) {
+                free_pages(pages[i]);
+            }
+        }
+        unsigned long long cached = rdtsc() - start;
+
+        start = rdtsc();
+        for (unsigned int r = 0; r < rounds; ++r) {
+            for (unsigned int i = 0; i < count_of(blocks); ++i) {
+                blocks[i] = bb_alloc_pages(buddy, order);
+            }
+            for (unsigned int i = 0; i < count_of(blocks); ++i) {
+                bb_free_pages(buddy, blocks[i]);
+            }
+        }
+        unsigned long long direct = rdtsc() - start;
+
+        unsigned int operations = rounds * count_of(pages);
+        pr_notice(
+            "    order %u: %u cycles per alloc/free with caches, %u on the free lists\n", order,
+            tsc_div(cached, operations), tsc_div(direct, operations));
+    }
+
+    TEST_SECTION_END();
+}
+
 /// @brief Main test function for buddy system.
 void test_buddy(void)
 {
@@ -413,4 +486,6 @@ void test_buddy(void)
     test_memory_buddy_cross_zone_accounting();
     test_memory_buddy_interleaved_alloc_free();
     test_memory_buddy_coalescing_at_boundaries();
+    test_memory_buddy_cached_blocks();
+    test_memory_buddy_cache_benchmark();
 }
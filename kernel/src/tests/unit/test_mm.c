@@ -113,10 +113,10 @@ TEST(memory_mm_clone)
     TEST_SECTION_END();
 }
 
-/// @brief Test cloned mm gets separate physical pages for present mappings.
-TEST(memory_mm_clone_separate_pages)
+/// @brief Test cloned mm shares physical pages as copy-on-write.
+TEST(memory_mm_clone_shares_pages)
 {
-    TEST_SECTION_START("MM clone separate pages");
+    TEST_SECTION_START("MM clone shares pages");
 
     mm_struct_t *mm = mm_create_blank(PAGE_SIZE * 2);
     ASSERT_MSG(mm != NULL, "mm_create_blank must succeed");
@@ -139,9 +139,11 @@ TEST(memory_mm_clone_separate_pages)
         page_t *page_b = mem_virtual_to_page(clone->pgd, (uint32_t)vm_start, &size_b);
 
         ASSERT_MSG(page_a != NULL && page_b != NULL, "both mappings must be present");
-        ASSERT_MSG(page_a != page_b, "clone must not share physical pages for present mapping");
+        ASSERT_MSG(page_a == page_b, "clone must share physical pages for present mapping");
+        ASSERT_MSG(page_count(page_a) == 2, "shared page must be referenced by both mappings");
 
         ASSERT_MSG(mm_destroy(clone) == 0, "mm_destroy(clone) must succeed");
+        ASSERT_MSG(page_count(page_a) == 1, "destroying the clone must drop its reference");
     }
 
     ASSERT_MSG(mm_destroy(mm) == 0, "mm_destroy(mm) must succeed");
@@ -187,7 +189,6 @@ TEST(memory_mm_clone_copies_content)
         size_t size_b  = PAGE_SIZE;
         page_t *page_b = mem_virtual_to_page(clone->pgd, (uint32_t)vm_start, &size_b);
         ASSERT_MSG(page_b != NULL, "clone mapping must be present");
-        ASSERT_MSG(page_a != page_b, "clone must not share physical pages");
 
         uint32_t lowmem_b = get_virtual_address_from_page(page_b);
         ASSERT_MSG(lowmem_b != 0, "get_virtual_address_from_page must succeed");
@@ -513,13 +514,136 @@ TEST(memory_mm_stack_growth_guard_page)
     TEST_SECTION_END();
 }
 
+/// @brief Test that demand-zero areas are accounted but not backed by frames.
+TEST(memory_mm_demand_zero_area)
+{
+    TEST_SECTION_START("Demand-zero VMA accounting");
+
+    mm_struct_t *mm = mm_create_blank(PAGE_SIZE * 256);
+    ASSERT_MSG(mm != NULL, "mm_create_blank must succeed");
+    ASSERT_MSG(mm->total_vm == 256, "total_vm must count the stack pages exactly");
+    ASSERT_MSG(mm_get_rss(mm) == 0, "the stack must not be backed before its first access");
+
+    unsigned long free_user_before = get_zone_free_space(GFP_HIGHUSER);
+
+    // A large demand-zero area takes no frame.
+    uint32_t lazy_vaddr   = 0x20000000;
+    vm_area_struct_t *lazy = vm_area_create(
+        mm, lazy_vaddr, PAGE_SIZE * 1024, MM_PRESENT | MM_RW | MM_USER | MM_COW, GFP_HIGHUSER);
+    ASSERT_MSG(lazy != NULL, "demand-zero VMA creation must succeed");
+    ASSERT_MSG(get_zone_free_space(GFP_HIGHUSER) == free_user_before, "demand-zero VMA must take no frame");
+    ASSERT_MSG(mm_get_rss(mm) == 0, "demand-zero VMA must not be resident");
+
+    // A populated area is not rounded up to a power of two.
+    uint32_t eager_vaddr   = 0x30000000;
+    vm_area_struct_t *eager = vm_area_create(mm, eager_vaddr, PAGE_SIZE * 3, MM_PRESENT | MM_RW | MM_USER, GFP_HIGHUSER);
+    ASSERT_MSG(eager != NULL, "populated VMA creation must succeed");
+    ASSERT_MSG(mm->total_vm == 256 + 1024 + 3, "total_vm must count the mapped pages exactly");
+    ASSERT_MSG(mm_get_rss(mm) == 3, "only the populated pages must be resident");
+
+    ASSERT_MSG(vm_area_destroy(mm, eager) == 0, "destroy populated VMA");
+    ASSERT_MSG(vm_area_destroy(mm, lazy) == 0, "destroy demand-zero VMA");
+    ASSERT_MSG(mm->total_vm == 256, "total_vm must drop when the areas are destroyed");
+    ASSERT_MSG(get_zone_free_space(GFP_HIGHUSER) == free_user_before, "User zone free pages must be restored");
+
+    ASSERT_MSG(mm_destroy(mm) == 0, "mm_destroy must succeed");
+
+    TEST_SECTION_END();
+}
+
+/// @brief Finds the highest gap between two areas, walking the sorted list.
+/// @param mm the memory descriptor.
+/// @param length the size of the gap.
+/// @return the expected start of a new area of the given size, 0 if none.
+static uint32_t mm_test_highest_gap(mm_struct_t *mm, uint32_t length)
+{
+    uint32_t result = 0;
+    list_for_each_decl (it, &mm->mmap_list) {
+        vm_area_struct_t *area = list_entry(it, vm_area_struct_t, vm_list);
+        if (area->vm_list.prev != &mm->mmap_list) {
+            vm_area_struct_t *prev = list_entry(area->vm_list.prev, vm_area_struct_t, vm_list);
+            if (area->vm_start - prev->vm_end >= length) {
+                result = area->vm_start - length;
+            }
+        }
+    }
+    return result;
+}
+
+/// @brief Test the index of the areas against a walk of the sorted list.
+TEST(memory_mm_vma_index)
+{
+    TEST_SECTION_START("VMA index");
+
+    mm_struct_t *mm = mm_create_blank(PAGE_SIZE * 4);
+    ASSERT_MSG(mm != NULL, "mm_create_blank must succeed");
+
+    // Create the areas right below the stack, in a scrambled order, each one
+    // followed by a gap of varying size, so that the stack is the last area.
+    enum { AREAS = 64 };
+    static vm_area_struct_t *areas[AREAS];
+    static uint32_t starts[AREAS];
+    uint32_t span = 0;
+    for (unsigned i = 0; i < AREAS; ++i) {
+        span += PAGE_SIZE * (2 + (i % 7));
+    }
+    uint32_t base = mm->start_stack - span;
+    for (unsigned i = 0; i < AREAS; ++i) {
+        starts[i] = base;
+        base += PAGE_SIZE * (2 + (i % 7));
+    }
+    for (unsigned k = 0; k < AREAS; ++k) {
+        unsigned i = (k * 37U) % AREAS;
+        areas[i]   = vm_area_create(mm, starts[i], PAGE_SIZE, MM_PRESENT | MM_RW | MM_USER | MM_COW, GFP_HIGHUSER);
+        ASSERT_MSG(areas[i] != NULL, "vm_area_create must succeed");
+    }
+
+    // The list must be sorted.
+    uint32_t last_end = 0;
+    list_for_each_decl (it, &mm->mmap_list) {
+        vm_area_struct_t *area = list_entry(it, vm_area_struct_t, vm_list);
+        ASSERT_MSG(area->vm_start >= last_end, "the areas must be sorted by address");
+        last_end = area->vm_end;
+    }
+
+    for (unsigned i = 0; i < AREAS; ++i) {
+        ASSERT_MSG(vm_area_lookup(mm, starts[i] + 16) == areas[i], "vm_area_lookup must find the containing area");
+        ASSERT_MSG(vm_area_lookup(mm, starts[i] + PAGE_SIZE) == NULL, "vm_area_lookup must miss the gaps");
+        ASSERT_MSG(vm_area_find(mm, starts[i]) == areas[i], "vm_area_find must find the area by its start");
+        ASSERT_MSG(vm_area_is_valid(mm, starts[i], starts[i] + PAGE_SIZE) == 0, "an identical range must overlap");
+        ASSERT_MSG(
+            vm_area_is_valid(mm, starts[i] - PAGE_SIZE, starts[i] + (2 * PAGE_SIZE)) == 0,
+            "a larger range must overlap");
+        ASSERT_MSG(
+            vm_area_is_valid(mm, starts[i] + PAGE_SIZE, starts[i] + (2 * PAGE_SIZE)) == 1,
+            "the page after an area must be free");
+    }
+
+    // Remove some areas, and compare the free-area search with a linear walk.
+    for (unsigned i = 0; i < AREAS; i += 3) {
+        ASSERT_MSG(vm_area_destroy(mm, areas[i]) == 0, "vm_area_destroy must succeed");
+        areas[i] = NULL;
+    }
+    for (uint32_t pages = 1; pages < 32; ++pages) {
+        uintptr_t vm_start = 0;
+        uint32_t expected  = mm_test_highest_gap(mm, pages * PAGE_SIZE);
+        int ret            = vm_area_search_free_area(mm, pages * PAGE_SIZE, &vm_start);
+        ASSERT_MSG(ret == (expected ? 0 : 1), "vm_area_search_free_area must find a gap if there is one");
+        ASSERT_MSG(!expected || (vm_start == expected), "vm_area_search_free_area must pick the highest gap");
+    }
+
+    ASSERT_MSG(mm_destroy(mm) == 0, "mm_destroy must succeed");
+
+    TEST_SECTION_END();
+}
+
 /// @brief Main test function for mm subsystem.
 void test_mm(void)
 {
     test_memory_mm_vm_area_lifecycle();
     test_memory_mm_create_blank_sanity();
     test_memory_mm_clone();
-    test_memory_mm_clone_separate_pages();
+    test_memory_mm_clone_shares_pages();
     test_memory_mm_clone_copies_content();
     test_memory_mm_lifecycle_stress();
     test_memory_mm_clone_copies_multi_page();
@@ -529,4 +653,6 @@ void test_mm(void)
     test_memory_mm_vma_permissions_propagation();
     test_memory_mm_vma_removal_validates_ptes();
     test_memory_mm_stack_growth_guard_page();
+    test_memory_mm_demand_zero_area();
+    test_memory_mm_vma_index();
 }
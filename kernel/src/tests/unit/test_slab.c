@@ -12,6 +12,7 @@
 #include "mem/alloc/slab.h"
 #include "mem/alloc/zone_allocator.h"
 #include "mem/gfp.h"
+#include "mem/mm/page.h"
 #include "mem/paging.h"
 #include "string.h"
 #include "tests/test.h"
@@ -433,6 +434,108 @@ TEST(memory_slab_cache_destruction_safety)
     TEST_SECTION_END();
 }
 
+/// @brief Test the magazine of recently freed objects in front of the slabs.
+TEST(memory_slab_magazine)
+{
+    TEST_SECTION_START("Slab magazine");
+
+    kmem_cache_t *cache = kmem_cache_create("test_obj_mag", 48, alignof(uint32_t), GFP_KERNEL, NULL, NULL);
+    ASSERT_MSG(cache != NULL, "kmem_cache_create must succeed");
+
+    // The first allocation misses, and fills the magazine from the slabs.
+    void *obj = kmem_cache_alloc(cache, GFP_KERNEL);
+    ASSERT_MSG(obj != NULL, "kmem_cache_alloc must succeed");
+    ASSERT_MSG(cache->alloc_misses == 1, "the first allocation must miss");
+    ASSERT_MSG(cache->magazine_count > 0, "the magazine must be filled on a miss");
+
+    // A freed object is handed out again by the next allocation.
+    ASSERT_MSG(kmem_cache_free(obj) == 0, "kmem_cache_free must succeed");
+    void *again = kmem_cache_alloc(cache, GFP_KERNEL);
+    ASSERT_MSG(again == obj, "the last freed object must be reused first");
+    ASSERT_MSG(cache->alloc_hits == 1, "the reuse must hit the magazine");
+    ASSERT_MSG(kmem_cache_free(again) == 0, "kmem_cache_free must succeed");
+
+    // Freeing more objects than the magazine holds drains it into the slabs.
+    void *objs[2 * KMEM_MAGAZINE_SIZE];
+    for (unsigned int i = 0; i < count_of(objs); ++i) {
+        objs[i] = kmem_cache_alloc(cache, GFP_KERNEL);
+        ASSERT_MSG(objs[i] != NULL, "kmem_cache_alloc must succeed");
+    }
+    for (unsigned int i = 0; i < count_of(objs); ++i) {
+        ASSERT_MSG(kmem_cache_free(objs[i]) == 0, "kmem_cache_free must succeed");
+    }
+    ASSERT_MSG(cache->free_misses > 0, "a full magazine must be drained");
+    ASSERT_MSG(cache->magazine_count <= KMEM_MAGAZINE_SIZE, "the magazine must not overflow");
+    ASSERT_MSG(cache->free_num == cache->total_num, "objects in the magazine must count as free");
+
+    ASSERT_MSG(kmem_cache_destroy(cache) == 0, "kmem_cache_destroy must succeed");
+
+    TEST_SECTION_END();
+}
+
+/// @brief Returns the cache an object was allocated from.
+/// @param ptr the object.
+/// @return the cache.
+static kmem_cache_t *slab_test_cache_of(void *ptr)
+{
+    page_t *page = get_page_from_virtual_address((uint32_t)ptr);
+    if (is_lowmem_page_struct(page->container.slab_main_page)) {
+        page = page->container.slab_main_page;
+    }
+    return page->container.slab_cache;
+}
+
+/// @brief Test that kmalloc picks the smallest size class fitting the request.
+TEST(memory_kmalloc_size_classes)
+{
+    TEST_SECTION_START("kmalloc size classes");
+
+    static const unsigned int requests[] = { 1, 8, 9, 24, 25, 65, 129, 200, 700, 1025, 2048 };
+    static const unsigned int expected[] = { 8, 8, 16, 24, 32, 96, 192, 256, 768, 1536, 2048 };
+
+    for (unsigned int i = 0; i < count_of(requests); ++i) {
+        void *ptr = kmalloc(requests[i]);
+        ASSERT_MSG(ptr != NULL, "kmalloc must succeed");
+        kmem_cache_t *cache = slab_test_cache_of(ptr);
+        ASSERT_MSG(cache != NULL, "small requests must come from a cache");
+        ASSERT_MSG(cache->aligned_object_size == expected[i], "the smallest fitting class must be used");
+        kfree(ptr);
+    }
+
+    TEST_SECTION_END();
+}
+
+/// @brief Test that large kmalloc requests use exactly the pages they need.
+TEST(memory_kmalloc_large_exact)
+{
+    TEST_SECTION_START("kmalloc large exact pages");
+
+    kmalloc_stats_t stats_before, stats;
+    kmalloc_get_stats(&stats_before);
+    unsigned long free_before = get_zone_free_space(GFP_KERNEL);
+
+    // Five pages, which used to take a block of eight.
+    unsigned int size = 4 * PAGE_SIZE + 100;
+    uint8_t *ptr      = kmalloc(size);
+    ASSERT_MSG(ptr != NULL, "kmalloc must succeed");
+    memset(ptr, 0x5A, size);
+    ASSERT_MSG(ptr[size - 1] == 0x5A, "the whole block must be usable");
+
+    ASSERT_MSG(get_zone_free_space(GFP_KERNEL) == free_before - 5 * PAGE_SIZE, "only the needed pages must be taken");
+    kmalloc_get_stats(&stats);
+    ASSERT_MSG(stats.large_objects == stats_before.large_objects + 1, "the large object must be tracked");
+    ASSERT_MSG(stats.large_pages == stats_before.large_pages + 5, "its pages must be tracked");
+    ASSERT_MSG(stats.large_wasted == stats_before.large_wasted + PAGE_SIZE - 100, "its waste must be tracked");
+
+    kfree(ptr);
+    ASSERT_MSG(get_zone_free_space(GFP_KERNEL) == free_before, "all the pages must be given back");
+    kmalloc_get_stats(&stats);
+    ASSERT_MSG(stats.large_objects == stats_before.large_objects, "the large object must be untracked");
+    ASSERT_MSG(stats.large_pages == stats_before.large_pages, "its pages must be untracked");
+
+    TEST_SECTION_END();
+}
+
 /// @brief Main test function for slab subsystem.
 void test_slab(void)
 {
@@ -451,4 +554,7 @@ void test_slab(void)
     test_memory_slab_object_reuse();
     test_memory_slab_parallel_caches();
     test_memory_slab_cache_destruction_safety();
+    test_memory_slab_magazine();
+    test_memory_kmalloc_size_classes();
+    test_memory_kmalloc_large_exact();
 }
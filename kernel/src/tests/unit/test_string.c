@@ -0,0 +1,254 @@
+/// @file test_string.c
+/// @brief Memory and string routines tests, and throughput benchmark.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"          // Include kernel log levels.
+#define __DEBUG_HEADER__ "[TUNIT ]"     ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                   // Include debugging functions.
+
+#include "io/tsc.h"
+#include "mem/alloc/zone_allocator.h"
+#include "mem/gfp.h"
+#include "mem/mm/page.h"
+#include "mem/paging.h"
+#include "string.h"
+#include "tests/test.h"
+#include "tests/test_utils.h"
+
+/// Order of the buffers used by the tests (64 KB).
+#define STRING_TEST_ORDER 4
+/// Size of the buffers used by the tests.
+#define STRING_TEST_SIZE  (PAGE_SIZE << STRING_TEST_ORDER)
+
+/// @brief Byte-by-byte copy, used as reference.
+/// @param dst the destination.
+/// @param src the source.
+/// @param num the number of bytes.
+static void __byte_memcpy(void *dst, const void *src, size_t num)
+{
+    unsigned char volatile *d       = (unsigned char volatile *)dst;
+    const unsigned char volatile *s = (const unsigned char volatile *)src;
+    while (num--) {
+        *d++ = *s++;
+    }
+}
+
+/// @brief Byte-by-byte fill, used as reference.
+/// @param dst the destination.
+/// @param value the value.
+/// @param num the number of bytes.
+static void __byte_memset(void *dst, int value, size_t num)
+{
+    unsigned char volatile *d = (unsigned char volatile *)dst;
+    while (num--) {
+        *d++ = (unsigned char)value;
+    }
+}
+
+/// @brief Fills the buffer with a pattern depending on the position.
+/// @param buffer the buffer.
+/// @param size the size of the buffer.
+static void __fill_pattern(unsigned char *buffer, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        buffer[i] = (unsigned char)((i * 7U) + 3U);
+    }
+}
+
+/// @brief Allocates a test buffer.
+/// @return the buffer.
+static unsigned char *__alloc_buffer(void)
+{
+    page_t *page = alloc_pages(GFP_KERNEL, STRING_TEST_ORDER);
+    ASSERT_MSG(page != NULL, "alloc_pages must succeed");
+    return (unsigned char *)get_virtual_address_from_page(page);
+}
+
+/// @brief Frees a test buffer.
+/// @param buffer the buffer.
+static void __free_buffer(unsigned char *buffer)
+{
+    ASSERT_MSG(free_pages(get_page_from_virtual_address((uint32_t)buffer)) == 0, "free_pages must succeed");
+}
+
+/// @brief Test memcpy with every alignment of source, destination and size.
+TEST(string_memcpy_alignments)
+{
+    TEST_SECTION_START("memcpy alignments");
+
+    unsigned char *src = __alloc_buffer();
+    unsigned char *dst = __alloc_buffer();
+    __fill_pattern(src, STRING_TEST_SIZE);
+
+    for (unsigned soff = 0; soff < 8; ++soff) {
+        for (unsigned doff = 0; doff < 8; ++doff) {
+            for (unsigned size = 0; size < 80; size += 3) {
+                memset(dst, 0xEE, 128);
+                ASSERT_MSG(memcpy(dst + doff, src + soff, size) == dst + doff, "memcpy must return dst");
+                ASSERT_MSG(memcmp(dst + doff, src + soff, size) == 0, "memcpy must copy every byte");
+                ASSERT_MSG(dst[doff + size] == 0xEE, "memcpy must not write past the end");
+                if (doff) {
+                    ASSERT_MSG(dst[doff - 1] == 0xEE, "memcpy must not write before the start");
+                }
+            }
+        }
+    }
+
+    __free_buffer(src);
+    __free_buffer(dst);
+
+    TEST_SECTION_END();
+}
+
+/// @brief Test memset with every alignment and with large sizes.
+TEST(string_memset_alignments)
+{
+    TEST_SECTION_START("memset alignments");
+
+    unsigned char *dst = __alloc_buffer();
+
+    for (unsigned doff = 0; doff < 8; ++doff) {
+        for (unsigned size = 0; size < 4096; size = (size * 2) + 1) {
+            __byte_memset(dst, 0x11, size + 16);
+            ASSERT_MSG(memset(dst + doff, 0xA5, size) == dst + doff, "memset must return ptr");
+            for (unsigned i = 0; i < size + 16; ++i) {
+                unsigned char expected = ((i >= doff) && (i < doff + size)) ? 0xA5 : 0x11;
+                ASSERT_MSG(dst[i] == expected, "memset must fill exactly the given range");
+            }
+        }
+    }
+
+    __free_buffer(dst);
+
+    TEST_SECTION_END();
+}
+
+/// @brief Test memmove with overlapping ranges in both directions.
+TEST(string_memmove_overlap)
+{
+    TEST_SECTION_START("memmove overlap");
+
+    unsigned char *buffer = __alloc_buffer();
+    unsigned char *expect = __alloc_buffer();
+
+    for (unsigned shift = 1; shift < 9; ++shift) {
+        for (unsigned size = 1; size < 300; size += 37) {
+            // Move forward (towards higher addresses).
+            __fill_pattern(buffer, 512);
+            __fill_pattern(expect, 512);
+            for (unsigned i = size; i > 0; --i) {
+                expect[64 + shift + i - 1] = expect[64 + i - 1];
+            }
+            memmove(buffer + 64 + shift, buffer + 64, size);
+            ASSERT_MSG(memcmp(buffer, expect, 512) == 0, "memmove forward overlap must be correct");
+
+            // Move backward (towards lower addresses).
+            __fill_pattern(buffer, 512);
+            __fill_pattern(expect, 512);
+            for (unsigned i = 0; i < size; ++i) {
+                expect[64 + i] = expect[64 + shift + i];
+            }
+            memmove(buffer + 64, buffer + 64 + shift, size);
+            ASSERT_MSG(memcmp(buffer, expect, 512) == 0, "memmove backward overlap must be correct");
+        }
+    }
+
+    __free_buffer(buffer);
+    __free_buffer(expect);
+
+    TEST_SECTION_END();
+}
+
+/// @brief Test memcmp ordering and strlen at every alignment.
+TEST(string_memcmp_strlen)
+{
+    TEST_SECTION_START("memcmp and strlen");
+
+    unsigned char *a = __alloc_buffer();
+    unsigned char *b = __alloc_buffer();
+    __fill_pattern(a, 256);
+    __fill_pattern(b, 256);
+
+    ASSERT_MSG(memcmp(a, b, 256) == 0, "memcmp of equal buffers must be zero");
+    for (unsigned i = 0; i < 64; ++i) {
+        b[i] = a[i] + 1;
+        ASSERT_MSG(memcmp(a, b, 256) < 0, "memcmp must find the first smaller byte");
+        ASSERT_MSG(memcmp(b, a, 256) > 0, "memcmp must find the first greater byte");
+        ASSERT_MSG(memcmp(a, b, i) == 0, "memcmp must ignore bytes past the size");
+        b[i] = a[i];
+    }
+
+    for (unsigned off = 0; off < 8; ++off) {
+        for (unsigned len = 0; len < 40; ++len) {
+            memset(a, 'x', 64);
+            a[off + len] = '\0';
+            ASSERT_MSG(strlen((const char *)a + off) == len, "strlen must find the terminator");
+        }
+    }
+
+    __free_buffer(a);
+    __free_buffer(b);
+
+    TEST_SECTION_END();
+}
+
+/// @brief Compares the throughput of memcpy and memset with byte loops.
+TEST(string_benchmark)
+{
+    TEST_SECTION_START("memcpy/memset throughput");
+
+    static const size_t sizes[] = { 64, 512, 4096, STRING_TEST_SIZE };
+
+    unsigned char *src = __alloc_buffer();
+    unsigned char *dst = __alloc_buffer();
+    __fill_pattern(src, STRING_TEST_SIZE);
+
+    pr_notice("    Size  | memcpy  | bytes   | memset  | bytes    (cycles per 100 bytes)\n");
+    for (unsigned i = 0; i < count_of(sizes); ++i) {
+        size_t size                 = sizes[i];
+        unsigned rounds             = (4U * STRING_TEST_SIZE) / size;
+        unsigned long long start    = rdtsc();
+        for (unsigned r = 0; r < rounds; ++r) {
+            memcpy(dst, src, size);
+        }
+        unsigned long long copy     = rdtsc() - start;
+        start                       = rdtsc();
+        for (unsigned r = 0; r < rounds; ++r) {
+            __byte_memcpy(dst, src, size);
+        }
+        unsigned long long copy_ref = rdtsc() - start;
+        start                       = rdtsc();
+        for (unsigned r = 0; r < rounds; ++r) {
+            memset(dst, r, size);
+        }
+        unsigned long long fill     = rdtsc() - start;
+        start                       = rdtsc();
+        for (unsigned r = 0; r < rounds; ++r) {
+            __byte_memset(dst, r, size);
+        }
+        unsigned long long fill_ref = rdtsc() - start;
+
+        uint32_t bytes = rounds * size / 100U;
+        pr_notice(
+            "    %5u | %7u | %7u | %7u | %7u\n", size, tsc_div(copy, bytes), tsc_div(copy_ref, bytes),
+            tsc_div(fill, bytes), tsc_div(fill_ref, bytes));
+    }
+
+    __free_buffer(src);
+    __free_buffer(dst);
+
+    TEST_SECTION_END();
+}
+
+/// @brief Main test function for the memory and string routines.
+void test_string(void)
+{
+    test_string_memcpy_alignments();
+    test_string_memset_alignments();
+    test_string_memmove_overlap();
+    test_string_memcmp_strlen();
+    test_string_benchmark();
+}
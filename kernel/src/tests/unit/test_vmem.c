@@ -14,6 +14,7 @@
 #include "mem/mm/page.h"
 #include "mem/mm/vmem.h"
 #include "mem/paging.h"
+#include "string.h"
 #include "tests/test.h"
 #include "tests/test_utils.h"
 
@@ -229,6 +230,59 @@ TEST(memory_vmem_stress)
     TEST_SECTION_END();
 }
 
+/// @brief Test the kmap windows, for both lowmem and highmem frames.
+TEST(memory_vmem_kmap_windows)
+{
+    TEST_SECTION_START("VMEM kmap windows");
+
+    // Lowmem frames are reached through the direct map.
+    page_t *low = alloc_pages(GFP_KERNEL, 0);
+    ASSERT_MSG(low != NULL, "alloc_pages must return a valid page");
+    void *addr = vmem_kmap(low, KMAP_DST);
+    ASSERT_MSG((uint32_t)addr == get_virtual_address_from_page(low), "Lowmem frames must use the direct map");
+    vmem_kunmap(addr, KMAP_DST);
+    ASSERT_MSG(free_pages(low) == 0, "free_pages must succeed");
+
+    // Highmem frames go through the windows.
+    if (get_zone_total_space(GFP_HIGHUSER) > 0) {
+        page_t *first  = alloc_pages(GFP_HIGHUSER, 0);
+        page_t *second = alloc_pages(GFP_HIGHUSER, 0);
+        ASSERT_MSG(first && second, "alloc_pages must return valid highmem pages");
+
+        // Fill the two frames through the same window, one after the other.
+        uint8_t *dst = (uint8_t *)vmem_kmap(first, KMAP_DST);
+        for (uint32_t i = 0; i < PAGE_SIZE; ++i) {
+            dst[i] = (uint8_t)(0x5A ^ i);
+        }
+        vmem_kunmap(dst, KMAP_DST);
+        dst = (uint8_t *)vmem_kmap(second, KMAP_DST);
+        memset(dst, 0, PAGE_SIZE);
+        vmem_kunmap(dst, KMAP_DST);
+
+        // Copy the first frame into the second, using two windows at once.
+        uint8_t *src = (uint8_t *)vmem_kmap(first, KMAP_SRC);
+        dst          = (uint8_t *)vmem_kmap(second, KMAP_DST);
+        ASSERT_MSG(src != dst, "Different slots must use different windows");
+        ASSERT_MSG(dst[0] == 0 && src[0] == 0x5A, "The window must show the frame placed last");
+        memcpy(dst, src, PAGE_SIZE);
+        vmem_kunmap(dst, KMAP_DST);
+        vmem_kunmap(src, KMAP_SRC);
+
+        // Check the copy through a regular mapping.
+        uint32_t vaddr = vmem_map_physical_pages(second, 1);
+        ASSERT_MSG(vaddr != 0, "vmem_map_physical_pages must return a valid address");
+        for (uint32_t i = 0; i < PAGE_SIZE; ++i) {
+            ASSERT_MSG(((uint8_t *)vaddr)[i] == (uint8_t)(0x5A ^ i), "The copy must reach the second frame");
+        }
+        ASSERT_MSG(vmem_unmap_virtual_address(vaddr) == 0, "vmem_unmap_virtual_address must succeed");
+
+        ASSERT_MSG(free_pages(first) == 0, "free_pages must succeed");
+        ASSERT_MSG(free_pages(second) == 0, "free_pages must succeed");
+    }
+
+    TEST_SECTION_END();
+}
+
 /// @brief Main test function for vmem subsystem.
 void test_vmem(void)
 {
@@ -241,4 +295,5 @@ void test_vmem(void)
     test_memory_vmem_beyond_valid_range();
     test_memory_vmem_unmap_idempotence();
     test_memory_vmem_stress();
+    test_memory_vmem_kmap_windows();
 }
@@ -485,6 +485,74 @@ TEST(memory_zone_gfp_flags)
     TEST_SECTION_END();
 }
 
+/// @brief Checks that the page contains only zeros.
+/// @param page the page.
+/// @return 1 if the page is clear, 0 otherwise.
+static int __page_is_clear(page_t *page)
+{
+    const uint32_t *ptr = (const uint32_t *)get_virtual_address_from_page(page);
+    for (uint32_t i = 0; i < PAGE_SIZE / sizeof(uint32_t); ++i) {
+        if (ptr[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/// @brief Test zeroed allocations, both cleared on the spot and from the pool.
+TEST(memory_zone_zero_pool)
+{
+    TEST_SECTION_START("Zero pool");
+
+    const zero_pool_t *pool   = get_zone_zero_pool(GFP_KERNEL);
+    ASSERT_MSG(pool != NULL, "The kernel zone must have a zero pool");
+    unsigned long free_before = get_zone_free_space(GFP_KERNEL);
+
+    // Leave a dirty page on top of the free pages.
+    page_t *page = alloc_pages(GFP_KERNEL, 0);
+    ASSERT_MSG(page != NULL, "alloc_pages must succeed");
+    memset((void *)get_virtual_address_from_page(page), 0xA5, PAGE_SIZE);
+    ASSERT_MSG(free_pages(page) == 0, "free_pages must succeed");
+
+    // Without zeroed pages ready, the page is cleared on the spot.
+    while (pool->count) {
+        page_t *drain = alloc_pages(GFP_KERNEL | __GFP_ZERO, 0);
+        ASSERT_MSG(drain != NULL, "Zeroed allocation must succeed");
+        ASSERT_MSG(free_pages(drain) == 0, "free_pages must succeed");
+    }
+    unsigned long misses = pool->misses;
+    page = alloc_pages(GFP_KERNEL | __GFP_ZERO, 0);
+    ASSERT_MSG(page != NULL, "Zeroed allocation must succeed");
+    ASSERT_MSG(pool->misses == misses + 1, "The allocation must miss the empty pool");
+    ASSERT_MSG(__page_is_clear(page), "The page must be cleared on the spot");
+    ASSERT_MSG(free_pages(page) == 0, "free_pages must succeed");
+
+    // Refill the pool, its pages still count as free.
+    ASSERT_MSG(zone_zero_pool_refill(ZERO_POOL_SIZE) > 0, "The pool must be refilled");
+    ASSERT_MSG(pool->count > 0 && pool->count <= ZERO_POOL_SIZE, "The pool must hold the zeroed pages");
+    ASSERT_MSG(get_zone_free_space(GFP_KERNEL) == free_before, "Pooled pages must count as free");
+
+    // The next zeroed page comes from the pool.
+    unsigned long hits  = pool->hits;
+    unsigned long count = pool->count;
+    page = alloc_pages(GFP_KERNEL | __GFP_ZERO, 0);
+    ASSERT_MSG(page != NULL, "Zeroed allocation must succeed");
+    ASSERT_MSG(pool->hits == hits + 1, "The allocation must hit the pool");
+    ASSERT_MSG(pool->count == count - 1, "The page must leave the pool");
+    ASSERT_MSG(__page_is_clear(page), "The pooled page must be clear");
+    ASSERT_MSG(free_pages(page) == 0, "free_pages must succeed");
+
+    // Larger blocks are always cleared on the spot.
+    page = alloc_pages(GFP_KERNEL | __GFP_ZERO, 1);
+    ASSERT_MSG(page != NULL, "Zeroed allocation must succeed");
+    ASSERT_MSG(__page_is_clear(page) && __page_is_clear(page + 1), "The whole block must be clear");
+    ASSERT_MSG(free_pages(page) == 0, "free_pages must succeed");
+
+    ASSERT_MSG(get_zone_free_space(GFP_KERNEL) == free_before, "Kernel zone free space must be restored");
+
+    TEST_SECTION_END();
+}
+
 /// @brief Test allocation when memory is very low (stress until near OOM).
 TEST(memory_zone_low_memory_stress)
 {
@@ -531,5 +599,6 @@ void test_zone_allocator(void)
     test_memory_page_address_roundtrip();
     test_memory_page_write_read();
     test_memory_zone_gfp_flags();
+    test_memory_zone_zero_pool();
     test_memory_zone_low_memory_stress();
 }
@@ -14,6 +14,9 @@ typedef unsigned int tcflag_t;
 /// The number of control characters.
 #define NCCS 32
 
+#define VTIME 5 ///< Index in c_cc of the timeout of non-canonical reads, in tenths of a second.
+#define VMIN  6 ///< Index in c_cc of the minimum number of bytes returned by non-canonical reads.
+
 /// @brief Stores information about a terminal IOs.
 typedef struct termios {
     tcflag_t c_iflag; ///< input mode flags
@@ -39,6 +39,9 @@
 #define F_GETLK  7 ///< Get record locking information.
 #define F_SETLK  8 ///< Set record locking information.
 #define F_SETLKW 9 ///< Set record locking info; wait if blocked.
+
+#define F_SETPIPE_SZ 1031 ///< Set the capacity of a pipe.
+#define F_GETPIPE_SZ 1032 ///< Get the capacity of a pipe.
 /// @}
 
 /// @name Lock Operation Flags
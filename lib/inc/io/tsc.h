@@ -0,0 +1,35 @@
+/// @file tsc.h
+/// @brief Reads the time-stamp counter, to measure intervals in cycles.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+/// @brief Reads the time-stamp counter.
+/// @return the number of cycles since reset.
+static inline unsigned long long rdtsc(void)
+{
+    unsigned int low, high;
+    __asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high));
+    return ((unsigned long long)high << 32U) | low;
+}
+
+/// @brief Divides a number of cycles, e.g., to get the cycles per iteration.
+/// @details There is no runtime support for 64-bit divisions, so the high half
+/// is divided first, and its remainder goes in front of the low half.
+/// @param cycles the number of cycles.
+/// @param divisor the divisor, which must not be zero.
+/// @return the quotient, saturated to 32 bits.
+static inline unsigned int tsc_div(unsigned long long cycles, unsigned int divisor)
+{
+    unsigned int high = (unsigned int)(cycles >> 32U);
+    unsigned int low  = (unsigned int)cycles;
+    if (high >= divisor) {
+        return ~0U;
+    }
+    // Since the remainder is below the divisor, the quotient fits in 32 bits.
+    unsigned int quotient, remainder;
+    __asm__("divl %4" : "=a"(quotient), "=d"(remainder) : "0"(low), "1"(high), "rm"(divisor));
+    (void)remainder;
+    return quotient;
+}
@@ -64,3 +64,6 @@
 
 /// Maximum number of links to follow during resolving a path.
 #define SYMLOOP_MAX 8
+
+/// Maximum number of bytes that is guaranteed to be written to a pipe atomically.
+#define PIPE_BUF 4096
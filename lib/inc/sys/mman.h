@@ -11,10 +11,32 @@
 #define PROT_WRITE 0x2 ///< Page can be written.
 #define PROT_EXEC  0x4 ///< Page can be executed.
 
-#define MAP_SHARED  0x01 ///< The memory is shared.
-#define MAP_PRIVATE 0x02 ///< The memory is private.
-
-#if 0
+#define MAP_SHARED    0x01 ///< The memory is shared.
+#define MAP_PRIVATE   0x02 ///< The memory is private.
+#define MAP_ANONYMOUS 0x20 ///< The memory is not backed by any file.
+
+#define MAP_FAILED ((void *)-1) ///< Value returned by mmap on failure.
+
+#define MS_ASYNC      0x1 ///< Schedule the write back of the mapping.
+#define MS_INVALIDATE 0x2 ///< Invalidate other mappings of the same file.
+#define MS_SYNC       0x4 ///< Write back the mapping, and wait for it.
+
+/// @brief Arguments of the mmap system call, which are too many to be passed
+/// through registers and are therefore passed through a pointer.
+typedef struct mmap_arg_struct {
+    /// The starting address for the new mapping.
+    void *addr;
+    /// The length of the mapping.
+    size_t length;
+    /// The desired memory protection of the mapping.
+    int prot;
+    /// The type of the mapping.
+    int flags;
+    /// The file descriptor of the mapped file.
+    int fd;
+    /// The offset in the file.
+    off_t offset;
+} mmap_arg_struct_t;
 
 /// @brief creates a new mapping in the virtual address space of the calling process.
 /// @param addr the starting address for the new mapping.
@@ -23,7 +45,7 @@
 /// @param flags determines whether updates to the mapping are visible to other processes mapping the same region.
 /// @param fd in case of file mapping, the file descriptor to use.
 /// @param offset offset in the file, which must be a multiple of the page size PAGE_SIZE.
-/// @return returns a pointer to the mapped area, -1 and errno is set.
+/// @return returns a pointer to the mapped area, MAP_FAILED and errno is set.
 void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset);
 
 /// @brief deletes the mappings for the specified address range.
@@ -32,4 +54,9 @@ void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
 /// @return 0 on success, -1 on falure and errno is set.
 int munmap(void *addr, size_t length);
 
-#endif
+/// @brief flushes changes made to a shared file mapping back to the file.
+/// @param addr the starting address, which must be a multiple of the page size.
+/// @param length the length of the range to synchronize.
+/// @param flags either MS_SYNC or MS_ASYNC, optionally with MS_INVALIDATE.
+/// @return 0 on success, -1 on falure and errno is set.
+int msync(void *addr, size_t length, int flags);
@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include "list_head.h"
 #include "stddef.h"
 #include "sys/ipc.h"
 #include "sys/types.h"
@@ -31,8 +32,10 @@ struct msgbuf {
 
 /// Keeps track of a stored message.
 struct msg {
-    /// Pointer to the next message on queue.
-    struct msg *msg_next;
+    /// Reference inside the queue, in arrival order.
+    list_head_t msg_list;
+    /// Reference inside the messages of the same type, in arrival order.
+    list_head_t msg_type_list;
     /// The type of message.
     long msg_type;
     /// Pointer to the beginning of the message.
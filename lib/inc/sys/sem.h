@@ -31,6 +31,9 @@
 /// @brief Defines the maximum number of semaphores in a semaphore set.
 #define SEM_SET_MAX 256
 
+/// @brief Defines the maximum value of a semaphore.
+#define SEMVMX 32767
+
 /// @brief Optional argument for semctl() function
 union semun {
     /// @brief Value for SETVAL.
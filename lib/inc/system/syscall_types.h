@@ -395,6 +395,15 @@
         return (type)(value);                                                                                          \
     } while (0)
 
+/// @brief Issues the system call whose number is in eax, with the arguments in
+/// ebx, ecx, edx, esi and edi. It points to a stub using SYSENTER when the CPU
+/// supports it, or to one using `int 0x80` otherwise.
+extern void (*__syscall_entry)(void);
+
+/// @brief Picks the fastest way to issue system calls supported by the CPU,
+/// called once at program startup.
+void __syscall_init(void);
+
 // Few things about what follows:
 //
 // 1. The symbol "=", is a a constraint modifier, and it means that the operand
@@ -407,32 +416,36 @@
 //
 
 /// @brief Heart of the code that calls a system call with 0 parameters.
-#define __inline_syscall_0(res, name) __asm__ __volatile__("int $0x80" : "=a"(res) : "0"(__NR_##name))
+#define __inline_syscall_0(res, name) __asm__ __volatile__("call *__syscall_entry" : "=a"(res) : "0"(__NR_##name))
 
 /// @brief Heart of the code that calls a system call with 1 parameter.
 #define __inline_syscall_1(res, name, arg1)                                                                            \
-    __asm__ __volatile__("push %%ebx; movl %2,%%ebx; int $0x80; pop %%ebx"                                             \
+    __asm__ __volatile__("push %%ebx; movl %2,%%ebx; "                                                                 \
+                         "call *__syscall_entry; pop %%ebx"                                                            \
                          : "=a"(res)                                                                                   \
                          : "0"(__NR_##name), "ri"(arg1)                                                                \
                          : "memory");
 
 /// @brief Heart of the code that calls a system call with 2 parameters.
 #define __inline_syscall_2(res, name, arg1, arg2)                                                                      \
-    __asm__ __volatile__("push %%ebx; movl %2,%%ebx; int $0x80; pop %%ebx"                                             \
+    __asm__ __volatile__("push %%ebx; movl %2,%%ebx; "                                                                 \
+                         "call *__syscall_entry; pop %%ebx"                                                            \
                          : "=a"(res)                                                                                   \
                          : "0"(__NR_##name), "ri"(arg1), "c"(arg2)                                                     \
                          : "memory");
 
 /// @brief Heart of the code that calls a system call with 3 parameters.
 #define __inline_syscall_3(res, name, arg1, arg2, arg3)                                                                \
-    __asm__ __volatile__("push %%ebx; movl %2,%%ebx; int $0x80; pop %%ebx"                                             \
+    __asm__ __volatile__("push %%ebx; movl %2,%%ebx; "                                                                 \
+                         "call *__syscall_entry; pop %%ebx"                                                            \
                          : "=a"(res)                                                                                   \
                          : "0"(__NR_##name), "ri"(arg1), "c"(arg2), "d"(arg3)                                          \
                          : "memory");
 
 /// @brief Heart of the code that calls a system call with 4 parameters.
 #define __inline_syscall_4(res, name, arg1, arg2, arg3, arg4)                                                          \
-    __asm__ __volatile__("push %%ebx; movl %2,%%ebx; int $0x80; pop %%ebx"                                             \
+    __asm__ __volatile__("push %%ebx; movl %2,%%ebx; "                                                                 \
+                         "call *__syscall_entry; pop %%ebx"                                                            \
                          : "=a"(res)                                                                                   \
                          : "0"(__NR_##name), "ri"(arg1), "c"(arg2), "d"(arg3), "S"(arg4)                               \
                          : "memory");
@@ -440,7 +453,7 @@
 /// @brief Heart of the code that calls a system call with 5 parameters.
 #define __inline_syscall_5(res, name, arg1, arg2, arg3, arg4, arg5)                                                    \
     __asm__ __volatile__("push %%ebx; movl %2,%%ebx; movl %1,%%eax; "                                                  \
-                         "int $0x80; pop %%ebx"                                                                        \
+                         "call *__syscall_entry; pop %%ebx"                                                            \
                          : "=a"(res)                                                                                   \
                          : "i"(__NR_##name), "ri"(arg1), "c"(arg2), "d"(arg3), "S"(arg4), "D"(arg5)                    \
                          : "memory");
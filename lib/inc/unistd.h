@@ -7,6 +7,7 @@
 
 #include "dirent.h"
 #include "stddef.h"
+#include "stdint.h"
 #include "sys/types.h"
 
 #define STDIN_FILENO  0 ///< Standard input file descriptor.
@@ -71,6 +72,9 @@ int symlink(const char *linkname, const char *path);
 /// @return The number of read characters on success, -1 otherwise and errno is set to indicate the error.
 int readlink(const char *path, char *buffer, size_t bufsize);
 
+/// @brief Commits the filesystem caches to disk.
+void sync(void);
+
 /// @brief Returns the process ID (PID) of the calling process.
 /// @return pid_t process identifier.
 pid_t getpid(void);
@@ -318,3 +322,14 @@ unsigned int sleep(unsigned int seconds);
 /// @param fds Array to store read and write file descriptors.
 /// @return 0 on success, or -1 on error.
 int pipe(int fds[2]);
+
+/// @brief Sets the end of the data segment (the program break).
+/// @param addr The new program break.
+/// @return 0 on success, -1 otherwise and errno is set to ENOMEM.
+int brk(void *addr);
+
+/// @brief Moves the program break by the given amount.
+/// @param increment The number of bytes to add to (or remove from) the heap.
+/// @return The previous program break on success, (void *)-1 otherwise and
+///         errno is set to ENOMEM.
+void *sbrk(intptr_t increment);
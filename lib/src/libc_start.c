@@ -27,6 +27,8 @@ int __libc_start_main(int (*main)(int, char **, char **), int argc, char *argv[]
     assert(argv && "There is no `argv` array.");
     assert(envp && "There is no `envp` array.");
     //dbg_print("environ  : %p\n", environ);
+    // Pick how to issue system calls.
+    __syscall_init();
     // Copy the environ.
     environ    = envp;
     // Call the main function.
@@ -0,0 +1,504 @@
+/// @file malloc.c
+/// @brief Dynamic memory allocator.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+/// @details The allocator carves chunks out of the heap, which is grown and
+/// shrunk by moving the program break (see sbrk). Each chunk starts with its
+/// size, and free chunks also keep their size at the start of the following
+/// chunk, so that neighbouring free chunks can be merged in both directions.
+///
+/// Free chunks are kept in three places:
+///  - fast bins, one LIFO list per small size, whose chunks are not merged
+///    with their neighbours, so that small blocks are recycled in a few
+///    instructions (since processes have a single thread, they play the role
+///    of a thread cache);
+///  - size-class bins, one list per power of two, whose chunks are merged with
+///    their free neighbours;
+///  - the top chunk, which is the free memory at the end of the heap.
+
+#include "errno.h"
+#include "stddef.h"
+#include "stdint.h"
+#include "stdlib.h"
+#include "string.h"
+#include "unistd.h"
+
+/// Alignment of the returned memory, and granularity of chunk sizes.
+#define MALLOC_ALIGNMENT 8U
+/// Bytes of each chunk used for bookkeeping.
+#define CHUNK_OVERHEAD   (2U * sizeof(size_t))
+/// Minimum size of a chunk, which must be able to hold the free list links.
+#define MIN_CHUNK_SIZE   (sizeof(malloc_chunk_t))
+/// Bit of the size field, set if the chunk is in use.
+#define CHUNK_INUSE      0x1U
+/// Bit of the size field, set if the previous chunk is in use.
+#define PREV_INUSE       0x2U
+/// Mask used to extract the size from the size field.
+#define CHUNK_SIZE_MASK  (~(size_t)(MALLOC_ALIGNMENT - 1U))
+
+/// Largest chunk kept in the fast bins.
+#define FAST_BIN_MAX_SIZE 128U
+/// Number of fast bins, indexed by chunk size divided by the alignment.
+#define FAST_BIN_COUNT    ((FAST_BIN_MAX_SIZE / MALLOC_ALIGNMENT) + 1U)
+/// Maximum number of chunks kept in each fast bin.
+#define FAST_BIN_LIMIT    32U
+/// Number of size-class bins, one for each power of two from 16 bytes on.
+#define BIN_COUNT         28U
+
+/// Size of a page, the granularity of the program break.
+#define MALLOC_PAGE_SIZE 4096U
+/// Minimum amount of memory requested to the kernel at once.
+#define HEAP_GROW_SIZE   (64U * 1024U)
+/// Size of the top chunk above which memory is given back to the kernel.
+#define TRIM_THRESHOLD   (256U * 1024U)
+
+/// @brief A chunk of memory.
+typedef struct malloc_chunk {
+    /// The size of the previous chunk, valid only if the previous chunk is free.
+    size_t prev_size;
+    /// The size of the chunk, including the bookkeeping, and its flags.
+    size_t size;
+    /// The next chunk of the same bin, valid only if the chunk is free.
+    struct malloc_chunk *next;
+    /// The previous chunk of the same bin, valid only if the chunk is free.
+    struct malloc_chunk *prev;
+} malloc_chunk_t;
+
+/// @brief The state of the allocator.
+static struct {
+    /// Fast bins of small chunks.
+    malloc_chunk_t *fast[FAST_BIN_COUNT];
+    /// Number of chunks inside each fast bin.
+    unsigned fast_count[FAST_BIN_COUNT];
+    /// Size-class bins.
+    malloc_chunk_t *bins[BIN_COUNT];
+    /// Bitmap of the non-empty size-class bins.
+    uint32_t binmap;
+    /// The chunk at the end of the heap.
+    malloc_chunk_t *top;
+    /// The lowest address of the heap.
+    char *heap_start;
+    /// The end of the heap.
+    char *heap_end;
+} mstate;
+
+/// @brief Returns the size of the chunk.
+/// @param chunk the chunk.
+/// @return the size of the chunk.
+static inline size_t __chunk_size(malloc_chunk_t *chunk) { return chunk->size & CHUNK_SIZE_MASK; }
+
+/// @brief Returns the chunk at the given offset from another.
+/// @param chunk the chunk.
+/// @param offset the offset in bytes.
+/// @return the chunk at the given offset.
+static inline malloc_chunk_t *__chunk_at(malloc_chunk_t *chunk, size_t offset)
+{
+    return (malloc_chunk_t *)((char *)chunk + offset);
+}
+
+/// @brief Returns the memory handed to the user for the given chunk.
+/// @param chunk the chunk.
+/// @return the memory.
+static inline void *__chunk_to_mem(malloc_chunk_t *chunk) { return (char *)chunk + CHUNK_OVERHEAD; }
+
+/// @brief Returns the chunk of the memory handed to the user.
+/// @param ptr the memory.
+/// @return the chunk.
+static inline malloc_chunk_t *__mem_to_chunk(void *ptr) { return (malloc_chunk_t *)((char *)ptr - CHUNK_OVERHEAD); }
+
+/// @brief Computes the size of the chunk needed to serve a request.
+/// @param size the requested size.
+/// @return the size of the chunk, or 0 if the request is too big.
+static inline size_t __request_to_size(size_t size)
+{
+    if (size > (SIZE_MAX - CHUNK_OVERHEAD - MALLOC_ALIGNMENT - MALLOC_PAGE_SIZE - HEAP_GROW_SIZE)) {
+        return 0;
+    }
+    size = (size + CHUNK_OVERHEAD + MALLOC_ALIGNMENT - 1U) & CHUNK_SIZE_MASK;
+    return (size < MIN_CHUNK_SIZE) ? MIN_CHUNK_SIZE : size;
+}
+
+/// @brief Checks that the pointer was returned by the allocator.
+/// @param chunk the chunk of the pointer.
+/// @return 1 if the chunk is in use, 0 otherwise.
+static inline int __chunk_is_valid(malloc_chunk_t *chunk)
+{
+    return ((char *)chunk >= mstate.heap_start) && ((char *)chunk < mstate.heap_end) &&
+           (((uintptr_t)chunk % MALLOC_ALIGNMENT) == 0) && (chunk->size & CHUNK_INUSE);
+}
+
+/// @brief Returns the size-class bin of the given size.
+/// @param size the size of the chunk.
+/// @return the index of the bin.
+static inline unsigned __bin_index(size_t size) { return (31U - __builtin_clz(size)) - 4U; }
+
+/// @brief Adds the free chunk to its bin.
+/// @param chunk the chunk.
+static inline void __bin_insert(malloc_chunk_t *chunk)
+{
+    unsigned index = __bin_index(__chunk_size(chunk));
+    chunk->prev    = NULL;
+    chunk->next    = mstate.bins[index];
+    if (chunk->next) {
+        chunk->next->prev = chunk;
+    }
+    mstate.bins[index] = chunk;
+    mstate.binmap |= (1U << index);
+}
+
+/// @brief Removes the free chunk from its bin.
+/// @param chunk the chunk.
+static inline void __bin_remove(malloc_chunk_t *chunk)
+{
+    unsigned index = __bin_index(__chunk_size(chunk));
+    if (chunk->prev) {
+        chunk->prev->next = chunk->next;
+    } else {
+        mstate.bins[index] = chunk->next;
+        if (!chunk->next) {
+            mstate.binmap &= ~(1U << index);
+        }
+    }
+    if (chunk->next) {
+        chunk->next->prev = chunk->prev;
+    }
+}
+
+/// @brief Marks a free chunk, removed from its bin, as used, putting back into
+/// the bins what exceeds the given size.
+/// @param chunk the chunk.
+/// @param size the size needed.
+static inline void __chunk_use(malloc_chunk_t *chunk, size_t size)
+{
+    size_t chunk_size = __chunk_size(chunk);
+    if ((chunk_size - size) >= MIN_CHUNK_SIZE) {
+        malloc_chunk_t *remainder = __chunk_at(chunk, size);
+        remainder->size           = (chunk_size - size) | PREV_INUSE;
+        // The following chunk already knows that its previous one is free.
+        __chunk_at(remainder, chunk_size - size)->prev_size = chunk_size - size;
+        __bin_insert(remainder);
+        chunk_size = size;
+    } else {
+        __chunk_at(chunk, chunk_size)->size |= PREV_INUSE;
+    }
+    chunk->size = chunk_size | CHUNK_INUSE | (chunk->size & PREV_INUSE);
+}
+
+/// @brief Gives back to the kernel the memory at the end of the heap.
+static void __malloc_trim(void)
+{
+    size_t top_size = __chunk_size(mstate.top);
+    // Only trim if we own the memory up to the program break.
+    if ((top_size < TRIM_THRESHOLD) || (((char *)mstate.top + top_size) != (char *)sbrk(0))) {
+        return;
+    }
+    // Keep some memory for the next allocations.
+    size_t extra = (top_size - HEAP_GROW_SIZE) & ~(MALLOC_PAGE_SIZE - 1U);
+    if (!extra || (sbrk(-(intptr_t)extra) == (void *)-1)) {
+        return;
+    }
+    mstate.top->size -= extra;
+    mstate.heap_end -= extra;
+}
+
+/// @brief Frees a chunk, merging it with its free neighbours.
+/// @param chunk the chunk, which must be marked as used.
+static void __free_chunk(malloc_chunk_t *chunk)
+{
+    size_t size          = __chunk_size(chunk);
+    malloc_chunk_t *next = __chunk_at(chunk, size);
+
+    // Merge with the previous chunk, whose own previous one is surely in use.
+    if (!(chunk->size & PREV_INUSE)) {
+        malloc_chunk_t *prev = (malloc_chunk_t *)((char *)chunk - chunk->prev_size);
+        __bin_remove(prev);
+        size += __chunk_size(prev);
+        chunk = prev;
+    }
+    // Merge with the top chunk.
+    if (next == mstate.top) {
+        chunk->size = (size + __chunk_size(next)) | PREV_INUSE;
+        mstate.top  = chunk;
+        __malloc_trim();
+        return;
+    }
+    // Merge with the next chunk.
+    if (!(next->size & CHUNK_INUSE)) {
+        __bin_remove(next);
+        size += __chunk_size(next);
+    }
+    chunk->size     = size | PREV_INUSE;
+    next            = __chunk_at(chunk, size);
+    next->prev_size = size;
+    next->size &= ~PREV_INUSE;
+    __bin_insert(chunk);
+}
+
+/// @brief Moves the chunks of the fast bins to the size-class bins, merging
+/// them with their free neighbours.
+/// @return 1 if at least a chunk was moved, 0 otherwise.
+static int __malloc_consolidate(void)
+{
+    int moved = 0;
+    for (unsigned index = 0; index < FAST_BIN_COUNT; ++index) {
+        while (mstate.fast[index]) {
+            malloc_chunk_t *chunk = mstate.fast[index];
+            mstate.fast[index]    = chunk->next;
+            __free_chunk(chunk);
+            moved = 1;
+        }
+        mstate.fast_count[index] = 0;
+    }
+    return moved;
+}
+
+/// @brief Takes a chunk of the given size from the size-class bins.
+/// @param size the size needed.
+/// @return the chunk, or NULL if no free chunk is big enough.
+static malloc_chunk_t *__bin_take(size_t size)
+{
+    unsigned index = __bin_index(size);
+    // Look for the first chunk which fits, inside the class of the request.
+    malloc_chunk_t *chunk = mstate.bins[index];
+    while (chunk && (__chunk_size(chunk) < size)) {
+        chunk = chunk->next;
+    }
+    if (!chunk) {
+        // Any chunk of a bigger class fits.
+        uint32_t map = mstate.binmap & ~((2U << index) - 1U);
+        if (!map) {
+            return NULL;
+        }
+        chunk = mstate.bins[__builtin_ctz(map)];
+    }
+    __bin_remove(chunk);
+    __chunk_use(chunk, size);
+    return chunk;
+}
+
+/// @brief Grows the heap, so that the top chunk has at least the given size.
+/// @param size the size needed.
+/// @return 0 on success, -1 on failure.
+static int __heap_grow(size_t size)
+{
+    size_t top_size = mstate.top ? __chunk_size(mstate.top) : 0;
+    size_t increment =
+        ((size > HEAP_GROW_SIZE ? size : HEAP_GROW_SIZE) + MALLOC_PAGE_SIZE - 1U) & ~(MALLOC_PAGE_SIZE - 1U);
+    char *base = sbrk((intptr_t)increment);
+    if (base == (void *)-1) {
+        return -1;
+    }
+    if (mstate.top && (base == mstate.heap_end)) {
+        // The heap is contiguous, just extend the top chunk.
+        mstate.top->size += increment;
+        mstate.heap_end += increment;
+        return 0;
+    }
+    if (mstate.top) {
+        // Somebody else moved the break: the old top chunk is left behind,
+        // followed by a chunk which is never freed, so that it is never merged
+        // past the end of its memory.
+        if (top_size >= (2U * MIN_CHUNK_SIZE)) {
+            malloc_chunk_t *fence = __chunk_at(mstate.top, top_size - MIN_CHUNK_SIZE);
+            fence->size           = MIN_CHUNK_SIZE | CHUNK_INUSE;
+            mstate.top->size      = (top_size - MIN_CHUNK_SIZE) | CHUNK_INUSE | (mstate.top->size & PREV_INUSE);
+            __free_chunk(mstate.top);
+        } else {
+            mstate.top->size |= CHUNK_INUSE;
+        }
+    }
+    // Align the start of the new memory.
+    size_t padding = (MALLOC_ALIGNMENT - ((uintptr_t)base % MALLOC_ALIGNMENT)) % MALLOC_ALIGNMENT;
+    if (!mstate.heap_start || (base < mstate.heap_start)) {
+        mstate.heap_start = base;
+    }
+    mstate.heap_end  = base + increment;
+    mstate.top       = (malloc_chunk_t *)(base + padding);
+    mstate.top->size = (increment - padding) | PREV_INUSE;
+    return (__chunk_size(mstate.top) >= size) ? 0 : -1;
+}
+
+/// @brief Takes a chunk of the given size from the top chunk.
+/// @param size the size needed.
+/// @param grow if the heap can be grown to serve the request.
+/// @return the chunk, or NULL on failure.
+static malloc_chunk_t *__top_take(size_t size, int grow)
+{
+    // The top chunk must never disappear.
+    if (!mstate.top || (__chunk_size(mstate.top) < (size + MIN_CHUNK_SIZE))) {
+        if (!grow || (__heap_grow(size + MIN_CHUNK_SIZE) < 0)) {
+            return NULL;
+        }
+    }
+    malloc_chunk_t *chunk = mstate.top;
+    size_t top_size       = __chunk_size(chunk);
+    mstate.top            = __chunk_at(chunk, size);
+    mstate.top->size      = (top_size - size) | PREV_INUSE;
+    chunk->size           = size | CHUNK_INUSE | (chunk->size & PREV_INUSE);
+    return chunk;
+}
+
+/// @brief Shrinks a chunk in use to the given size, freeing the rest.
+/// @param chunk the chunk.
+/// @param size the new size.
+static inline void __chunk_shrink(malloc_chunk_t *chunk, size_t size)
+{
+    size_t chunk_size = __chunk_size(chunk);
+    if ((chunk_size - size) < MIN_CHUNK_SIZE) {
+        return;
+    }
+    malloc_chunk_t *remainder = __chunk_at(chunk, size);
+    remainder->size           = (chunk_size - size) | CHUNK_INUSE | PREV_INUSE;
+    chunk->size               = size | CHUNK_INUSE | (chunk->size & PREV_INUSE);
+    __free_chunk(remainder);
+}
+
+size_t malloc_usable_size(void *ptr)
+{
+    if (!ptr || !__chunk_is_valid(__mem_to_chunk(ptr))) {
+        return 0;
+    }
+    return __chunk_size(__mem_to_chunk(ptr)) - CHUNK_OVERHEAD;
+}
+
+void *malloc(unsigned int size)
+{
+    // Return NULL if size is zero, as no memory needs to be allocated.
+    if (size == 0) {
+        return NULL;
+    }
+    size_t chunk_size = __request_to_size(size);
+    if (!chunk_size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    // Small requests are served from the fast bins first.
+    if (chunk_size <= FAST_BIN_MAX_SIZE) {
+        unsigned index        = chunk_size / MALLOC_ALIGNMENT;
+        malloc_chunk_t *chunk = mstate.fast[index];
+        if (chunk) {
+            mstate.fast[index] = chunk->next;
+            mstate.fast_count[index]--;
+            return __chunk_to_mem(chunk);
+        }
+    }
+    malloc_chunk_t *chunk = __bin_take(chunk_size);
+    if (!chunk) {
+        chunk = __top_take(chunk_size, 0);
+    }
+    if (!chunk) {
+        // Before growing the heap, see if the fast bins can be merged into a
+        // chunk which is big enough.
+        if (__malloc_consolidate()) {
+            chunk = __bin_take(chunk_size);
+        }
+        if (!chunk) {
+            chunk = __top_take(chunk_size, 1);
+        }
+        if (!chunk) {
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
+    return __chunk_to_mem(chunk);
+}
+
+void *calloc(size_t num, size_t size)
+{
+    // Check for overflow in multiplication (num * size)
+    if ((num != 0) && (size > (SIZE_MAX / num))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    // Allocate memory.
+    void *ptr = malloc(num * size);
+    if (ptr) {
+        // Zero-initialize the allocated memory.
+        memset(ptr, 0, num * size);
+    }
+    // Return the allocated and initialized memory.
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    // C standard implementation: When NULL is passed to realloc, simply malloc
+    // the requested size and return a pointer to that.
+    if (__builtin_expect(ptr == NULL, 0)) {
+        return malloc(size);
+    }
+    // C standard implementation: For a size of zero, free the pointer and
+    // return NULL, allocating no new memory.
+    if (__builtin_expect(size == 0, 0)) {
+        free(ptr);
+        return NULL;
+    }
+    malloc_chunk_t *chunk = __mem_to_chunk(ptr);
+    if (!__chunk_is_valid(chunk)) {
+        return NULL;
+    }
+    size_t new_size = __request_to_size(size);
+    if (!new_size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    size_t chunk_size    = __chunk_size(chunk);
+    malloc_chunk_t *next = __chunk_at(chunk, chunk_size);
+    // The chunk is already big enough.
+    if (chunk_size >= new_size) {
+        __chunk_shrink(chunk, new_size);
+        return ptr;
+    }
+    // Grow the chunk into the top chunk.
+    if ((next == mstate.top) && ((chunk_size + __chunk_size(next)) >= (new_size + MIN_CHUNK_SIZE))) {
+        size_t top_size  = __chunk_size(next);
+        mstate.top       = __chunk_at(chunk, new_size);
+        mstate.top->size = (chunk_size + top_size - new_size) | PREV_INUSE;
+        chunk->size      = new_size | CHUNK_INUSE | (chunk->size & PREV_INUSE);
+        return ptr;
+    }
+    // Grow the chunk into the next one, if it is free.
+    if ((next != mstate.top) && !(next->size & CHUNK_INUSE) && ((chunk_size + __chunk_size(next)) >= new_size)) {
+        __bin_remove(next);
+        chunk_size += __chunk_size(next);
+        chunk->size = chunk_size | CHUNK_INUSE | (chunk->size & PREV_INUSE);
+        __chunk_at(chunk, chunk_size)->size |= PREV_INUSE;
+        __chunk_shrink(chunk, new_size);
+        return ptr;
+    }
+    // Move the content to a new chunk.
+    void *newp = malloc(size);
+    if (newp) {
+        memcpy(newp, ptr, chunk_size - CHUNK_OVERHEAD);
+        free(ptr);
+    }
+    return newp;
+}
+
+void free(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+    malloc_chunk_t *chunk = __mem_to_chunk(ptr);
+    if (!__chunk_is_valid(chunk)) {
+        return;
+    }
+    // Small chunks are kept aside as they are, for the next allocations.
+    size_t size = __chunk_size(chunk);
+    if (size <= FAST_BIN_MAX_SIZE) {
+        unsigned index = size / MALLOC_ALIGNMENT;
+        if (mstate.fast_count[index] < FAST_BIN_LIMIT) {
+            chunk->next        = mstate.fast[index];
+            mstate.fast[index] = chunk;
+            mstate.fast_count[index]++;
+            return;
+        }
+    }
+    __free_chunk(chunk);
+    // After freeing a large chunk, merge the small ones as well, so that the
+    // free memory at the end of the heap can be given back.
+    if (size >= HEAP_GROW_SIZE) {
+        __malloc_consolidate();
+    }
+}
@@ -19,7 +19,9 @@ void puts(const char *str) { write(STDOUT_FILENO, str, strlen(str)); }
 int getchar(void)
 {
     char c = 0;
-    while (read(STDIN_FILENO, &c, 1) == 0) {
+    // The terminal puts us to sleep until a character is available.
+    if (read(STDIN_FILENO, &c, 1) <= 0) {
+        return EOF;
     }
     return c;
 }
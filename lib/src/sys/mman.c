@@ -8,13 +8,20 @@
 #include "system/syscall_types.h"
 #include "unistd.h"
 
-#if 0
-
-// _syscall6(void *, mmap, void *, addr, size_t, length, int, prot, int, flags, int, fd, off_t, offset)
+// _syscall1(void *, mmap, mmap_arg_struct_t *, args)
 void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
 {
+    // The arguments do not fit in the registers, pass them through memory.
+    mmap_arg_struct_t args = {
+        .addr   = addr,
+        .length = length,
+        .prot   = prot,
+        .flags  = flags,
+        .fd     = fd,
+        .offset = offset,
+    };
     long __res;
-    __inline_syscall_6(__res, mmap, addr, length, prot, flags, fd, offset);
+    __inline_syscall_1(__res, mmap, &args);
     __syscall_return(void *, __res);
 }
 
@@ -26,4 +33,10 @@ int munmap(void *addr, size_t length)
     __syscall_return(int, __res);
 }
 
-#endif
+// _syscall3(int, msync, void *, addr, size_t, length, int, flags)
+int msync(void *addr, size_t length, int flags)
+{
+    long __res;
+    __inline_syscall_3(__res, msync, addr, length, flags);
+    __syscall_return(int, __res);
+}
@@ -0,0 +1,34 @@
+/// @file syscall.c
+/// @brief Selects how the system calls are issued.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "system/syscall_types.h"
+
+/// CPUID.1:EDX bit telling that SYSENTER and SYSEXIT are supported.
+#define CPUID_EDX_SEP (1U << 11U)
+
+/// @brief Issues a system call with `int 0x80` (syscall_entry.S).
+extern void __syscall_int80(void);
+
+/// @brief Issues a system call with SYSENTER (syscall_entry.S).
+extern void __syscall_sysenter(void);
+
+void (*__syscall_entry)(void) = __syscall_int80;
+
+void __syscall_init(void)
+{
+    unsigned int eax = 1, ebx, ecx, edx;
+    __asm__ __volatile__("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    unsigned int family   = (eax >> 8U) & 0xFU;
+    unsigned int model    = (eax >> 4U) & 0xFU;
+    unsigned int stepping = eax & 0xFU;
+    // The first Pentium Pro report the feature, but do not have it. The kernel
+    // does the same check before enabling it.
+    if ((family == 6) && (model < 3) && (stepping < 3)) {
+        return;
+    }
+    if (edx & CPUID_EDX_SEP) {
+        __syscall_entry = __syscall_sysenter;
+    }
+}
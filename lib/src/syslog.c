@@ -83,7 +83,7 @@ int __syslog(const char *file, const char *fun, int line, short log_level, const
     // Call the syslog system call to send the formatted message to the system log.
     // __inline_syscall_5(len, syslog, type, file, func, line, buf);
     __asm__ __volatile__("push %%ebx; movl %2,%%ebx; movl %1,%%eax; "
-                         "int $0x80; pop %%ebx"
+                         "call *__syscall_entry; pop %%ebx"
                          : "=a"(len)
                          : "i"(__NR_syslog), "ri"(file), "c"(fun), "d"(line), "S"(log_level), "D"(buf)
                          : "memory");
@@ -11,7 +11,7 @@
 int tcgetattr(int fd, termios_t *termios_p)
 {
     int retval;
-    __asm__ volatile("int $0x80"
+    __asm__ volatile("call *__syscall_entry"
                      : "=a"(retval)
                      : "0"(__NR_ioctl), "b"((long)(fd)), "c"((long)(TCGETS)), "d"((long)(termios_p)));
     if (retval < 0) {
@@ -24,7 +24,7 @@ int tcgetattr(int fd, termios_t *termios_p)
 int tcsetattr(int fd, int optional_actions, const termios_t *termios_p)
 {
     int retval;
-    __asm__ volatile("int $0x80"
+    __asm__ volatile("call *__syscall_entry"
                      : "=a"(retval)
                      : "0"(__NR_ioctl), "b"((long)(fd)), "c"((long)(TCSETS)), "d"((long)(termios_p)));
     if (retval < 0) {
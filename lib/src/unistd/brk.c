@@ -0,0 +1,40 @@
+/// @file brk.c
+/// @brief
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "errno.h"
+#include "stdint.h"
+#include "system/syscall_types.h"
+#include "unistd.h"
+
+/// The current program break, NULL until it is first asked to the kernel.
+static char *__curbrk = NULL;
+
+// _syscall1(void *, brk, void *, addr)
+int brk(void *addr)
+{
+    char *__res;
+    __inline_syscall_1(__res, brk, addr);
+    __curbrk = __res;
+    // The kernel returns the current break if it could not be moved, asking
+    // for a NULL break only queries the current one (see sbrk).
+    if (!__res || (addr && (__res != (char *)addr))) {
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+void *sbrk(intptr_t increment)
+{
+    // Ask the kernel for the current break, only the first time.
+    if (!__curbrk && (brk(NULL) < 0)) {
+        return (void *)-1;
+    }
+    char *old_brk = __curbrk;
+    if (increment && (brk(old_brk + increment) < 0)) {
+        return (void *)-1;
+    }
+    return old_brk;
+}
@@ -10,6 +10,7 @@
 int main(int argc, char **argv)
 {
     printf("Executing power-off...\n");
+    sync();
     reboot(LINUX_REBOOT_MAGIC1, LINUX_REBOOT_MAGIC2, LINUX_REBOOT_CMD_POWER_OFF, NULL);
     return 0;
 }
@@ -0,0 +1,86 @@
+/// @file t_dcache.c
+/// @brief Tests that cached directory entries follow directory changes.
+/// @details Each name is looked up before and after it is created or removed,
+/// so that a stale positive or negative entry would make the test fail.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#define TEST_DIR  "/tmp/t_dcache"
+#define TEST_FILE "/tmp/t_dcache/file"
+
+/// @brief Checks that the path exists (or not) as expected.
+/// @param path the path to check.
+/// @param expected 1 if the path must exist, 0 otherwise.
+/// @return 0 on success, 1 on failure.
+static int check_exists(const char *path, int expected)
+{
+    struct stat st;
+    int exists = (stat(path, &st) == 0);
+    if (exists != expected) {
+        syslog(LOG_ERR, "`%s` should %sexist: %s\n", path, expected ? "" : "not ", strerror(errno));
+        return 1;
+    }
+    return 0;
+}
+
+/// @brief Creates and removes a file, looking it up at every step.
+/// @return 0 on success, 1 on failure.
+static int test_file_lifecycle(void)
+{
+    for (int i = 0; i < 3; ++i) {
+        if (check_exists(TEST_FILE, 0)) {
+            return 1;
+        }
+        int fd = creat(TEST_FILE, 0644);
+        if (fd < 0) {
+            syslog(LOG_ERR, "Failed to create `%s`: %s\n", TEST_FILE, strerror(errno));
+            return 1;
+        }
+        close(fd);
+        if (check_exists(TEST_FILE, 1)) {
+            return 1;
+        }
+        if (unlink(TEST_FILE) < 0) {
+            syslog(LOG_ERR, "Failed to remove `%s`: %s\n", TEST_FILE, strerror(errno));
+            return 1;
+        }
+    }
+    return check_exists(TEST_FILE, 0);
+}
+
+int main(void)
+{
+    openlog("t_dcache", LOG_CONS | LOG_PID, LOG_USER);
+
+    int failures = 0;
+
+    // Cache a negative entry for the directory, then create it.
+    failures += check_exists(TEST_DIR, 0);
+    if (mkdir(TEST_DIR, 0755) < 0) {
+        syslog(LOG_ERR, "Failed to create `%s`: %s\n", TEST_DIR, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    failures += check_exists(TEST_DIR, 1);
+    failures += test_file_lifecycle();
+
+    // Remove the directory, its entries must disappear with it.
+    if (rmdir(TEST_DIR) < 0) {
+        syslog(LOG_ERR, "Failed to remove `%s`: %s\n", TEST_DIR, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    failures += check_exists(TEST_DIR, 0);
+    failures += check_exists(TEST_FILE, 0);
+
+    closelog();
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,94 @@
+/// @file t_fpu.c
+/// @brief Tests that processes keep their own FPU registers.
+/// @details Several children use the FPU at the same time, each one with a
+/// different rounding mode, while making system calls and being preempted.
+/// Each child must always find its own control word, and always compute the
+/// same result.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#define CHILDREN   4
+#define ROUNDS     64
+#define ITERATIONS 20000
+
+/// @brief Reads the FPU control word.
+/// @return the control word.
+static unsigned short get_cw(void)
+{
+    unsigned short cw;
+    __asm__ __volatile__("fnstcw %0" : "=m"(cw));
+    return cw;
+}
+
+/// @brief Sets the FPU control word.
+/// @param cw the control word.
+static void set_cw(unsigned short cw) { __asm__ __volatile__("fldcw %0" ::"m"(cw)); }
+
+/// @brief Computes a value whose last bits depend on the rounding mode.
+/// @param seed the starting value.
+/// @return the result.
+static double work(double seed)
+{
+    volatile double a = seed;
+    for (int i = 0; i < ITERATIONS; ++i) {
+        a = (a * 1.000001) + (0.5 / (a + 1.0));
+    }
+    return a;
+}
+
+/// @brief Body of a child.
+/// @param index the index of the child.
+/// @return 0 on success, 1 on failure.
+static int child(int index)
+{
+    // Use a different rounding mode in each child.
+    unsigned short cw = (unsigned short)((get_cw() & ~0x0C00U) | ((unsigned)index << 10U));
+    set_cw(cw);
+    double expected = work(index + 1.0);
+    for (int round = 0; round < ROUNDS; ++round) {
+        // Leave the FPU to the others for a while.
+        getpid();
+        double result = work(index + 1.0);
+        if (get_cw() != cw) {
+            syslog(LOG_ERR, "Child %d found control word 0x%04x instead of 0x%04x.\n", index, get_cw(), cw);
+            return 1;
+        }
+        if (result != expected) {
+            syslog(LOG_ERR, "Child %d computed a different result at round %d.\n", index, round);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    openlog("t_fpu", LOG_CONS | LOG_PID, LOG_USER);
+
+    pid_t pids[CHILDREN];
+    for (int i = 0; i < CHILDREN; ++i) {
+        pids[i] = fork();
+        if (pids[i] < 0) {
+            syslog(LOG_ERR, "Failed to fork child %d.\n", i);
+            return EXIT_FAILURE;
+        }
+        if (pids[i] == 0) {
+            exit(child(i) ? EXIT_FAILURE : EXIT_SUCCESS);
+        }
+    }
+
+    int failures = 0;
+    for (int i = 0; i < CHILDREN; ++i) {
+        int status;
+        if ((waitpid(pids[i], &status, 0) != pids[i]) || !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+            syslog(LOG_ERR, "Child %d failed.\n", i);
+            ++failures;
+        }
+    }
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
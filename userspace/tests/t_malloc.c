@@ -0,0 +1,133 @@
+/// @file t_malloc.c
+/// @brief Tests the userspace allocator and the program break.
+/// @details Blocks of many sizes are allocated, filled with a pattern, resized
+/// and freed, checking that no block overwrites another. Then, a block bigger
+/// than the old fixed heap is allocated, and the heap must shrink once it is
+/// freed, and moving the break below the start of the heap must fail.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#define BLOCKS     256
+#define BIG_BLOCK  (8U * 1024U * 1024U)
+#define ITERATIONS 4096
+
+/// @brief Fills the block with a pattern depending on its index.
+/// @param block the block.
+/// @param index the index of the block.
+/// @param size the size of the block.
+static void fill(unsigned char *block, unsigned index, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        block[i] = (unsigned char)(index + i);
+    }
+}
+
+/// @brief Checks that the block still contains its pattern.
+/// @param block the block.
+/// @param index the index of the block.
+/// @param size the size of the block.
+/// @return 0 on success, 1 on failure.
+static int check(unsigned char *block, unsigned index, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        if (block[i] != (unsigned char)(index + i)) {
+            syslog(LOG_ERR, "Block %u was overwritten at byte %u.\n", index, i);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    openlog("t_malloc", LOG_CONS | LOG_PID, LOG_USER);
+
+    static unsigned char *blocks[BLOCKS];
+    static size_t sizes[BLOCKS];
+
+    // Allocate, resize and free blocks in a pseudo-random order.
+    srand(42);
+    for (unsigned it = 0; it < ITERATIONS; ++it) {
+        unsigned index = rand() % BLOCKS;
+        if (blocks[index]) {
+            if (check(blocks[index], index, sizes[index])) {
+                return EXIT_FAILURE;
+            }
+            if (rand() % 2) {
+                size_t size          = (rand() % 2048) + 1;
+                unsigned char *block = realloc(blocks[index], size);
+                if (!block) {
+                    syslog(LOG_ERR, "Failed to resize block %u to %u bytes.\n", index, size);
+                    return EXIT_FAILURE;
+                }
+                blocks[index] = block;
+                sizes[index]  = size;
+                fill(block, index, size);
+            } else {
+                free(blocks[index]);
+                blocks[index] = NULL;
+            }
+        } else {
+            sizes[index]  = (rand() % 512) + 1;
+            blocks[index] = malloc(sizes[index]);
+            if (!blocks[index]) {
+                syslog(LOG_ERR, "Failed to allocate %u bytes.\n", sizes[index]);
+                return EXIT_FAILURE;
+            }
+            fill(blocks[index], index, sizes[index]);
+        }
+    }
+    for (unsigned index = 0; index < BLOCKS; ++index) {
+        if (blocks[index] && check(blocks[index], index, sizes[index])) {
+            return EXIT_FAILURE;
+        }
+        free(blocks[index]);
+    }
+
+    // Small blocks are recycled without moving the break.
+    void *brk_before = sbrk(0);
+    for (unsigned it = 0; it < ITERATIONS; ++it) {
+        free(malloc(32));
+    }
+    if (sbrk(0) != brk_before) {
+        syslog(LOG_ERR, "The break moved while recycling small blocks.\n");
+        return EXIT_FAILURE;
+    }
+
+    // The heap is not limited to a fixed size anymore.
+    unsigned char *big = malloc(BIG_BLOCK);
+    if (!big) {
+        syslog(LOG_ERR, "Failed to allocate %u bytes.\n", BIG_BLOCK);
+        return EXIT_FAILURE;
+    }
+    memset(big, 0xAA, BIG_BLOCK);
+    if ((big[0] != 0xAA) || (big[BIG_BLOCK - 1] != 0xAA)) {
+        syslog(LOG_ERR, "The big block does not hold its content.\n");
+        return EXIT_FAILURE;
+    }
+    void *brk_big = sbrk(0);
+    free(big);
+    if (sbrk(0) >= brk_big) {
+        syslog(LOG_ERR, "The heap did not shrink after freeing the big block.\n");
+        return EXIT_FAILURE;
+    }
+
+    // The kernel refuses to move the break below the start of the heap.
+    void *brk_now = sbrk(0);
+    if ((brk((void *)1) == 0) || (errno != ENOMEM)) {
+        syslog(LOG_ERR, "Moving the break below the heap did not fail.\n");
+        return EXIT_FAILURE;
+    }
+    if (sbrk(0) != brk_now) {
+        syslog(LOG_ERR, "The break moved after a refused brk.\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
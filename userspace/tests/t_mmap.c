@@ -0,0 +1,108 @@
+/// @file t_mmap.c
+/// @brief Tests file-backed memory mappings.
+/// @details A file is mapped twice: changes made through the shared mapping
+/// must reach the file, while changes made through the private one must not.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#define TEST_FILE "/tmp/t_mmap"
+#define FILE_SIZE 6000
+
+/// @brief Checks that the file contains the given pattern.
+/// @param fd the file descriptor.
+/// @param offset where the pattern should be.
+/// @param pattern the expected content.
+/// @return 0 on success, 1 on failure.
+static int check_file(int fd, off_t offset, const char *pattern)
+{
+    char buffer[32];
+    size_t length = strlen(pattern);
+    if (lseek(fd, offset, SEEK_SET) != offset || read(fd, buffer, length) != (ssize_t)length) {
+        syslog(LOG_ERR, "Failed to read `%s`: %s\n", TEST_FILE, strerror(errno));
+        return 1;
+    }
+    if (memcmp(buffer, pattern, length)) {
+        syslog(LOG_ERR, "The file does not contain `%s` at %ld.\n", pattern, offset);
+        return 1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    openlog("t_mmap", LOG_CONS | LOG_PID, LOG_USER);
+
+    // Create a file spanning two pages, filled with a known byte.
+    int fd = open(TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        syslog(LOG_ERR, "Failed to create `%s`: %s\n", TEST_FILE, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    char block[FILE_SIZE];
+    memset(block, 'a', FILE_SIZE);
+    if (write(fd, block, FILE_SIZE) != FILE_SIZE) {
+        syslog(LOG_ERR, "Failed to write `%s`: %s\n", TEST_FILE, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    int failures = 0;
+
+    // Writes through a private mapping stay private.
+    char *private = mmap(NULL, FILE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (private == MAP_FAILED) {
+        syslog(LOG_ERR, "Failed to map `%s` privately: %s\n", TEST_FILE, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if ((private[0] != 'a') || (private[FILE_SIZE - 1] != 'a')) {
+        syslog(LOG_ERR, "The private mapping does not match the file.\n");
+        ++failures;
+    }
+    memcpy(private, "private", 7);
+    if (munmap(private, FILE_SIZE) < 0) {
+        syslog(LOG_ERR, "Failed to unmap the private mapping: %s\n", strerror(errno));
+        ++failures;
+    }
+    failures += check_file(fd, 0, "aaaaaaa");
+
+    // Writes through a shared mapping reach the file.
+    char *shared = mmap(NULL, FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (shared == MAP_FAILED) {
+        syslog(LOG_ERR, "Failed to map `%s` shared: %s\n", TEST_FILE, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    memcpy(shared, "shared", 6);
+    memcpy(shared + 4096, "second", 6);
+    if (msync(shared, FILE_SIZE, MS_SYNC) < 0) {
+        syslog(LOG_ERR, "Failed to synchronize the shared mapping: %s\n", strerror(errno));
+        ++failures;
+    }
+    failures += check_file(fd, 0, "shared");
+    failures += check_file(fd, 4096, "second");
+
+    // Whatever is left is written back when the mapping goes away.
+    memcpy(shared + 100, "unmapped", 8);
+    if (munmap(shared, FILE_SIZE) < 0) {
+        syslog(LOG_ERR, "Failed to unmap the shared mapping: %s\n", strerror(errno));
+        ++failures;
+    }
+    failures += check_file(fd, 100, "unmapped");
+
+    close(fd);
+    unlink(TEST_FILE);
+
+    if (failures) {
+        syslog(LOG_ERR, "%d checks failed.\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,188 @@
+/// @file t_msgbench.c
+/// @brief Tests blocking message queues, and measures their throughput.
+/// @details Checks the selection of messages by type, that senders sleep
+/// while the queue is full, and that a signal interrupts a receiver. Then a producer streams messages to a consumer,
+/// both sleeping while they wait for each other.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <io/tsc.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#define MESSAGES 2000
+#define SIZE     1024
+
+/// @brief A message.
+typedef struct {
+    long mtype;       ///< Message type.
+    char mtext[SIZE]; ///< Message text.
+} message_t;
+
+/// @brief Sends a message.
+/// @param msqid the message queue.
+/// @param type the type of the message.
+/// @param size the size of the message.
+/// @param flags the flags.
+/// @return the result of msgsnd.
+static int send_message(int msqid, long type, size_t size, int flags)
+{
+    message_t message;
+    message.mtype = type;
+    memset(message.mtext, (int)type, size);
+    return msgsnd(msqid, &message, size, flags);
+}
+
+/// @brief Receives a message, and returns its type.
+/// @param msqid the message queue.
+/// @param type the requested type.
+/// @return the type of the received message, -1 on failure.
+static long receive_message(int msqid, long type)
+{
+    message_t message;
+    if (msgrcv(msqid, &message, SIZE, type, IPC_NOWAIT) < 0) {
+        return -1;
+    }
+    return message.mtype;
+}
+
+/// @brief Checks that the messages are selected by type.
+/// @param msqid the message queue.
+/// @return 0 on success, 1 on failure.
+static int test_types(int msqid)
+{
+    send_message(msqid, 3, 8, 0);
+    send_message(msqid, 1, 8, 0);
+    send_message(msqid, 2, 8, 0);
+    send_message(msqid, 1, 8, 0);
+    // The first of type 2, the lowest type up to 2, the first, and the rest.
+    long expected[] = {2, 1, 3, 1}, requested[] = {2, -2, 0, 0};
+    for (int i = 0; i < 4; ++i) {
+        long type = receive_message(msqid, requested[i]);
+        if (type != expected[i]) {
+            syslog(LOG_ERR, "Asked for type %ld, expected %ld, received %ld.\n", requested[i], expected[i], type);
+            return 1;
+        }
+    }
+    if ((receive_message(msqid, 0) != -1) || (errno != ENOMSG)) {
+        syslog(LOG_ERR, "The queue should be empty.\n");
+        return 1;
+    }
+    return 0;
+}
+
+/// @brief Checks that the senders wait while the queue is full.
+/// @param msqid the message queue.
+/// @return 0 on success, 1 on failure.
+static int test_full(int msqid)
+{
+    struct msqid_ds ds;
+    msgctl(msqid, IPC_STAT, &ds);
+    ds.msg_qbytes = 256;
+    if (msgctl(msqid, IPC_SET, &ds) < 0) {
+        syslog(LOG_ERR, "Failed to limit the size of the queue.\n");
+        return 1;
+    }
+    send_message(msqid, 1, 200, 0);
+    if ((send_message(msqid, 2, 100, IPC_NOWAIT) != -1) || (errno != EAGAIN)) {
+        syslog(LOG_ERR, "A message beyond msg_qbytes should fail with EAGAIN.\n");
+        return 1;
+    }
+    if ((send_message(msqid, 2, 300, 0) != -1) || (errno != EINVAL)) {
+        syslog(LOG_ERR, "A message bigger than msg_qbytes should fail with EINVAL.\n");
+        return 1;
+    }
+    // The child sleeps until we make room for its message.
+    pid_t pid = fork();
+    if (pid == 0) {
+        exit(send_message(msqid, 2, 100, 0) ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+    int status;
+    if ((receive_message(msqid, 1) != 1) || (waitpid(pid, &status, 0) != pid) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+        syslog(LOG_ERR, "The sender did not wake up when the queue was emptied.\n");
+        return 1;
+    }
+    if (receive_message(msqid, 2) != 2) {
+        syslog(LOG_ERR, "The message of the sender was not queued.\n");
+        return 1;
+    }
+    ds.msg_qbytes = MSGMNB;
+    return msgctl(msqid, IPC_SET, &ds) < 0;
+}
+
+/// @brief Handles the alarm that interrupts the receiver.
+/// @param sig the signal.
+static void alarm_handler(int sig) {}
+
+/// @brief Checks that a signal interrupts a receiver waiting for a message.
+/// @param msqid the message queue.
+/// @return 0 on success, 1 on failure.
+static int test_interrupt(int msqid)
+{
+    sigaction_t action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = alarm_handler;
+    if (sigaction(SIGALRM, &action, NULL) == -1) {
+        syslog(LOG_ERR, "Failed to set the handler for SIGALRM.\n");
+        return 1;
+    }
+    alarm(1);
+    message_t message;
+    if ((msgrcv(msqid, &message, SIZE, 1, 0) != -1) || (errno != EINTR)) {
+        syslog(LOG_ERR, "The alarm should have interrupted the receiver with EINTR.\n");
+        return 1;
+    }
+    return 0;
+}
+
+/// @brief Streams messages from a producer to a consumer.
+/// @param msqid the message queue.
+/// @return 0 on success, 1 on failure.
+static int bench_stream(int msqid)
+{
+    pid_t pid = fork();
+    if (pid == 0) {
+        for (int i = 0; i < MESSAGES; ++i) {
+            send_message(msqid, 1 + (i % 4), SIZE, 0);
+        }
+        exit(EXIT_SUCCESS);
+    }
+    message_t message;
+    unsigned long long start = rdtsc();
+    for (int i = 0; i < MESSAGES; ++i) {
+        // Receive the messages of each type in turn.
+        if ((msgrcv(msqid, &message, SIZE, 1 + (i % 4), 0) != SIZE) || (message.mtext[SIZE - 1] != 1 + (i % 4))) {
+            syslog(LOG_ERR, "Received a wrong message at iteration %d.\n", i);
+            return 1;
+        }
+    }
+    unsigned long long cycles = rdtsc() - start;
+    waitpid(pid, NULL, 0);
+    printf("Message queue stream: %u cycles per %d bytes message.\n", tsc_div(cycles, MESSAGES), SIZE);
+    return 0;
+}
+
+int main(void)
+{
+    openlog("t_msgbench", LOG_CONS | LOG_PID, LOG_USER);
+
+    int msqid = msgget(IPC_PRIVATE, IPC_CREAT | S_IRUSR | S_IWUSR);
+    if (msqid < 0) {
+        syslog(LOG_ERR, "Failed to create the message queue.\n");
+        return EXIT_FAILURE;
+    }
+
+    int failures = test_types(msqid) + test_full(msqid) + test_interrupt(msqid) + bench_stream(msqid);
+
+    msgctl(msqid, IPC_RMID, NULL);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
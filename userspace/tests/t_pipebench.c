@@ -0,0 +1,221 @@
+/// @file t_pipebench.c
+/// @brief Tests the capacity of pipes, and measures their throughput.
+/// @details Checks that the capacity of a pipe can be changed with fcntl, that
+/// writes of up to PIPE_BUF bytes are atomic, that a page handed over to a pipe
+/// keeps the data it had when written, and that a signal interrupts a blocked
+/// reader. Then
+/// a producer streams data to a consumer, first with small writes, then with
+/// whole pages, which are given to the pipe instead of being copied.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <io/tsc.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#define PAGE   4096
+#define TOTAL  (1024 * 1024)
+#define SMALL  64
+#define BUFFER (4 * PAGE)
+
+/// @brief The data being written, aligned to a page so that it can be gifted.
+static char page[PAGE] __attribute__((aligned(PAGE)));
+/// @brief The buffer used to read.
+static char buffer[BUFFER];
+
+/// @brief Checks that the capacity of the pipe can be changed.
+/// @param fds the pipe, both ends are non-blocking.
+/// @return 0 on success, 1 on failure.
+static int test_size(int fds[2])
+{
+    if (fcntl(fds[1], F_GETPIPE_SZ, 0) != 16 * PAGE) {
+        syslog(LOG_ERR, "Expected a default capacity of %d bytes.\n", 16 * PAGE);
+        return 1;
+    }
+    // The data in the pipe does not fit a single buffer.
+    memset(page, 'x', PAGE);
+    write(fds[1], page, 100);
+    write(fds[1], page, PAGE);
+    if ((fcntl(fds[1], F_SETPIPE_SZ, PAGE) != -1) || (errno != EBUSY)) {
+        syslog(LOG_ERR, "Shrinking the pipe below its content should fail with EBUSY.\n");
+        return 1;
+    }
+    if (read(fds[0], buffer, BUFFER) != PAGE + 100) {
+        syslog(LOG_ERR, "Failed to drain the pipe.\n");
+        return 1;
+    }
+    // The capacity is rounded up to whole pages.
+    if (fcntl(fds[1], F_SETPIPE_SZ, 1) != PAGE) {
+        syslog(LOG_ERR, "Expected the capacity to be rounded up to a page.\n");
+        return 1;
+    }
+    if (write(fds[1], buffer, 2 * PAGE) != PAGE) {
+        syslog(LOG_ERR, "Expected a write to stop when the pipe is full.\n");
+        return 1;
+    }
+    if ((write(fds[1], buffer, 1) != -1) || (errno != EAGAIN)) {
+        syslog(LOG_ERR, "Writing to a full pipe should fail with EAGAIN.\n");
+        return 1;
+    }
+    read(fds[0], buffer, BUFFER);
+    return fcntl(fds[1], F_SETPIPE_SZ, 16 * PAGE) != 16 * PAGE;
+}
+
+/// @brief Checks that writes of up to PIPE_BUF bytes are not split.
+/// @param fds the pipe, both ends are non-blocking.
+/// @return 0 on success, 1 on failure.
+static int test_atomic(int fds[2])
+{
+    fcntl(fds[1], F_SETPIPE_SZ, PAGE);
+    write(fds[1], page, 100);
+    // Only part of the write would fit, so nothing is written.
+    if ((write(fds[1], page, PIPE_BUF) != -1) || (errno != EAGAIN)) {
+        syslog(LOG_ERR, "A write of PIPE_BUF bytes which does not fit should fail with EAGAIN.\n");
+        return 1;
+    }
+    if (read(fds[0], buffer, BUFFER) != 100) {
+        syslog(LOG_ERR, "Expected only the first write in the pipe.\n");
+        return 1;
+    }
+    if (write(fds[1], page, PIPE_BUF) != PIPE_BUF) {
+        syslog(LOG_ERR, "A write of PIPE_BUF bytes should fit in an empty pipe.\n");
+        return 1;
+    }
+    read(fds[0], buffer, BUFFER);
+    return fcntl(fds[1], F_SETPIPE_SZ, 16 * PAGE) != 16 * PAGE;
+}
+
+/// @brief Checks that a gifted page keeps the data it had when written.
+/// @param fds the pipe, both ends are non-blocking.
+/// @return 0 on success, 1 on failure.
+static int test_gift(int fds[2])
+{
+    memset(page, 'a', PAGE);
+    if (write(fds[1], page, PAGE) != PAGE) {
+        syslog(LOG_ERR, "Failed to write a whole page.\n");
+        return 1;
+    }
+    // The writer still owns its page, but changing it must not change the pipe.
+    memset(page, 'b', PAGE);
+    if (read(fds[0], buffer, BUFFER) != PAGE) {
+        syslog(LOG_ERR, "Failed to read a whole page.\n");
+        return 1;
+    }
+    for (int i = 0; i < PAGE; ++i) {
+        if (buffer[i] != 'a') {
+            syslog(LOG_ERR, "Found '%c' at %d, the pipe saw a later write.\n", buffer[i], i);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/// @brief Handles the alarm that interrupts the reader.
+/// @param sig the signal.
+static void alarm_handler(int sig) {}
+
+/// @brief Checks that a signal interrupts a reader waiting for data.
+/// @return 0 on success, 1 on failure.
+static int test_interrupt(void)
+{
+    int fds[2];
+    if (pipe(fds) < 0) {
+        syslog(LOG_ERR, "Failed to create the pipe.\n");
+        return 1;
+    }
+    sigaction_t action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = alarm_handler;
+    sigaction(SIGALRM, &action, NULL);
+    alarm(1);
+    int failed = (read(fds[0], buffer, BUFFER) != -1) || (errno != EINTR);
+    if (failed) {
+        syslog(LOG_ERR, "The alarm should have interrupted the reader with EINTR.\n");
+    }
+    close(fds[0]);
+    close(fds[1]);
+    return failed;
+}
+
+/// @brief Streams data from a producer to a consumer.
+/// @param chunk the size of each write.
+/// @return 0 on success, 1 on failure.
+static int bench_stream(int chunk)
+{
+    int fds[2];
+    if (pipe(fds) < 0) {
+        syslog(LOG_ERR, "Failed to create the pipe.\n");
+        return 1;
+    }
+    unsigned long expected = 0;
+    for (int i = 0; i < TOTAL / chunk; ++i) {
+        expected += (unsigned long)chunk * (i & 0x7F);
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        for (int i = 0; i < TOTAL / chunk; ++i) {
+            memset(page, i & 0x7F, chunk);
+            if (write(fds[1], page, chunk) != chunk) {
+                exit(EXIT_FAILURE);
+            }
+        }
+        close(fds[1]);
+        exit(EXIT_SUCCESS);
+    }
+    close(fds[1]);
+
+    unsigned long sum = 0;
+    size_t total      = 0;
+    ssize_t bytes;
+    unsigned long long start = rdtsc();
+    while ((bytes = read(fds[0], buffer, BUFFER)) > 0) {
+        for (ssize_t i = 0; i < bytes; ++i) {
+            sum += (unsigned char)buffer[i];
+        }
+        total += bytes;
+    }
+    unsigned long long cycles = rdtsc() - start;
+    close(fds[0]);
+
+    int status;
+    if ((waitpid(pid, &status, 0) != pid) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+        syslog(LOG_ERR, "The producer failed to write with chunks of %d bytes.\n", chunk);
+        return 1;
+    }
+    if ((total != TOTAL) || (sum != expected)) {
+        syslog(LOG_ERR, "Received %u bytes with sum %lu, expected %d with sum %lu.\n", total, sum, TOTAL, expected);
+        return 1;
+    }
+    printf("Pipe stream: %u cycles per KiB, with writes of %d bytes.\n", tsc_div(cycles, TOTAL / 1024), chunk);
+    return 0;
+}
+
+int main(void)
+{
+    openlog("t_pipebench", LOG_CONS | LOG_PID, LOG_USER);
+
+    int fds[2];
+    if (pipe(fds) < 0) {
+        syslog(LOG_ERR, "Failed to create the pipe.\n");
+        return EXIT_FAILURE;
+    }
+    if ((fcntl(fds[0], F_SETFL, O_NONBLOCK) < 0) || (fcntl(fds[1], F_SETFL, O_NONBLOCK) < 0)) {
+        syslog(LOG_ERR, "Failed to make the pipe non-blocking.\n");
+        return EXIT_FAILURE;
+    }
+    int failures = test_size(fds) + test_atomic(fds) + test_gift(fds);
+    close(fds[0]);
+    close(fds[1]);
+
+    failures += test_interrupt() + bench_stream(SMALL) + bench_stream(PAGE);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
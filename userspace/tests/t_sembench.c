@@ -0,0 +1,178 @@
+/// @file t_sembench.c
+/// @brief Tests blocking semaphores, and measures their throughput.
+/// @details Checks that the operations of a semop are applied all together or
+/// not at all, that waiting for zero works, that SEM_UNDO operations are
+/// reverted on exit, and that a waiting process can be killed. Then a producer and a consumer hand a token back and
+/// forth through two semaphores, sleeping while they wait for each other.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <io/tsc.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ipc.h>
+#include <sys/sem.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#define ROUNDS 2000
+#define POLLS  10000000
+
+/// @brief Performs a single operation on a semaphore.
+/// @param semid the semaphore set.
+/// @param num the semaphore.
+/// @param op the operation.
+/// @param flg the flags.
+/// @return the result of semop.
+static long sem_do(int semid, unsigned short num, short op, short flg)
+{
+    struct sembuf sop = {.sem_num = num, .sem_op = op, .sem_flg = flg};
+    return semop(semid, &sop, 1);
+}
+
+/// @brief Checks that two or more operations are applied all together or not at all.
+/// @param semid the semaphore set.
+/// @return 0 on success, 1 on failure.
+static int test_atomic(int semid)
+{
+    // The second operation cannot be performed, so neither is the first.
+    struct sembuf sops[2] = {
+        {.sem_num = 0, .sem_op = 1, .sem_flg = 0},
+        {.sem_num = 1, .sem_op = -1, .sem_flg = IPC_NOWAIT},
+    };
+    if ((semop(semid, sops, 2) != -1) || (errno != EAGAIN)) {
+        syslog(LOG_ERR, "The operations should have failed with EAGAIN.\n");
+        return 1;
+    }
+    if (semctl(semid, 0, GETVAL, NULL) != 0) {
+        syslog(LOG_ERR, "The first operation was applied, even if the second failed.\n");
+        return 1;
+    }
+    // Now both can be performed.
+    sops[1].sem_op = 0;
+    if ((semop(semid, sops, 2) != 0) || (semctl(semid, 0, GETVAL, NULL) != 1)) {
+        syslog(LOG_ERR, "The operations should have been applied.\n");
+        return 1;
+    }
+    return sem_do(semid, 0, -1, 0) != 0;
+}
+
+/// @brief Checks that a process can wait for a semaphore to become zero.
+/// @param semid the semaphore set.
+/// @return 0 on success, 1 on failure.
+static int test_zero(int semid)
+{
+    sem_do(semid, 0, 1, 0);
+    pid_t pid = fork();
+    if (pid == 0) {
+        exit(sem_do(semid, 0, 0, 0) ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+    // Wait for the child to go to sleep.
+    for (int i = 0; (i < POLLS) && (semctl(semid, 0, GETZCNT, NULL) == 0); ++i) {}
+    if (semctl(semid, 0, GETZCNT, NULL) != 1) {
+        syslog(LOG_ERR, "The child is not waiting for zero.\n");
+        return 1;
+    }
+    sem_do(semid, 0, -1, 0);
+    int status;
+    if ((waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+        syslog(LOG_ERR, "The child did not wake up when the semaphore became zero.\n");
+        return 1;
+    }
+    return semctl(semid, 0, GETZCNT, NULL) != 0;
+}
+
+/// @brief Checks that the SEM_UNDO operations are reverted on exit.
+/// @param semid the semaphore set.
+/// @return 0 on success, 1 on failure.
+static int test_undo(int semid)
+{
+    pid_t pid = fork();
+    if (pid == 0) {
+        sem_do(semid, 1, 3, SEM_UNDO);
+        sem_do(semid, 1, -1, SEM_UNDO);
+        sem_do(semid, 1, 1, 0);
+        exit(EXIT_SUCCESS);
+    }
+    waitpid(pid, NULL, 0);
+    // Only the operation without SEM_UNDO is left.
+    if (semctl(semid, 1, GETVAL, NULL) != 1) {
+        syslog(LOG_ERR, "Expected 1 after the child exited, found %ld.\n", semctl(semid, 1, GETVAL, NULL));
+        return 1;
+    }
+    return sem_do(semid, 1, -1, 0) != 0;
+}
+
+/// @brief Checks that a process waiting on a semaphore can be killed.
+/// @param semid the semaphore set.
+/// @return 0 on success, 1 on failure.
+static int test_kill(int semid)
+{
+    pid_t pid = fork();
+    if (pid == 0) {
+        sem_do(semid, 0, -1, 0);
+        exit(EXIT_SUCCESS);
+    }
+    // Wait for the child to go to sleep.
+    for (int i = 0; (i < POLLS) && (semctl(semid, 0, GETNCNT, NULL) == 0); ++i) {}
+    kill(pid, SIGKILL);
+    int status;
+    if ((waitpid(pid, &status, 0) != pid) || (WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_SUCCESS))) {
+        syslog(LOG_ERR, "The child waiting on the semaphore was not killed.\n");
+        return 1;
+    }
+    // The child does not wait anymore.
+    if (semctl(semid, 0, GETNCNT, NULL) != 0) {
+        syslog(LOG_ERR, "The killed child is still counted among the waiting ones.\n");
+        return 1;
+    }
+    return 0;
+}
+
+/// @brief Hands a token back and forth between a producer and a consumer.
+/// @param semid the semaphore set.
+/// @return 0 on success, 1 on failure.
+static int bench_pingpong(int semid)
+{
+    pid_t pid = fork();
+    if (pid == 0) {
+        for (int i = 0; i < ROUNDS; ++i) {
+            sem_do(semid, 0, -1, 0);
+            sem_do(semid, 1, 1, 0);
+        }
+        exit(EXIT_SUCCESS);
+    }
+    unsigned long long start = rdtsc();
+    for (int i = 0; i < ROUNDS; ++i) {
+        sem_do(semid, 0, 1, 0);
+        sem_do(semid, 1, -1, 0);
+    }
+    unsigned long long cycles = rdtsc() - start;
+    waitpid(pid, NULL, 0);
+    printf("Semaphore ping-pong: %u cycles per round trip.\n", tsc_div(cycles, ROUNDS));
+    if ((semctl(semid, 0, GETVAL, NULL) != 0) || (semctl(semid, 1, GETVAL, NULL) != 0)) {
+        syslog(LOG_ERR, "The semaphores should be back to zero.\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    openlog("t_sembench", LOG_CONS | LOG_PID, LOG_USER);
+
+    int semid = semget(IPC_PRIVATE, 2, IPC_CREAT | S_IRUSR | S_IWUSR);
+    if (semid < 0) {
+        syslog(LOG_ERR, "Failed to create the semaphore set.\n");
+        return EXIT_FAILURE;
+    }
+
+    int failures = test_atomic(semid) + test_zero(semid) + test_undo(semid) + test_kill(semid) + bench_pingpong(semid);
+
+    semctl(semid, 0, IPC_RMID, NULL);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,112 @@
+/// @file t_syscall.c
+/// @brief Measures the latency of system calls.
+/// @details Trivial system calls return without entering the scheduler, while
+/// `nice` asks for it explicitly, so the difference between the two is the
+/// cost of a reschedule on system call exit. The libc issues system calls with
+/// SYSENTER when available, which is compared with `int 0x80`. For each system
+/// call the best round is reported, to leave out the rounds hit by the timer
+/// tick. A SYSENTER with a bad user stack must only kill the process.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <io/tsc.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <syslog.h>
+#include <system/syscall_types.h>
+#include <unistd.h>
+
+#define ROUNDS     32
+#define ITERATIONS 256
+
+/// The libc stub issuing system calls with SYSENTER.
+extern void __syscall_sysenter(void);
+
+/// @brief Calls getpid.
+static void call_getpid(void) { getpid(); }
+
+/// @brief Calls getpid with `int 0x80`, regardless of what the libc uses.
+static void call_getpid_int80(void)
+{
+    int res;
+    __asm__ __volatile__("int $0x80" : "=a"(res) : "0"(__NR_getpid));
+}
+
+/// @brief Calls getppid.
+static void call_getppid(void) { getppid(); }
+
+/// @brief Calls nice without changing the priority.
+static void call_nice(void) { nice(0); }
+
+/// @brief Issues SYSENTER with the given user stack, in a child process.
+/// @param stack the value of ebp, which should point to the stub frame.
+/// @return 0 if the child is killed by SIGSEGV, 1 otherwise.
+static int test_bad_stack(unsigned stack)
+{
+    pid_t pid = fork();
+    if (pid == 0) {
+        // The kernel returns nowhere, since it cannot read the return address.
+        __asm__ __volatile__("mov %0, %%ebp; sysenter" : : "r"(stack), "a"(__NR_getpid) : "memory");
+        exit(EXIT_SUCCESS);
+    }
+    int status;
+    if ((waitpid(pid, &status, 0) != pid) || !WIFSIGNALED(status) || (WTERMSIG(status) != SIGSEGV)) {
+        syslog(LOG_ERR, "A SYSENTER with ebp = 0x%x should have been killed by SIGSEGV.\n", stack);
+        return 1;
+    }
+    return 0;
+}
+
+/// @brief Measures the latency of a system call.
+/// @param call the function performing the system call.
+/// @return the best number of cycles per call.
+static unsigned measure(void (*call)(void))
+{
+    unsigned best = ~0U;
+    for (int round = 0; round < ROUNDS; ++round) {
+        unsigned long long start = rdtsc();
+        for (int i = 0; i < ITERATIONS; ++i) {
+            call();
+        }
+        unsigned cycles = tsc_div(rdtsc() - start, ITERATIONS);
+        if (cycles < best) {
+            best = cycles;
+        }
+    }
+    return best;
+}
+
+int main(void)
+{
+    openlog("t_syscall", LOG_CONS | LOG_PID, LOG_USER);
+
+    // The fast path must still return the right values.
+    pid_t pid = getpid();
+    for (int i = 0; i < ITERATIONS; ++i) {
+        int res;
+        __asm__ __volatile__("int $0x80" : "=a"(res) : "0"(__NR_getpid));
+        if ((getpid() != pid) || (res != pid)) {
+            syslog(LOG_ERR, "getpid returned a different value at iteration %d.\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // A bad user stack must not bring down the kernel.
+    if ((__syscall_entry == __syscall_sysenter) && (test_bad_stack(0) || test_bad_stack(0xC0000000))) {
+        return EXIT_FAILURE;
+    }
+
+    unsigned fast_getpid  = measure(call_getpid);
+    unsigned int80_getpid = measure(call_getpid_int80);
+    unsigned fast_getppid = measure(call_getppid);
+    unsigned slow_nice    = measure(call_nice);
+
+    printf("System call latency (cycles per call):\n");
+    printf("    getpid  : %u\n", fast_getpid);
+    printf("    getpid  : %u (with int 0x80)\n", int80_getpid);
+    printf("    getppid : %u\n", fast_getppid);
+    printf("    nice(0) : %u (with reschedule)\n", slow_nice);
+    return EXIT_SUCCESS;
+}
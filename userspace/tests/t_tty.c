@@ -0,0 +1,87 @@
+/// @file t_tty.c
+/// @brief Tests the VMIN and VTIME settings of non-canonical terminal reads.
+/// @details Nobody types while the test runs: a read with VMIN = VTIME = 0
+/// must return immediately, while a read with VMIN = 0 and VTIME > 0 must
+/// sleep until the timeout expires, and then return nothing. A read with
+/// VMIN = 1 sleeps until an alarm interrupts it with EINTR.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/// @brief Reads from the terminal with the given VMIN and VTIME.
+/// @param raw the non-canonical settings.
+/// @param vmin the minimum number of bytes.
+/// @param vtime the timeout, in tenths of a second.
+/// @return the result of the read.
+static ssize_t read_with(const termios_t *raw, cc_t vmin, cc_t vtime)
+{
+    termios_t settings   = *raw;
+    settings.c_cc[VMIN]  = vmin;
+    settings.c_cc[VTIME] = vtime;
+    char buffer[16];
+    tcsetattr(STDIN_FILENO, 0, &settings);
+    return read(STDIN_FILENO, buffer, sizeof(buffer));
+}
+
+/// @brief Handles the alarm that interrupts the read.
+/// @param sig the signal.
+static void alarm_handler(int sig) {}
+
+int main(void)
+{
+    openlog("t_tty", LOG_CONS | LOG_PID, LOG_USER);
+
+    termios_t original;
+    if (tcgetattr(STDIN_FILENO, &original) < 0) {
+        syslog(LOG_INFO, "The standard input is not a terminal, skipping.\n");
+        return EXIT_SUCCESS;
+    }
+    termios_t raw = original;
+    raw.c_lflag &= ~(ICANON | ECHO | ISIG);
+
+    int status = EXIT_SUCCESS;
+
+    // A poll returns immediately.
+    if (read_with(&raw, 0, 0) != 0) {
+        syslog(LOG_ERR, "A read with VMIN = VTIME = 0 must return 0.\n");
+        status = EXIT_FAILURE;
+    }
+
+    // A timed read returns nothing once the two seconds have passed.
+    time_t start = time(NULL);
+    if (read_with(&raw, 0, 20) != 0) {
+        syslog(LOG_ERR, "A read with VMIN = 0 and VTIME = 20 must return 0.\n");
+        status = EXIT_FAILURE;
+    }
+    time_t elapsed = time(NULL) - start;
+    if ((elapsed < 1) || (elapsed > 4)) {
+        syslog(LOG_ERR, "The timed read returned after %d seconds instead of 2.\n", (int)elapsed);
+        status = EXIT_FAILURE;
+    }
+
+    // A signal interrupts a read waiting for a byte.
+    sigaction_t action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = alarm_handler;
+    if (sigaction(SIGALRM, &action, NULL) == -1) {
+        syslog(LOG_ERR, "Failed to set the handler for SIGALRM.\n");
+        status = EXIT_FAILURE;
+    } else {
+        alarm(1);
+        if ((read_with(&raw, 1, 0) != -1) || (errno != EINTR)) {
+            syslog(LOG_ERR, "The alarm should have interrupted the read with EINTR.\n");
+            status = EXIT_FAILURE;
+        }
+    }
+
+    tcsetattr(STDIN_FILENO, 0, &original);
+    return status;
+}
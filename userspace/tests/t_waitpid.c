@@ -0,0 +1,135 @@
+/// @file t_waitpid.c
+/// @brief Tests that waitpid sleeps in the kernel until a child changes state.
+/// @details While the parent waits, the child must get the whole CPU: it
+/// measures how long a fixed amount of work takes with and without the parent
+/// competing for the CPU. Then WNOHANG, WUNTRACED, waiting for a process
+/// which is not a child, and a wait interrupted by a signal are checked.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <io/tsc.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+
+#define WORK 4000000
+
+/// @brief Does some work.
+/// @return the number of cycles it took.
+static unsigned long long work(void)
+{
+    unsigned long long start = rdtsc();
+    for (volatile int i = 0; i < WORK; ++i) {}
+    return rdtsc() - start;
+}
+
+/// @brief Counts the signals received by the parent.
+static volatile int interrupted = 0;
+
+/// @brief Handles the signal that interrupts the wait.
+/// @param sig the signal.
+static void sig_handler(int sig) { ++interrupted; }
+
+/// @brief Forks a child that does some work and exits with the given code.
+/// @param code the exit code.
+/// @return the pid of the child.
+static pid_t spawn_worker(int code)
+{
+    pid_t pid = fork();
+    if (pid == 0) {
+        work();
+        exit(code);
+    }
+    return pid;
+}
+
+int main(void)
+{
+    openlog("t_waitpid", LOG_CONS | LOG_PID, LOG_USER);
+
+    // The time it takes to do the work when nobody else runs.
+    unsigned long long alone = work();
+
+    // A child doing the same work, while we wait.
+    pid_t pid = spawn_worker(42);
+    if (pid < 0) {
+        syslog(LOG_ERR, "Failed to fork.\n");
+        return EXIT_FAILURE;
+    }
+    // The child has just started, it cannot have exited yet.
+    int status = -1;
+    if (waitpid(pid, &status, WNOHANG) != 0) {
+        syslog(LOG_ERR, "WNOHANG must return 0 while the child runs.\n");
+        return EXIT_FAILURE;
+    }
+    unsigned long long start  = rdtsc();
+    pid_t collected           = waitpid(pid, &status, 0);
+    unsigned long long waited = rdtsc() - start;
+    if ((collected != pid) || !WIFEXITED(status) || (WEXITSTATUS(status) != 42)) {
+        syslog(LOG_ERR, "Expected child %d to exit with 42, got %d (status 0x%x).\n", pid, collected, status);
+        return EXIT_FAILURE;
+    }
+    // If we spun while waiting, the child would have taken about twice as long.
+    if (waited > alone + alone / 2) {
+        syslog(
+            LOG_ERR, "The child took %u kcycles instead of %u, the parent was not sleeping.\n", tsc_div(waited, 1000),
+            tsc_div(alone, 1000));
+        return EXIT_FAILURE;
+    }
+
+    // Nothing left to wait for.
+    if ((waitpid(-1, &status, 0) != -1) || (errno != ECHILD)) {
+        syslog(LOG_ERR, "Waiting without children must fail with ECHILD.\n");
+        return EXIT_FAILURE;
+    }
+    if ((waitpid(1, &status, 0) != -1) || (errno != ECHILD)) {
+        syslog(LOG_ERR, "Waiting for a process which is not a child must fail with ECHILD.\n");
+        return EXIT_FAILURE;
+    }
+
+    // A child that stops itself is reported with WUNTRACED.
+    pid = fork();
+    if (pid == 0) {
+        kill(getpid(), SIGSTOP);
+        exit(7);
+    }
+    if ((waitpid(pid, &status, WUNTRACED) != pid) || !WIFSTOPPED(status) || (WSTOPSIG(status) != SIGSTOP)) {
+        syslog(LOG_ERR, "Expected child %d to be reported as stopped (status 0x%x).\n", pid, status);
+        return EXIT_FAILURE;
+    }
+    kill(pid, SIGCONT);
+    if ((waitpid(pid, &status, WUNTRACED) != pid) || !WIFEXITED(status) || (WEXITSTATUS(status) != 7)) {
+        syslog(LOG_ERR, "Expected child %d to exit with 7 (status 0x%x).\n", pid, status);
+        return EXIT_FAILURE;
+    }
+
+    // A signal sent while we wait interrupts the wait.
+    sigaction_t action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = sig_handler;
+    if (sigaction(SIGUSR1, &action, NULL) == -1) {
+        syslog(LOG_ERR, "Failed to set the handler for SIGUSR1.\n");
+        return EXIT_FAILURE;
+    }
+    pid = fork();
+    if (pid == 0) {
+        work();
+        kill(getppid(), SIGUSR1);
+        work();
+        exit(9);
+    }
+    if ((waitpid(pid, &status, 0) != -1) || (errno != EINTR) || (interrupted != 1)) {
+        syslog(LOG_ERR, "Expected the wait to fail with EINTR once the signal is handled.\n");
+        return EXIT_FAILURE;
+    }
+    if ((waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) || (WEXITSTATUS(status) != 9)) {
+        syslog(LOG_ERR, "Expected child %d to exit with 9 (status 0x%x).\n", pid, status);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}